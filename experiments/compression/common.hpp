@@ -155,6 +155,8 @@ run(config c, std::ostream& os) {
 
     __GENERATE_CASE(bah)
     __GENERATE_CASE(partitioned_bah)
+
+    __GENERATE_CASE(partitioned_adaptive)
 #undef __GENERATE_CASE
   }
 }
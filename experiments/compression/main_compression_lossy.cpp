@@ -0,0 +1,119 @@
+#include "common.hpp"
+#include "experiments/util/gen.hpp"
+
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+#include <dtl/dtl.hpp>
+
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Experiment: Compression ratios of lossy TEBs for varying (target)
+//             false-positive rates.
+//===----------------------------------------------------------------------===//
+struct config_t {
+  $u64 n;
+  $f64 bit_density;
+  $f64 clustering_factor;
+  $f64 fpr;
+
+  void
+  print(std::ostream& os) const {
+    os << "config[n=" << n
+       << ",d=" << bit_density
+       << ",f=" << clustering_factor
+       << ",fpr=" << fpr
+       << "]";
+  }
+};
+//===----------------------------------------------------------------------===//
+void run(const config_t& config, std::ostream& os) {
+  $f64 size_teb = 0;
+  $f64 size_teb_lossy = 0;
+  $f64 size_roaring = 0;
+  $f64 actual_fpr = 0;
+
+  // # of runs
+  for ($u64 r = 0; r < RUNS; r++) {
+    auto bm = gen_random_bitmap_markov(config.n,
+        config.clustering_factor,
+        config.bit_density);
+
+    dtl::dynamic_roaring_bitmap roaring(bm);
+    size_roaring += roaring.size_in_bytes();
+    dtl::teb_wrapper teb(bm);
+    size_teb += teb.size_in_bytes();
+    dtl::teb_wrapper teb_lossy(bm, config.fpr);
+    size_teb_lossy += teb_lossy.size_in_bytes();
+
+    // Validation. - A lossy TEB must not contain false negatives.
+    const auto dec = dtl::to_bitmap_using_iterator(teb_lossy);
+    if ((bm & ~dec).any()) {
+      std::cerr << "Validation failed. (TEB lossy)" << std::endl;
+      std::exit(1);
+    }
+    const auto zero_cnt = bm.size() - bm.count();
+    if (zero_cnt > 0) {
+      actual_fpr += static_cast<f64>((dec & ~bm).count()) / zero_cnt;
+    }
+  }
+
+  std::stringstream out;
+  out << config.n / 8 / 1024.0
+      << "," << config.bit_density
+      << "," << config.clustering_factor
+      << "," << config.fpr
+      << "," << actual_fpr / RUNS
+      << "," << (size_teb / RUNS) / 1024.0
+      << "," << (size_teb_lossy / RUNS) / 1024.0
+      << "," << (size_roaring / RUNS) / 1024.0
+      << std::endl;
+  os << out.str();
+}
+//===----------------------------------------------------------------------===//
+$i32 main() {
+  std::vector<$u64> n_s { 1ull << 20 };
+  std::vector<$f64> clustering_factors { 8 };
+  std::vector<$f64> bit_densities { 0.001, 0.01, 0.1 };
+  std::vector<$f64> fprs { 0.0, 0.0001, 0.001, 0.01, 0.05, 0.1, 0.2, 0.5 };
+
+  std::vector<config_t> configs;
+  for (auto n : n_s) {
+    for (auto d : bit_densities) {
+      for (auto f : clustering_factors) {
+        if (f > n * d) {
+          std::stringstream err;
+          err << "Skipping n=" << n << ", d=" << d << ", f=" << f << "."
+              << std::endl;
+          std::cerr << err.str();
+          continue;
+        }
+        for (auto fpr : fprs) {
+          config_t c;
+          c.n = n;
+          c.bit_density = d;
+          c.clustering_factor = f;
+          c.fpr = fpr;
+          configs.push_back(c);
+        }
+      }
+    }
+  }
+
+  std::function<void(const config_t&, std::ostream&)> fn =
+      [](const config_t c, std::ostream& os) -> void {
+    try {
+      run(c, os);
+    }
+    catch (...) {
+      std::stringstream err;
+      err << "Failed to run " << c << "." << std::endl;
+      std::cerr << err.str();
+    }
+  };
+  dispatch<config_t>(configs, fn);
+}
+//===----------------------------------------------------------------------===//
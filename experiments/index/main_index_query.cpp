@@ -0,0 +1,278 @@
+#include "experiments/util/seq_db.hpp"
+#include "experiments/util/threading.hpp"
+#include "version.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/bitwise_count.hpp>
+#include <dtl/bitmap/index/bit_sliced_index.hpp>
+#include <dtl/bitmap/index/equality_encoded_index.hpp>
+#include <dtl/bitmap/index/range_encoded_index.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/random.hpp>
+#include <dtl/dtl.hpp>
+#include <dtl/env.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <ostream>
+#include <random>
+#include <string>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Experiment: Measure the query latency and the size of equality-encoded,
+//             range-encoded and bit-sliced bitmap indexes (TEBs), constructed
+//             from the random integer sequences of the index compression
+//             experiment. Thereby varying the parameters c and f, where c
+//             refers to the number of distinct values.
+//===----------------------------------------------------------------------===//
+
+//===----------------------------------------------------------------------===//
+// The number of independent runs.
+static constexpr u64 RUNS = 10;
+// The number of queries per query type.
+static u64 QUERY_CNT = dtl::env<$u64>::get("QUERY_CNT", 100);
+// The density of the filter bitmap.
+static f64 FILTER_DENSITY = dtl::env<$f64>::get("FILTER_DENSITY", 0.1);
+// Identifies the benchmark run.
+static const i64 RUN_ID =
+    std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch())
+        .count();
+// The data set.
+static const std::string DB_FILE =
+    dtl::env<std::string>::get("DB_FILE", "./random_sequences.sqlite3");
+static seq_db db(DB_FILE);
+
+//===----------------------------------------------------------------------===//
+/// The index encodings.
+enum class index_t {
+  equality,
+  range,
+  bit_sliced,
+
+  _first = equality,
+  _last = bit_sliced
+};
+//===----------------------------------------------------------------------===//
+// An instance of config contains all information to run a single measurement.
+struct config {
+  /// Sequence ID (in the database).
+  $u64 seq_id;
+  /// The index encoding.
+  index_t index_type;
+  /// Total number of elements.
+  $u64 n;
+  /// Attribute cardinality (# of distinct values).
+  $u32 c;
+  /// Clustering factor.
+  $f64 f;
+};
+//===----------------------------------------------------------------------===//
+static u64
+now_nanos() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+//===----------------------------------------------------------------------===//
+/// Returns the number of qualifying rows.
+template<typename iter_t>
+static std::size_t
+consume(iter_t&& it) {
+  std::size_t cnt = 0;
+  while (!it.end()) {
+    cnt += it.length();
+    it.next();
+  }
+  return cnt;
+}
+//===----------------------------------------------------------------------===//
+template<typename T>
+void __attribute__((noinline))
+run(const config& conf, std::ostream& os) {
+  // Load the integer values.
+  const auto values = db.get(conf.seq_id);
+  if (values.size() != conf.n) {
+    std::cerr << "Validation failed. Number of values does not match."
+              << std::endl;
+    std::exit(1);
+  }
+
+  // Construct the bitmap index.
+  const T idx(values, conf.c);
+
+  // The filter, e.g., the result of a predicate on another column.
+  const auto filter_bm = dtl::gen_random_bitmap_markov(conf.n, 8.0,
+      FILTER_DENSITY);
+  const dtl::teb_wrapper filter(filter_bm);
+
+  // The query parameters.
+  std::mt19937 gen(conf.seq_id);
+  std::vector<$u64> points(QUERY_CNT);
+  std::vector<$u64> range_begins(QUERY_CNT);
+  const u64 range_length = std::max(u32(1), conf.c / 10);
+  for (std::size_t i = 0; i < QUERY_CNT; ++i) {
+    points[i] = gen() % conf.c;
+    range_begins[i] = gen() % conf.c;
+  }
+
+  // Validation code.
+  {
+    const auto v = points[0];
+    const auto lo = range_begins[0];
+    const auto hi = lo + range_length - 1;
+    std::size_t expected_eq = 0;
+    std::size_t expected_lt = 0;
+    std::size_t expected_between = 0;
+    $u64 expected_sum = 0;
+    for (std::size_t i = 0; i < conf.n; ++i) {
+      if (!filter_bm[i]) continue;
+      expected_eq += values[i] == v;
+      expected_lt += values[i] < v;
+      expected_between += values[i] >= lo && values[i] <= hi;
+      expected_sum += values[i];
+    }
+    if (consume(idx.eq(v, filter)) != expected_eq
+        || consume(idx.lt(v, filter)) != expected_lt
+        || consume(idx.between(lo, hi, filter)) != expected_between
+        || idx.sum(filter) != expected_sum) {
+      std::cerr << "Validation failed: " << T::name() << ", seq_id="
+                << conf.seq_id << std::endl;
+      std::exit(1);
+    }
+  }
+
+  // The actual measurement.
+  std::size_t checksum = 0;
+  u64 eq_begin = now_nanos();
+  for (std::size_t i = 0; i < QUERY_CNT; ++i) {
+    checksum += consume(idx.eq(points[i], filter));
+  }
+  u64 lt_begin = now_nanos();
+  for (std::size_t i = 0; i < QUERY_CNT; ++i) {
+    checksum += consume(idx.lt(points[i], filter));
+  }
+  u64 between_begin = now_nanos();
+  for (std::size_t i = 0; i < QUERY_CNT; ++i) {
+    checksum += consume(idx.between(range_begins[i],
+        range_begins[i] + range_length - 1, filter));
+  }
+  u64 sum_begin = now_nanos();
+  for (std::size_t i = 0; i < QUERY_CNT; ++i) {
+    checksum += idx.sum(filter);
+  }
+  u64 sum_end = now_nanos();
+
+  std::string type_info = idx.info();
+  boost::replace_all(type_info, "\"", "\"\""); // Escape JSON for CSV output.
+
+  // Print results.
+  os << RUN_ID
+     << ",\"" << BUILD_ID << "\""
+     << "," << conf.n
+     << "," << conf.c
+     << "," << conf.f
+     << "," << conf.seq_id
+     << "," << T::name()
+     << "," << idx.size_in_bytes()
+     << "," << idx.bitmap_cnt()
+     << "," << FILTER_DENSITY
+     << "," << (lt_begin - eq_begin) / QUERY_CNT
+     << "," << (between_begin - lt_begin) / QUERY_CNT
+     << "," << (sum_begin - between_begin) / QUERY_CNT
+     << "," << (sum_end - sum_begin) / QUERY_CNT
+     << ","
+     << "\"" << type_info << "\""
+     << "," << checksum
+     << std::endl;
+}
+//===----------------------------------------------------------------------===//
+void bmi_query_benchmark(const config& conf, std::ostream& os) {
+  switch (conf.index_type) {
+    case index_t::equality:
+      run<dtl::equality_encoded_index<dtl::teb_wrapper>>(conf, os);
+      break;
+    case index_t::range:
+      run<dtl::range_encoded_index<dtl::teb_wrapper>>(conf, os);
+      break;
+    case index_t::bit_sliced:
+      run<dtl::bit_sliced_index<dtl::teb_wrapper>>(conf, os);
+      break;
+  }
+}
+//===----------------------------------------------------------------------===//
+$i32 main() {
+  // Prepare benchmark settings.
+  u64 n = 1ull << 20;
+
+  std::cerr << "run_id=" << RUN_ID << std::endl;
+  std::cerr << "build_id=" << BUILD_ID << std::endl;
+  std::vector<$f64> clustering_factors;
+  for ($f64 f = 1; f <= 128; f *= 4) {
+    clustering_factors.push_back(f);
+  }
+
+  std::vector<$u32> cardinalities;
+  for ($u32 c = 8; c <= 8192; c *= 4) {
+    cardinalities.push_back(c);
+  }
+
+  if (db.empty()) {
+    std::cerr << "Integer sequence database is empty. Use GEN_DATA=1 with "
+                 "ex_index_compression to populate the database."
+              << std::endl;
+    std::exit(1);
+  }
+
+  std::vector<config> configs;
+  for (auto f : clustering_factors) {
+    for (auto c : cardinalities) {
+      if (c * f >= n / 4) continue;
+
+      config conf;
+      conf.n = n;
+      conf.c = c;
+      conf.f = f;
+
+      auto seq_ids = db.find(n, c, f);
+      if (seq_ids.empty()) {
+        continue;
+      }
+      if (seq_ids.size() < RUNS) {
+        std::cerr << "There are only " << seq_ids.size() << " prepared "
+                  << "sequences for the parameters n=" << n << ", c=" << c
+                  << ", f=" << f << ", but " << RUNS << " are required."
+                  << std::endl;
+      }
+      for (auto seq_id : seq_ids) {
+        conf.seq_id = seq_id;
+        for (auto index_type = static_cast<int>(index_t::_first);
+             index_type <= static_cast<int>(index_t::_last);
+             ++index_type) {
+          conf.index_type = static_cast<index_t>(index_type);
+          configs.push_back(conf);
+        }
+      }
+    }
+  }
+
+  {
+    // Shuffle the configurations to better predict the overall runtime of the
+    // benchmark.
+    std::random_device rd;
+    std::mt19937 gen(rd());
+    std::shuffle(configs.begin(), configs.end(), gen);
+  }
+
+  // Run the actual benchmark.
+  std::function<void(const config&, std::ostream&)> fn =
+      [&](const config conf, std::ostream& os) -> void {
+    bmi_query_benchmark(conf, os);
+  };
+  const auto thread_cnt = 1; // run performance measurements single-threaded
+  dispatch(configs, fn, thread_cnt);
+}
+//===----------------------------------------------------------------------===//
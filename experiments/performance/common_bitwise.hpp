@@ -1,6 +1,7 @@
 #pragma once
 //===----------------------------------------------------------------------===//
 #include "common.hpp"
+#include "thirdparty/perfevent/PerfEvent.hpp"
 
 #include <dtl/bitmap/bitwise_operations.hpp>
 //===----------------------------------------------------------------------===//
@@ -57,6 +58,9 @@ run_intersect(const config_pair& c, std::ostream& os) {
   $u64 runtime_cycles_scan_it = 0;
   $u64 runtime_nanos_skip_it = 0;
   $u64 runtime_cycles_skip_it = 0;
+  // Cache misses per intersection (skip iterator only).
+  $f64 l1_misses_skip_it = 0;
+  $f64 llc_misses_skip_it = 0;
 
   {
     std::size_t pos_sink = 0;
@@ -94,6 +98,8 @@ run_intersect(const config_pair& c, std::ostream& os) {
     // Re-run the experiment with the other iterator.
     std::size_t pos_sink = 0;
     std::size_t length_sink = 0;
+    PerfEvent e;
+    e.startCounters();
     const auto nanos_begin = now_nanos();
     const auto tsc_begin = _rdtsc();
     std::size_t rep_cntr = 0;
@@ -109,9 +115,12 @@ run_intersect(const config_pair& c, std::ostream& os) {
     }
     const auto tsc_end = _rdtsc();
     const auto nanos_end = now_nanos();
+    e.stopCounters();
 
     runtime_nanos_skip_it = (nanos_end - nanos_begin) / rep_cntr;
     runtime_cycles_skip_it = (tsc_end - tsc_begin) / rep_cntr;
+    l1_misses_skip_it = e.getCounter("L1-misses") / rep_cntr;
+    llc_misses_skip_it = e.getCounter("LLC-misses") / rep_cntr;
     checksum += pos_sink + length_sink;
   }
 
@@ -144,6 +153,8 @@ run_intersect(const config_pair& c, std::ostream& os) {
      << "\"" << type_info1 << "\""
      << ","
      << "\"" << type_info2 << "\""
+     << "," << l1_misses_skip_it
+     << "," << llc_misses_skip_it
      << "," << checksum
      << std::endl;
 }
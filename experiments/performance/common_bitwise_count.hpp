@@ -0,0 +1,142 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "common.hpp"
+
+#include <dtl/bitmap/bitwise_count.hpp>
+#include <dtl/bitmap/bitwise_operations.hpp>
+//===----------------------------------------------------------------------===//
+/// Repeatedly evaluates the given function for (at least) RUN_DURATION_NANOS
+/// and returns the number of evaluations per second.
+template<typename Fn>
+f64 __attribute__((noinline))
+measure_counts_per_second(Fn&& fn, std::size_t& checksum) {
+  const auto duration_nanos = RUN_DURATION_NANOS;
+  const std::size_t MIN_REPS = 10;
+  std::size_t cnt_sink = 0;
+  const auto nanos_begin = now_nanos();
+  std::size_t rep_cntr = 0;
+  while (now_nanos() - nanos_begin < duration_nanos
+      || rep_cntr < MIN_REPS) {
+    ++rep_cntr;
+    cnt_sink += fn();
+  }
+  const auto nanos_end = now_nanos();
+  checksum += cnt_sink;
+  return rep_cntr / ((nanos_end - nanos_begin) / 1e9);
+}
+//===----------------------------------------------------------------------===//
+template<typename T>
+void __attribute__((noinline))
+run_intersect_count(const config_pair& c, std::ostream& os) {
+  // Load the bitmap from DB.
+  const auto bs1 = db.load_bitmap(c.bitmap_id1);
+  const auto bs2 = db.load_bitmap(c.bitmap_id2);
+  // Encode the bitmap.
+  const T enc_bs1(bs1);
+  const T enc_bs2(bs2);
+
+  // The baseline, which produces the resulting runs and adds up their lengths.
+  const auto and_count_it = [&]() {
+    std::size_t cnt = 0;
+    auto result_it = dtl::bitwise_and_it(enc_bs1.scan_it(), enc_bs2.it());
+    while (!result_it.end()) {
+      cnt += result_it.length();
+      result_it.next();
+    }
+    return cnt;
+  };
+  const auto and_count = [&]() { return dtl::and_count(enc_bs1, enc_bs2); };
+  const auto or_count = [&]() { return dtl::or_count(enc_bs1, enc_bs2); };
+  const auto xor_count = [&]() { return dtl::xor_count(enc_bs1, enc_bs2); };
+
+  // Validation code.
+  {
+    if (and_count_it() != (bs1 & bs2).count()
+        || and_count() != (bs1 & bs2).count()
+        || or_count() != (bs1 | bs2).count()
+        || xor_count() != (bs1 ^ bs2).count()) {
+      std::cerr << "Validation failed: " << c << std::endl;
+      std::exit(1);
+    }
+  }
+
+  // Warm up run
+  std::size_t checksum = 0;
+  checksum += and_count_it();
+  checksum += and_count();
+
+  // The actual measurement.
+  const auto counts_per_sec_and_it =
+      measure_counts_per_second(and_count_it, checksum);
+  const auto counts_per_sec_and =
+      measure_counts_per_second(and_count, checksum);
+  const auto counts_per_sec_or =
+      measure_counts_per_second(or_count, checksum);
+  const auto counts_per_sec_xor =
+      measure_counts_per_second(xor_count, checksum);
+
+  std::string type_info1 = enc_bs1.info();
+  boost::replace_all(type_info1, "\"", "\"\""); // Escape JSON for CSV output.
+  std::string type_info2 = enc_bs2.info();
+  boost::replace_all(type_info2, "\"", "\"\""); // Escape JSON for CSV output.
+
+  os << RUN_ID
+     << ",\"" << BUILD_ID << "\""
+     << "," << c.n
+     << "," << T::name()
+     << "," << counts_per_sec_and_it
+     << "," << counts_per_sec_and
+     << "," << counts_per_sec_or
+     << "," << counts_per_sec_xor
+     << "," << c.density1
+     << "," << c.density2
+     << "," << dtl::determine_bit_density(bs1)
+     << "," << dtl::determine_bit_density(bs2)
+     << "," << c.clustering_factor1
+     << "," << c.clustering_factor2
+     << "," << dtl::determine_clustering_factor(bs1)
+     << "," << dtl::determine_clustering_factor(bs2)
+     << "," << c.bitmap_id1
+     << "," << c.bitmap_id2
+     << "," << enc_bs1.size_in_bytes()
+     << "," << enc_bs2.size_in_bytes()
+     << ","
+     << "\"" << type_info1 << "\""
+     << ","
+     << "\"" << type_info2 << "\""
+     << "," << checksum
+     << std::endl;
+}
+//===----------------------------------------------------------------------===//
+void run_intersect_count(config_pair c, std::ostream& os) {
+  switch (c.bitmap_type) {
+    case bitmap_t::bitmap:
+      run_intersect_count<dtl::dynamic_bitmap<$u32>>(c, os);
+      break;
+    case bitmap_t::roaring:
+      run_intersect_count<dtl::dynamic_roaring_bitmap>(c, os);
+      break;
+    case bitmap_t::wah:
+      run_intersect_count<dtl::dynamic_wah32>(c, os);
+      break;
+    case bitmap_t::teb_wrapper:
+      run_intersect_count<dtl::teb_wrapper>(c, os);
+      break;
+    case bitmap_t::partitioned_teb_wrapper:
+      run_intersect_count<type_of<bitmap_t::partitioned_teb_wrapper>::type>(
+          c, os);
+      break;
+    default:
+      break;
+  }
+}
+//===----------------------------------------------------------------------===//
+void run_intersect_count(const std::vector<config_pair>& configs) {
+  std::function<void(const config_pair&, std::ostream&)> fn =
+      [](const config_pair c, std::ostream& os) -> void {
+    run_intersect_count(c, os);
+  };
+  const auto thread_cnt = 1; // run performance measurements single-threaded
+  dispatch(configs, fn, thread_cnt);
+}
+//===----------------------------------------------------------------------===//
@@ -0,0 +1,104 @@
+#include "thirdparty/perfevent/PerfEvent.hpp"
+
+#include <dtl/bitmap/teb_probe.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/random.hpp>
+#include <dtl/dtl.hpp>
+#include <dtl/env.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Micro-Experiment: Determine the throughput of point lookups on many small
+//                   TEBs (e.g., one per group), evaluated one after another
+//                   vs. interleaved with a varying number of streams.
+//===----------------------------------------------------------------------===//
+/// The number of TEBs.
+static const std::size_t TEB_CNT = dtl::env<$u64>::get("TEB_CNT", 4096);
+/// The length of each bitmap.
+static const std::size_t N = dtl::env<$u64>::get("N", 1ull << 16);
+/// The number of lookups per batch.
+static const std::size_t PROBE_CNT = dtl::env<$u64>::get("PROBE_CNT", 1ull << 16);
+/// The bit densities we test.
+std::vector<$f64> bit_densities = { 0.001, 0.01, 0.1 };
+/// The clustering factors we test.
+std::vector<$f64> clustering_factors = { 1.0, 8.0 };
+/// Each measurement is repeated until the time below is elapsed.
+static $u64 RUN_DURATION_NANOS = 250e6; // 250ms
+//===----------------------------------------------------------------------===//
+// Helper
+auto now_nanos = []() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+};
+//===----------------------------------------------------------------------===//
+/// Runs the lookups using the given number of streams. A stream count of 0
+/// refers to the sequential evaluation.
+void
+run(f64 f, f64 d, const std::vector<dtl::teb_probe>& probes,
+    std::size_t stream_cnt) {
+  std::unique_ptr<$u1[]> results(new $u1[probes.size()]);
+  const auto nanos_begin = now_nanos();
+  const auto nanos_end = nanos_begin + RUN_DURATION_NANOS;
+  std::size_t repeat_cnt = 0;
+  std::size_t chksum = 0;
+  PerfEvent e;
+  e.startCounters();
+  while (now_nanos() < nanos_end) {
+    ++repeat_cnt;
+    if (stream_cnt == 0) {
+      dtl::teb_probe_executor::test_sequential(probes.data(), results.get(),
+          probes.size());
+    }
+    else {
+      dtl::teb_probe_executor::test(probes.data(), results.get(),
+          probes.size(), stream_cnt);
+    }
+    chksum += results[repeat_cnt % probes.size()];
+  }
+  e.stopCounters();
+  const auto nanos = now_nanos() - nanos_begin;
+  const auto probe_cnt = probes.size() * repeat_cnt;
+
+  std::cout << TEB_CNT << "," << N << "," << f << "," << d
+            << "," << stream_cnt
+            << "," << (nanos * 1.0 / probe_cnt)
+            << "," << (e.getCounter("cycles") / probe_cnt)
+            << "," << (e.getCounter("L1-misses") / probe_cnt)
+            << "," << chksum
+            << std::endl;
+}
+//===----------------------------------------------------------------------===//
+$i32 main() {
+  // CSV header
+  std::cerr << "teb_cnt,n,f,d,stream_cnt,nanos_per_probe,cycles_per_probe,"
+               "l1_misses_per_probe,dontcare"
+            << std::endl;
+  std::mt19937 gen(42);
+  for (auto f : clustering_factors) {
+    for (auto d : bit_densities) {
+      std::vector<std::unique_ptr<dtl::teb_wrapper>> tebs;
+      for (std::size_t i = 0; i < TEB_CNT; ++i) {
+        const auto bm = dtl::gen_random_bitmap_markov(N, f, d);
+        tebs.emplace_back(std::make_unique<dtl::teb_wrapper>(bm));
+      }
+      std::vector<dtl::teb_probe> probes;
+      probes.reserve(PROBE_CNT);
+      for (std::size_t i = 0; i < PROBE_CNT; ++i) {
+        probes.push_back(tebs[gen() % TEB_CNT]->probe(gen() % N));
+      }
+      run(f, d, probes, 0);
+      for (std::size_t stream_cnt = 1;
+           stream_cnt <= dtl::teb_probe_executor::max_stream_cnt;
+           stream_cnt *= 2) {
+        run(f, d, probes, stream_cnt);
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
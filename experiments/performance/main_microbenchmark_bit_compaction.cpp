@@ -0,0 +1,143 @@
+#include "experiments/util/gen.hpp"
+#include "thirdparty/perfevent/PerfEvent.hpp"
+
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/bit_compact.hpp>
+#include <dtl/dtl.hpp>
+#include <dtl/env.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Micro-Experiment: Determine the throughput of the bit-compaction kernels
+//                   (which replace PEXT in the bitmap tree) and the resulting
+//                   TEB construction throughput.
+//===----------------------------------------------------------------------===//
+/// The number of 64-bit words processed by the kernel benchmark.
+static const std::size_t WORD_CNT =
+    dtl::env<$u64>::get("WORD_CNT", 1ull << 12);
+/// The bitmap length used for the construction benchmark.
+static const std::size_t N = dtl::env<$u64>::get("N", 1ull << 20);
+/// The bit densities we test.
+std::vector<$f64> bit_densities = { 0.0001, 0.001, 0.01, 0.1, 0.5 };
+/// The clustering factors we test.
+std::vector<$f64> clustering_factors = { 1.0, 8.0, 64.0 };
+/// Each measurement is repeated until the time below is elapsed.
+static $u64 RUN_DURATION_NANOS = 250e6; // 250ms
+//===----------------------------------------------------------------------===//
+// Helper
+auto now_nanos = []() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+};
+//===----------------------------------------------------------------------===//
+using kernel_fn = void (*)(const $u64*, const $u64*, $u32*);
+//===----------------------------------------------------------------------===//
+#ifdef __BMI2__
+/// The PEXT based implementation (the baseline).
+void
+compact_even_bits_pext(const $u64* src_begin, const $u64* src_end, $u32* dst) {
+  const std::size_t word_cnt = src_end - src_begin;
+  for (std::size_t i = 0; i < word_cnt; ++i) {
+    u64 w = src_begin[i];
+    dst[i] = static_cast<$u32>(_pext_u64(w | (w >> 1), 0x5555555555555555ull));
+  }
+}
+#endif
+//===----------------------------------------------------------------------===//
+void
+run_kernel(const std::string& name, kernel_fn fn) {
+  std::vector<$u64> src(WORD_CNT);
+  std::mt19937_64 gen(42);
+  for (auto& w : src) w = gen();
+  std::vector<$u32> dst(WORD_CNT);
+
+  const auto nanos_begin = now_nanos();
+  const auto nanos_end = nanos_begin + RUN_DURATION_NANOS;
+  std::size_t repeat_cnt = 0;
+  std::size_t chksum = 0;
+  PerfEvent e;
+  e.startCounters();
+  while (now_nanos() < nanos_end) {
+    ++repeat_cnt;
+    fn(src.data(), src.data() + src.size(), dst.data());
+    chksum += dst[repeat_cnt % WORD_CNT];
+  }
+  e.stopCounters();
+  const auto nanos = now_nanos() - nanos_begin;
+  const auto word_cnt = WORD_CNT * repeat_cnt;
+
+  std::cout << "kernel"
+            << "," << name
+            << "," << (e.getCounter("cycles") / word_cnt)
+            << "," << (e.getCounter("instructions") / word_cnt)
+            << "," << (word_cnt * 1.0 / nanos) // words per nanosecond
+            << "," << chksum
+            << std::endl;
+}
+//===----------------------------------------------------------------------===//
+void
+run_construction(f64 f, f64 d) {
+  const auto plain_bitmap = gen_random_bitmap_markov(N, f, d);
+
+  const auto nanos_begin = now_nanos();
+  const auto nanos_end = nanos_begin + RUN_DURATION_NANOS;
+  std::size_t repeat_cnt = 0;
+  std::size_t chksum = 0;
+  PerfEvent e;
+  e.startCounters();
+  while (now_nanos() < nanos_end) {
+    ++repeat_cnt;
+    dtl::teb_wrapper enc_bitmap(plain_bitmap);
+    chksum += enc_bitmap.size_in_bytes();
+  }
+  e.stopCounters();
+  const auto nanos = now_nanos() - nanos_begin;
+
+  std::cout << "construction"
+            << "," << N << "," << f << "," << d
+            << "," << (e.getCounter("cycles") / repeat_cnt)
+            << "," << (e.getCounter("instructions") / repeat_cnt)
+            << "," << ((N * repeat_cnt) / 1024.0 / 1024.0)
+                / (nanos / 1e9) // Mbit/s
+            << "," << chksum
+            << std::endl;
+}
+//===----------------------------------------------------------------------===//
+$i32 main() {
+  using bc = dtl::bit_compact;
+  using op = bc::pair_or;
+
+  // CSV header
+  std::cerr << "kernel,name,cycles_per_word,instructions_per_word,"
+            << "words_per_ns,dontcare" << std::endl;
+#ifdef __BMI2__
+  run_kernel("pext", compact_even_bits_pext);
+#endif
+  run_kernel("x86", bc::compact_even_bits_x86<op>);
+#ifdef __AVX2__
+  run_kernel("avx2", bc::compact_even_bits_avx2<op>);
+#endif
+#ifdef __AVX512BW__
+  run_kernel("avx512", bc::compact_even_bits_avx512<op>);
+#endif
+#if defined(__AVX512BW__) && defined(__GFNI__)
+  run_kernel("avx512_gfni", bc::compact_even_bits_avx512_gfni<op>);
+#endif
+  run_kernel("default", bc::compact_even_bits<op>);
+
+  std::cerr << "construction,n,f,d,cycles,instructions,mbits_per_sec,dontcare"
+            << std::endl;
+  for (auto f : clustering_factors) {
+    for (auto d : bit_densities) {
+      if (!markov_parameters_are_valid(N, f, d)) continue;
+      run_construction(f, d);
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
@@ -0,0 +1,140 @@
+#include "common.hpp"
+#include "experiments/util/gen.hpp"
+
+#include <dtl/dtl.hpp>
+#include <dtl/env.hpp>
+#include <dtl/thread.hpp>
+
+#include <dtl/bitmap/diff/diff.hpp>
+#include <dtl/bitmap/diff/diff_buffered.hpp>
+#include <dtl/bitmap/dynamic_roaring_bitmap.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Experiment: Measures the update throughput of differential TEBs with
+//             multiple concurrent writers, with and without an update log in
+//             front of the differential data structure. Also measures the
+//             scan performance after the updates have been applied.
+//===----------------------------------------------------------------------===//
+/// The bitmap length.
+static const std::size_t BITMAP_LENGTH =
+    dtl::env<$u64>::get("N", 1ull << 24);
+/// The number of updates to perform.
+static const std::size_t UPDATE_CNT =
+    dtl::env<$u64>::get("UPDATE_CNT", 1ull << 18);
+/// The maximum number of writer threads.
+static const std::size_t MAX_THREAD_CNT =
+    dtl::env<$u64>::get("MAX_THREAD_CNT", 16);
+//===----------------------------------------------------------------------===//
+using diff_teb = dtl::diff<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap>;
+using diff_buffered_teb =
+    dtl::diff_buffered<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap>;
+//===----------------------------------------------------------------------===//
+/// Serializes all writers using a global mutex. This is required for the
+/// differential bitmaps without update log.
+template<typename T>
+struct locked_writer {
+  static void
+  set(T& enc, std::mutex& mutex, std::size_t i, u1 val) {
+    std::lock_guard<std::mutex> lock(mutex);
+    enc.set(i, val);
+  }
+};
+/// Lock-free writers.
+template<typename B, typename D, std::size_t S, std::size_t C>
+struct locked_writer<dtl::diff_buffered<B, D, S, C>> {
+  static void
+  set(dtl::diff_buffered<B, D, S, C>& enc, std::mutex&, std::size_t i, u1 val) {
+    enc.set(i, val);
+  }
+};
+//===----------------------------------------------------------------------===//
+template<typename T>
+void __attribute__((noinline))
+run(const dtl::bitmap& b, f64 f, f64 d,
+    const std::vector<std::pair<std::size_t, $u1>>& updates,
+    std::size_t thread_cnt) {
+  const std::size_t MIN_REPS = 5;
+  $u64 update_nanos = 0;
+  $u64 scan_nanos = 0;
+  std::size_t checksum = 0;
+
+  const auto nanos_begin = now_nanos();
+  std::size_t rep_cntr = 0;
+  while (now_nanos() - nanos_begin < RUN_DURATION_NANOS
+      || rep_cntr < MIN_REPS) {
+    ++rep_cntr;
+    T enc(b);
+    std::mutex mutex;
+    const std::size_t updates_per_thread =
+        (updates.size() + thread_cnt - 1) / thread_cnt;
+    auto thread_fn = [&](u32 thread_id) {
+      const auto begin = std::min(thread_id * updates_per_thread, updates.size());
+      const auto end = std::min(begin + updates_per_thread, updates.size());
+      for (std::size_t i = begin; i < end; ++i) {
+        locked_writer<T>::set(enc, mutex, updates[i].first, updates[i].second);
+      }
+    };
+    const auto nanos_begin_updates = now_nanos();
+    dtl::run_in_parallel(thread_fn, cpu_mask, thread_cnt);
+    const auto nanos_end_updates = now_nanos();
+    update_nanos += nanos_end_updates - nanos_begin_updates;
+
+    // Scan the bitmap after the updates.
+    const auto nanos_begin_scan = now_nanos();
+    auto it = enc.scan_it();
+    while (!it.end()) {
+      checksum += it.pos() + it.length();
+      it.next();
+    }
+    const auto nanos_end_scan = now_nanos();
+    scan_nanos += nanos_end_scan - nanos_begin_scan;
+  }
+  update_nanos /= rep_cntr;
+  scan_nanos /= rep_cntr;
+
+  std::cout << RUN_ID
+      << ",\"" << BUILD_ID << "\""
+      << "," << b.size()
+      << "," << "\"" << T::name() << "\""
+      << "," << f
+      << "," << d
+      << "," << thread_cnt
+      << "," << updates.size()
+      << "," << update_nanos
+      << "," << (updates.size() * 1e3 / update_nanos) // updates per us
+      << "," << scan_nanos
+      << "," << checksum
+      << std::endl;
+}
+//===----------------------------------------------------------------------===//
+$i32 main() {
+  std::cerr << "run_id=" << RUN_ID << std::endl;
+  std::cerr << "build_id=" << BUILD_ID << std::endl;
+  const $f64 f = 8.0;
+  const $f64 d = 0.1;
+  const auto b = gen_random_bitmap_markov(BITMAP_LENGTH, f, d);
+
+  // Uniformly distributed point updates.
+  std::mt19937 gen(42);
+  std::vector<std::pair<std::size_t, $u1>> updates;
+  updates.reserve(UPDATE_CNT);
+  for (std::size_t i = 0; i < UPDATE_CNT; ++i) {
+    updates.emplace_back(gen() % BITMAP_LENGTH, gen() % 2);
+  }
+
+  const std::size_t max_thread_cnt =
+      std::min(MAX_THREAD_CNT, static_cast<std::size_t>(cpu_mask.count()));
+  for (std::size_t thread_cnt = 1; thread_cnt <= max_thread_cnt;
+       thread_cnt *= 2) {
+    run<diff_teb>(b, f, d, updates, thread_cnt);
+    run<diff_buffered_teb>(b, f, d, updates, thread_cnt);
+  }
+}
+//===----------------------------------------------------------------------===//
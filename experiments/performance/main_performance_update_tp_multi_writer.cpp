@@ -0,0 +1,254 @@
+#include "common.hpp"
+#include "experiments/util/bitmap_db.hpp"
+#include "experiments/util/gen.hpp"
+#include "experiments/util/params.hpp"
+#include "experiments/util/prep_data.hpp"
+#include "experiments/util/prep_updates.hpp"
+
+#include <dtl/dtl.hpp>
+#include <dtl/env.hpp>
+#include <dtl/thread.hpp>
+
+#include <dtl/bitmap/part/part_updirect.hpp>
+#include <dtl/bitmap/part/part_updirect_concurrent.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Experiment: Measures the update throughput of partitioned TEBs with multiple
+//             concurrent writers.
+//===----------------------------------------------------------------------===//
+/// The partition size in bits.
+static constexpr std::size_t P = 1ull << 16;
+/// The number of updates that are grouped together (batched mode only).
+static const std::size_t BATCH_SIZE =
+    dtl::env<$u64>::get("BATCH_SIZE", 1024);
+/// The maximum number of updates to perform.
+static const std::size_t MAX_UPDATES =
+    dtl::env<$u64>::get("MAX_UPDATES", 100000);
+//===----------------------------------------------------------------------===//
+enum class writer_mode {
+  /// All writers are serialized using a global mutex (part_updirect).
+  global_lock,
+  /// Per-partition latches, point updates (part_updirect_concurrent).
+  partition_lock,
+  /// Per-partition latches, updates are grouped by partition.
+  partition_lock_batched,
+};
+//===----------------------------------------------------------------------===//
+static std::string
+mode_name(writer_mode m) {
+  switch (m) {
+    case writer_mode::global_lock: return "global_lock";
+    case writer_mode::partition_lock: return "partition_lock";
+    case writer_mode::partition_lock_batched: return "partition_lock_batched";
+  }
+  return "";
+}
+//===----------------------------------------------------------------------===//
+struct benchmark_results {
+  std::string type_name;
+  std::size_t encoded_size_before_updates;
+  std::size_t encoded_size_after_updates;
+  std::size_t update_cnt;
+  $u64 runtime_nanos = 0;
+  // Don't care.
+  std::size_t checksum = 0;
+};
+//===----------------------------------------------------------------------===//
+/// Applies the updates in [begin, end) to the given bitmap.
+template<typename T>
+static void
+apply_updates(T& enc, std::mutex& mutex, writer_mode mode,
+    const std::vector<std::pair<std::size_t, $u1>>& updates,
+    std::size_t begin, std::size_t end) {
+  switch (mode) {
+    case writer_mode::global_lock:
+      for (std::size_t i = begin; i < end; ++i) {
+        std::lock_guard<std::mutex> lock(mutex);
+        enc.set(updates[i].first, updates[i].second);
+      }
+      break;
+    case writer_mode::partition_lock:
+      for (std::size_t i = begin; i < end; ++i) {
+        enc.set(updates[i].first, updates[i].second);
+      }
+      break;
+    case writer_mode::partition_lock_batched:
+      for (std::size_t i = begin; i < end; i += BATCH_SIZE) {
+        const auto batch_end = std::min(i + BATCH_SIZE, end);
+        enc.set(updates.begin() + i, updates.begin() + batch_end);
+      }
+      break;
+  }
+}
+//===----------------------------------------------------------------------===//
+template<typename T>
+benchmark_results __attribute__((noinline))
+run_benchmark(
+    const dtl::bitmap& b,
+    const std::vector<std::pair<std::size_t, $u1>>& updates,
+    writer_mode mode,
+    std::size_t thread_cnt) {
+
+  const auto duration_nanos = RUN_DURATION_NANOS;
+  const std::size_t MIN_REPS = 5;
+
+  benchmark_results res;
+  {
+    T enc(b);
+    res.encoded_size_before_updates = enc.size_in_bytes();
+    res.type_name = enc.name();
+  }
+
+  // The repetition loop.
+  const auto nanos_begin = now_nanos();
+  const auto nanos_term = nanos_begin + duration_nanos;
+  std::size_t rep_cntr = 0;
+  std::size_t checksum = 0;
+  while (now_nanos() < nanos_term || rep_cntr < MIN_REPS) {
+    ++rep_cntr;
+
+    // Encode the bitmap.
+    T enc(b);
+    std::mutex mutex;
+
+    // Each thread applies a contiguous range of the (shuffled) updates.
+    const std::size_t updates_per_thread =
+        (updates.size() + thread_cnt - 1) / thread_cnt;
+    auto thread_fn = [&](u32 thread_id) {
+      const auto begin = std::min(thread_id * updates_per_thread, updates.size());
+      const auto end = std::min(begin + updates_per_thread, updates.size());
+      apply_updates(enc, mutex, mode, updates, begin, end);
+    };
+
+    const auto nanos_begin_updates = now_nanos();
+    dtl::run_in_parallel(thread_fn, cpu_mask, thread_cnt);
+    const auto nanos_end_updates = now_nanos();
+    res.runtime_nanos += nanos_end_updates - nanos_begin_updates;
+
+    res.encoded_size_after_updates = enc.size_in_bytes();
+    checksum += res.encoded_size_after_updates;
+  }
+  res.checksum = checksum;
+  res.update_cnt = updates.size();
+  res.runtime_nanos /= rep_cntr;
+  return res;
+}
+//===----------------------------------------------------------------------===//
+void
+do_measurement($u64 bitmap_id_a, $u64 bitmap_id_b) {
+  // The bitmap that is used as starting point.
+  const auto bm_a = db.load_bitmap(bitmap_id_a);
+  // The second bitmap determines the updates to perform.
+  const auto bm_b = db.load_bitmap(bitmap_id_b);
+  assert(bm_a.size() == bm_b.size());
+
+  // Prepare the updates. The updates are clustered, so that the characteristics
+  // of the bitmap remains roughly the same during modifications.
+  auto range_updates = prepare_range_updates(bm_a, bm_b);
+
+  // Shuffle the update order.
+  std::mt19937 gen(42); // for reproducible results, same order among all benchmarks
+  std::shuffle(range_updates.begin(), range_updates.end(), gen);
+
+  std::vector<std::pair<std::size_t, $u1>> updates;
+  for (auto& range : range_updates) {
+    for (std::size_t i = range.pos; i < range.pos + range.length; ++i) {
+      if (updates.size() < MAX_UPDATES) {
+        updates.emplace_back(i, range.value);
+      }
+    }
+  }
+
+  const std::size_t max_thread_cnt = cpu_mask.count();
+  for (std::size_t thread_cnt = 1; thread_cnt <= max_thread_cnt;
+       thread_cnt *= 2) {
+    for (auto mode : {writer_mode::global_lock, writer_mode::partition_lock,
+             writer_mode::partition_lock_batched}) {
+      benchmark_results res;
+      if (mode == writer_mode::global_lock) {
+        res = run_benchmark<dtl::part_updirect<dtl::teb_wrapper, P>>(
+            bm_a, updates, mode, thread_cnt);
+      }
+      else {
+        res = run_benchmark<dtl::part_updirect_concurrent<dtl::teb_wrapper, P>>(
+            bm_a, updates, mode, thread_cnt);
+      }
+
+      std::cout << RUN_ID
+          << ",\"" << BUILD_ID << "\""
+          << "," << bm_a.size()
+          << "," << "\"" << res.type_name << "\""
+          << "," << mode_name(mode)
+          << "," << thread_cnt
+          << "," << ((mode == writer_mode::partition_lock_batched) ? BATCH_SIZE : 1)
+          << "," << bitmap_id_a
+          << "," << bitmap_id_b
+          << "," << res.update_cnt
+          << "," << res.runtime_nanos
+          << "," << (res.runtime_nanos / res.update_cnt)
+          << "," << (res.update_cnt * 1e3 / res.runtime_nanos) // updates per us
+          << "," << dtl::determine_bit_density(bm_a)
+          << "," << dtl::determine_clustering_factor(bm_a)
+          << "," << res.encoded_size_before_updates
+          << "," << res.encoded_size_after_updates
+          << "," << res.checksum
+          << std::endl;
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+$i32 main() {
+  // Prepare benchmark settings.
+  u64 n = 1ull << 24;
+  const std::vector<$f64> clustering_factors { 8.0 };
+  const std::vector<$f64> bit_densities { 0.1 };
+
+  std::cerr << "run_id=" << RUN_ID << std::endl;
+  std::cerr << "build_id=" << BUILD_ID << std::endl;
+
+  if (GEN_DATA) {
+    std::vector<params_markov> params;
+    for (auto f : clustering_factors) {
+      for (auto d : bit_densities) {
+        if (!markov_parameters_are_valid(n, f, d)) continue;
+        params_markov p;
+        p.n = n;
+        p.clustering_factor = f;
+        p.density = d;
+        params.push_back(p);
+      }
+    }
+    prep_data(params, RUNS, db);
+    std::exit(0);
+  }
+  else {
+    if (db.empty()) {
+      std::cerr << "Bitmap database is empty. Use GEN_DATA=1 to populate the "
+                   "database."
+                << std::endl;
+      std::exit(1);
+    }
+  }
+
+  for (auto f : clustering_factors) {
+    for (auto d : bit_densities) {
+      if (!markov_parameters_are_valid(n, f, d)) continue;
+      auto bitmap_ids = db.find_bitmaps(n, f, d);
+      if (bitmap_ids.size() < 2) {
+        std::cerr << "At least two prepared bitmaps are required for the "
+                  << "parameters n=" << n << ", f=" << f << ", d=" << d
+                  << std::endl;
+        continue;
+      }
+      do_measurement(bitmap_ids[0], bitmap_ids[1]);
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
@@ -20,7 +20,10 @@
 //===----------------------------------------------------------------------===//
 // Experiment: Measures the read performance for varying number of pending
 //             updates.
+//             With MEASURE_MERGE=1, the merge performance of the TEB-specific
+//             merge strategies is measured instead, compared to a rebuild.
 //===----------------------------------------------------------------------===//
+static u64 MEASURE_MERGE = dtl::env<$u64>::get("MEASURE_MERGE", 0);
 struct benchmark_results {
   std::size_t n;
   std::string type_name;
@@ -288,6 +291,69 @@ do_measurement(uint64_t bid_a, uint64_t bid_b) {
   }
 }
 //===----------------------------------------------------------------------===//
+/// Measures the time it takes to merge a varying number of pending updates
+/// into a TEB, using the merge strategy M.
+template<typename D, template<typename, typename> class M>
+void
+do_merge_measurement(uint64_t bid_a, uint64_t bid_b) {
+  using T = dtl::diff<dtl::teb_wrapper, D>;
+  using merge_type = M<dtl::teb_wrapper, D>;
+  const auto bm_a = db.load_bitmap(bid_a);
+  const auto bm_b = db.load_bitmap(bid_b);
+  assert(bm_a.size() == bm_b.size());
+
+  // Prepare the updates (see do_measurement).
+  auto range_updates = prepare_range_updates(bm_a, bm_b);
+  std::mt19937 gen(42); // for reproducible results
+  std::shuffle(range_updates.begin(), range_updates.end(), gen);
+  const std::size_t max_updates = 20000;
+  std::vector<update_entry> updates;
+  for (auto& range : range_updates) {
+    for (std::size_t i = range.pos; i < range.pos + range.length; ++i) {
+      if (updates.size() < max_updates) {
+        updates.emplace_back(i, range.value);
+      }
+    }
+  }
+
+  for (std::size_t pending_update_cnt = 1;
+       pending_update_cnt <= updates.size(); pending_update_cnt *= 10) {
+    $u64 runtime_nanos = 0;
+    std::size_t encoded_size = 0;
+    for (std::size_t r = 0; r < RUNS; ++r) {
+      T b(bm_a);
+      auto bm_expected = bm_a;
+      for (std::size_t i = 0; i < pending_update_cnt; ++i) {
+        b.set(updates[i].pos, updates[i].value);
+        bm_expected[updates[i].pos] = updates[i].value;
+      }
+      const auto nanos_begin = now_nanos();
+      b.template merge<merge_type>();
+      runtime_nanos += now_nanos() - nanos_begin;
+      encoded_size = b.size_in_bytes();
+
+      if (dtl::to_bitmap_using_iterator(b) != bm_expected) {
+        std::cerr << "Validation failed. " << std::endl;
+        std::cerr << "Failed to merge the pending updates using "
+            << merge_type::name() << "." << std::endl;
+        std::exit(1);
+      }
+    }
+
+    std::cout << RUN_ID
+        << ",\"" << BUILD_ID << "\""
+        << "," << bm_a.size()
+        << "," << "\"" << T::name() << "\""
+        << "," << "\"" << merge_type::name() << "\""
+        << "," << bid_a
+        << "," << bid_b
+        << "," << pending_update_cnt
+        << "," << (runtime_nanos / RUNS)
+        << "," << encoded_size
+        << std::endl;
+  }
+}
+//===----------------------------------------------------------------------===//
 $i32 main() {
   // Prepare benchmark settings.
   u64 n_min = 1ull << 20;
@@ -364,6 +430,12 @@ $i32 main() {
           using W = dtl::dynamic_wah32;
           using pW = dtl::part<dtl::dynamic_wah32, P>;
 
+          if (MEASURE_MERGE) {
+            do_merge_measurement<D, dtl::merge_naive_iter>(bid_a, bid_b);
+            do_merge_measurement<D, dtl::merge_inplace_teb>(bid_a, bid_b);
+            continue;
+          }
+
           do_measurement<dtl::diff<R,  D>,                        R >(bid_a, bid_b);
           do_measurement<dtl::diff<T,  D>,                        T >(bid_a, bid_b);
           do_measurement<dtl::diff<W,  D>,                        W >(bid_a, bid_b);
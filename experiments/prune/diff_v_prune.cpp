@@ -2,15 +2,20 @@
 #include "src/dtl/bitmap/diff/diff.hpp"
 #include <dtl/bitmap/dynamic_roaring_bitmap.hpp>
 #include "src/dtl/bitmap/diff/merge.hpp"
+#include "src/dtl/bitmap/diff/small_diff.hpp"
 
 /*
 Experiment: compare pruning v. differential updates for run-forming updates
+
+    The differential updates are measured with Roaring and with the small_diff as differential data structure.
 */
 
 void run_diff_benchmark(benchmark_task task, std::ofstream &log_file, std::ofstream &res_file) {
     dtl::diff<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap> new_diff_teb(task.bitset);
     dtl::teb_wrapper new_teb(task.bitset);
     using merge_type = dtl::merge_naive<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap>;
+    dtl::diff<dtl::teb_wrapper, dtl::small_diff> new_small_diff_teb(task.bitset);
+    using small_merge_type = dtl::merge_naive_iter<dtl::teb_wrapper, dtl::small_diff>;
 
     log_file << "New TEB granularity: " << new_teb.teb_->rank_.get_block_bitlength() << std::endl;
 
@@ -28,16 +33,24 @@ void run_diff_benchmark(benchmark_task task, std::ofstream &log_file, std::ofstr
     clock_t prune_update_t = 0;
     clock_t merge_total_t = 0;
     clock_t prune_total_t = 0;
+    clock_t small_diff_lookup_t = 0;
+    clock_t small_diff_update_t = 0;
+    clock_t small_merge_total_t = 0;
     for (update_task update : task.mixed_updates) {
         clock_t t_diff = clock();
         new_diff_teb.set(update.pos, update.val);
         t_diff = clock() - t_diff;
         
+        clock_t t_small_diff = clock();
+        new_small_diff_teb.set(update.pos, update.val);
+        small_diff_update_t += clock() - t_small_diff;
+
         clock_t t_teb = clock();
         new_teb.update(update.pos, update.val);
         t_teb = clock() - t_teb;
 
         assert(new_diff_teb.test(update.pos) == new_teb.test(update.pos));
+        assert(new_small_diff_teb.test(update.pos) == new_teb.test(update.pos));
         update_count++;
         diff_update_t += t_diff;
         prune_update_t += t_teb;
@@ -48,6 +61,10 @@ void run_diff_benchmark(benchmark_task task, std::ofstream &log_file, std::ofstr
                 new_diff_teb.test(i);
                 diff_lookup_t += clock() - lookup_t;
 
+                lookup_t = clock();
+                new_small_diff_teb.test(i);
+                small_diff_lookup_t += clock() - lookup_t;
+
                 lookup_t = clock();
                 new_teb.test(i);
                 prune_lookup_t += clock() - lookup_t;
@@ -57,6 +74,10 @@ void run_diff_benchmark(benchmark_task task, std::ofstream &log_file, std::ofstr
             clock_t merge_t = clock();
             new_diff_teb.template merge<merge_type>();
             merge_t = clock() - merge_t;
+
+            clock_t small_merge_t = clock();
+            new_small_diff_teb.template merge<small_merge_type>();
+            small_merge_total_t += clock() - small_merge_t;
             
             clock_t prune_t = clock();
             new_teb.teb_->prune();
@@ -72,16 +93,19 @@ void run_diff_benchmark(benchmark_task task, std::ofstream &log_file, std::ofstr
     log_file << "Applied " << update_count << " updates.\n";
     log_file << "Total update time for TEB + diff: " << ((float) diff_update_t) / CLOCKS_PER_SEC * 1000000 << " microseconds.\n";
     log_file << "Average update time for TEB + diff: " << ((float) diff_update_t) / CLOCKS_PER_SEC * 1000000000 / update_count << " nanoseconds.\n";
+    log_file << "Average update time for TEB + small diff: " << ((float) small_diff_update_t) / CLOCKS_PER_SEC * 1000000000 / update_count << " nanoseconds.\n";
     log_file << "Total update time for TEB w/ prune: " << ((float) prune_update_t) / CLOCKS_PER_SEC  * 1000000 << " microseconds.\n";
     log_file << "Average update time for TEB + prune: " << ((float) prune_update_t) / CLOCKS_PER_SEC * 1000000000 / update_count << " nanoseconds.\n";
     log_file << "Performed " << lookup_count << " lookups.\n";
     log_file << "Total lookup time for TEB + diff: " << ((float) diff_lookup_t) / CLOCKS_PER_SEC * 1000000 << " microseconds.\n";
     log_file << "Average lookup time for TEB + diff: " << ((float) diff_lookup_t) / CLOCKS_PER_SEC / lookup_count * 1000000000 << " nanoseconds.\n";
+    log_file << "Average lookup time for TEB + small diff: " << ((float) small_diff_lookup_t) / CLOCKS_PER_SEC / lookup_count * 1000000000 << " nanoseconds.\n";
     log_file << "Total lookup time for TEB w/ prune: " << ((float) prune_lookup_t) / CLOCKS_PER_SEC * 1000000 << " microseconds.\n";
     log_file << "Average lookup time for TEB w/ prune: " << ((float) prune_lookup_t) / CLOCKS_PER_SEC / lookup_count * 1000000000 << " nanoseconds.\n";
     log_file << "Performed " << merge_count << " merges/prunes.\n";
     log_file << "Total merge time: " << ((float) merge_total_t) / CLOCKS_PER_SEC << " seconds.\n";
     log_file << "Average merge time: " << ((float) merge_total_t) / CLOCKS_PER_SEC / merge_count << " seconds.\n";
+    log_file << "Average merge time (small diff): " << ((float) small_merge_total_t) / CLOCKS_PER_SEC / merge_count << " seconds.\n";
     log_file << "Total prune time: " << ((float) prune_total_t) / CLOCKS_PER_SEC << " seconds.\n";
     log_file << "Average prune: " << ((float) prune_total_t) / CLOCKS_PER_SEC / merge_count << " seconds.\n";
     float avg_total_t_diff = 
@@ -100,6 +124,7 @@ void run_diff_benchmark(benchmark_task task, std::ofstream &log_file, std::ofstr
     // <update count> <total diff update time in microsec> <avg diff update time in ns> <total teb update time in microsec> <avg teb update time in ns>
     // <lookup count> <total diff lookup t in microsec> <avg diff lookup t in ns> <total teb lookup t in microsec> <avg teb lookup t in ns>
     // <merge/prune count> <total merge time in s> <avg merge time in s> <total prune time in s> <avg prune time in s>
+    // <avg small diff update t in ns> <avg small diff lookup t in ns> <avg small diff merge time in s>
     res_file
         << task.bitset.size() << " "
         << task.prune_trigger << " "
@@ -117,7 +142,10 @@ void run_diff_benchmark(benchmark_task task, std::ofstream &log_file, std::ofstr
         << ((float) merge_total_t) / CLOCKS_PER_SEC << " "
         << ((float) merge_total_t) / CLOCKS_PER_SEC / merge_count << " "
         << ((float) prune_total_t) / CLOCKS_PER_SEC << " "
-        << ((float) prune_total_t) / CLOCKS_PER_SEC / merge_count << "\n";
+        << ((float) prune_total_t) / CLOCKS_PER_SEC / merge_count << " "
+        << ((float) small_diff_update_t) / CLOCKS_PER_SEC * 1000000000 / update_count << " "
+        << ((float) small_diff_lookup_t) / CLOCKS_PER_SEC / lookup_count * 1000000000 << " "
+        << ((float) small_merge_total_t) / CLOCKS_PER_SEC / merge_count << "\n";
     res_file.flush();
 }
 
@@ -0,0 +1,95 @@
+#include "experiments/util/prune_util.hpp"
+
+/*
+Experiment:
+    Extends bitset_size_v_update. Measuring the update throughput (random bit flips, including run-breaking updates)
+    with respect to the growth factor of the serialized TEB, and the resulting memory overhead. A growth factor of 0
+    disables the growth, i.e., updates fail when the free bits run out.
+
+Expectation:
+    Larger growth factors require fewer re-allocations, which results in a higher update throughput, but also in
+    a higher memory overhead compared to the size of the TEB without free bits (see teb_wrapper::shrink_to_fit).
+*/
+
+std::vector<double> growth_factors {0.0, 1.25, 1.5, 2.0, 4.0};
+std::vector<std::size_t> bitset_sizes {1000, 10000, 100000, 1000000, 10000000};
+std::size_t update_cnt = 100000;
+
+void perform_benchmark(const boost::dynamic_bitset<u_int32_t> &bitset, const std::vector<update_task> &updates,
+        double growth_factor, std::ofstream &log_file, std::ofstream &res_file) {
+    dtl::teb_wrapper new_teb = dtl::teb_wrapper(bitset);
+    new_teb.set_growth_factor(growth_factor);
+    const std::size_t initial_size = new_teb.size_in_bytes();
+
+    boost::dynamic_bitset<u_int32_t> test_bitset = bitset;
+    std::size_t inplace_count = 0;
+    std::size_t failed_count = 0;
+    std::size_t realloc_count = 0;
+    clock_t update_total_t = 0;
+    for (update_task update : updates) {
+        const std::size_t size_before = new_teb.size_in_bytes();
+        clock_t t_update = clock();
+        int update_result = new_teb.update(update.pos, update.val, nullptr);
+        t_update = clock() - t_update;
+        update_total_t += t_update;
+        realloc_count += new_teb.size_in_bytes() != size_before;
+        if (update_result == 2) {
+            failed_count++;
+            continue;
+        }
+        inplace_count += update_result;
+        test_bitset.set(update.pos, update.val);
+    }
+
+    const std::size_t size_after = new_teb.size_in_bytes();
+    dtl::teb_wrapper shrunk_teb(new_teb);
+    shrunk_teb.shrink_to_fit();
+    const std::size_t size_shrunk = shrunk_teb.size_in_bytes();
+
+    if (!bitmap_equals_teb(test_bitset, &new_teb) || !bitmap_equals_teb(test_bitset, &shrunk_teb)) {
+        log_file << "Failed: TEB does not equal uncompressed bitset (growth factor " << growth_factor << ").\n";
+    }
+    log_file << "Bitset size: " << bitset.size() << ", growth factor: " << growth_factor << "\n"
+        << "Applied " << inplace_count << " in-place updates, " << failed_count << " failed, "
+        << realloc_count << " re-allocation(s).\n"
+        << "Size: " << initial_size << " -> " << size_after << " bytes (" << size_shrunk << " bytes shrunk).\n\n";
+    log_file.flush();
+
+    // <bitset size> <growth factor> <in-place update count> <failed update count> <reallocation count>
+    // <total t in ms> <average t in ns> <initial size> <final size> <shrunk size> <memory overhead>
+    res_file
+        << bitset.size() << " "
+        << growth_factor << " "
+        << inplace_count << " " << failed_count << " " << realloc_count << " "
+        << ((float) update_total_t) / CLOCKS_PER_SEC * 1000 << " "
+        << ((float) update_total_t) / CLOCKS_PER_SEC / updates.size() * 1000000000 << " "
+        << initial_size << " " << size_after << " " << size_shrunk << " "
+        << ((double) size_after / size_shrunk) << "\n";
+    res_file.flush();
+}
+
+int main() {
+    std::ofstream log_file;
+    log_file.open("growth_v_update_log.txt");
+    std::ofstream res_file;
+    res_file.open("growth_v_update_res.txt");
+
+    std::mt19937 gen(42);
+    for (std::size_t bitset_size : bitset_sizes) {
+        boost::dynamic_bitset<u_int32_t> new_bitset = generate_bitset_bernoulli(bitset_size, 1u, 0.25);
+
+        // Generate random bit flips.
+        std::vector<update_task> updates;
+        for (std::size_t i = 0; i < update_cnt; ++i) {
+            const std::size_t pos = gen() % bitset_size;
+            updates.push_back(update_task{pos, !new_bitset[pos]});
+        }
+        log_file << "Generated " << updates.size() << " updates for a bitset of size " << bitset_size << ".\n\n";
+
+        for (double growth_factor : growth_factors) {
+            perform_benchmark(new_bitset, updates, growth_factor, log_file, res_file);
+        }
+    }
+    res_file.close();
+    log_file.close();
+}
@@ -2,6 +2,7 @@
 #include "src/dtl/bitmap/diff/diff.hpp"
 #include <dtl/bitmap/dynamic_roaring_bitmap.hpp>
 #include "src/dtl/bitmap/diff/merge.hpp"
+#include "src/dtl/bitmap/diff/small_diff.hpp"
 
 // Bitmap generation from TEB paper
 #include "experiments/util/params.hpp"
@@ -12,6 +13,9 @@
 
 /*
 Experiment: hybrid approach with purely differential updates
+
+    Both approaches are additionally measured with the small_diff as differential data structure, which avoids
+    the expensive re-compression of the Roaring bitmap after each update (see diff::set).
 */
 
 //std::vector<double> bit_densities {0.1, 0.01, 0.001, 0.0001, 0.00001};
@@ -94,6 +98,8 @@ int main() {
                 dtl::diff<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap> hybrid_teb(bm_a);
                 dtl::diff<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap> diff_teb(bm_a);
                 dtl::diff<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap> hybridplus_teb(bm_a);
+                dtl::diff<dtl::teb_wrapper, dtl::small_diff> hybrid_small_teb(bm_a);
+                dtl::diff<dtl::teb_wrapper, dtl::small_diff> diff_small_teb(bm_a);
 
                 std::size_t failed_count_hybrid = 0;
                 std::size_t inplace_count_hybrid = 0;
@@ -106,6 +112,8 @@ int main() {
                 clock_t hybrid_time = 0;
                 clock_t hybridplus_time = 0;
                 clock_t diff_time = 0;
+                clock_t hybrid_small_time = 0;
+                clock_t diff_small_time = 0;
                 for (update_entry update : updates) {
                     clock_t start_t = clock();
                     int update_res = hybrid_teb.update(update.pos, update.value);
@@ -154,10 +162,20 @@ int main() {
                     start_t = clock();
                     diff_teb.set(update.pos, update.value);
                     diff_time += clock() - start_t;
+
+                    start_t = clock();
+                    hybrid_small_teb.update(update.pos, update.value);
+                    hybrid_small_time += clock() - start_t;
+
+                    start_t = clock();
+                    diff_small_teb.set(update.pos, update.value);
+                    diff_small_time += clock() - start_t;
                 }
                 bool tebs_valid = 1;
                 for (std::size_t i = 0; i < bitset_size; i++) {
-                    if (hybrid_teb.test(i) != diff_teb.test(i)) {
+                    if (hybrid_teb.test(i) != diff_teb.test(i)
+                            || hybrid_small_teb.test(i) != diff_teb.test(i)
+                            || diff_small_teb.test(i) != diff_teb.test(i)) {
                         tebs_valid = 0;
                     }
                 }
@@ -179,8 +197,12 @@ int main() {
                     << "Hybrid total update time: " << ((float) hybrid_time) / (updates.size()) / CLOCKS_PER_SEC * 1000000 << "micros\n"
                     << "Hybrid total update time: " << ((float) hybridplus_time) / (updates.size()) / CLOCKS_PER_SEC * 1000000 << "micros\n"
                     << "Diff total update time: " << ((float) diff_time) / (updates.size()) / CLOCKS_PER_SEC * 1000000 << "micros\n"
+                    << "Hybrid (small diff) total update time: " << ((float) hybrid_small_time) / (updates.size()) / CLOCKS_PER_SEC * 1000000 << "micros\n"
+                    << "Diff (small diff) total update time: " << ((float) diff_small_time) / (updates.size()) / CLOCKS_PER_SEC * 1000000 << "micros\n"
                     << "Hybrid size: " << hybrid_teb.size_in_bytes() << " bytes\n"
-                    << "Diff size: " << diff_teb.size_in_bytes() << " bytes\n\n";
+                    << "Diff size: " << diff_teb.size_in_bytes() << " bytes\n"
+                    << "Hybrid (small diff) size: " << hybrid_small_teb.size_in_bytes() << " bytes\n"
+                    << "Diff (small diff) size: " << diff_small_teb.size_in_bytes() << " bytes\n\n";
                 log_file.flush();
 
                 res_file 
@@ -190,7 +212,11 @@ int main() {
                     << ((float) hybrid_time) / (updates.size()) / CLOCKS_PER_SEC * 1000000 << " "
                     << ((float) diff_time) / (updates.size()) / CLOCKS_PER_SEC * 1000000 << " "
                     << hybrid_teb.size_in_bytes() << " "
-                    << diff_teb.size_in_bytes() << "\n";
+                    << diff_teb.size_in_bytes() << " "
+                    << ((float) hybrid_small_time) / (updates.size()) / CLOCKS_PER_SEC * 1000000 << " "
+                    << ((float) diff_small_time) / (updates.size()) / CLOCKS_PER_SEC * 1000000 << " "
+                    << hybrid_small_teb.size_in_bytes() << " "
+                    << diff_small_teb.size_in_bytes() << "\n";
             }
         } else {
             std::cout << "Markov params are invalid.\n";
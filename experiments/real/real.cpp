@@ -11,6 +11,7 @@
 #include <dtl/bitmap/uah.hpp>
 #include <dtl/bitmap/util/convert.hpp>
 #include <dtl/bitmap/util/random.hpp>
+#include <dtl/bitmap/util/size_estimator.hpp>
 #include <dtl/dtl.hpp>
 #include <dtl/env.hpp>
 
@@ -29,6 +30,9 @@
 //===----------------------------------------------------------------------===//
 namespace fs = boost::filesystem;
 //===----------------------------------------------------------------------===//
+// If set, the estimated sizes (see dtl::size_estimator) are reported as well.
+static const bool ESTIMATE = dtl::env<$i32>::get("ESTIMATE", 0) != 0;
+//===----------------------------------------------------------------------===//
 template<typename T>
 std::size_t
 get_compressed_size(dtl::bitmap& bm) {
@@ -110,6 +114,18 @@ void run(const std::string& dir, std::ostream& result_out,
   std::atomic<std::size_t> bytes_concise { 0 };
   std::atomic<std::size_t> bytes_bbc { 0 };
 
+  // The estimated sizes.
+  std::atomic<std::size_t> est_bytes_roaring { 0 };
+  std::atomic<std::size_t> est_bytes_wah { 0 };
+  std::atomic<std::size_t> est_bytes_wah64 { 0 };
+  std::atomic<std::size_t> est_bytes_teb { 0 };
+  std::atomic<std::size_t> est_bytes_uah8 { 0 };
+  std::atomic<std::size_t> est_bytes_uah16 { 0 };
+  std::atomic<std::size_t> est_bytes_uah32 { 0 };
+  std::atomic<std::size_t> est_bytes_bah { 0 };
+  std::atomic<std::size_t> est_bytes_concise { 0 };
+  std::atomic<std::size_t> est_bytes_bbc { 0 };
+
   std::vector<dtl::bitmap> bitmaps;
   std::vector<dtl::bitmap> bitmaps_pow2;
 
@@ -261,6 +277,20 @@ void run(const std::string& dir, std::ostream& result_out,
     bytes_bah += bah;
     bytes_concise += concise;
     bytes_bbc += bbc;
+
+    if (ESTIMATE) {
+      const dtl::size_estimator est(bm);
+      est_bytes_roaring += est.roaring().size_in_bytes;
+      est_bytes_wah += est.wah32().size_in_bytes;
+      est_bytes_wah64 += est.wah64().size_in_bytes;
+      est_bytes_teb += est.teb().size_in_bytes;
+      est_bytes_uah8 += est.uah(8).size_in_bytes;
+      est_bytes_uah16 += est.uah(16).size_in_bytes;
+      est_bytes_uah32 += est.uah(32).size_in_bytes;
+      est_bytes_bah += est.sampled<dtl::bah>().size_in_bytes;
+      est_bytes_concise += est.concise().size_in_bytes;
+      est_bytes_bbc += est.bbc().size_in_bytes;
+    }
   };
 
   dispatch(0, bitmaps.size(), thread_fn);
@@ -276,6 +306,26 @@ void run(const std::string& dir, std::ostream& result_out,
   result_out << "concise: " << std::setw(15) << bytes_concise << " bytes, " << std::setw(15) << std::setprecision(4) << ((bytes_concise * 8.0) / total_bit_cnt) << " bits/int" << std::endl;
   result_out << "bbc:     " << std::setw(15) << bytes_bbc << " bytes, " << std::setw(15) << std::setprecision(4) << ((bytes_bbc * 8.0) / total_bit_cnt) << " bits/int" << std::endl;
 
+  if (ESTIMATE) {
+    auto print_estimate = [&](const std::string& name, std::size_t estimated,
+        std::size_t actual) {
+      result_out << "estimated " << name << std::setw(15) << estimated
+                 << " bytes, error: " << std::setw(8) << std::setprecision(4)
+                 << ((estimated * 100.0) / actual - 100.0) << " %"
+                 << std::endl;
+    };
+    print_estimate("roaring: ", est_bytes_roaring, bytes_roaring);
+    print_estimate("teb:     ", est_bytes_teb, bytes_teb);
+    print_estimate("wah:     ", est_bytes_wah, bytes_wah);
+    print_estimate("wah64:   ", est_bytes_wah64, bytes_wah64);
+    print_estimate("uah8 :   ", est_bytes_uah8, bytes_uah8);
+    print_estimate("uah16 :  ", est_bytes_uah16, bytes_uah16);
+    print_estimate("uah32 :  ", est_bytes_uah32, bytes_uah32);
+    print_estimate("bah :    ", est_bytes_bah, bytes_bah);
+    print_estimate("concise: ", est_bytes_concise, bytes_concise);
+    print_estimate("bbc:     ", est_bytes_bbc, bytes_bbc);
+  }
+
   result_csv_out << "\"" << dir << "\"";
   result_csv_out << "," << std::setprecision(4) << ((bytes_roaring * 8.0) / total_bit_cnt);
   result_csv_out << "," << std::setprecision(4) << ((bytes_teb * 8.0) / total_bit_cnt);
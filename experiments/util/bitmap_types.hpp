@@ -5,6 +5,7 @@
 #include <dtl/bitmap/dynamic_roaring_bitmap.hpp>
 #include <dtl/bitmap/dynamic_wah.hpp>
 #include <dtl/bitmap/part/part.hpp>
+#include <dtl/bitmap/part/part_adaptive.hpp>
 #include <dtl/bitmap/position_list.hpp>
 #include <dtl/bitmap/range_list.hpp>
 #include <dtl/bitmap/teb_wrapper.hpp>
@@ -77,8 +78,10 @@ enum class bitmap_t {
   bah,
   partitioned_bah,
 
+  partitioned_adaptive,
+
   _first = bitmap,
-  _last = partitioned_bah
+  _last = partitioned_adaptive
 };
 static const std::vector<bitmap_t>
     bitmap_t_list = []() {
@@ -349,4 +352,9 @@ template<>
 struct type_of<bitmap_t::partitioned_bah> {
   using type = dtl::part<dtl::bah, 1ull << 16>;
 };
+
+template<>
+struct type_of<bitmap_t::partitioned_adaptive> {
+  using type = dtl::part_adaptive<1ull << 16>;
+};
 //===----------------------------------------------------------------------===//
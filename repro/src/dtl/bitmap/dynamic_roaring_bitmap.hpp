@@ -152,6 +152,13 @@ struct dynamic_roaring_bitmap {
     return size_;
   }
 
+  /// Returns the number of set bits. Roaring maintains the cardinality per
+  /// container, thus no decoding is required.
+  std::size_t
+  count() const {
+    return bitmap_.cardinality();
+  }
+
   //===--------------------------------------------------------------------===//
   /// 1-fill iterator, with skip support.
   class iter {
@@ -0,0 +1,220 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "bitwise_operations.hpp"
+#include "part/part.hpp"
+#include "teb_flat.hpp"
+#include "teb_wrapper.hpp"
+
+#include <dtl/dtl.hpp>
+
+#include <algorithm>
+#include <cassert>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+namespace internal {
+//===----------------------------------------------------------------------===//
+// Functors for the population count of bitwise operations. If one of the
+// two subtrees is a leaf, the count is determined by the label of that leaf
+// and (if necessary) the population count of the other subtree.
+//===----------------------------------------------------------------------===//
+struct count_and {
+  static constexpr u1
+  eval(u1 a, u1 b) noexcept {
+    return a & b;
+  }
+
+  /// A 0-leaf terminates the traversal of the other subtree.
+  template<typename fn_t>
+  static std::size_t __forceinline__
+  with_leaf(u1 label, std::size_t width, fn_t&& count_other) noexcept {
+    return label ? count_other() : 0;
+  }
+};
+//===----------------------------------------------------------------------===//
+struct count_or {
+  static constexpr u1
+  eval(u1 a, u1 b) noexcept {
+    return a | b;
+  }
+
+  /// A 1-leaf terminates the traversal of the other subtree.
+  template<typename fn_t>
+  static std::size_t __forceinline__
+  with_leaf(u1 label, std::size_t width, fn_t&& count_other) noexcept {
+    return label ? width : count_other();
+  }
+};
+//===----------------------------------------------------------------------===//
+struct count_xor {
+  static constexpr u1
+  eval(u1 a, u1 b) noexcept {
+    return a ^ b;
+  }
+
+  template<typename fn_t>
+  static std::size_t __forceinline__
+  with_leaf(u1 label, std::size_t width, fn_t&& count_other) noexcept {
+    return label ? width - count_other() : count_other();
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Returns the number of set bits in the subtree rooted at the given node,
+/// which covers the bits [lo, lo + 2^log_width). The 1-leaves are added up by
+/// their level-implied lengths, whereby the padding beyond the length of the
+/// bitmap is excluded.
+static std::size_t
+teb_subtree_count(const teb_flat& t, teb_flat::size_type node_idx,
+    std::size_t lo, std::size_t log_width) noexcept {
+  const std::size_t n = t.n_actual_;
+  if (lo >= n) return 0;
+  if (t.is_leaf_node(node_idx)) {
+    const auto hi = std::min(lo + (std::size_t(1) << log_width), n);
+    return t.get_label(node_idx) ? hi - lo : 0;
+  }
+  const auto left_child_idx = 2 * t.rank_inclusive(node_idx) - 1;
+  const auto mid = lo + (std::size_t(1) << (log_width - 1));
+  return teb_subtree_count(t, left_child_idx, lo, log_width - 1)
+      + teb_subtree_count(t, left_child_idx + 1, mid, log_width - 1);
+}
+//===----------------------------------------------------------------------===//
+/// Returns the population count of the given bitwise operation of the two
+/// subtrees, which both cover the bits [lo, lo + 2^log_width). The two trees
+/// are traversed simultaneously. Once one of the subtrees is a leaf, the
+/// traversal continues in the other subtree only if necessary (see the
+/// functors above).
+template<typename op>
+static std::size_t
+teb_bitwise_count(const teb_flat& a, teb_flat::size_type a_node_idx,
+    const teb_flat& b, teb_flat::size_type b_node_idx,
+    std::size_t lo, std::size_t log_width) noexcept {
+  const std::size_t n = a.n_actual_;
+  if (lo >= n) return 0;
+  const u1 a_is_leaf = a.is_leaf_node(a_node_idx);
+  const u1 b_is_leaf = b.is_leaf_node(b_node_idx);
+  if (a_is_leaf || b_is_leaf) {
+    const auto width =
+        std::min(lo + (std::size_t(1) << log_width), n) - lo;
+    if (a_is_leaf && b_is_leaf) {
+      return op::eval(a.get_label(a_node_idx), b.get_label(b_node_idx))
+          ? width : 0;
+    }
+    if (a_is_leaf) {
+      return op::with_leaf(a.get_label(a_node_idx), width, [&]() {
+        return teb_subtree_count(b, b_node_idx, lo, log_width);
+      });
+    }
+    return op::with_leaf(b.get_label(b_node_idx), width, [&]() {
+      return teb_subtree_count(a, a_node_idx, lo, log_width);
+    });
+  }
+  const auto a_left_child_idx = 2 * a.rank_inclusive(a_node_idx) - 1;
+  const auto b_left_child_idx = 2 * b.rank_inclusive(b_node_idx) - 1;
+  const auto mid = lo + (std::size_t(1) << (log_width - 1));
+  return teb_bitwise_count<op>(a, a_left_child_idx, b, b_left_child_idx,
+          lo, log_width - 1)
+      + teb_bitwise_count<op>(a, a_left_child_idx + 1, b, b_left_child_idx + 1,
+          mid, log_width - 1);
+}
+//===----------------------------------------------------------------------===//
+template<typename op>
+static std::size_t
+teb_bitwise_count(const teb_wrapper& a, const teb_wrapper& b) noexcept {
+  assert(a.size() == b.size());
+  const auto& teb_a = *a.teb_;
+  const auto& teb_b = *b.teb_;
+  return teb_bitwise_count<op>(teb_a, 0, teb_b, 0, 0, teb_a.tree_height_);
+}
+//===----------------------------------------------------------------------===//
+/// Returns the sum of the lengths of the 1-fills produced by the given run
+/// iterator.
+template<typename iter_t>
+static std::size_t
+count_it(iter_t&& it) {
+  std::size_t cnt = 0;
+  while (!it.end()) {
+    cnt += it.length();
+    it.next();
+  }
+  return cnt;
+}
+//===----------------------------------------------------------------------===//
+} // namespace internal
+//===----------------------------------------------------------------------===//
+// Population count of bitwise operations, i.e., |A AND B|, |A OR B| and
+// |A XOR B|, e.g., for cardinality estimation or COUNT(*) queries. For TEBs,
+// the two trees are traversed simultaneously without producing the resulting
+// runs. For other types, the runs produced by the run iterators are added up.
+//===----------------------------------------------------------------------===//
+/// Returns the number of bits set in A AND B.
+template<typename A, typename B>
+static std::size_t
+and_count(const A& a, const B& b) {
+  return internal::count_it(dtl::bitwise_and_it(a.scan_it(), b.it()));
+}
+
+/// Returns the number of bits set in A OR B.
+template<typename A, typename B>
+static std::size_t
+or_count(const A& a, const B& b) {
+  return internal::count_it(dtl::bitwise_or_it(a.scan_it(), b.scan_it()));
+}
+
+/// Returns the number of bits set in A XOR B.
+template<typename A, typename B>
+static std::size_t
+xor_count(const A& a, const B& b) {
+  return internal::count_it(dtl::bitwise_xor_it(a.scan_it(), b.scan_it()));
+}
+//===----------------------------------------------------------------------===//
+static std::size_t
+and_count(const teb_wrapper& a, const teb_wrapper& b) noexcept {
+  return internal::teb_bitwise_count<internal::count_and>(a, b);
+}
+
+static std::size_t
+or_count(const teb_wrapper& a, const teb_wrapper& b) noexcept {
+  return internal::teb_bitwise_count<internal::count_or>(a, b);
+}
+
+static std::size_t
+xor_count(const teb_wrapper& a, const teb_wrapper& b) noexcept {
+  return internal::teb_bitwise_count<internal::count_xor>(a, b);
+}
+//===----------------------------------------------------------------------===//
+// Partitioned bitmaps with the same partitioning are processed partition by
+// partition.
+//===----------------------------------------------------------------------===//
+template<typename B, std::size_t P>
+static std::size_t
+and_count(const part<B, P>& a, const part<B, P>& b) {
+  assert(a.size() == b.size());
+  std::size_t cnt = 0;
+  for (std::size_t i = 0; i < a.partition_cnt(); ++i) {
+    cnt += and_count(a.get_partition(i), b.get_partition(i));
+  }
+  return cnt;
+}
+
+template<typename B, std::size_t P>
+static std::size_t
+or_count(const part<B, P>& a, const part<B, P>& b) {
+  assert(a.size() == b.size());
+  std::size_t cnt = 0;
+  for (std::size_t i = 0; i < a.partition_cnt(); ++i) {
+    cnt += or_count(a.get_partition(i), b.get_partition(i));
+  }
+  return cnt;
+}
+
+template<typename B, std::size_t P>
+static std::size_t
+xor_count(const part<B, P>& a, const part<B, P>& b) {
+  assert(a.size() == b.size());
+  std::size_t cnt = 0;
+  for (std::size_t i = 0; i < a.partition_cnt(); ++i) {
+    cnt += xor_count(a.get_partition(i), b.get_partition(i));
+  }
+  return cnt;
+}
+//===----------------------------------------------------------------------===//
+} // namespace dtl
@@ -2,11 +2,55 @@
 //===----------------------------------------------------------------------===//
 #include <dtl/dtl.hpp>
 
+#include <algorithm>
 #include <type_traits>
 //===----------------------------------------------------------------------===//
 namespace dtl {
 namespace internal { // TODO should be dtl::bitmap::internal
 //===----------------------------------------------------------------------===//
+/// Type trait to determine whether an iterator type supports forwarding
+/// multiple instances at once, e.g., the TEB skip iterator.
+template<typename iter_t, typename = void>
+struct has_skip_to_many : std::false_type {};
+
+template<typename iter_t>
+struct has_skip_to_many<iter_t,
+    decltype(iter_t::skip_to_many(nullptr, nullptr, 0), void())>
+    : std::true_type {};
+//===----------------------------------------------------------------------===//
+/// Forwards both iterators to the given position (if necessary).
+template<typename iter_ta, typename iter_tb>
+static void __forceinline__
+skip_both_to(iter_ta& it_a, iter_tb& it_b, const std::size_t to_pos,
+    std::false_type /* skip_to_many */) {
+  if (to_pos > it_a.pos()) it_a.skip_to(to_pos);
+  if (to_pos > it_b.pos()) it_b.skip_to(to_pos);
+}
+
+/// Forwards both iterators to the given position (if necessary). Both
+/// iterators are forwarded at once, which allows for interleaving the
+/// (independent) tree navigations.
+template<typename iter_t>
+static void __forceinline__
+skip_both_to(iter_t& it_a, iter_t& it_b, const std::size_t to_pos,
+    std::true_type /* skip_to_many */) {
+  iter_t* iters[2];
+  const std::size_t to_pos_arr[2] = { to_pos, to_pos };
+  std::size_t cnt = 0;
+  if (to_pos > it_a.pos()) iters[cnt++] = &it_a;
+  if (to_pos > it_b.pos()) iters[cnt++] = &it_b;
+  iter_t::skip_to_many(iters, to_pos_arr, cnt);
+}
+
+template<typename iter_ta, typename iter_tb>
+static void __forceinline__
+skip_both_to(iter_ta& it_a, iter_tb& it_b, const std::size_t to_pos) {
+  using batched = std::integral_constant<bool,
+      std::is_same<iter_ta, iter_tb>::value
+          && has_skip_to_many<iter_ta>::value>;
+  skip_both_to(it_a, it_b, to_pos, batched());
+}
+//===----------------------------------------------------------------------===//
 // Functors for bitwise operations.
 //===----------------------------------------------------------------------===//
 struct bitwise_and {
@@ -112,8 +156,7 @@ struct bitwise_or {
       u1 contiguous = begin_max <= end_min;
 
       if (contiguous) {
-        it_a.skip_to(end_max); // TODO not sure if that is the most efficient way
-        it_b.skip_to(end_max);
+        skip_both_to(it_a, it_b, end_max); // TODO not sure if that is the most efficient way
         // Produce an output.
         output_pos = begin_min;
         output_length = end_max - begin_min;
@@ -301,6 +344,60 @@ struct bitwise_xor_re {
   }
 };
 //===----------------------------------------------------------------------===//
+/// Computes A AND NOT B. The 1-fills of B are only used to cut the 1-fills of
+/// A, i.e., B is never iterated over the 0-fills of A, but forwarded using
+/// skip_to().
+struct bitwise_and_not {
+  template<typename iter_ta, typename iter_tb>
+  static void __forceinline__
+  first(iter_ta& it_a, iter_tb& it_b, $u64& output_pos, $u64& output_length) {
+    next(it_a, it_b, output_pos, output_length);
+  }
+
+  template<typename iter_ta, typename iter_tb>
+  static void __forceinline__
+  next(iter_ta& it_a, iter_tb& it_b, $u64& output_pos, $u64& output_length) {
+    while (!it_a.end()) {
+      const auto a_begin = it_a.pos();
+      const auto a_end = it_a.pos() + it_a.length();
+      if (it_b.end()) {
+        // Produce an output.
+        output_pos = a_begin;
+        output_length = a_end - a_begin;
+        it_a.next();
+        return;
+      }
+      const auto b_begin = it_b.pos();
+      const auto b_end = it_b.pos() + it_b.length();
+
+      if (b_end <= a_begin) {
+        // B is behind.
+        it_b.skip_to(a_begin);
+      }
+      else if (a_end <= b_begin) {
+        // Produce an output. The 1-fill of A is not affected by B.
+        output_pos = a_begin;
+        output_length = a_end - a_begin;
+        it_a.next();
+        return;
+      }
+      else if (a_begin < b_begin) {
+        // Produce an output. The 1-fill of A is cut by B.
+        output_pos = a_begin;
+        output_length = b_begin - a_begin;
+        it_a.skip_to(b_begin);
+        return;
+      }
+      else {
+        // The 1-fill of A begins within the 1-fill of B.
+        it_a.skip_to(b_end);
+      }
+    }
+    output_pos = 0;
+    output_length = 0;
+  }
+};
+//===----------------------------------------------------------------------===//
 /// Iterator template for bitwise operations.
 template<typename iter_ta, typename iter_tb, typename operation>
 class bitwise_iter {
@@ -335,11 +432,385 @@ public:
       return;
     }
     // TODO remove condition check. - the problem here is, that internally, the iterators were already advanced
-    if (to_pos > it_a_.pos()) it_a_.skip_to(to_pos);
-    if (to_pos > it_b_.pos()) it_b_.skip_to(to_pos);
+    skip_both_to(it_a_, it_b_, to_pos);
+    // Note: After skipping, the input iterators no longer necessarily
+    // overlap. Thus, we need to call first() instead of next().
+    operation::first(it_a_, it_b_, pos_, length_);
+  }
+
+  /// Returns true if the iterator reached the end, false otherwise.
+  u1 __forceinline__
+  end() const noexcept {
+    return length_ == 0;
+  }
+
+  /// Returns the starting position of the current 1-fill.
+  u64 __forceinline__
+  pos() const noexcept {
+    return pos_;
+  }
+
+  /// Returns the length of the current 1-fill.
+  u64 __forceinline__
+  length() const noexcept {
+    return length_;
+  }
+};
+//===----------------------------------------------------------------------===//
+// Reverse iteration.
+//===----------------------------------------------------------------------===//
+/// Moves a reverse iterator backwards, so that it no longer covers positions
+/// at or after 'to_pos' (if necessary).
+template<typename iter_t>
+static void __forceinline__
+skip_before(iter_t& it, const std::size_t to_pos) {
+  if (!it.end() && to_pos < it.pos() + it.length()) it.skip_to_before(to_pos);
+}
+//===----------------------------------------------------------------------===//
+/// Bitwise AND on reverse iterators, i.e., the mirror image of bitwise_and.
+struct bitwise_rev_and {
+  template<typename iter_ta, typename iter_tb>
+  static void __forceinline__
+  first(iter_ta& it_a, iter_tb& it_b, $u64& output_pos, $u64& output_length) {
+    while (!(it_a.end() || it_b.end())) {
+      const auto a_begin = it_a.pos();
+      const auto a_end = it_a.pos() + it_a.length();
+      const auto b_begin = it_b.pos();
+      const auto b_end = it_b.pos() + it_b.length();
+
+      const auto begin_max = (a_begin < b_begin) ? b_begin : a_begin;
+      const auto end_min = (a_end < b_end) ? a_end : b_end;
+      u1 overlap = begin_max < end_min;
+
+      if (overlap) {
+        // Produce an output.
+        output_pos = begin_max;
+        output_length = end_min - begin_max;
+        return;
+      }
+      else {
+        if (a_begin > b_begin) {
+          it_a.skip_to_before(b_end);
+        }
+        else {
+          it_b.skip_to_before(a_end);
+        }
+      }
+    }
+    output_pos = 0;
+    output_length = 0;
+  }
+
+  template<typename iter_ta, typename iter_tb>
+  static void __forceinline__
+  next(iter_ta& it_a, iter_tb& it_b, $u64& output_pos, $u64& output_length) {
+    // assert a and b overlap
+    {
+      const auto a_begin = it_a.pos();
+      const auto b_begin = it_b.pos();
+      if (a_begin >= b_begin) {
+        it_a.prev();
+      }
+      if (b_begin >= a_begin) {
+        it_b.prev();
+      }
+    }
+    first(it_a, it_b, output_pos, output_length);
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Bitwise OR on reverse iterators, i.e., the mirror image of bitwise_or.
+struct bitwise_rev_or {
+  template<typename iter_ta, typename iter_tb>
+  static void __forceinline__
+  first(iter_ta& it_a, iter_tb& it_b, $u64& output_pos, $u64& output_length) {
+    next(it_a, it_b, output_pos, output_length);
+  }
+
+  template<typename iter_ta, typename iter_tb>
+  static void __forceinline__
+  next(iter_ta& it_a, iter_tb& it_b, $u64& output_pos, $u64& output_length) {
+    while (!(it_a.end() || it_b.end())) {
+      const auto a_begin = it_a.pos();
+      const auto a_end = it_a.pos() + it_a.length();
+      const auto b_begin = it_b.pos();
+      const auto b_end = it_b.pos() + it_b.length();
+
+      const auto begin_min = (a_begin > b_begin) ? b_begin : a_begin;
+      const auto begin_max = (a_begin < b_begin) ? b_begin : a_begin;
+      const auto end_min = (a_end < b_end) ? a_end : b_end;
+      const auto end_max = (a_end > b_end) ? a_end : b_end;
+      u1 contiguous = begin_max <= end_min;
+
+      if (contiguous) {
+        skip_before(it_a, begin_min);
+        skip_before(it_b, begin_min);
+        // Produce an output.
+        output_pos = begin_min;
+        output_length = end_max - begin_min;
+        return;
+      }
+      else {
+        if (a_begin > b_end) {
+          it_a.prev();
+          // Produce an output.
+          output_pos = a_begin;
+          output_length = a_end - a_begin;
+          return;
+        }
+        else if (b_begin > a_end) {
+          it_b.prev();
+          // Produce an output.
+          output_pos = b_begin;
+          output_length = b_end - b_begin;
+          return;
+        }
+      }
+    }
+    if (!it_a.end()) {
+      // Produce an output.
+      output_pos = it_a.pos();
+      output_length = it_a.length();
+      it_a.prev();
+      return;
+    }
+    if (!it_b.end()) {
+      // Produce an output.
+      output_pos = it_b.pos();
+      output_length = it_b.length();
+      it_b.prev();
+      return;
+    }
+    output_pos = 0;
+    output_length = 0;
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Iterator template for bitwise operations on reverse iterators, i.e., the
+/// 1-fills are produced in descending order. The input iterators need to
+/// support prev() and skip_to_before().
+template<typename iter_ta, typename iter_tb, typename operation>
+class bitwise_rev_iter {
+  /// The first input iterator.
+  iter_ta it_a_;
+  /// The second input iterator.
+  iter_tb it_b_;
+  /// Points to the beginning of the current 1-fill.
+  $u64 pos_ = 0;
+  /// The length of the current 1-fill.
+  $u64 length_ = 0;
+
+public:
+  bitwise_rev_iter(iter_ta&& it_a, iter_tb&& it_b)
+      : it_a_(std::move(it_a)), it_b_(std::move(it_b)) {
+    operation::first(it_a_, it_b_, pos_, length_);
+  }
+
+  __forceinline__
+  bitwise_rev_iter(bitwise_rev_iter&&) = default;
+
+  void __forceinline__
+  prev() noexcept __attribute__((flatten, hot)) {
     operation::next(it_a_, it_b_, pos_, length_);
   }
 
+  void __forceinline__
+  skip_to_before(const std::size_t to_pos) noexcept {
+    if (to_pos > pos_) {
+      length_ = std::min(length_, to_pos - pos_);
+      return;
+    }
+    skip_before(it_a_, to_pos);
+    skip_before(it_b_, to_pos);
+    // Note: After skipping, the input iterators no longer necessarily
+    // overlap. Thus, we need to call first() instead of next().
+    operation::first(it_a_, it_b_, pos_, length_);
+  }
+
+  /// Returns true if the iterator reached the end, false otherwise.
+  u1 __forceinline__
+  end() const noexcept {
+    return length_ == 0;
+  }
+
+  /// Returns the starting position of the current 1-fill.
+  u64 __forceinline__
+  pos() const noexcept {
+    return pos_;
+  }
+
+  /// Returns the length of the current 1-fill.
+  u64 __forceinline__
+  length() const noexcept {
+    return length_;
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Iterator for the bitwise XOR, where the second input is supposed to be
+/// sparse, e.g., the pending updates of a differential bitmap. The 1-fills of
+/// the first input that end before the next 1-fill of the second input are
+/// passed through as is, i.e., the XOR logic is only engaged in the vicinity
+/// of the (few) 1-fills of the second input. If the second input is empty,
+/// the iterator degenerates to the first input iterator.
+template<typename iter_ta, typename iter_tb>
+class bitwise_xor_sparse_iter {
+  /// The first input iterator.
+  iter_ta it_a_;
+  /// The second (sparse) input iterator.
+  iter_tb it_b_;
+  /// The beginning of the current 1-fill of the second input, or the max
+  /// value if the second input reached its end.
+  $u64 b_pos_;
+  /// Points to the beginning of the current 1-fill.
+  $u64 pos_ = 0;
+  /// The length of the current 1-fill.
+  $u64 length_ = 0;
+
+  void __forceinline__
+  read_b_pos() noexcept {
+    b_pos_ = it_b_.end() ? ~$u64(0) : it_b_.pos();
+  }
+
+  /// Produces the next output.
+  void __forceinline__
+  advance() noexcept {
+    if (!it_a_.end() && it_a_.pos() + it_a_.length() <= b_pos_) {
+      // Fast path. The 1-fill ends before the next pending update.
+      pos_ = it_a_.pos();
+      length_ = it_a_.length();
+      it_a_.next();
+      return;
+    }
+    bitwise_xor::next(it_a_, it_b_, pos_, length_);
+    read_b_pos();
+  }
+
+public:
+  bitwise_xor_sparse_iter(iter_ta&& it_a, iter_tb&& it_b)
+      : it_a_(std::move(it_a)), it_b_(std::move(it_b)) {
+    read_b_pos();
+    advance();
+  }
+
+  __forceinline__
+  bitwise_xor_sparse_iter(bitwise_xor_sparse_iter&&) = default;
+
+  void __forceinline__
+  next() noexcept __attribute__((flatten, hot)) {
+    advance();
+  }
+
+  void __forceinline__
+  skip_to(const std::size_t to_pos) noexcept {
+    if (to_pos < (pos_ + length_)) {
+      length_ -= to_pos - pos_;
+      pos_ = to_pos;
+      return;
+    }
+    if (to_pos > it_a_.pos()) it_a_.skip_to(to_pos);
+    // The second input is only forwarded, if it is behind.
+    if (to_pos > b_pos_) {
+      it_b_.skip_to(to_pos);
+      read_b_pos();
+    }
+    advance();
+  }
+
+  /// Returns true if the iterator reached the end, false otherwise.
+  u1 __forceinline__
+  end() const noexcept {
+    return length_ == 0;
+  }
+
+  /// Returns the starting position of the current 1-fill.
+  u64 __forceinline__
+  pos() const noexcept {
+    return pos_;
+  }
+
+  /// Returns the length of the current 1-fill.
+  u64 __forceinline__
+  length() const noexcept {
+    return length_;
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Run iterator that represents the complement of the given input iterator
+/// within the range [0, n). The 0-fills of the input are emitted as 1-fills,
+/// thus the complement is never materialized.
+template<typename iter_t>
+class complement_iter {
+  /// The input iterator.
+  iter_t it_;
+  /// The length of the bitmap.
+  $u64 n_;
+  /// The position up to which the input has been consumed.
+  $u64 cur_ = 0;
+  /// Points to the beginning of the current 1-fill.
+  $u64 pos_ = 0;
+  /// The length of the current 1-fill.
+  $u64 length_ = 0;
+
+  /// Produces the next output, i.e., the gap between the current position and
+  /// the next 1-fill of the input.
+  void __forceinline__
+  advance() noexcept {
+    while (cur_ < n_) {
+      if (it_.end() || it_.pos() >= n_) {
+        // Produce an output. The remainder of the bitmap is 0 in the input.
+        pos_ = cur_;
+        length_ = n_ - cur_;
+        cur_ = n_;
+        return;
+      }
+      if (it_.pos() > cur_) {
+        // Produce an output.
+        pos_ = cur_;
+        length_ = it_.pos() - cur_;
+        cur_ = it_.pos();
+        return;
+      }
+      // The input 1-fill covers the current position.
+      const auto run_end = it_.pos() + it_.length();
+      cur_ = std::max(cur_, run_end);
+      it_.next();
+    }
+    pos_ = n_;
+    length_ = 0;
+  }
+
+public:
+  complement_iter(iter_t&& it, std::size_t n)
+      : it_(std::move(it)), n_(n) {
+    advance();
+  }
+
+  __forceinline__
+  complement_iter(complement_iter&&) = default;
+
+  void __forceinline__
+  next() noexcept __attribute__((flatten, hot)) {
+    advance();
+  }
+
+  void __forceinline__
+  skip_to(const std::size_t to_pos) noexcept {
+    if (to_pos < (pos_ + length_)) {
+      length_ -= to_pos - pos_;
+      pos_ = to_pos;
+      return;
+    }
+    if (to_pos >= n_) {
+      cur_ = n_;
+      pos_ = n_;
+      length_ = 0;
+      return;
+    }
+    cur_ = std::max(cur_, $u64(to_pos));
+    if (!it_.end() && to_pos > it_.pos()) it_.skip_to(to_pos);
+    advance();
+  }
+
   /// Returns true if the iterator reached the end, false otherwise.
   u1 __forceinline__
   end() const noexcept {
@@ -398,4 +869,51 @@ bitwise_xor_re_it(iter_ta&& it_a, iter_tb&& it_b) {
       std::forward<iter_ta>(it_a), std::forward<iter_tb>(it_b));
 };
 //===----------------------------------------------------------------------===//
+/// Constructs a run iterator that represents the logical exclusive
+/// disjunction of the given input iterators. The second input is supposed to
+/// be sparse (see bitwise_xor_sparse_iter).
+template<typename iter_ta, typename iter_tb>
+auto __forceinline__
+bitwise_xor_sparse_it(iter_ta&& it_a, iter_tb&& it_b) {
+  return internal::bitwise_xor_sparse_iter<iter_ta, iter_tb>(
+      std::forward<iter_ta>(it_a), std::forward<iter_tb>(it_b));
+};
+//===----------------------------------------------------------------------===//
+/// Constructs a run iterator that represents the logical conjunction of the
+/// first input and the negated second input, i.e., A AND NOT B.
+template<typename iter_ta, typename iter_tb>
+auto __forceinline__
+bitwise_and_not_it(iter_ta&& it_a, iter_tb&& it_b) {
+  return internal::bitwise_iter<iter_ta, iter_tb, internal::bitwise_and_not>(
+      std::forward<iter_ta>(it_a), std::forward<iter_tb>(it_b));
+};
+//===----------------------------------------------------------------------===//
+/// Constructs a reverse run iterator that represents the logical conjunction
+/// of the given reverse input iterators.
+template<typename iter_ta, typename iter_tb>
+auto __forceinline__
+bitwise_and_rev_it(iter_ta&& it_a, iter_tb&& it_b) {
+  return internal::bitwise_rev_iter<iter_ta, iter_tb,
+      internal::bitwise_rev_and>(
+      std::forward<iter_ta>(it_a), std::forward<iter_tb>(it_b));
+};
+//===----------------------------------------------------------------------===//
+/// Constructs a reverse run iterator that represents the logical disjunction
+/// of the given reverse input iterators.
+template<typename iter_ta, typename iter_tb>
+auto __forceinline__
+bitwise_or_rev_it(iter_ta&& it_a, iter_tb&& it_b) {
+  return internal::bitwise_rev_iter<iter_ta, iter_tb,
+      internal::bitwise_rev_or>(
+      std::forward<iter_ta>(it_a), std::forward<iter_tb>(it_b));
+};
+//===----------------------------------------------------------------------===//
+/// Constructs a run iterator that represents the negation of the given input
+/// iterator, where n is the length of the bitmap.
+template<typename iter_t>
+auto __forceinline__
+complement_it(iter_t&& it, std::size_t n) {
+  return internal::complement_iter<iter_t>(std::forward<iter_t>(it), n);
+};
+//===----------------------------------------------------------------------===//
 } // namespace dtl
@@ -1,11 +1,13 @@
 #pragma once
 //===----------------------------------------------------------------------===//
 #include <dtl/bitmap/bitwise_operations.hpp>
+#include <dtl/bitmap/util/bitmap_fun.hpp>
 #include <dtl/dtl.hpp>
 
 #include <boost/dynamic_bitset.hpp>
 
 #include <memory>
+#include <type_traits>
 //===----------------------------------------------------------------------===//
 namespace dtl {
 //===----------------------------------------------------------------------===//
@@ -17,13 +19,16 @@ namespace dtl {
 /// bitmap.
 ///
 /// Note that read accesses become more costly, as the XOR of the bitmap and
-/// diff needs to be computed on-the-fly.
+/// diff needs to be computed on-the-fly. To keep the overhead low, the XOR
+/// logic is only engaged in the vicinity of pending updates, and it is
+/// skipped entirely if there are no pending updates.
 template<
     /// The (compressed) bitmap type.
     typename B,
     /// The differential data structure to use.
     typename D>
 class diff {
+protected:
   /// The (compressed) bitmap.
   std::unique_ptr<B> bitmap_;
   /// Contains the pending updates.
@@ -41,6 +46,16 @@ public:
         diff_(std::make_unique<D>(bitmap.size())),
         has_pending_updates_(false) {}
 
+  /// C'tor. The additional argument is passed to the c'tor of the bitmap, e.g.,
+  /// to reserve space for in-place updates.
+  template<typename A, typename = typename std::enable_if<
+      std::is_constructible<B, const boost::dynamic_bitset<$u32>&,
+          const A&>::value>::type>
+  diff(const boost::dynamic_bitset<$u32>& bitmap, const A& bitmap_arg)
+      : bitmap_(std::make_unique<B>(bitmap, bitmap_arg)),
+        diff_(std::make_unique<D>(bitmap.size())),
+        has_pending_updates_(false) {}
+
   /// Return the name of the implementation.
   static std::string
   name() noexcept {
@@ -129,6 +144,7 @@ public:
     // cancelled run-breaking update -> diff update
     // update_res != 0 implies actual value == !val -> flip diff_val
     if (update_res == 2) {
+      has_pending_updates_ = true;
       diff_->set(i, !diff_val);
       diff_->shrink();
       return 2;
@@ -150,6 +166,7 @@ public:
     // Clear the diff.
     std::unique_ptr<D> empty_diff = std::make_unique<D>(bitmap_->size());
     std::swap(diff_, empty_diff);
+    has_pending_updates_ = false;
   }
 
   /// Try to reduce the memory consumption. This function is supposed to be
@@ -165,26 +182,48 @@ public:
   /// Returns the value of the bit at the given position.
   u1 __forceinline__
   test(const std::size_t pos) const noexcept {
+    if (!has_pending_updates_) return bitmap_->test(pos);
     return bitmap_->test(pos) ^ diff_->test(pos);
   }
 
+  /// Decodes the bits in [b, e) into the given (plain) bitmap, whereby the
+  /// bit at position b is written to the least significant bit of dst[0].
+  /// The destination needs to provide space for (e - b + 63) / 64 words.
+  /// The pending updates are applied directly to the decoded words.
+  void
+  fetch_words(std::size_t b, std::size_t e, $u64* dst) const noexcept {
+    bitmap_->fetch_words(b, e, dst);
+    if (!has_pending_updates_) return;
+    e = std::min(e, size());
+    auto it = diff_->it();
+    if (!it.end() && it.pos() < b) {
+      it.skip_to(b);
+    }
+    while (!it.end() && it.pos() < e) {
+      const auto run_begin = std::max(std::size_t(it.pos()), b);
+      const auto run_end = std::min(std::size_t(it.pos() + it.length()), e);
+      dtl::bitmap_fun<$u64>::flip(dst, run_begin - b, run_end - b);
+      it.next();
+    }
+  }
+
   using skip_iter_type =
-      decltype(dtl::bitwise_xor_it(bitmap_->it(), diff_->it()));
+      decltype(dtl::bitwise_xor_sparse_it(bitmap_->it(), diff_->it()));
   // We always use the skip iterator for the diff, as the diffs are supposed
   // to be small.
   using scan_iter_type =
-      decltype(dtl::bitwise_xor_it(bitmap_->scan_it(), diff_->it()));
+      decltype(dtl::bitwise_xor_sparse_it(bitmap_->scan_it(), diff_->it()));
 
   /// Returns a 1-run iterator, with efficient skip support.
   skip_iter_type __forceinline__
   it() const noexcept {
-    return dtl::bitwise_xor_it(bitmap_->it(), diff_->it());
+    return dtl::bitwise_xor_sparse_it(bitmap_->it(), diff_->it());
   }
 
   /// Returns a 1-run iterator, with WITHOUT efficient skip support.
   scan_iter_type __forceinline__
   scan_it() const noexcept {
-    return dtl::bitwise_xor_it(bitmap_->scan_it(), diff_->it());
+    return dtl::bitwise_xor_sparse_it(bitmap_->scan_it(), diff_->it());
   }
 
   /// Returns a pointer to the compressed bitmap.
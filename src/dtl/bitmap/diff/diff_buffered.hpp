@@ -0,0 +1,325 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "diff.hpp"
+
+#include <dtl/dtl.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <immintrin.h>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// Extends the differential bitmap by an append-only update log, that is
+/// placed in front of the differential data structure.
+///
+/// Point updates (set) are appended to the log without taking any locks. The
+/// log is sharded; each writer thread is assigned to one shard, so that
+/// concurrent writers (up to the number of shards) do not share any cache
+/// lines, except for a global sequence counter, which is used to establish
+/// a total order among all logged updates. If there are more writers than
+/// shards, a shard is shared by multiple writers. Each log entry is published
+/// individually, thus, readers never observe a reserved but not yet written
+/// entry, regardless of the order in which the writers complete their
+/// appends. Once a shard is full, the entire
+/// log is drained, i.e., the logged updates are sorted by position and
+/// applied to the differential data structure in a single batch. Thus, the
+/// (expensive) shrink() of the differential data structure is called once per
+/// batch rather than once per update.
+///
+/// Thread-safety: set() and test() can be called concurrently. Point lookups
+/// (test) consult both, the log and the differential data structure, and
+/// therefore exclude concurrent drains using the drain mutex. All other
+/// functions must not be called concurrently with set(). The remaining read
+/// functions drain the log first, so that iterators are not affected by the
+/// log.
+template<
+    /// The (compressed) bitmap type.
+    typename B,
+    /// The differential data structure to use.
+    typename D,
+    /// The number of log shards.
+    std::size_t SHARD_CNT = 16,
+    /// The capacity of a single shard (number of updates).
+    std::size_t SHARD_CAPACITY = 256>
+class diff_buffered : public diff<B, D> {
+  using base = diff<B, D>;
+
+  /// A logged update.
+  struct log_entry {
+    /// The position of the bit to update.
+    $u64 pos;
+    /// The sequence number (upper 63 bits) and the value (lowest bit). The
+    /// sequence numbers start at 1.
+    $u64 seq_val;
+
+    u64 __forceinline__ seq() const noexcept { return seq_val >> 1; }
+    u1 __forceinline__ val() const noexcept { return (seq_val & 1) != 0; }
+  };
+
+  /// A slot in the log. The entry is published by storing its (non-zero)
+  /// 'seq_val' with release semantics; a zero value refers to an empty slot
+  /// or an entry that is currently being written.
+  struct log_slot {
+    $u64 pos;
+    std::atomic<$u64> seq_val { 0 };
+  };
+
+  /// A single log shard. Writers reserve slots using an atomic increment on
+  /// 'reserved' and publish each entry individually.
+  struct alignas(64) shard {
+    std::atomic<$u64> reserved { 0 };
+    log_slot slots[SHARD_CAPACITY];
+  };
+
+  struct log {
+    shard shards[SHARD_CNT];
+    /// Generates the sequence numbers.
+    alignas(64) std::atomic<$u64> seq { 0 };
+    /// Serializes the drain operations.
+    std::mutex drain_mutex;
+  };
+
+  /// The update log.
+  std::unique_ptr<log> log_;
+
+  /// Returns the shard of the calling thread.
+  static std::size_t __forceinline__
+  thread_shard_idx() noexcept {
+    static std::atomic<$u64> thread_cntr { 0 };
+    static thread_local u64 thread_id = thread_cntr.fetch_add(1);
+    return thread_id % SHARD_CNT;
+  }
+
+  /// Applies all logged updates to the differential data structure and clears
+  /// the log. The caller must hold the drain mutex.
+  void
+  drain() {
+    // Close all shards and collect the logged updates. Concurrent writers that
+    // try to append to a closed shard wait for the drain to complete.
+    std::vector<log_entry> entries;
+    for (std::size_t s = 0; s < SHARD_CNT; ++s) {
+      auto& sh = log_->shards[s];
+      const auto r = sh.reserved.exchange(SHARD_CAPACITY,
+          std::memory_order_acq_rel);
+      const auto n = std::min(r, static_cast<$u64>(SHARD_CAPACITY));
+      for (std::size_t i = 0; i < n; ++i) {
+        auto& slot = sh.slots[i];
+        // Wait for in-flight appends.
+        $u64 seq_val;
+        while ((seq_val = slot.seq_val.load(std::memory_order_acquire)) == 0) {
+          _mm_pause();
+        }
+        entries.push_back(log_entry { slot.pos, seq_val });
+        slot.seq_val.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    if (!entries.empty()) {
+      // Sort the updates by position, and within the same position, by
+      // sequence number.
+      std::sort(entries.begin(), entries.end(),
+          [](const log_entry& a, const log_entry& b) {
+            return a.pos < b.pos || (a.pos == b.pos && a.seq() < b.seq());
+          });
+      $u1 modified = false;
+      for (std::size_t i = 0; i < entries.size(); ++i) {
+        // Only the most recent update of each position needs to be applied.
+        if (i + 1 < entries.size() && entries[i + 1].pos == entries[i].pos) {
+          continue;
+        }
+        const auto pos = entries[i].pos;
+        u1 bitmap_val = this->bitmap_->test(pos);
+        u1 diff_val = this->diff_->test(pos);
+        if ((bitmap_val ^ diff_val) != entries[i].val()) {
+          this->diff_->set(pos, !diff_val);
+          modified = true;
+        }
+      }
+      if (modified) {
+        this->has_pending_updates_ = true;
+        this->diff_->shrink();
+      }
+    }
+
+    // Re-open the shards. The release store also publishes the cleared
+    // slots.
+    for (std::size_t s = 0; s < SHARD_CNT; ++s) {
+      log_->shards[s].reserved.store(0, std::memory_order_release);
+    }
+  }
+
+public:
+  using bitmap_type = B;
+  using diff_type = D;
+
+  /// C'tor (similar to all other implementations)
+  diff_buffered(const boost::dynamic_bitset<$u32>& bitmap)
+      : base(bitmap),
+        log_(std::make_unique<log>()) {}
+
+  /// Return the name of the implementation.
+  static std::string
+  name() noexcept {
+    return std::string("diff_buffered<")
+        + B::name() + std::string(",") + D::name()
+        + std::string(">");
+  }
+
+  /// Return the size in bytes.
+  std::size_t __forceinline__
+  size_in_bytes() const noexcept {
+    return base::size_in_bytes() + sizeof(log) + 8 /* one pointer */;
+  }
+
+  /// Returns the name of the instance including the most important parameters
+  /// in JSON.
+  std::string
+  info() const noexcept {
+    return "{\"name\":\"" + name() + "\""
+        + ",\"bitmap\":" + this->bitmap_->info()
+        + ",\"diff\":" + this->diff_->info()
+        + ",\"shard_cnt\":" + std::to_string(SHARD_CNT)
+        + ",\"shard_capacity\":" + std::to_string(SHARD_CAPACITY)
+        + "}";
+  }
+
+  /// For debugging purposes.
+  void
+  print(std::ostream& os) const {
+    flush();
+    base::print(os);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Update related functions.
+  //===--------------------------------------------------------------------===//
+  /// Set the i-th bit to the given value. (thread-safe)
+  void __forceinline__
+  set(std::size_t i, u1 val) {
+    auto& sh = log_->shards[thread_shard_idx()];
+    while (true) {
+      const auto idx = sh.reserved.fetch_add(1, std::memory_order_acq_rel);
+      if (idx < SHARD_CAPACITY) {
+        auto& slot = sh.slots[idx];
+        slot.pos = i;
+        const auto seq = log_->seq.fetch_add(1, std::memory_order_relaxed) + 1;
+        slot.seq_val.store((seq << 1) | static_cast<$u64>(val),
+            std::memory_order_release);
+        return;
+      }
+      // The shard is full or it is currently being drained.
+      std::lock_guard<std::mutex> lock(log_->drain_mutex);
+      if (sh.reserved.load(std::memory_order_acquire) >= SHARD_CAPACITY) {
+        drain();
+      }
+    }
+  }
+
+  /// Applies the logged updates to the differential data structure. Note that
+  /// this function does not alter the bitmap contents.
+  void
+  flush() const {
+    auto self = const_cast<diff_buffered*>(this);
+    std::lock_guard<std::mutex> lock(log_->drain_mutex);
+    self->drain();
+  }
+
+  /// Returns the number of logged updates, that have not been applied to the
+  /// differential data structure yet.
+  std::size_t
+  logged_update_cnt() const noexcept {
+    std::size_t cnt = 0;
+    for (std::size_t s = 0; s < SHARD_CNT; ++s) {
+      cnt += std::min(log_->shards[s].reserved.load(),
+          static_cast<$u64>(SHARD_CAPACITY));
+    }
+    return cnt;
+  }
+
+  /// Hybrid update. See diff::update().
+  int
+  update(std::size_t i, u1 val, u1 two_run_opt = false) {
+    flush();
+    return base::update(i, val, two_run_opt);
+  }
+
+  /// Apply the pending updates and clear the diff.
+  template<typename M>
+  void
+  merge() {
+    flush();
+    base::template merge<M>();
+  }
+
+  /// Try to reduce the memory consumption.
+  void __forceinline__
+  shrink() {
+    flush();
+    base::shrink();
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Read related functions.
+  //===--------------------------------------------------------------------===//
+  /// Returns the value of the bit at the given position. (thread-safe)
+  u1 __forceinline__
+  test(const std::size_t pos) const {
+    // Prevent concurrent drains, which modify the differential data
+    // structure.
+    std::lock_guard<std::mutex> lock(log_->drain_mutex);
+    // Look for the most recent update in the log.
+    $u1 found = false;
+    $u1 val = false;
+    $u64 seq = 0;
+    for (std::size_t s = 0; s < SHARD_CNT; ++s) {
+      const auto& sh = log_->shards[s];
+      const auto n = std::min(sh.reserved.load(std::memory_order_acquire),
+          static_cast<$u64>(SHARD_CAPACITY));
+      for (std::size_t i = 0; i < n; ++i) {
+        const log_entry e { 0,
+            sh.slots[i].seq_val.load(std::memory_order_acquire) };
+        // Skip the entries that have not been published yet.
+        if (e.seq_val == 0) continue;
+        if (sh.slots[i].pos == pos && (!found || e.seq() > seq)) {
+          found = true;
+          val = e.val();
+          seq = e.seq();
+        }
+      }
+    }
+    return found ? val : base::test(pos);
+  }
+
+  using skip_iter_type = typename base::skip_iter_type;
+  using scan_iter_type = typename base::scan_iter_type;
+
+  /// Returns a 1-run iterator, with efficient skip support.
+  skip_iter_type __forceinline__
+  it() const {
+    flush();
+    return base::it();
+  }
+
+  /// Returns a 1-run iterator, with WITHOUT efficient skip support.
+  scan_iter_type __forceinline__
+  scan_it() const {
+    flush();
+    return base::scan_it();
+  }
+
+  /// Returns a pointer to the diff. The log is drained first.
+  D*
+  get_diff() const {
+    flush();
+    return base::get_diff();
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
@@ -52,7 +52,7 @@ struct merge_naive_iter {
   void
   merge(std::unique_ptr<B>& bitmap, std::unique_ptr<D>& diff) {
     // Decompress the bitmap and XOR the diff on-the-fly.
-    auto it = dtl::bitwise_xor_it(bitmap->scan_it(), diff->it());
+    auto it = dtl::bitwise_xor_sparse_it(bitmap->scan_it(), diff->it());
     auto plain_bitmap = dtl::to_bitmap_from_iterator(it, bitmap->size());
 
     // Re-compress the bitmap.
@@ -1,6 +1,7 @@
 #pragma once
 //===----------------------------------------------------------------------===//
 #include <dtl/bitmap/bitwise_operations.hpp>
+#include <dtl/bitmap/diff/merge.hpp>
 #include <dtl/bitmap/util/bitmap_fun.hpp>
 #include <dtl/bitmap/util/convert.hpp>
 #include <dtl/bitmap/util/mutable_bitmap_tree.hpp>
@@ -49,4 +50,88 @@ struct merge_tree {
   }
 };
 //===----------------------------------------------------------------------===//
+/// Applies the updates in place, using the in-place update logic of the TEB.
+/// The diff is processed in a single sorted pass, and the modified subtrees
+/// are pruned afterwards. The reserved space of the TEB grows as needed.
+///
+/// Each run-breaking update shifts the tree and label bits to the right of
+/// the update position. If the estimated shift volume exceeds the costs of a
+/// rebuild, which is linear in the bitmap size, the strategy falls back to
+/// the naive merge.
+template<
+    /// The (compressed) bitmap type.
+    typename B,
+    /// The differential data structure to use.
+    typename D>
+struct merge_inplace_teb {
+  /// The factor by which the reserved space grows, if it is exhausted.
+  static constexpr f64 growth_factor = 2.0;
+
+  /// Returns true if the estimated costs of the in-place updates are below
+  /// the costs of a rebuild. - An update shifts half of the encoded bits on
+  /// average and it updates the rank LuT, which together is roughly as
+  /// expensive as processing all encoded words once. A rebuild decompresses
+  /// the bitmap and constructs the tree bit by bit, which is significantly
+  /// more expensive than shifting the n/64 words of the uncompressed bitmap.
+  /// The rebuild costs are therefore weighted by a factor of 8, i.e.,
+  /// n/8 words, which is still a conservative bound. (Measured on x86, a
+  /// rebuild takes about as long as shifting n words, or longer.)
+  static u1
+  prefer_inplace(const B& bitmap, const D& diff) {
+    const auto& teb = *bitmap.teb_;
+    const std::size_t words_per_update =
+        (teb.tree_bit_cnt_ + teb.label_bit_cnt_) / teb.word_bitlength + 1;
+    const std::size_t rebuild_cost = 8 * (bitmap.size() / teb.word_bitlength);
+    std::size_t cost = 0;
+    auto it = diff.it();
+    while (!it.end()) {
+      cost += it.length() * words_per_update;
+      if (cost > rebuild_cost) return false;
+      it.next();
+    }
+    return true;
+  }
+
+  void __attribute__((noinline))
+  merge(std::unique_ptr<B>& bitmap, std::unique_ptr<D>& diff) {
+    if (!prefer_inplace(*bitmap, *diff)) {
+      merge_naive_iter<B, D>().merge(bitmap, diff);
+      return;
+    }
+
+    auto it = diff->it();
+    while (!it.end()) {
+      const auto b = it.pos();
+      const auto e = it.length() + b;
+      for (std::size_t i = b; i < e; ++i) {
+        if (bitmap->update_growing(i, !bitmap->test(i), growth_factor) == 2) {
+          // The update cannot be performed in place. Apply the remaining
+          // updates to the decompressed bitmap and re-compress it. The
+          // reserved space and the growth factor of the TEB are retained.
+          auto plain_bitmap = dtl::to_bitmap_using_iterator(*bitmap);
+          for (std::size_t j = i; j < e; ++j) {
+            plain_bitmap.flip(j);
+          }
+          it.next();
+          while (!it.end()) {
+            for (std::size_t j = it.pos(); j < it.pos() + it.length(); ++j) {
+              plain_bitmap.flip(j);
+            }
+            it.next();
+          }
+          bitmap->reencode(plain_bitmap);
+          return;
+        }
+      }
+      it.next();
+    }
+    bitmap->prune_dirty();
+  }
+
+  static std::string
+  name() {
+    return "inplace_teb_merge";
+  }
+};
+//===----------------------------------------------------------------------===//
 } // namespace dtl
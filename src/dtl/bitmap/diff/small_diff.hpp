@@ -0,0 +1,416 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include <dtl/bitmap/util/bitmap_fun.hpp>
+#include <dtl/dtl.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <string>
+#include <vector>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// Differential data structure, specialized for small diffs as produced by
+/// the hybrid update scheme, where only the run-breaking updates end up in the
+/// diff.
+///
+/// The set bits are stored as a sorted vector of positions. New positions are
+/// first appended to a small unsorted buffer, which is merged into the vector
+/// once it is full. Thereby, the (amortized) cost of an insert is
+/// O(k / buffer_capacity) for k set bits. Once the diff becomes dense (more
+/// than one set bit per 'dense_threshold' bits), it switches to an
+/// uncompressed bitmap, and it switches back to the sorted vector when it
+/// becomes sparse again.
+///
+/// In contrast to Roaring or WAH, shrinking is cheap, as the structure never
+/// needs to be re-compressed.
+class small_diff {
+public:
+  using position_t = $u32;
+  using word_type = $u64;
+  using bitmap_fn = dtl::bitmap_fun<word_type>;
+
+  /// The max number of positions in the unsorted insert buffer.
+  static constexpr std::size_t buffer_capacity = 16;
+  /// Switch to the uncompressed representation when the number of set bits
+  /// exceeds n / dense_threshold, which is where the uncompressed bitmap
+  /// becomes smaller than the position list.
+  static constexpr std::size_t dense_threshold = sizeof(position_t) * 8;
+
+private:
+  /// The length of the bitmap.
+  std::size_t n_;
+  /// The number of set bits.
+  std::size_t cnt_ = 0;
+  /// The sorted positions (sparse representation).
+  std::vector<position_t> sorted_;
+  /// The recently inserted positions, not yet merged into 'sorted_'.
+  std::array<position_t, buffer_capacity> buffer_;
+  /// The number of positions in the insert buffer.
+  std::size_t buffer_cnt_ = 0;
+  /// The uncompressed bitmap (dense representation). Empty, if the sparse
+  /// representation is used.
+  std::vector<word_type> dense_;
+
+  /// Returns true if the uncompressed representation is used.
+  u1 __forceinline__
+  is_dense() const noexcept {
+    return !dense_.empty();
+  }
+
+  /// Merges the insert buffer into the sorted vector.
+  void
+  flush_buffer() {
+    if (buffer_cnt_ == 0) return;
+    std::sort(buffer_.begin(), buffer_.begin() + buffer_cnt_);
+    const auto mid = sorted_.size();
+    sorted_.insert(sorted_.end(),
+        buffer_.begin(), buffer_.begin() + buffer_cnt_);
+    std::inplace_merge(sorted_.begin(), sorted_.begin() + mid, sorted_.end());
+    buffer_cnt_ = 0;
+  }
+
+  /// Switches to the uncompressed representation.
+  void
+  to_dense() {
+    dense_.assign((n_ + bitmap_fn::word_bitlength - 1)
+        / bitmap_fn::word_bitlength, 0);
+    for (auto pos : sorted_) bitmap_fn::set(dense_.data(), pos);
+    for (std::size_t i = 0; i < buffer_cnt_; ++i) {
+      bitmap_fn::set(dense_.data(), buffer_[i]);
+    }
+    std::vector<position_t>().swap(sorted_);
+    buffer_cnt_ = 0;
+  }
+
+  /// Switches to the sparse representation.
+  void
+  to_sparse() {
+    sorted_.reserve(cnt_);
+    const auto* bitmap = dense_.data();
+    for (std::size_t i = bitmap_fn::find_first(bitmap, 0, n_); i < n_;
+        i = bitmap_fn::find_first(bitmap, i + 1, n_)) {
+      sorted_.push_back(static_cast<position_t>(i));
+    }
+    std::vector<word_type>().swap(dense_);
+  }
+
+  /// Returns the position of the given value in the insert buffer, or
+  /// buffer_capacity if it is not contained.
+  std::size_t __forceinline__
+  find_in_buffer(position_t pos) const noexcept {
+    for (std::size_t i = 0; i < buffer_cnt_; ++i) {
+      if (buffer_[i] == pos) return i;
+    }
+    return buffer_capacity;
+  }
+
+public:
+  /// Constructs an empty bitmap of size n.
+  explicit small_diff(std::size_t n) : n_(n) {}
+
+  /// C'tor (similar to all other implementations)
+  explicit small_diff(const boost::dynamic_bitset<$u32>& in)
+      : n_(in.size()) {
+    auto i = in.find_first();
+    while (i != boost::dynamic_bitset<$u32>::npos) {
+      sorted_.push_back(static_cast<position_t>(i));
+      i = in.find_next(i);
+    }
+    cnt_ = sorted_.size();
+    shrink();
+  }
+
+  small_diff(const small_diff& other) = default;
+  small_diff(small_diff&& other) noexcept = default;
+  small_diff& operator=(const small_diff& other) = default;
+  small_diff& operator=(small_diff&& other) noexcept = default;
+  ~small_diff() = default;
+
+  /// Returns the value of the bit at the position pos.
+  u1 __forceinline__
+  test(const std::size_t pos) const noexcept {
+    if (is_dense()) {
+      return bitmap_fn::test(dense_.data(), pos);
+    }
+    const auto p = static_cast<position_t>(pos);
+    return find_in_buffer(p) != buffer_capacity
+        || std::binary_search(sorted_.begin(), sorted_.end(), p);
+  }
+
+  /// Set the i-th bit to the given value.
+  void __forceinline__
+  set(std::size_t i, u1 val) {
+    assert(i < n_);
+    if (is_dense()) {
+      if (bitmap_fn::test(dense_.data(), i) == val) return;
+      bitmap_fn::set(dense_.data(), i, val);
+      cnt_ += val ? 1 : -1;
+      return;
+    }
+    const auto p = static_cast<position_t>(i);
+    if (val) {
+      if (test(i)) return;
+      if (buffer_cnt_ == buffer_capacity) flush_buffer();
+      buffer_[buffer_cnt_++] = p;
+      ++cnt_;
+    }
+    else {
+      const auto buffer_idx = find_in_buffer(p);
+      if (buffer_idx != buffer_capacity) {
+        buffer_[buffer_idx] = buffer_[--buffer_cnt_];
+        --cnt_;
+        return;
+      }
+      auto it = std::lower_bound(sorted_.begin(), sorted_.end(), p);
+      if (it != sorted_.end() && *it == p) {
+        sorted_.erase(it);
+        --cnt_;
+      }
+    }
+  }
+
+  /// Try to reduce the memory consumption. This function is supposed to be
+  /// called after the bitmap has been modified. - Switches between the sparse
+  /// and the dense representation. The thresholds differ by a factor of two
+  /// to prevent alternating updates from switching back and forth.
+  void __forceinline__
+  shrink() {
+    if (is_dense()) {
+      if (cnt_ * dense_threshold * 2 < n_) to_sparse();
+      return;
+    }
+    if (cnt_ * dense_threshold > n_) {
+      to_dense();
+      return;
+    }
+    if (sorted_.capacity() > 2 * (sorted_.size() + buffer_capacity)) {
+      sorted_.shrink_to_fit();
+    }
+  }
+
+  /// Returns the size of the bitmap.
+  std::size_t __forceinline__
+  size() const noexcept {
+    return n_;
+  }
+
+  /// Returns the number of set bits.
+  std::size_t __forceinline__
+  count() const noexcept {
+    return cnt_;
+  }
+
+  /// Return the size in bytes.
+  std::size_t
+  size_in_bytes() const noexcept {
+    return dense_.size() * sizeof(word_type)
+        + sorted_.size() * sizeof(position_t)
+        + buffer_cnt_ * sizeof(position_t)
+        + sizeof(n_) + sizeof(cnt_) + sizeof(buffer_cnt_);
+  }
+
+  /// Conversion to an std::bitset.
+  boost::dynamic_bitset<$u32>
+  to_bitset() const {
+    boost::dynamic_bitset<$u32> ret(n_);
+    for (auto it = this->it(); !it.end(); it.next()) {
+      for (std::size_t i = it.pos(); i < it.pos() + it.length(); ++i) {
+        ret[i] = true;
+      }
+    }
+    return ret;
+  }
+
+  void
+  print(std::ostream& os) const {
+    os << "[";
+    for (auto it = this->it(); !it.end(); it.next()) {
+      os << "(" << it.pos() << "," << it.length() << ")";
+    }
+    os << "]";
+  }
+
+  static std::string
+  name() {
+    return "small_diff";
+  }
+
+  /// Returns the name of the instance including the most important parameters
+  /// in JSON.
+  std::string
+  info() const {
+    return "{\"name\":\"" + name() + "\""
+        + ",\"n\":" + std::to_string(n_)
+        + ",\"size\":" + std::to_string(size_in_bytes())
+        + ",\"cnt\":" + std::to_string(cnt_)
+        + ",\"dense\":" + std::string(is_dense() ? "true" : "false")
+        + "}";
+  }
+
+  //===--------------------------------------------------------------------===//
+  /// 1-fill iterator, with skip support. - In the sparse representation, the
+  /// iterator merges the sorted vector with a (sorted) copy of the insert
+  /// buffer. Thus, the diff itself is not modified by read accesses.
+  class iter {
+    const small_diff& diff_;
+
+    //===------------------------------------------------------------------===//
+    // Iterator state
+    //===------------------------------------------------------------------===//
+    /// The sorted copy of the insert buffer.
+    std::array<position_t, buffer_capacity> buffer_;
+    std::size_t buffer_cnt_;
+    /// The read positions in the sorted vector and the buffer.
+    std::size_t sorted_idx_ = 0;
+    std::size_t buffer_idx_ = 0;
+    /// Points to the beginning of a 1-fill.
+    $u64 pos_;
+    /// The length of the current 1-fill
+    $u64 length_;
+    //===------------------------------------------------------------------===//
+
+    /// Returns the next position in the sparse representation without
+    /// consuming it, or n if there are no more positions.
+    $u64 __forceinline__
+    peek() const noexcept {
+      const $u64 s = sorted_idx_ < diff_.sorted_.size()
+          ? diff_.sorted_[sorted_idx_] : diff_.n_;
+      const $u64 b = buffer_idx_ < buffer_cnt_
+          ? buffer_[buffer_idx_] : diff_.n_;
+      return std::min(s, b);
+    }
+
+    /// Consumes the position returned by peek().
+    void __forceinline__
+    pop() noexcept {
+      if (sorted_idx_ < diff_.sorted_.size()
+          && (buffer_idx_ == buffer_cnt_
+              || diff_.sorted_[sorted_idx_] < buffer_[buffer_idx_])) {
+        ++sorted_idx_;
+      }
+      else {
+        ++buffer_idx_;
+      }
+    }
+
+    /// Reads the 1-fill that starts at or after the given position (dense).
+    void __forceinline__
+    read_dense_run(std::size_t from) noexcept {
+      const auto* bitmap = diff_.dense_.data();
+      const auto b = bitmap_fn::find_first(bitmap, from, diff_.n_);
+      if (b >= diff_.n_) {
+        pos_ = diff_.n_;
+        length_ = 0;
+        return;
+      }
+      // Note: The bits beyond n are always 0.
+      const auto e = (b + 1 == diff_.n_)
+          ? diff_.n_
+          : std::min(bitmap_fn::find_next_zero(bitmap, b, diff_.n_),
+              diff_.n_);
+      pos_ = b;
+      length_ = e - b;
+    }
+
+    /// Reads the next 1-fill (sparse).
+    void __forceinline__
+    read_sparse_run() noexcept {
+      pos_ = peek();
+      if (pos_ == diff_.n_) {
+        length_ = 0;
+        return;
+      }
+      pop();
+      $u64 end = pos_ + 1;
+      while (peek() == end && end != diff_.n_) {
+        pop();
+        ++end;
+      }
+      length_ = end - pos_;
+    }
+
+  public:
+    explicit iter(const small_diff& diff)
+        : diff_(diff),
+          buffer_(diff.buffer_),
+          buffer_cnt_(diff.buffer_cnt_) {
+      if (diff_.is_dense()) {
+        read_dense_run(0);
+        return;
+      }
+      std::sort(buffer_.begin(), buffer_.begin() + buffer_cnt_);
+      read_sparse_run();
+    }
+
+    iter(iter&&) = default;
+
+    void __forceinline__
+    next() noexcept {
+      if (diff_.is_dense()) {
+        read_dense_run(pos_ + length_);
+        return;
+      }
+      read_sparse_run();
+    }
+
+    void __forceinline__
+    nav_to(const std::size_t to_pos) noexcept {
+      if (to_pos >= diff_.n_) {
+        pos_ = diff_.n_;
+        length_ = 0;
+        return;
+      }
+      if (diff_.is_dense()) {
+        read_dense_run(to_pos);
+        return;
+      }
+      const auto p = static_cast<position_t>(to_pos);
+      sorted_idx_ = std::lower_bound(diff_.sorted_.begin(),
+          diff_.sorted_.end(), p) - diff_.sorted_.begin();
+      buffer_idx_ = std::lower_bound(buffer_.begin(),
+          buffer_.begin() + buffer_cnt_, p) - buffer_.begin();
+      read_sparse_run();
+    }
+
+    void __forceinline__
+    skip_to(const std::size_t to_pos) noexcept {
+      nav_to(to_pos);
+    }
+
+    u1 __forceinline__
+    end() const noexcept {
+      return pos_ == diff_.n_;
+    }
+
+    u64 __forceinline__
+    pos() const noexcept {
+      return pos_;
+    }
+
+    u64 __forceinline__
+    length() const noexcept {
+      return length_;
+    }
+  };
+
+  using skip_iter_type = iter;
+  using scan_iter_type = iter;
+
+  skip_iter_type __forceinline__
+  it() const {
+    return skip_iter_type(*this);
+  }
+
+  scan_iter_type __forceinline__
+  scan_it() const {
+    return scan_iter_type(*this);
+  }
+  //===--------------------------------------------------------------------===//
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
@@ -0,0 +1,371 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "bitwise_operations.hpp"
+#include "util/any_run_iter.hpp"
+
+#include <dtl/dtl.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+namespace internal {
+//===----------------------------------------------------------------------===//
+/// Type trait to determine whether a bitmap type provides its cardinality,
+/// e.g., Roaring.
+template<typename B, typename = void>
+struct has_count : std::false_type {};
+
+template<typename B>
+struct has_count<B, decltype(std::declval<const B&>().count(), void())>
+    : std::true_type {};
+//===----------------------------------------------------------------------===//
+/// Returns the (exact) number of set bits.
+template<typename B>
+static f64
+estimate_cardinality(const B& bitmap, std::true_type /* has_count */) {
+  return static_cast<f64>(bitmap.count());
+}
+
+/// Determines the number of set bits using a run scan. Thus, all operands
+/// are ordered by the same (exact) metric, regardless of whether the bitmap
+/// type keeps track of its cardinality.
+template<typename B>
+static f64
+estimate_cardinality(const B& bitmap, std::false_type /* has_count */) {
+  std::size_t cnt = 0;
+  auto it = bitmap.scan_it();
+  while (!it.end()) {
+    cnt += it.length();
+    it.next();
+  }
+  return static_cast<f64>(cnt);
+}
+//===----------------------------------------------------------------------===//
+} // namespace internal
+//===----------------------------------------------------------------------===//
+/// A boolean expression over bitmaps, which is composed at runtime, e.g., by
+/// a query planner. The leaves refer to bitmaps of arbitrary types that
+/// provide run iterators (TEBs, partitioned TEBs, Roaring, differential
+/// bitmaps, ...). The referenced bitmaps need to outlive the expression and
+/// all iterators obtained from it.
+///
+/// The expression is evaluated using type-erased run iterators (see
+/// any_run_iter), which exchange the runs in batches. Prior to evaluation,
+/// the expression is normalized and the operands of AND and OR are ordered
+/// by their estimated selectivity, such that the sparsest input drives the
+/// skips of the conjunctions.
+class bitmap_expr {
+public:
+  /// The operation of an expression node.
+  enum class op_t {
+    LEAF,
+    AND,
+    OR,
+    NOT
+  };
+
+private:
+  /// A bitmap and its metadata.
+  struct leaf_t {
+    /// The name of the leaf (for display purposes only).
+    std::string name;
+    /// The estimated number of set bits.
+    $f64 cardinality;
+    /// Factories for the run iterators.
+    std::function<any_run_iter()> skip_it;
+    std::function<any_run_iter()> scan_it;
+  };
+
+  /// The operation.
+  op_t op_;
+  /// The length of the bitmaps.
+  $u64 n_;
+  /// The bitmap, in case of a leaf.
+  std::shared_ptr<const leaf_t> leaf_;
+  /// The operands, otherwise.
+  std::vector<bitmap_expr> operands_;
+
+  bitmap_expr(op_t op, std::size_t n) : op_(op), n_(n) {}
+
+  /// Constructs a node with the given operands, which are required to be
+  /// non-empty and to refer to bitmaps of the same length.
+  static bitmap_expr
+  make_node(op_t op, std::vector<bitmap_expr>&& operands) {
+    assert(!operands.empty());
+    bitmap_expr ret(op, operands[0].n_);
+    for (const auto& o : operands) {
+      assert(o.n_ == ret.n_);
+    }
+    ret.operands_ = std::move(operands);
+    return ret;
+  }
+
+public:
+  //===--------------------------------------------------------------------===//
+  // Construction.
+  //===--------------------------------------------------------------------===//
+  /// Creates a leaf that refers to the given bitmap. The cardinality is
+  /// obtained from the bitmap, if available, or determined using a run scan.
+  /// A non-negative value overrides the cardinality, e.g., if it is known
+  /// from the catalog.
+  template<typename B>
+  static bitmap_expr
+  leaf(const B& bitmap, const std::string& name = "",
+      f64 cardinality = -1.0) {
+    const std::size_t n = bitmap.size();
+    bitmap_expr ret(op_t::LEAF, n);
+    auto l = std::make_shared<leaf_t>();
+    l->name = name;
+    l->cardinality = (cardinality >= 0.0)
+        ? cardinality
+        : internal::estimate_cardinality(bitmap, internal::has_count<B>());
+    const B* b = &bitmap;
+    l->skip_it = [b, n]() { return any_run_iter(b->it(), n); };
+    l->scan_it = [b, n]() { return any_run_iter(b->scan_it(), n); };
+    ret.leaf_ = std::move(l);
+    return ret;
+  }
+
+  /// Creates the conjunction of the given expressions.
+  static bitmap_expr
+  conjunction(std::vector<bitmap_expr> operands) {
+    return make_node(op_t::AND, std::move(operands));
+  }
+
+  /// Creates the disjunction of the given expressions.
+  static bitmap_expr
+  disjunction(std::vector<bitmap_expr> operands) {
+    return make_node(op_t::OR, std::move(operands));
+  }
+
+  /// Creates the negation of the given expression.
+  static bitmap_expr
+  negation(bitmap_expr operand) {
+    std::vector<bitmap_expr> operands;
+    operands.push_back(std::move(operand));
+    return make_node(op_t::NOT, std::move(operands));
+  }
+
+  friend bitmap_expr
+  operator&(bitmap_expr a, bitmap_expr b) {
+    return conjunction({std::move(a), std::move(b)});
+  }
+
+  friend bitmap_expr
+  operator|(bitmap_expr a, bitmap_expr b) {
+    return disjunction({std::move(a), std::move(b)});
+  }
+
+  friend bitmap_expr
+  operator!(bitmap_expr a) {
+    return negation(std::move(a));
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Properties.
+  //===--------------------------------------------------------------------===//
+  /// Returns the operation.
+  op_t
+  op() const noexcept {
+    return op_;
+  }
+
+  /// Returns the length of the bitmaps.
+  std::size_t
+  size() const noexcept {
+    return n_;
+  }
+
+  /// Returns the operands.
+  const std::vector<bitmap_expr>&
+  operands() const noexcept {
+    return operands_;
+  }
+
+  /// Returns the estimated fraction of set bits in the result, assuming that
+  /// the operands are independent.
+  f64
+  selectivity() const noexcept {
+    switch (op_) {
+      case op_t::LEAF:
+        return (n_ == 0) ? 0.0 : std::min(1.0, leaf_->cardinality / n_);
+      case op_t::NOT:
+        return 1.0 - operands_[0].selectivity();
+      case op_t::AND: {
+        $f64 s = 1.0;
+        for (const auto& o : operands_) s *= o.selectivity();
+        return s;
+      }
+      case op_t::OR: {
+        $f64 s = 1.0;
+        for (const auto& o : operands_) s *= 1.0 - o.selectivity();
+        return 1.0 - s;
+      }
+    }
+    return 1.0;
+  }
+
+  /// Returns a textual representation, e.g., "AND(a,NOT(b))".
+  std::string
+  to_string() const {
+    if (op_ == op_t::LEAF) {
+      return leaf_->name.empty() ? "?" : leaf_->name;
+    }
+    std::string s = (op_ == op_t::AND) ? "AND("
+        : (op_ == op_t::OR) ? "OR(" : "NOT(";
+    for (std::size_t i = 0; i < operands_.size(); ++i) {
+      if (i > 0) s += ",";
+      s += operands_[i].to_string();
+    }
+    return s + ")";
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Optimization.
+  //===--------------------------------------------------------------------===//
+  /// Returns an equivalent expression, where
+  ///  - double negations are removed,
+  ///  - nested conjunctions and disjunctions are flattened,
+  ///  - conjunctions of negations are turned into the negation of a
+  ///    disjunction (De Morgan), such that each conjunction has at least one
+  ///    positive operand that drives the evaluation, and
+  ///  - the operands of conjunctions and disjunctions are ordered by their
+  ///    estimated selectivity (sparsest first). The negated operands of a
+  ///    conjunction, which are evaluated as AND-NOT, are placed last.
+  bitmap_expr
+  optimize() const {
+    if (op_ == op_t::LEAF) return *this;
+
+    std::vector<bitmap_expr> operands;
+    for (const auto& o : operands_) {
+      auto opt = o.optimize();
+      if (opt.op_ == op_ && op_ != op_t::NOT) {
+        // Flatten.
+        for (auto& oo : opt.operands_) operands.push_back(std::move(oo));
+      }
+      else {
+        operands.push_back(std::move(opt));
+      }
+    }
+
+    switch (op_) {
+      case op_t::NOT: {
+        if (operands[0].op_ == op_t::NOT) {
+          return std::move(operands[0].operands_[0]);
+        }
+        return negation(std::move(operands[0]));
+      }
+      case op_t::AND: {
+        const auto is_negation = [](const bitmap_expr& e) {
+          return e.op_ == op_t::NOT;
+        };
+        auto positive_end = std::stable_partition(
+            operands.begin(), operands.end(),
+            [&](const bitmap_expr& e) { return !is_negation(e); });
+        if (positive_end == operands.begin()) {
+          // NOT(a) AND NOT(b) = NOT(a OR b)
+          std::vector<bitmap_expr> disjuncts;
+          for (auto& o : operands) {
+            disjuncts.push_back(std::move(o.operands_[0]));
+          }
+          return negation(disjunction(std::move(disjuncts))).optimize();
+        }
+        const auto by_selectivity = [](const bitmap_expr& a,
+            const bitmap_expr& b) {
+          return a.selectivity() < b.selectivity();
+        };
+        std::stable_sort(operands.begin(), positive_end, by_selectivity);
+        // The negated operands that remove the most bits come first.
+        std::stable_sort(positive_end, operands.end(), by_selectivity);
+        break;
+      }
+      case op_t::OR: {
+        std::stable_sort(operands.begin(), operands.end(),
+            [](const bitmap_expr& a, const bitmap_expr& b) {
+              return a.selectivity() < b.selectivity();
+            });
+        break;
+      }
+      default:
+        break;
+    }
+    if (operands.size() == 1) return std::move(operands[0]);
+    return make_node(op_, std::move(operands));
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Evaluation.
+  //===--------------------------------------------------------------------===//
+  /// Returns a run iterator over the result of the (optimized) expression.
+  any_run_iter
+  it() const {
+    return optimize().evaluate(false);
+  }
+
+  /// Returns a run iterator over the result of the expression, as is, i.e.,
+  /// without optimizing it first.
+  any_run_iter
+  it_unoptimized() const {
+    return evaluate(false);
+  }
+
+private:
+  /// Constructs the iterator tree. The 'skip' argument indicates whether the
+  /// resulting iterator is forwarded using skip_to(), i.e., whether the
+  /// leaves should provide skip iterators rather than scan iterators.
+  any_run_iter
+  evaluate(u1 skip) const {
+    switch (op_) {
+      case op_t::LEAF:
+        return skip ? leaf_->skip_it() : leaf_->scan_it();
+      case op_t::NOT:
+        return any_run_iter(
+            complement_it(operands_[0].evaluate(true), n_), n_);
+      case op_t::AND: {
+        // The first operand drives the evaluation. Negated operands are
+        // evaluated as AND-NOT.
+        std::size_t i = 0;
+        while (i < operands_.size() && operands_[i].op_ == op_t::NOT) ++i;
+        if (i == operands_.size()) {
+          // Only negated operands. (Not the case for optimized expressions.)
+          std::vector<bitmap_expr> disjuncts;
+          for (const auto& o : operands_) disjuncts.push_back(o.operands_[0]);
+          return negation(disjunction(std::move(disjuncts))).evaluate(skip);
+        }
+        auto ret = operands_[i].evaluate(true);
+        for (std::size_t j = 0; j < operands_.size(); ++j) {
+          if (j == i) continue;
+          const auto& o = operands_[j];
+          if (o.op_ == op_t::NOT) {
+            ret = any_run_iter(bitwise_and_not_it(std::move(ret),
+                o.operands_[0].evaluate(true)), n_);
+          }
+          else {
+            ret = any_run_iter(bitwise_and_it(std::move(ret),
+                o.evaluate(true)), n_);
+          }
+        }
+        return ret;
+      }
+      case op_t::OR: {
+        auto ret = operands_[0].evaluate(skip);
+        for (std::size_t j = 1; j < operands_.size(); ++j) {
+          ret = any_run_iter(bitwise_or_it(std::move(ret),
+              operands_[j].evaluate(skip)), n_);
+        }
+        return ret;
+      }
+    }
+    assert(false);
+    return leaf_->scan_it();
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
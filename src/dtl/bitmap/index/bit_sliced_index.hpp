@@ -0,0 +1,137 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "bitmap_index.hpp"
+
+#include <dtl/bitmap/bitwise_operations.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bits.hpp>
+#include <dtl/dtl.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// Bit-sliced bitmap index (BSI). The index consists of k = ceil(log2(c))
+/// bitmaps (slices), where the i-th slice refers to the rows whose value has
+/// the i-th bit set. All queries are evaluated using O(k) bitmap operations.
+template<typename B = teb_wrapper>
+class bit_sliced_index
+    : public bitmap_index<bit_sliced_index<B>, B> {
+  using base_type = bitmap_index<bit_sliced_index<B>, B>;
+  friend base_type;
+  using base_type::bitmaps_;
+  using base_type::n_;
+  using base_type::c_;
+
+public:
+  /// C'tor. Constructs the index for the given values, which are required to
+  /// be in [0, c).
+  bit_sliced_index(const std::vector<$u32>& values, u32 c)
+      : base_type(values, c) {
+    for (std::size_t r = 0; r < n_; ++r) {
+      if (values[r] >= c) {
+        throw std::invalid_argument("The value exceeds the cardinality.");
+      }
+    }
+    std::size_t slice_cnt = 1;
+    while (slice_cnt < 32 && (c - 1) >> slice_cnt) ++slice_cnt;
+    bitmaps_.reserve(slice_cnt);
+    for (std::size_t i = 0; i < slice_cnt; ++i) {
+      boost::dynamic_bitset<$u32> bm(n_);
+      for (std::size_t r = 0; r < n_; ++r) {
+        bm[r] = (values[r] >> i) & 1;
+      }
+      bitmaps_.emplace_back(bm);
+    }
+  }
+
+  /// Return the name of the implementation.
+  static std::string
+  name() noexcept {
+    return "bit_sliced_index<" + B::name() + ">";
+  }
+
+protected:
+  any_run_iter
+  slice_it(std::size_t i) const {
+    return any_run_iter(bitmaps_[i].it(), n_);
+  }
+
+  any_run_iter
+  eq_it(u64 v) const {
+    if (v >= c_) return base_type::fill_it(false);
+    const auto slice_cnt = bitmaps_.size();
+    if (v == 0) {
+      // NOT (S_0 OR S_1 OR ...)
+      std::vector<any_run_iter> its;
+      for (std::size_t i = 0; i < slice_cnt; ++i) {
+        its.push_back(slice_it(i));
+      }
+      return any_run_iter(
+          complement_it(internal::disjunction_it(std::move(its), n_), n_), n_);
+    }
+    // The slices that correspond to the 1-bits of v are intersected first.
+    // The remaining slices are subtracted from the intermediate result.
+    auto ret = slice_it(dtl::bits::tz_count(v));
+    for (std::size_t i = dtl::bits::tz_count(v) + 1; i < slice_cnt; ++i) {
+      if ((v >> i) & 1) {
+        ret = any_run_iter(bitwise_and_it(std::move(ret), slice_it(i)), n_);
+      }
+    }
+    for (std::size_t i = 0; i < slice_cnt; ++i) {
+      if (!((v >> i) & 1)) {
+        ret = any_run_iter(bitwise_and_not_it(std::move(ret), slice_it(i)), n_);
+      }
+    }
+    return ret;
+  }
+
+  /// Compares the slices from the least to the most significant bit, where
+  /// L_i refers to the rows whose lower i+1 bits are less than those of v:
+  ///  - L_i = NOT S_i OR L_{i-1},  if the i-th bit of v is set,
+  ///  - L_i = L_{i-1} AND NOT S_i, otherwise,
+  /// with L_{-1} being empty. Thus, each slice is accessed once.
+  any_run_iter
+  lt_it(u64 v) const {
+    const auto slice_cnt = bitmaps_.size();
+    if (v == 0) return base_type::fill_it(false);
+    if (v >= c_) return base_type::fill_it(true);
+    const std::size_t first = dtl::bits::tz_count(v);
+    auto ret = any_run_iter(complement_it(slice_it(first), n_), n_);
+    for (std::size_t i = first + 1; i < slice_cnt; ++i) {
+      if ((v >> i) & 1) {
+        ret = any_run_iter(bitwise_or_it(std::move(ret),
+            complement_it(slice_it(i), n_)), n_);
+      }
+      else {
+        ret = any_run_iter(bitwise_and_not_it(std::move(ret), slice_it(i)), n_);
+      }
+    }
+    return ret;
+  }
+
+  any_run_iter
+  between_it(u64 lo, $u64 hi) const {
+    hi = std::min(hi, u64(c_ - 1));
+    if (lo > hi) return base_type::fill_it(false);
+    if (lo == 0) return lt_it(hi + 1);
+    // (value < hi + 1) AND NOT (value < lo)
+    return any_run_iter(bitwise_and_not_it(lt_it(hi + 1), lt_it(lo)), n_);
+  }
+
+  template<typename count_fn_t>
+  u64
+  sum_of(count_fn_t&& count_fn, u64 /* cnt */) const {
+    $u64 sum = 0;
+    for (std::size_t i = 0; i < bitmaps_.size(); ++i) {
+      sum += count_fn(bitmaps_[i]) << i;
+    }
+    return sum;
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
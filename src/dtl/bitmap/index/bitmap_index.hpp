@@ -0,0 +1,246 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include <dtl/bitmap/bitwise_count.hpp>
+#include <dtl/bitmap/bitwise_operations.hpp>
+#include <dtl/bitmap/util/any_run_iter.hpp>
+#include <dtl/dtl.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+namespace internal {
+//===----------------------------------------------------------------------===//
+/// Run iterator over a single 1-fill [b, e). An empty range yields an empty
+/// iterator.
+class fill_iter {
+  /// Points to the beginning of the current 1-fill.
+  $u64 pos_;
+  /// The end of the 1-fill.
+  $u64 end_;
+
+public:
+  fill_iter(std::size_t b, std::size_t e) : pos_(b), end_(std::max(b, e)) {}
+
+  void __forceinline__
+  next() noexcept {
+    pos_ = end_;
+  }
+
+  void __forceinline__
+  skip_to(const std::size_t to_pos) noexcept {
+    pos_ = std::max(pos_, std::min($u64(to_pos), end_));
+  }
+
+  u1 __forceinline__
+  end() const noexcept {
+    return pos_ == end_;
+  }
+
+  u64 __forceinline__
+  pos() const noexcept {
+    return pos_;
+  }
+
+  u64 __forceinline__
+  length() const noexcept {
+    return end_ - pos_;
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Returns the disjunction of the given iterators. The iterators are combined
+/// pairwise, i.e., the resulting iterator tree has a logarithmic depth.
+static any_run_iter
+disjunction_it(std::vector<any_run_iter>&& its, std::size_t n) {
+  if (its.empty()) return any_run_iter(fill_iter(n, n), n);
+  while (its.size() > 1) {
+    std::vector<any_run_iter> combined;
+    combined.reserve((its.size() + 1) / 2);
+    for (std::size_t i = 0; i + 1 < its.size(); i += 2) {
+      combined.emplace_back(
+          bitwise_or_it(std::move(its[i]), std::move(its[i + 1])), n);
+    }
+    if (its.size() % 2 == 1) combined.push_back(std::move(its.back()));
+    its = std::move(combined);
+  }
+  return std::move(its[0]);
+}
+//===----------------------------------------------------------------------===//
+} // namespace internal
+//===----------------------------------------------------------------------===//
+/// Base class of the bitmap indexes over an integer column with the values
+/// [0, c). The encoding specific part is implemented by the derived class
+/// (CRTP), which provides the following functions:
+///  - eq_it(v):              rows with value = v
+///  - lt_it(v):              rows with value < v
+///  - between_it(lo, hi):    rows with value in [lo, hi]
+///  - sum_of(count_fn, cnt): the sum of the values of the qualifying rows,
+///                           where count_fn(b) returns the number of
+///                           qualifying rows in bitmap b, and cnt is the
+///                           number of qualifying rows.
+///
+/// The queries are evaluated using run iterators, thus, only the final result
+/// is materialized, if at all. The queries can optionally be restricted to the
+/// rows in a filter bitmap (of arbitrary type), e.g., the result of a
+/// predicate on another column.
+template<typename derived_t, typename B>
+class bitmap_index {
+protected:
+  /// The bitmaps.
+  std::vector<B> bitmaps_;
+  /// The number of rows.
+  $u64 n_;
+  /// The attribute cardinality, i.e., the number of distinct values.
+  $u32 c_;
+
+  bitmap_index(const std::vector<$u32>& values, u32 c)
+      : n_(values.size()), c_(c) {
+    if (c == 0) {
+      throw std::invalid_argument("The cardinality must be greater than 0.");
+    }
+  }
+
+  /// Returns the row IDs ordered by their values, and the offsets of the
+  /// values within that list, i.e., the rows with value v are
+  /// rows[offsets[v]] to rows[offsets[v + 1] - 1].
+  static void
+  group_by_value(const std::vector<$u32>& values, u32 c,
+      std::vector<$u32>& rows, std::vector<$u64>& offsets) {
+    offsets.assign(c + 1, 0);
+    for (auto v : values) {
+      if (v >= c) {
+        throw std::invalid_argument("The value exceeds the cardinality.");
+      }
+      ++offsets[v + 1];
+    }
+    for (std::size_t v = 0; v < c; ++v) {
+      offsets[v + 1] += offsets[v];
+    }
+    rows.resize(values.size());
+    auto write_pos = offsets;
+    for (std::size_t i = 0; i < values.size(); ++i) {
+      rows[write_pos[values[i]]++] = static_cast<$u32>(i);
+    }
+  }
+
+  /// Returns an iterator over the rows in [0, n) if 'all' is true, or an
+  /// empty iterator otherwise.
+  any_run_iter
+  fill_it(u1 all) const {
+    return any_run_iter(internal::fill_iter(all ? 0 : n_, n_), n_);
+  }
+
+  const derived_t&
+  derived() const noexcept {
+    return *static_cast<const derived_t*>(this);
+  }
+
+public:
+  /// Returns the number of rows.
+  std::size_t
+  size() const noexcept {
+    return n_;
+  }
+
+  /// Returns the attribute cardinality.
+  std::size_t
+  cardinality() const noexcept {
+    return c_;
+  }
+
+  /// Returns the number of bitmaps.
+  std::size_t
+  bitmap_cnt() const noexcept {
+    return bitmaps_.size();
+  }
+
+  /// Returns the size of the index in bytes.
+  std::size_t
+  size_in_bytes() const noexcept {
+    std::size_t s = 0;
+    for (const auto& b : bitmaps_) {
+      s += b.size_in_bytes();
+    }
+    return s;
+  }
+
+  /// Returns the name of the instance including the most important parameters
+  /// in JSON.
+  std::string
+  info() const noexcept {
+    return "{\"name\":\"" + derived_t::name() + "\""
+        + ",\"n\":" + std::to_string(n_)
+        + ",\"c\":" + std::to_string(c_)
+        + ",\"bitmap_cnt\":" + std::to_string(bitmaps_.size())
+        + ",\"size\":" + std::to_string(size_in_bytes())
+        + "}";
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Queries.
+  //===--------------------------------------------------------------------===//
+  /// Returns the rows with value = v.
+  any_run_iter
+  eq(u64 v) const {
+    return derived().eq_it(v);
+  }
+
+  /// Returns the rows with value < v.
+  any_run_iter
+  lt(u64 v) const {
+    return derived().lt_it(v);
+  }
+
+  /// Returns the rows with a value in [lo, hi].
+  any_run_iter
+  between(u64 lo, u64 hi) const {
+    return derived().between_it(lo, hi);
+  }
+
+  /// Returns the sum of all values.
+  u64
+  sum() const {
+    return derived().sum_of([](const B& b) {
+          return internal::count_it(b.scan_it());
+        }, n_);
+  }
+
+  /// Returns the rows in the filter with value = v.
+  template<typename F>
+  any_run_iter
+  eq(u64 v, const F& filter) const {
+    return any_run_iter(bitwise_and_it(filter.scan_it(), eq(v)), n_);
+  }
+
+  /// Returns the rows in the filter with value < v.
+  template<typename F>
+  any_run_iter
+  lt(u64 v, const F& filter) const {
+    return any_run_iter(bitwise_and_it(filter.scan_it(), lt(v)), n_);
+  }
+
+  /// Returns the rows in the filter with a value in [lo, hi].
+  template<typename F>
+  any_run_iter
+  between(u64 lo, u64 hi, const F& filter) const {
+    return any_run_iter(bitwise_and_it(filter.scan_it(), between(lo, hi)), n_);
+  }
+
+  /// Returns the sum of the values of the rows in the filter.
+  template<typename F>
+  u64
+  sum(const F& filter) const {
+    assert(filter.size() == n_);
+    return derived().sum_of([&](const B& b) {
+          return dtl::and_count(filter, b);
+        }, internal::count_it(filter.scan_it()));
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
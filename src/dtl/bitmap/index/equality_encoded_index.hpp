@@ -0,0 +1,88 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "bitmap_index.hpp"
+
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/dtl.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// Equality-encoded bitmap index. The index consists of c bitmaps, where the
+/// v-th bitmap refers to the rows with value = v. Point queries touch a
+/// single bitmap, whereas range queries and SUM touch up to c bitmaps.
+template<typename B = teb_wrapper>
+class equality_encoded_index
+    : public bitmap_index<equality_encoded_index<B>, B> {
+  using base_type = bitmap_index<equality_encoded_index<B>, B>;
+  friend base_type;
+  using base_type::bitmaps_;
+  using base_type::n_;
+  using base_type::c_;
+
+public:
+  /// C'tor. Constructs the index for the given values, which are required to
+  /// be in [0, c).
+  equality_encoded_index(const std::vector<$u32>& values, u32 c)
+      : base_type(values, c) {
+    std::vector<$u32> rows;
+    std::vector<$u64> offsets;
+    base_type::group_by_value(values, c, rows, offsets);
+    bitmaps_.reserve(c);
+    boost::dynamic_bitset<$u32> bm(n_);
+    for (std::size_t v = 0; v < c; ++v) {
+      for (auto i = offsets[v]; i < offsets[v + 1]; ++i) bm[rows[i]] = true;
+      bitmaps_.emplace_back(bm);
+      for (auto i = offsets[v]; i < offsets[v + 1]; ++i) bm[rows[i]] = false;
+    }
+  }
+
+  /// Return the name of the implementation.
+  static std::string
+  name() noexcept {
+    return "equality_encoded_index<" + B::name() + ">";
+  }
+
+protected:
+  any_run_iter
+  eq_it(u64 v) const {
+    if (v >= c_) return base_type::fill_it(false);
+    return any_run_iter(bitmaps_[v].it(), n_);
+  }
+
+  any_run_iter
+  lt_it(u64 v) const {
+    if (v == 0) return base_type::fill_it(false);
+    return between_it(0, v - 1);
+  }
+
+  any_run_iter
+  between_it(u64 lo, $u64 hi) const {
+    hi = std::min(hi, u64(c_ - 1));
+    if (lo > hi) return base_type::fill_it(false);
+    if (lo == 0 && hi == c_ - 1) return base_type::fill_it(true);
+    std::vector<any_run_iter> its;
+    its.reserve(hi - lo + 1);
+    for (auto v = lo; v <= hi; ++v) {
+      its.emplace_back(bitmaps_[v].it(), n_);
+    }
+    return internal::disjunction_it(std::move(its), n_);
+  }
+
+  template<typename count_fn_t>
+  u64
+  sum_of(count_fn_t&& count_fn, u64 /* cnt */) const {
+    $u64 sum = 0;
+    for (std::size_t v = 1; v < c_; ++v) {
+      sum += v * count_fn(bitmaps_[v]);
+    }
+    return sum;
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
@@ -0,0 +1,97 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "bitmap_index.hpp"
+
+#include <dtl/bitmap/bitwise_operations.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/dtl.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// Range-encoded bitmap index. The index consists of c - 1 bitmaps, where the
+/// v-th bitmap refers to the rows with value <= v. The bitmap for v = c - 1 is
+/// omitted, as all its bits are set. Point and range queries touch at most
+/// two bitmaps. SUM touches all bitmaps, as each row contributes one to the
+/// sum for each bitmap in which it is not contained.
+template<typename B = teb_wrapper>
+class range_encoded_index
+    : public bitmap_index<range_encoded_index<B>, B> {
+  using base_type = bitmap_index<range_encoded_index<B>, B>;
+  friend base_type;
+  using base_type::bitmaps_;
+  using base_type::n_;
+  using base_type::c_;
+
+public:
+  /// C'tor. Constructs the index for the given values, which are required to
+  /// be in [0, c).
+  range_encoded_index(const std::vector<$u32>& values, u32 c)
+      : base_type(values, c) {
+    std::vector<$u32> rows;
+    std::vector<$u64> offsets;
+    base_type::group_by_value(values, c, rows, offsets);
+    bitmaps_.reserve(c - 1);
+    boost::dynamic_bitset<$u32> bm(n_);
+    for (std::size_t v = 0; v + 1 < c; ++v) {
+      for (auto i = offsets[v]; i < offsets[v + 1]; ++i) bm[rows[i]] = true;
+      bitmaps_.emplace_back(bm);
+    }
+  }
+
+  /// Return the name of the implementation.
+  static std::string
+  name() noexcept {
+    return "range_encoded_index<" + B::name() + ">";
+  }
+
+protected:
+  /// Returns the rows with value <= v, where v < c.
+  any_run_iter
+  le_it(u64 v) const {
+    if (v + 1 >= c_) return base_type::fill_it(true);
+    return any_run_iter(bitmaps_[v].it(), n_);
+  }
+
+  any_run_iter
+  eq_it(u64 v) const {
+    return between_it(v, v);
+  }
+
+  any_run_iter
+  lt_it(u64 v) const {
+    if (v == 0) return base_type::fill_it(false);
+    return le_it(std::min(v - 1, u64(c_ - 1)));
+  }
+
+  any_run_iter
+  between_it(u64 lo, $u64 hi) const {
+    hi = std::min(hi, u64(c_ - 1));
+    if (lo > hi) return base_type::fill_it(false);
+    if (lo == 0) return le_it(hi);
+    if (hi == c_ - 1) {
+      // NOT (value <= lo - 1)
+      return any_run_iter(complement_it(bitmaps_[lo - 1].it(), n_), n_);
+    }
+    // (value <= hi) AND NOT (value <= lo - 1)
+    return any_run_iter(
+        bitwise_and_not_it(bitmaps_[hi].it(), bitmaps_[lo - 1].it()), n_);
+  }
+
+  template<typename count_fn_t>
+  u64
+  sum_of(count_fn_t&& count_fn, u64 cnt) const {
+    $u64 sum = 0;
+    for (std::size_t v = 0; v < bitmaps_.size(); ++v) {
+      sum += cnt - count_fn(bitmaps_[v]);
+    }
+    return sum;
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
@@ -1,6 +1,7 @@
 #pragma once
 //===----------------------------------------------------------------------===//
 #include <dtl/bitmap/iterator.hpp>
+#include <dtl/bitmap/util/bitmap_fun.hpp>
 #include <dtl/dtl.hpp>
 #include <dtl/math.hpp>
 
@@ -33,6 +34,14 @@ public:
 
   /// C'tor (similar to all other implementations)
   explicit part(const boost::dynamic_bitset<$u32>& bitmap)
+      : part(bitmap, [](const boost::dynamic_bitset<$u32>& b) {
+          return std::make_unique<B>(b);
+        }) {}
+
+  /// C'tor. The partitions are compressed using the given function, which
+  /// returns a std::unique_ptr<B>.
+  template<typename F>
+  part(const boost::dynamic_bitset<$u32>& bitmap, F compress_fn)
       : parts_(), n_(bitmap.size()) {
     const std::size_t part_cnt =
         (bitmap.size() + (part_bitlength - 1)) / part_bitlength;
@@ -50,7 +59,7 @@ public:
         i = bitmap.find_next(i);
       }
       // Compress the current partition.
-      auto compressed_part_ptr = std::make_unique<B>(b);
+      auto compressed_part_ptr = compress_fn(b);
       parts_.push_back(std::move(compressed_part_ptr));
     }
   }
@@ -87,6 +96,20 @@ public:
     return s;
   }
 
+  /// Returns the number of partitions.
+  std::size_t __forceinline__
+  partition_cnt() const noexcept {
+    return parts_.size();
+  }
+
+  /// Returns the i-th partition. Note that the last partition is padded with
+  /// zeros to the partition size.
+  __forceinline__ const B&
+  get_partition(std::size_t i) const noexcept {
+    assert(i < parts_.size());
+    return *parts_[i];
+  }
+
   /// Returns the name of the instance including the most important parameters
   /// in JSON.
   std::string
@@ -121,6 +144,45 @@ public:
     return part_ptr->test(pos % part_bitlength);
   }
 
+  /// Decodes the bits in [b, e) into the given (plain) bitmap, whereby the
+  /// bit at position b is written to the least significant bit of dst[0].
+  /// The destination needs to provide space for (e - b + 63) / 64 words.
+  /// Requires the partitions to support fetch_words() as well.
+  void
+  fetch_words(std::size_t b, std::size_t e, $u64* dst) const noexcept {
+    using bitmap_fn = dtl::bitmap_fun<$u64>;
+    static constexpr std::size_t word_bitlength = 64;
+    const auto word_cnt = (e - b + word_bitlength - 1) / word_bitlength;
+    std::fill(dst, dst + word_cnt, $u64(0));
+    e = std::min(e, n_);
+    if (b >= e) return;
+
+    std::vector<$u64> tmp;
+    for (auto p = b / part_bitlength; p <= (e - 1) / part_bitlength; ++p) {
+      const auto part_begin = p * part_bitlength;
+      const auto b_local = std::max(b, part_begin) - part_begin;
+      const auto e_local = std::min(e, part_begin + part_bitlength) - part_begin;
+      const auto len = e_local - b_local;
+      const auto dst_off = part_begin + b_local - b;
+      if (dst_off % word_bitlength == 0
+          && (len % word_bitlength == 0 || part_begin + e_local == e)) {
+        // Word aligned. Decode directly into the destination.
+        parts_[p]->fetch_words(b_local, e_local,
+            dst + dst_off / word_bitlength);
+        continue;
+      }
+      // Decode into a temporary buffer and shift the bits into place.
+      tmp.resize((len + word_bitlength - 1) / word_bitlength);
+      parts_[p]->fetch_words(b_local, e_local, tmp.data());
+      for (std::size_t k = 0; k < tmp.size(); ++k) {
+        const auto chunk_begin = k * word_bitlength;
+        const auto chunk_end = std::min(chunk_begin + word_bitlength, len);
+        bitmap_fn::store_bits(dst, dst_off + chunk_begin, dst_off + chunk_end,
+            tmp[k]);
+      }
+    }
+  }
+
   //===--------------------------------------------------------------------===//
   /// 1-run iterator for partitioned bitmaps.
   template<run_iterator_type iter_type>
@@ -0,0 +1,699 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include <dtl/bitmap/dynamic_bitmap.hpp>
+#include <dtl/bitmap/dynamic_roaring_bitmap.hpp>
+#include <dtl/bitmap/iterator.hpp>
+#include <dtl/bitmap/position_list.hpp>
+#include <dtl/bitmap/range_list.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/bitmap_tree.hpp>
+#include <dtl/bits.hpp>
+#include <dtl/dtl.hpp>
+#include <dtl/math.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <iomanip>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// The encodings a partition of a part_adaptive bitmap can have.
+enum class part_encoding : $u8 {
+  /// All bits are 0. (no bitmap instance)
+  ZEROS,
+  /// All bits are 1. (no bitmap instance)
+  ONES,
+  TEB,
+  ROARING,
+  RANGE_LIST,
+  POSITION_LIST,
+  PLAIN,
+
+  _first = ZEROS,
+  _last = PLAIN
+};
+//===----------------------------------------------------------------------===//
+static std::string
+to_string(part_encoding e) {
+  switch (e) {
+    case part_encoding::ZEROS:         return "zeros";
+    case part_encoding::ONES:          return "ones";
+    case part_encoding::TEB:           return "teb";
+    case part_encoding::ROARING:       return "roaring";
+    case part_encoding::RANGE_LIST:    return "range_list";
+    case part_encoding::POSITION_LIST: return "position_list";
+    case part_encoding::PLAIN:         return "plain";
+  }
+  return "unknown";
+}
+//===----------------------------------------------------------------------===//
+/// Applies a fixed size partitioning to the given bitmap and chooses the
+/// encoding of each partition individually, among TEB, Roaring, range list,
+/// position list and an uncompressed bitmap. Partitions that consist of
+/// 0-bits or 1-bits only do not have a bitmap instance at all. Note that, in
+/// contrast to part_run, other single-run partitions (e.g., a 1-run in the
+/// middle of the partition) are encoded using one of the candidates, which
+/// typically is a range list with a single entry.
+///
+/// The encoding is chosen whenever a partition is (re-)compressed, i.e., at
+/// construction time and when updates are merged. The sizes of the candidate
+/// encodings are estimated based on the population count and the number of
+/// 1-runs of the partition, except for TEB, where the size is estimated based
+/// on the (pruned) bitmap tree. Thus, only the chosen encoding is actually
+/// constructed. By default, the smallest encoding is chosen. A size tolerance
+/// > 0 trades space for scan performance, i.e., the fastest-to-scan encoding
+/// within (1 + size_tolerance) times the minimum size is chosen.
+template<
+    /// The partition size in bits.
+    std::size_t P>
+class part_adaptive {
+  static_assert(dtl::is_power_of_two(P),
+      "The partition size must be a power of two.");
+  static_assert(P >= 64,
+      "The partition size must be at least 64 bits.");
+
+public:
+  static constexpr std::size_t part_bitlength = P;
+
+  /// The position type of the list-based encodings, which is sufficient to
+  /// address the bits within a partition.
+  using position_type = typename std::conditional<
+      (P <= (1ull << 16)), $u16, $u32>::type;
+
+  // The partition types.
+  using teb_type = teb_wrapper;
+  using roaring_type = dynamic_roaring_bitmap;
+  using range_list_type = range_list<position_type>;
+  using position_list_type = position_list<position_type>;
+  using plain_type = dynamic_bitmap<$u32>;
+
+private:
+  /// Encapsulates a partition, i.e., its encoding and the pointer to the
+  /// bitmap instance (if any). The pointer is owned by the partition.
+  struct part_t {
+    part_encoding encoding;
+    void* ptr;
+
+    inline part_t() : encoding(part_encoding::ZEROS), ptr(nullptr) {}
+    inline part_t(const part_t& other) = delete;
+    inline part_t(part_t&& other) noexcept
+        : encoding(other.encoding), ptr(other.ptr) {
+      other.encoding = part_encoding::ZEROS;
+      other.ptr = nullptr;
+    }
+    inline part_t& operator=(const part_t& other) = delete;
+    inline part_t& operator=(part_t&& other) noexcept {
+      if (this != &other) {
+        reset();
+        encoding = other.encoding;
+        ptr = other.ptr;
+        other.encoding = part_encoding::ZEROS;
+        other.ptr = nullptr;
+      }
+      return *this;
+    }
+
+    /// D'tor
+    inline ~part_t() {
+      reset();
+    }
+
+    /// Returns the bitmap instance. (The encoding must match.)
+    template<typename T>
+    inline T*
+    get() const noexcept {
+      assert(ptr != nullptr);
+      return reinterpret_cast<T*>(ptr);
+    }
+
+    /// Deletes the bitmap instance (if any) and resets the partition to 0.
+    inline void
+    reset() noexcept {
+      if (ptr != nullptr) {
+        switch (encoding) {
+          case part_encoding::TEB:
+            delete get<teb_type>(); break;
+          case part_encoding::ROARING:
+            delete get<roaring_type>(); break;
+          case part_encoding::RANGE_LIST:
+            delete get<range_list_type>(); break;
+          case part_encoding::POSITION_LIST:
+            delete get<position_list_type>(); break;
+          case part_encoding::PLAIN:
+            delete get<plain_type>(); break;
+          default:
+            assert(false);
+        }
+      }
+      encoding = part_encoding::ZEROS;
+      ptr = nullptr;
+    }
+
+    /// Invokes the given (generic) function with a reference to the bitmap
+    /// instance. The partition must not be single-valued.
+    template<typename fn_t>
+    inline auto
+    visit(fn_t&& fn) const -> decltype(fn(*get<teb_type>())) {
+      switch (encoding) {
+        case part_encoding::TEB:
+          return fn(*get<teb_type>());
+        case part_encoding::ROARING:
+          return fn(*get<roaring_type>());
+        case part_encoding::RANGE_LIST:
+          return fn(*get<range_list_type>());
+        case part_encoding::POSITION_LIST:
+          return fn(*get<position_list_type>());
+        case part_encoding::PLAIN:
+          return fn(*get<plain_type>());
+        default:
+          assert(false);
+          __builtin_unreachable();
+      }
+    }
+
+    inline u1
+    is_value() const noexcept {
+      return encoding == part_encoding::ZEROS
+          || encoding == part_encoding::ONES;
+    }
+  };
+
+  /// The partitions.
+  std::vector<part_t> parts_;
+  /// The (total) length of the bitmap.
+  std::size_t n_;
+  /// The encoding choice may exceed the minimum size by this factor in favor
+  /// of an encoding that is faster to scan.
+  $f64 size_tolerance_;
+
+  //===--------------------------------------------------------------------===//
+  // Encoding selection.
+  //===--------------------------------------------------------------------===//
+  /// The encodings that require a bitmap instance, ordered by their scan
+  /// performance (fastest first).
+  static constexpr std::array<part_encoding, 5> candidates_ = {{
+      part_encoding::RANGE_LIST,
+      part_encoding::POSITION_LIST,
+      part_encoding::TEB,
+      part_encoding::ROARING,
+      part_encoding::PLAIN}};
+
+  /// Estimates the sizes of the candidate encodings based on the population
+  /// count and the number of 1-runs. The returned array is indexed by the
+  /// positions in candidates_. The TEB size is left to the caller.
+  static std::array<std::size_t, 5>
+  estimate_sizes(const boost::dynamic_bitset<$u32>& b) {
+    std::vector<$u32> words;
+    words.reserve(b.num_blocks());
+    boost::to_block_range(b, std::back_inserter(words));
+
+    // The number of set bits and the number of 1-runs in each Roaring chunk
+    // (2^16 bits).
+    constexpr std::size_t chunk_bitlength = 1ull << 16;
+    const std::size_t chunk_cnt =
+        (b.size() + chunk_bitlength - 1) / chunk_bitlength;
+    std::vector<$u64> chunk_pop_cnt(chunk_cnt, 0);
+    std::vector<$u64> chunk_run_cnt(chunk_cnt, 0);
+    $u64 pop_cnt = 0;
+    $u64 run_cnt = 0;
+    $u32 carry = 0;
+    for (std::size_t i = 0; i < words.size(); ++i) {
+      u32 w = words[i];
+      u32 run_begins = w & ~((w << 1) | carry);
+      carry = w >> 31;
+      const auto chunk_idx = (i * 32) / chunk_bitlength;
+      const auto c = dtl::bits::pop_count(w);
+      const auto r = dtl::bits::pop_count(run_begins);
+      chunk_pop_cnt[chunk_idx] += c;
+      chunk_run_cnt[chunk_idx] += r;
+      pop_cnt += c;
+      run_cnt += r;
+    }
+
+    std::array<std::size_t, 5> sizes;
+    // Range list: Two positions per run, the number of runs and the length.
+    sizes[0] = run_cnt * 2 * sizeof(position_type)
+        + sizeof(std::size_t) + sizeof($u64);
+    // Position list: One position per set bit, the number of positions and
+    // the length.
+    sizes[1] = pop_cnt * sizeof(position_type)
+        + sizeof(position_type) + sizeof($u64);
+    sizes[2] = std::numeric_limits<std::size_t>::max();
+    // Roaring: Each chunk is either an array, a bitset or a run container,
+    // whichever is the smallest. Similar to Roaring's own estimate, the
+    // serialized size is limited by an array of 32-bit integers.
+    std::size_t roaring_size = 8; // header
+    for (std::size_t c = 0; c < chunk_cnt; ++c) {
+      if (chunk_pop_cnt[c] == 0) continue;
+      roaring_size += 4 /* key and cardinality */
+          + std::min({chunk_pop_cnt[c] * 2, $u64(8192),
+                      2 + chunk_run_cnt[c] * 4});
+    }
+    roaring_size = std::min(roaring_size, pop_cnt * 4 + 4) + 1;
+    sizes[3] = roaring_size + sizeof(std::size_t);
+    // Plain: The bitmap words and the length.
+    sizes[4] = ((b.size() + 31) / 32) * sizeof($u32) + 4;
+    return sizes;
+  }
+
+  /// Compresses the given partition, thereby choosing the encoding.
+  part_t
+  compress(const boost::dynamic_bitset<$u32>& b) const {
+    part_t part;
+    const std::size_t b_count = b.count();
+    if (b_count == 0) {
+      return part;
+    }
+    if (b_count == part_bitlength) {
+      part.encoding = part_encoding::ONES;
+      return part;
+    }
+
+    auto sizes = estimate_sizes(b);
+    bitmap_tree<> tree(b);
+    tree.ensure_counters_are_valid();
+    sizes[2] = tree.estimate_encoded_size_in_bytes();
+
+    const auto min_size = *std::min_element(sizes.begin(), sizes.end());
+    const auto max_size = static_cast<std::size_t>(
+        min_size * (1.0 + size_tolerance_));
+    std::size_t chosen = 0;
+    while (sizes[chosen] > max_size) ++chosen;
+
+    part.encoding = candidates_[chosen];
+    switch (part.encoding) {
+      case part_encoding::TEB:
+        part.ptr = new teb_type(std::move(tree)); break;
+      case part_encoding::ROARING:
+        part.ptr = new roaring_type(b); break;
+      case part_encoding::RANGE_LIST:
+        part.ptr = new range_list_type(b); break;
+      case part_encoding::POSITION_LIST:
+        part.ptr = new position_list_type(b); break;
+      case part_encoding::PLAIN:
+        part.ptr = new plain_type(b); break;
+      default:
+        assert(false);
+    }
+    return part;
+  }
+
+  /// Decompresses the given partition.
+  static boost::dynamic_bitset<$u32>
+  decompress(const part_t& part) {
+    boost::dynamic_bitset<$u32> dec(part_bitlength);
+    if (part.is_value()) {
+      if (part.encoding == part_encoding::ONES) dec.set();
+      return dec;
+    }
+    part.visit([&](const auto& b) {
+      auto it = b.scan_it();
+      while (!it.end()) {
+        for (std::size_t i = it.pos(); i < it.pos() + it.length(); ++i) {
+          dec[i] = true;
+        }
+        it.next();
+      }
+    });
+    return dec;
+  }
+
+public:
+  /// C'tor (similar to all other implementations)
+  explicit part_adaptive(const boost::dynamic_bitset<$u32>& bitmap,
+      f64 size_tolerance = 0.0)
+      : parts_(), n_(bitmap.size()), size_tolerance_(size_tolerance) {
+    const std::size_t part_cnt =
+        (bitmap.size() + (part_bitlength - 1)) / part_bitlength;
+    parts_.reserve(part_cnt);
+    boost::dynamic_bitset<$u32> b(part_bitlength);
+    for (std::size_t p = 0; p < part_cnt; ++p) {
+      b.reset();
+      const std::size_t p_begin = p * part_bitlength;
+      const std::size_t p_end = std::min((p + 1) * part_bitlength, n_);
+      auto i = (p_begin == 0)
+          ? bitmap.find_first()
+          : bitmap.find_next(p_begin - 1);
+      while (i < p_end && i != boost::dynamic_bitset<$u32>::npos) {
+        b[i % part_bitlength] = true;
+        i = bitmap.find_next(i);
+      }
+      parts_.push_back(compress(b));
+    }
+  }
+
+  part_adaptive(const part_adaptive& other) = delete;
+  part_adaptive(part_adaptive&& other) noexcept = default;
+  part_adaptive& operator=(const part_adaptive& other) = delete;
+  part_adaptive& operator=(part_adaptive&& other) noexcept = default;
+
+  /// Return the name of the implementation.
+  static std::string
+  name() noexcept {
+    return std::string("part_adaptive<")
+        + std::to_string(dtl::log_2(part_bitlength))
+        + std::string(">");
+  }
+
+  /// Returns the length of the original bitmap.
+  std::size_t __forceinline__
+  size() const noexcept {
+    return n_;
+  }
+
+  /// Return the size in bytes.
+  std::size_t __forceinline__
+  size_in_bytes() const noexcept {
+    std::size_t s = 0;
+    for (const auto& part : parts_) {
+      if (!part.is_value()) {
+        s += part.visit([](const auto& b) { return b.size_in_bytes(); });
+      }
+    }
+    s += parts_.size() * sizeof(part_encoding);
+    s += parts_.size() * sizeof(void*);
+    return s;
+  }
+
+  /// Returns the encoding of the given partition.
+  part_encoding
+  encoding_of(std::size_t part_idx) const noexcept {
+    assert(part_idx < parts_.size());
+    return parts_[part_idx].encoding;
+  }
+
+  /// Returns the number of partitions.
+  std::size_t
+  partition_cnt() const noexcept {
+    return parts_.size();
+  }
+
+  /// Returns the name of the instance including the most important parameters
+  /// in JSON.
+  std::string
+  info() const noexcept {
+    std::array<std::size_t, 7> cnts {};
+    for (const auto& part : parts_) {
+      ++cnts[static_cast<std::size_t>(part.encoding)];
+    }
+    std::string encodings;
+    for (auto e = static_cast<std::size_t>(part_encoding::_first);
+         e <= static_cast<std::size_t>(part_encoding::_last); ++e) {
+      if (!encodings.empty()) encodings += ",";
+      encodings += "\"" + to_string(static_cast<part_encoding>(e)) + "\":"
+          + std::to_string(cnts[e]);
+    }
+    return "{\"name\":\"" + name() + "\""
+        + ",\"n\":" + std::to_string(n_)
+        + ",\"part_cnt\":" + std::to_string(parts_.size())
+        + ",\"size_tolerance\":" + std::to_string(size_tolerance_)
+        + ",\"encodings\":{" + encodings + "}"
+        + ",\"size\":" + std::to_string(size_in_bytes())
+        + "}";
+  }
+
+  /// For debugging purposes.
+  void
+  print(std::ostream& os) const noexcept {
+    for (std::size_t i = 0; i < parts_.size(); ++i) {
+      os << std::setw(4) << i << ": " << to_string(parts_[i].encoding)
+         << std::endl;
+    }
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Read related functions.
+  //===--------------------------------------------------------------------===//
+  /// Returns the value of the bit at the given position.
+  u1 __forceinline__
+  test(const std::size_t pos) const noexcept {
+    assert(pos < n_);
+    const auto& part = parts_[pos / part_bitlength];
+    if (part.is_value()) {
+      return part.encoding == part_encoding::ONES;
+    }
+    const auto p = pos % part_bitlength;
+    return part.visit([&](const auto& b) { return b.test(p); });
+  }
+
+  //===--------------------------------------------------------------------===//
+  /// 1-run iterator for adaptively partitioned bitmaps. The nested iterator
+  /// of the current partition is dispatched based on its encoding.
+  template<run_iterator_type iter_type>
+  class iter {
+    /// Reference to the outer instance.
+    const part_adaptive& part_bitmap_;
+
+    // Hack to place nested iterators on heap memory.
+    template<typename T>
+    struct heap_iter {
+      typename obtain_run_iterator<T, iter_type>::type iter;
+
+      heap_iter(T* bitmap)
+          : iter(obtain_run_iterator<T, iter_type>::from(*bitmap)) {}
+      heap_iter(const heap_iter& other) = delete;
+      heap_iter(heap_iter&& other) noexcept = delete;
+      heap_iter& operator=(const heap_iter& other) = delete;
+      heap_iter& operator=(heap_iter&& other) noexcept = delete;
+      ~heap_iter() = default;
+    };
+
+    //===------------------------------------------------------------------===//
+    // Iterator state
+    //===------------------------------------------------------------------===//
+    /// The current partition.
+    std::size_t current_part_idx_;
+    /// The encoding of the current partition.
+    part_encoding current_encoding_;
+    /// The nested iterators. Only the one that corresponds to the encoding of
+    /// the current partition is valid.
+    std::unique_ptr<heap_iter<teb_type>> teb_iter_;
+    std::unique_ptr<heap_iter<roaring_type>> roaring_iter_;
+    std::unique_ptr<heap_iter<range_list_type>> range_list_iter_;
+    std::unique_ptr<heap_iter<position_list_type>> position_list_iter_;
+    std::unique_ptr<heap_iter<plain_type>> plain_iter_;
+    /// Points to the beginning of a 1-fill.
+    $u64 pos_;
+    /// The length of the current 1-fill
+    $u64 length_;
+    //===------------------------------------------------------------------===//
+
+    /// Invokes the given (generic) function with the nested iterator of the
+    /// current partition.
+    template<typename fn_t>
+    inline auto
+    visit(fn_t&& fn) -> decltype(fn(teb_iter_->iter)) {
+      switch (current_encoding_) {
+        case part_encoding::TEB:
+          return fn(teb_iter_->iter);
+        case part_encoding::ROARING:
+          return fn(roaring_iter_->iter);
+        case part_encoding::RANGE_LIST:
+          return fn(range_list_iter_->iter);
+        case part_encoding::POSITION_LIST:
+          return fn(position_list_iter_->iter);
+        case part_encoding::PLAIN:
+          return fn(plain_iter_->iter);
+        default:
+          assert(false);
+          __builtin_unreachable();
+      }
+    }
+
+    /// Instantiates the nested iterator of the current partition.
+    inline void
+    init_part_iter() {
+      const auto& part = part_bitmap_.parts_[current_part_idx_];
+      current_encoding_ = part.encoding;
+      switch (current_encoding_) {
+        case part_encoding::TEB:
+          teb_iter_ = std::make_unique<heap_iter<teb_type>>(
+              part.template get<teb_type>());
+          break;
+        case part_encoding::ROARING:
+          roaring_iter_ = std::make_unique<heap_iter<roaring_type>>(
+              part.template get<roaring_type>());
+          break;
+        case part_encoding::RANGE_LIST:
+          range_list_iter_ = std::make_unique<heap_iter<range_list_type>>(
+              part.template get<range_list_type>());
+          break;
+        case part_encoding::POSITION_LIST:
+          position_list_iter_ =
+              std::make_unique<heap_iter<position_list_type>>(
+                  part.template get<position_list_type>());
+          break;
+        case part_encoding::PLAIN:
+          plain_iter_ = std::make_unique<heap_iter<plain_type>>(
+              part.template get<plain_type>());
+          break;
+        default:
+          break;
+      }
+    }
+
+    /// Updates the iterator state based on the nested iterator. Returns false
+    /// if the nested iterator reached the end.
+    inline u1
+    sync() {
+      return visit([&](auto& it) {
+        if (it.end()) return false;
+        pos_ = (current_part_idx_ * part_bitlength) + it.pos();
+        length_ = it.length();
+        return true;
+      });
+    }
+
+    /// Positions the iterator at the first 1-fill in the current or in one of
+    /// the subsequent partitions.
+    inline void
+    seek_part() {
+      for (; current_part_idx_ < part_bitmap_.parts_.size();
+           ++current_part_idx_) {
+        const auto encoding = part_bitmap_.parts_[current_part_idx_].encoding;
+        if (encoding == part_encoding::ZEROS) {
+          continue; // with the next partition
+        }
+        if (encoding == part_encoding::ONES) {
+          // The entire partition is 1.
+          current_encoding_ = encoding;
+          pos_ = current_part_idx_ * part_bitlength;
+          length_ = part_bitlength;
+          return;
+        }
+        init_part_iter();
+        if (sync()) return;
+        // The current partition contains a bitmap, but seems to be empty.
+        // Continue with the next partition, if there is any.
+      }
+      // Reached the end.
+      current_encoding_ = part_encoding::ZEROS;
+      pos_ = part_bitmap_.n_;
+      length_ = 0;
+    }
+
+  public:
+    explicit iter(const part_adaptive& part)
+        : part_bitmap_(part),
+          current_part_idx_(0),
+          current_encoding_(part_encoding::ZEROS),
+          pos_(part.n_),
+          length_(0) {
+      seek_part();
+    }
+
+    iter(iter&&) = default;
+
+    /// Advance to the next partition if there is any.
+    void __forceinline__
+    next_part() {
+      ++current_part_idx_;
+      seek_part();
+    }
+
+    void __forceinline__
+    next() {
+      assert(!end());
+      if (current_encoding_ != part_encoding::ONES) {
+        visit([](auto& it) { it.next(); });
+        if (sync()) return;
+      }
+      // Advance to the next partition if there is any.
+      next_part();
+    }
+
+    void __forceinline__
+    skip_to(const std::size_t to_pos) {
+      if (to_pos < (pos_ + length_)) {
+        if (to_pos > pos_) {
+          length_ -= to_pos - pos_;
+          pos_ = to_pos;
+        }
+        return;
+      }
+
+      const auto dst_part = to_pos / part_bitlength;
+      if (dst_part != current_part_idx_) {
+        // Skip to the destination partition.
+        current_part_idx_ = dst_part;
+        seek_part();
+        // Check if we have reached the end or if we skipped over the
+        // destination position.
+        if (end() || pos_ >= to_pos) {
+          return;
+        }
+      }
+      assert(current_part_idx_ == (to_pos / part_bitlength));
+
+      // Skip within the current partition, if necessary.
+      if (pos_ < to_pos) {
+        if (current_encoding_ == part_encoding::ONES) {
+          pos_ = to_pos;
+          length_ = part_bitlength - (to_pos % part_bitlength);
+          return;
+        }
+        visit([&](auto& it) { it.skip_to(to_pos % part_bitlength); });
+        if (!sync()) {
+          // We skipped over the destination partition because there was no
+          // 1-run. Thus, we simply forward the iterator to the next partition.
+          next_part();
+        }
+      }
+    }
+
+    u1 __forceinline__
+    end() const noexcept {
+      return length_ == 0;
+    }
+
+    u64 __forceinline__
+    pos() const noexcept {
+      return pos_;
+    }
+
+    u64 __forceinline__
+    length() const noexcept {
+      return length_;
+    }
+  };
+
+  using skip_iter_type = iter<run_iterator_type::SKIP>;
+  using scan_iter_type = iter<run_iterator_type::SCAN>;
+
+  skip_iter_type __forceinline__
+  it() const {
+    return skip_iter_type(*this);
+  }
+
+  scan_iter_type __forceinline__
+  scan_it() const {
+    return scan_iter_type(*this);
+  }
+  //===--------------------------------------------------------------------===//
+
+  /// Set the i-th bit to the given value. The affected partition is
+  /// decompressed, updated and re-compressed, thereby its encoding is chosen
+  /// anew.
+  void __forceinline__
+  set(std::size_t i, u1 val) {
+    assert(i < n_);
+    auto& part = parts_[i / part_bitlength];
+    auto dec = decompress(part);
+    dec[i % part_bitlength] = val;
+    part = compress(dec);
+  }
+};
+//===----------------------------------------------------------------------===//
+template<std::size_t P>
+constexpr std::array<part_encoding, 5> part_adaptive<P>::candidates_;
+//===----------------------------------------------------------------------===//
+} // namespace dtl
@@ -3,16 +3,22 @@
 #include "part.hpp"
 
 #include <dtl/bitmap/iterator.hpp>
+#include <dtl/bitmap/teb_types.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/update_traits.hpp>
 #include <dtl/dtl.hpp>
 #include <dtl/math.hpp>
 
 #include <boost/dynamic_bitset.hpp>
 #include <memory>
+#include <type_traits>
 //===----------------------------------------------------------------------===//
 namespace dtl {
 //===----------------------------------------------------------------------===//
 /// Applies a fixed size partitioning to the given bitmap.
-/// Updates are handled by decompressing/re-compressing the target partition.
+/// Updates are performed in place, if supported by the bitmap type (e.g.,
+/// TEB). Otherwise, or if the update cannot be performed in place, updates are
+/// handled by decompressing/re-compressing the target partition.
 template<
     /// The (compressed) bitmap type.
     typename B,
@@ -20,10 +26,24 @@ template<
     std::size_t P>
 class part_updirect
     : public part<B,P> {
+  /// The space reserved in each partition for in-place updates.
+  teb_slack slack_;
+
 public:
+  /// Returns the default slack, which is sized relative to the size of the
+  /// individual partitions.
+  static teb_slack
+  default_slack() noexcept {
+    return teb_slack { 1.0 / 16, 256 };
+  }
+
   /// C'tor (similar to all other implementations)
-  explicit part_updirect(const boost::dynamic_bitset<$u32>& bitmap)
-      : part<B,P>(bitmap) {}
+  explicit part_updirect(const boost::dynamic_bitset<$u32>& bitmap,
+      const teb_slack& slack = default_slack())
+      : part<B,P>(bitmap, [&](const boost::dynamic_bitset<$u32>& b) {
+          return dtl::make_updatable_bitmap<B>(b, slack);
+        }),
+        slack_(slack) {}
 
   part_updirect(const part_updirect& other) = delete;
   part_updirect(part_updirect&& other) noexcept = default;
@@ -43,12 +63,16 @@ public:
   void __forceinline__
   set(std::size_t i, u1 val) noexcept {
     const auto part_idx = i / P;
+    // Try to perform the update in place.
+    const auto res = update_inplace(part_idx, i % P, val,
+        has_inplace_update<B>());
+    if (res != 2) return;
     // Decompress the partition.
     auto dec = dtl::to_bitmap_using_iterator(*this->parts_[part_idx]);
     // Apply the update.
     dec[i % P] = val;
     // Re-compress and install the partition.
-    auto compressed_part_ptr = std::make_unique<B>(dec);
+    auto compressed_part_ptr = dtl::make_updatable_bitmap<B>(dec, slack_);
     std::swap(compressed_part_ptr, this->parts_[part_idx]);
   }
 
@@ -56,6 +80,23 @@ public:
   template<typename M>
   void __forceinline__
   merge() {}
+
+private:
+  /// Performs an in-place update of the given partition. Returns 2 if the
+  /// update could not be performed in place. See teb_flat::update().
+  int __forceinline__
+  update_inplace(std::size_t part_idx, std::size_t pos, u1 val,
+      std::true_type /* has_inplace_update */) noexcept {
+    // There is no differential data structure. Thus, run-breaking updates
+    // are performed in place as well, as long as there are enough free bits.
+    return this->parts_[part_idx]->update(pos, val, nullptr);
+  }
+
+  int __forceinline__
+  update_inplace(std::size_t /* part_idx */, std::size_t /* pos */,
+      u1 /* val */, std::false_type /* has_inplace_update */) noexcept {
+    return 2;
+  }
 };
 //===----------------------------------------------------------------------===//
 } // namespace dtl
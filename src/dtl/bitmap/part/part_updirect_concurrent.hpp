@@ -0,0 +1,165 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "part.hpp"
+
+#include <dtl/bitmap/iterator.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/dtl.hpp>
+#include <dtl/math.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <immintrin.h>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// Applies a fixed size partitioning to the given bitmap.
+/// Updates are handled by decompressing/re-compressing the target partition,
+/// similar to part_updirect. In contrast to part_updirect, concurrent writers
+/// are supported. Each partition is protected by its own (spin) latch, thus
+/// updates to different partitions proceed in parallel.
+///
+/// Point lookups (test) acquire the latch of the corresponding partition.
+/// Iterators do NOT acquire any latches and must therefore not be used while
+/// writers are active.
+template<
+    /// The (compressed) bitmap type.
+    typename B,
+    /// The partition size in bits.
+    std::size_t P>
+class part_updirect_concurrent
+    : public part<B,P> {
+
+  /// A lightweight test-and-test-and-set latch. Each latch occupies its own
+  /// cache line to avoid false sharing among writers.
+  struct alignas(64) latch {
+    std::atomic<$u32> locked { 0 };
+
+    void __forceinline__
+    lock() noexcept {
+      while (true) {
+        if (locked.exchange(1, std::memory_order_acquire) == 0) return;
+        while (locked.load(std::memory_order_relaxed) != 0) {
+          _mm_pause();
+        }
+      }
+    }
+
+    void __forceinline__
+    unlock() noexcept {
+      locked.store(0, std::memory_order_release);
+    }
+  };
+
+  /// One latch per partition.
+  std::unique_ptr<latch[]> latches_;
+
+  /// Replaces the given partition. The caller must hold the latch.
+  /// Returns the old partition, which should be destroyed after the latch has
+  /// been released to keep the critical section short.
+  std::unique_ptr<B> __forceinline__
+  install(std::size_t part_idx, const boost::dynamic_bitset<$u32>& dec) {
+    auto compressed_part_ptr = std::make_unique<B>(dec);
+    std::swap(compressed_part_ptr, this->parts_[part_idx]);
+    return compressed_part_ptr;
+  }
+
+public:
+  /// C'tor (similar to all other implementations)
+  explicit part_updirect_concurrent(const boost::dynamic_bitset<$u32>& bitmap)
+      : part<B,P>(bitmap),
+        latches_(std::make_unique<latch[]>(this->parts_.size())) {}
+
+  part_updirect_concurrent(const part_updirect_concurrent& other) = delete;
+  part_updirect_concurrent(part_updirect_concurrent&& other) noexcept = default;
+  part_updirect_concurrent& operator=(const part_updirect_concurrent& other) = delete;
+  part_updirect_concurrent& operator=(part_updirect_concurrent&& other) noexcept = default;
+
+  /// Return the name of the implementation.
+  static std::string
+  name() noexcept {
+    return std::string("part_updirect_concurrent<")
+        + B::name() + std::string(",")
+        + std::to_string(dtl::log_2(P))
+        + std::string(">");
+  }
+
+  /// Returns the value of the bit at the given position. (thread-safe)
+  u1 __forceinline__
+  test(const std::size_t pos) const noexcept {
+    assert(pos < this->n_);
+    const auto part_idx = pos / P;
+    latches_[part_idx].lock();
+    u1 ret = this->parts_[part_idx]->test(pos % P);
+    latches_[part_idx].unlock();
+    return ret;
+  }
+
+  /// Set the i-th bit to the given value. (thread-safe)
+  void __forceinline__
+  set(std::size_t i, u1 val) noexcept {
+    const auto part_idx = i / P;
+    std::unique_ptr<B> old_part_ptr;
+    latches_[part_idx].lock();
+    {
+      // Decompress the partition.
+      auto dec = dtl::to_bitmap_using_iterator(*this->parts_[part_idx]);
+      if (dec[i % P] != val) {
+        // Apply the update, re-compress and install the partition.
+        dec[i % P] = val;
+        old_part_ptr = install(part_idx, dec);
+      }
+    }
+    latches_[part_idx].unlock();
+  }
+
+  /// Applies a batch of updates. The updates are given as (position, value)
+  /// pairs. Updates are grouped by partition, so that each affected partition
+  /// is decompressed and re-compressed only once. If the same position is
+  /// updated multiple times, the last update wins. (thread-safe)
+  template<typename It>
+  void
+  set(It begin, It end) {
+    // Sort the updates by partition. The sort is stable to preserve the order
+    // of updates within a partition.
+    std::vector<std::pair<std::size_t, $u1>> updates(begin, end);
+    std::stable_sort(updates.begin(), updates.end(),
+        [](const std::pair<std::size_t, $u1>& a,
+            const std::pair<std::size_t, $u1>& b) {
+          return (a.first / P) < (b.first / P);
+        });
+
+    std::size_t i = 0;
+    while (i < updates.size()) {
+      const auto part_idx = updates[i].first / P;
+      std::unique_ptr<B> old_part_ptr;
+      latches_[part_idx].lock();
+      {
+        auto dec = dtl::to_bitmap_using_iterator(*this->parts_[part_idx]);
+        $u1 modified = false;
+        for (; i < updates.size() && (updates[i].first / P) == part_idx; ++i) {
+          const auto pos = updates[i].first % P;
+          modified |= dec[pos] != updates[i].second;
+          dec[pos] = updates[i].second;
+        }
+        if (modified) {
+          old_part_ptr = install(part_idx, dec);
+        }
+      }
+      latches_[part_idx].unlock();
+    }
+  }
+
+  /// Does nothing. Just for compatibility reasons.
+  template<typename M>
+  void __forceinline__
+  merge() {}
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
@@ -3,17 +3,22 @@
 #include "part.hpp"
 
 #include <dtl/bitmap/iterator.hpp>
+#include <dtl/bitmap/teb_types.hpp>
+#include <dtl/bitmap/util/update_traits.hpp>
 #include <dtl/dtl.hpp>
 #include <dtl/math.hpp>
 
 #include <boost/dynamic_bitset.hpp>
 #include <memory>
+#include <type_traits>
 //===----------------------------------------------------------------------===//
 namespace dtl {
 //===----------------------------------------------------------------------===//
 /// Applies a fixed size partitioning to the given bitmap.
 /// Updates are forwarded to the internally used bitmap type. This requires the
-/// bitmap type to be updatable.
+/// bitmap type to be updatable. If the bitmap type supports hybrid updates
+/// (e.g., a differential TEB), the updates are performed in place if possible
+/// and are written to the differential data structure otherwise.
 template<
     /// The (compressed) bitmap type.
     typename B,
@@ -22,9 +27,19 @@ template<
 class part_upforward
     : public part<B,P> {
 public:
+  /// Returns the default slack, which is sized relative to the size of the
+  /// individual partitions.
+  static teb_slack
+  default_slack() noexcept {
+    return teb_slack { 1.0 / 16, 256 };
+  }
+
   /// C'tor (similar to all other implementations)
-  explicit part_upforward(const boost::dynamic_bitset<$u32>& bitmap)
-      : part<B,P>(bitmap) {}
+  explicit part_upforward(const boost::dynamic_bitset<$u32>& bitmap,
+      const teb_slack& slack = default_slack())
+      : part<B,P>(bitmap, [&](const boost::dynamic_bitset<$u32>& b) {
+          return dtl::make_updatable_bitmap<B>(b, slack);
+        }) {}
 
   part_upforward(const part_upforward& other) = delete;
   part_upforward(part_upforward&& other) noexcept = default;
@@ -45,7 +60,7 @@ public:
   set(std::size_t i, u1 val) noexcept {
     // Forward the call.
     const auto part_idx = i / P;
-    this->parts_[part_idx]->set(i % P, val);
+    set(*this->parts_[part_idx], i % P, val, has_hybrid_update<B>());
   }
 
   /// Apply the pending updates and clear the diff.
@@ -56,6 +71,21 @@ public:
       this->parts_[part_idx]->template merge<M>();
     }
   }
+
+private:
+  static void __forceinline__
+  set(B& partition, std::size_t pos, u1 val,
+      std::true_type /* has_hybrid_update */) noexcept {
+    // Falls back to the differential data structure if the update cannot be
+    // performed in place.
+    partition.update(pos, val);
+  }
+
+  static void __forceinline__
+  set(B& partition, std::size_t pos, u1 val,
+      std::false_type /* has_hybrid_update */) noexcept {
+    partition.set(pos, val);
+  }
 };
 //===----------------------------------------------------------------------===//
 } // namespace dtl
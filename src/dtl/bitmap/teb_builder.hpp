@@ -26,19 +26,32 @@ class teb_builder {
 
   /// The intermediate representation of the bitmap.
   dtl::bitmap_tree<> bitmap_tree_;
+  /// The number of bits to reserve for in-place updates.
+  teb_slack slack_;
 
 public:
-  /// C'tor
-  explicit teb_builder(const boost::dynamic_bitset<$u32>& bitmap)
-      : bitmap_tree_(bitmap) {
+  /// C'tor. A false-positive rate (fpr) > 0 results in a lossy TEB.
+  explicit teb_builder(const boost::dynamic_bitset<$u32>& bitmap,
+      f64 fpr = 0.0)
+      : bitmap_tree_(bitmap, fpr) {
     bitmap_tree_.ensure_counters_are_valid();
   }
 
-  explicit teb_builder(const bitmap_tree<>&& bitmap_tree)
+  /// C'tor. A false-positive rate (fpr) > 0 results in a lossy TEB.
+  explicit teb_builder(const bitmap_tree<>&& bitmap_tree, f64 fpr = 0.0)
       : bitmap_tree_(std::move(bitmap_tree)) {
+    if (fpr > 0.0) bitmap_tree_.prune_lossy(fpr);
     bitmap_tree_.ensure_counters_are_valid();
   }
 
+  /// Reserves additional bits in the tree structure and in the labels, which
+  /// allows for run-breaking updates to be performed in place. Must be called
+  /// prior to serialized_size_in_words() and serialize().
+  void
+  set_slack(const teb_slack& slack) {
+    slack_ = slack;
+  }
+
   /// Returns the serialized size in number of words.
   inline std::size_t
   serialized_size_in_words() {
@@ -72,16 +85,29 @@ private:
         - bitmap_tree_.get_trailing_0label_cnt();
   }
 
+  /// Returns the number of bits reserved at the end of the tree structure.
+  inline std::size_t
+  tree_slack_bit_cnt() {
+    return slack_.bits(explicit_node_cnt());
+  }
+
+  /// Returns the number of bits reserved at the end of the labels.
+  inline std::size_t
+  label_slack_bit_cnt() {
+    return slack_.bits(explicit_label_cnt());
+  }
+
   /// Returns the length of the tree in number of words.
   inline std::size_t
   tree_word_cnt() {
-    return (explicit_node_cnt() + word_bitlength - 1) / word_bitlength;
+    return (explicit_node_cnt() + tree_slack_bit_cnt() + word_bitlength - 1)
+        / word_bitlength;
   }
 
   /// Returns the length of the rank lookup table in number of words.
   inline std::size_t
   rank_word_cnt() {
-    const auto tree_bits = explicit_node_cnt();
+    const auto tree_bits = explicit_node_cnt() + tree_slack_bit_cnt();
     return (tree_bits > 0)
         ? (teb_rank_type::estimate_size_in_bytes(tree_bits) + word_size - 1) / word_size
         : 0;
@@ -90,7 +116,8 @@ private:
   /// Returns the length of the label bitmap in number of words.
   inline std::size_t
   label_word_cnt() {
-    return (explicit_label_cnt() + word_bitlength - 1) / word_bitlength;
+    return (explicit_label_cnt() + label_slack_bit_cnt() + word_bitlength - 1)
+        / word_bitlength;
   }
 
   /// Returns the length of the additional meta data in number of words.
@@ -121,6 +148,9 @@ teb_builder::serialize(word_type* dst) {
   hdr.has_level_offsets = u8(1);
   hdr.update_counter = 0;
   hdr.update_threshold = 10;
+  hdr.free_bits_T = static_cast<u32>(tree_slack_bit_cnt());
+  hdr.free_bits_L = static_cast<u32>(label_slack_bit_cnt());
+  hdr.is_lossy = bitmap_tree_.is_lossy();
   //hdr.has_level_offsets = hdr.tree_bit_cnt > 1024 ? u8(1) : u8(0); // TODO remove magic number
 
   word_type* ptr = dst;
@@ -282,6 +312,9 @@ teb_builder::serialize(word_type* dst) {
     }
     succinct_tree_writer.flush();
     succinct_labels_writer.flush();
+    // Clear the reserved bits.
+    if (hdr.free_bits_T > 0) tree_data.clear(hdr.tree_bit_cnt, tree_bit_cnt);
+    if (hdr.free_bits_L > 0) label_data.clear(hdr.label_bit_cnt, label_bit_cnt);
 
     // Compute the level offsets.
     if (hdr.has_level_offsets) {
@@ -6,9 +6,14 @@
 #include "util/bitmap_fun.hpp"
 #include "util/bitmap_view.hpp"
 
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cstring>
 #include <ostream>
 #include <string>
+#include <thread>
+#include <vector>
 #include <algorithm> //std::min
 #include <boost/dynamic_bitset.hpp>
 
@@ -17,6 +22,7 @@
 namespace dtl {
 //===----------------------------------------------------------------------===//
 class teb_iter;
+class teb_rev_iter;
 class teb_scan_iter;
 class teb_wrapper;
 //===----------------------------------------------------------------------===//
@@ -25,6 +31,7 @@ class teb_wrapper;
 class teb_flat {
 public: // TODO remove
   friend class teb_iter;
+  friend class teb_rev_iter;
   friend class teb_scan_iter;
   friend class teb_wrapper;
 
@@ -41,8 +48,8 @@ public: // TODO remove
 
   /// The internal bitmap size. (rounded up to the next power of two)
   const size_type n_;
-  /// The actual bitmap size.
-  const size_type n_actual_;
+  /// The actual bitmap size. (may grow up to n_)
+  size_type n_actual_;
   size_type tree_height_;
   size_type implicit_inner_node_cnt_;
   size_type implicit_trailing_leaf_cnt_;
@@ -70,6 +77,21 @@ public: // TODO remove
   size_type update_counter_;
   size_type update_threshold_;
 
+  /// The max. number of positions that are tracked as dirty. If more
+  /// positions are updated in place, the entire tree is considered dirty.
+  static constexpr std::size_t dirty_max_cnt = 32;
+  /// The positions that have been updated in place since the last prune.
+  std::array<size_type, dirty_max_cnt> dirty_pos_;
+  /// The number of dirty positions (dirty_max_cnt + 1 if all are dirty).
+  size_type dirty_cnt_ = 0;
+
+  /// The number of free bits in T and L, respectively, that were missing to
+  /// perform the most recent in-place update. Non-zero values indicate that
+  /// the update has failed due to insufficient space, which can be resolved by
+  /// re-allocating the serialized TEB.
+  size_type missing_bits_T_ = 0;
+  size_type missing_bits_L_ = 0;
+
 public:
   /// Returns the pointer to the header.
   static constexpr const teb_header* const
@@ -103,7 +125,8 @@ public:
   static constexpr std::size_t
   get_tree_word_cnt(const word_type* const ptr) {
     const auto* hdr = get_header_ptr(ptr);
-    return (hdr->tree_bit_cnt + word_bitlength - 1) / word_bitlength;
+    return (hdr->tree_bit_cnt + hdr->free_bits_T + word_bitlength - 1)
+        / word_bitlength;
   }
 
   /// Returns the pointer to the rank structure, or NULL if it does not exist.
@@ -136,7 +159,9 @@ public:
   static constexpr std::size_t
   get_rank_word_cnt(const word_type* const ptr) {
     const auto* hdr = get_header_ptr(ptr);
-    const auto rank_size_bytes = rank_type::estimate_size_in_bytes(hdr->tree_bit_cnt);
+    // The rank LuT also covers the reserved bits.
+    const auto rank_size_bytes = rank_type::estimate_size_in_bytes(
+        hdr->tree_bit_cnt + hdr->free_bits_T);
     return (hdr->tree_bit_cnt > 0)
         ? (rank_size_bytes + word_size - 1) / word_size
         : 0;
@@ -168,7 +193,8 @@ public:
   static constexpr std::size_t
   get_label_word_cnt(const word_type* const ptr) {
     const auto* hdr = get_header_ptr(ptr);
-    return (hdr->label_bit_cnt + word_bitlength - 1) / word_bitlength;
+    return (hdr->label_bit_cnt + hdr->free_bits_L + word_bitlength - 1)
+        / word_bitlength;
   }
 
   /// Returns the pointer to the additional meta data, or NULL if it does not exist.
@@ -193,7 +219,8 @@ public:
   static constexpr std::size_t
   get_metadata_word_cnt(const word_type* const ptr) {
     const auto* hdr = get_header_ptr(ptr);
-    const auto entry_cnt = hdr->encoded_tree_height - hdr->perfect_level_cnt;
+    // The offsets are stored for all levels, including the perfect levels.
+    const auto entry_cnt = hdr->encoded_tree_height;
     const auto size_in_bytes = 2 * sizeof(size_type) * entry_cnt;
     const auto word_cnt = (size_in_bytes + word_size - 1) / word_size;
     return hdr->has_level_offsets ? word_cnt : 0;
@@ -251,6 +278,48 @@ public:
     }
   }
 
+  /// Construct a TEB instance for a (bitwise) copy of the serialized TEB of
+  /// 'other', which is located at 'ptr'. In contrast to the c'tor above, the
+  /// state that is not reflected in the serialized header, e.g., due to
+  /// in-place updates, is taken over from 'other'.
+  teb_flat(const teb_flat& other, word_type* const ptr)
+      : ptr_(ptr),
+        hdr_(get_header_ptr(ptr)),
+        n_(other.n_),
+        n_actual_(other.n_actual_),
+        tree_height_(other.tree_height_),
+        implicit_inner_node_cnt_(other.implicit_inner_node_cnt_),
+        implicit_trailing_leaf_cnt_(other.implicit_trailing_leaf_cnt_),
+        implicit_leading_label_cnt_(other.implicit_leading_label_cnt_),
+        implicit_trailing_label_cnt_(other.implicit_trailing_label_cnt_),
+        perfect_level_cnt_(other.perfect_level_cnt_),
+        encoded_tree_height_(other.encoded_tree_height_),
+        free_bits_T_(other.free_bits_T_),
+        free_bits_L_(other.free_bits_L_),
+        tree_ptr_(other.relocate(other.tree_ptr_, ptr)),
+        tree_bit_cnt_(other.tree_bit_cnt_),
+        T_(other.relocate(other.T_.data_.begin(), ptr),
+            other.relocate(other.T_.data_.end(), ptr)),
+        label_ptr_(other.relocate(other.label_ptr_, ptr)),
+        label_bit_cnt_(other.label_bit_cnt_),
+        L_(other.relocate(other.L_.data_.begin(), ptr),
+            other.relocate(other.L_.data_.end(), ptr)),
+        rank_lut_ptr_(other.relocate(other.rank_lut_ptr_, ptr)),
+        rank_(other.rank_),
+        level_offsets_tree_lut_ptr_(
+            other.relocate(other.level_offsets_tree_lut_ptr_, ptr)),
+        level_offsets_labels_lut_ptr_(
+            other.relocate(other.level_offsets_labels_lut_ptr_, ptr)),
+        update_counter_(other.update_counter_),
+        update_threshold_(other.update_threshold_),
+        dirty_pos_(other.dirty_pos_),
+        dirty_cnt_(other.dirty_cnt_) {
+    if (other.rank_lut_ptr_ == other.rank_.lut.data()) {
+      // The rank LuT has been initialized on the fly.
+      rank_lut_ptr_ = rank_.lut.data();
+    }
+  }
+
   teb_flat(const teb_flat& other) = default;
   teb_flat(teb_flat&& other) = default;
   teb_flat& operator=(const teb_flat& other) = default;
@@ -289,6 +358,122 @@ public:
     return get_label(node_idx);
   }
 
+  /// Decodes the bits in [b, e) into the given (plain) bitmap, whereby the
+  /// bit at position b is written to the least significant bit of dst[0].
+  /// The destination needs to provide space for (e - b + 63) / 64 words,
+  /// which are overwritten. Only the subtrees that intersect with the range
+  /// are visited, and 1-leaves are written with word-wide stores. The range
+  /// is required to be valid, i.e., b <= e.
+  void
+  fetch_words(std::size_t b, std::size_t e, word_type* dst) const noexcept {
+    assert(b <= e);
+    if (b >= e) return;
+    const auto word_cnt = (e - b + word_bitlength - 1) / word_bitlength;
+    std::fill(dst, dst + word_cnt, word_type(0));
+    e = std::min(e, std::size_t(n_actual_));
+    if (b >= e) return;
+
+    // Determine the (perfect) top nodes that cover the range.
+    const size_type level = perfect_level_cnt_ - 1;
+    const auto top_node_idx_begin = (1ull << level) - 1;
+    const std::size_t shift = tree_height_ - level;
+    const auto top_first = b >> shift;
+    const auto top_last = (e - 1) >> shift;
+    for (auto i = top_first; i <= top_last; ++i) {
+      fetch_words_rec(top_node_idx_begin + i, i << shift, shift, b, e, dst);
+    }
+  }
+
+private:
+  /// Helper function for fetch_words(). Decodes the intersection of the
+  /// subtree rooted at the given node, which covers the bits
+  /// [lo, lo + 2^log_width), with the range [b, e).
+  void
+  fetch_words_rec(size_type node_idx, std::size_t lo, std::size_t log_width,
+      std::size_t b, std::size_t e, word_type* dst) const noexcept {
+    if (is_leaf_node(node_idx)) {
+      if (get_label(node_idx)) {
+        const auto hi = lo + (std::size_t(1) << log_width);
+        bitmap_fn::set(dst, std::max(lo, b) - b, std::min(hi, e) - b);
+      }
+      return;
+    }
+    const size_type left_child_idx = 2 * rank_inclusive(node_idx) - 1;
+    const auto mid = lo + (std::size_t(1) << (log_width - 1));
+    if (b < mid) {
+      fetch_words_rec(left_child_idx, lo, log_width - 1, b, e, dst);
+    }
+    if (e > mid) {
+      fetch_words_rec(left_child_idx + 1, mid, log_width - 1, b, e, dst);
+    }
+  }
+
+  /// Helper function for complement_labels() and clear_padding_labels().
+  /// Clears the labels of the leaves in the subtree rooted at the given node,
+  /// which covers the bits [lo, lo + 2^log_width), that lie entirely in the
+  /// padding beyond n_actual_. The given label bitmap starts at the label
+  /// with index 'label_offset' and contains 'label_cnt' labels; the other
+  /// labels are implicit 0-labels. Returns false if a leaf that covers
+  /// n_actual_ - 1 as well as the padding has a 1-label.
+  u1
+  clear_padding_labels_rec(size_type node_idx, std::size_t lo,
+      std::size_t log_width, word_type* labels, std::size_t label_offset,
+      std::size_t label_cnt) const noexcept {
+    if (is_leaf_node(node_idx)) {
+      const std::size_t label_idx = get_label_idx(node_idx);
+      if (label_idx < label_offset || label_idx >= label_offset + label_cnt) {
+        return true;
+      }
+      if (lo >= n_actual_) {
+        bitmap_fn::clear(labels, label_idx - label_offset);
+        return true;
+      }
+      return !bitmap_fn::test(labels, label_idx - label_offset);
+    }
+    const size_type left_child_idx = 2 * rank_inclusive(node_idx) - 1;
+    const auto mid = lo + (std::size_t(1) << (log_width - 1));
+    $u1 success = true;
+    if (n_actual_ < mid) {
+      success &= clear_padding_labels_rec(left_child_idx, lo, log_width - 1,
+          labels, label_offset, label_cnt);
+    }
+    success &= clear_padding_labels_rec(left_child_idx + 1, mid,
+        log_width - 1, labels, label_offset, label_cnt);
+    return success;
+  }
+
+  /// Clears the labels of the leaves that lie entirely in the padding beyond
+  /// n_actual_ (up to the next power of two), using the given label bitmap
+  /// (see clear_padding_labels_rec()).
+  u1
+  clear_padding_labels(word_type* labels, std::size_t label_offset,
+      std::size_t label_cnt) const noexcept {
+    if (n_actual_ == n_) return true;
+    // Visit the leaves that (partially) cover the padding.
+    const size_type level = perfect_level_cnt_ - 1;
+    const auto top_node_idx_begin = (1ull << level) - 1;
+    const std::size_t shift = tree_height_ - level;
+    const auto top_first = std::size_t(n_actual_) >> shift;
+    const auto top_last = (std::size_t(n_) - 1) >> shift;
+    $u1 success = true;
+    for (auto i = top_first; i <= top_last; ++i) {
+      success &= clear_padding_labels_rec(top_node_idx_begin + i, i << shift,
+          shift, labels, label_offset, label_cnt);
+    }
+    return success;
+  }
+
+public:
+  /// Clears the (explicit) labels of the leaves that lie entirely in the
+  /// padding beyond n_actual_. Returns false if a 1-leaf covers the last bit
+  /// as well as (a part of) the padding.
+  u1
+  clear_padding_labels() noexcept {
+    if (label_bit_cnt_ == 0) return true;
+    return clear_padding_labels(get_label_ptr(ptr_),
+        implicit_leading_label_cnt_, label_bit_cnt_);
+  }
+
   u64 get_run_length_by_pos(std::size_t pos) {
     size_type level = perfect_level_cnt_ - 1;
     const auto foo = pos >> (tree_height_ - level);
@@ -309,6 +494,8 @@ public:
 
   // Set a new value at the given position
   int update(std::size_t pos, bool val, clock_t *timer = nullptr, u1 *diff_val = nullptr, u1 two_run_opt = false) {
+    missing_bits_T_ = 0;
+    missing_bits_L_ = 0;
     // I copied the following code from test() right above
     size_type level = perfect_level_cnt_ - 1;
     const auto foo = pos >> (tree_height_ - level);
@@ -349,6 +536,10 @@ public:
       #ifdef DEBUG
       std::cout << "Update failed: node ID " << node_idx << ", position " << pos << " is not at the lowest level\n";
       #endif
+      // Run-breaking updates require a materialized tree and labels.
+      if (get_tree_ptr(ptr_) == nullptr || get_label_ptr(ptr_) == nullptr) {
+        return 2;
+      }
       if (diff_val == nullptr) {
         return runbreaking_update(pos,val ,level, node_idx, i, timer);
       } else {
@@ -393,6 +584,7 @@ public:
           #ifdef DEBUG
           std::cout << "Update failed: node ID " << node_idx << ", position " << pos << "; not enough free bits to materialize leading labels\n";
           #endif
+          missing_bits_L_ = cost_L - free_bits_L_;
           return 2; // do diff update instead
           //return 0;
         }
@@ -406,6 +598,7 @@ public:
           #ifdef DEBUG
           std::cout << "Update failed: node ID " << node_idx << ", position " << pos << "; not enough free bits to materialize trailing labels\n";
           #endif
+          missing_bits_L_ = cost_L - free_bits_L_;
           return 2; // do diff update instead
           // return 0;
         }
@@ -414,6 +607,7 @@ public:
 
     // Sets the corresponding location in L, luckily bitmap_fun already has a method for it
     bitmap_fn::set(get_label_ptr(ptr_), node_label_idx - implicit_leading_label_cnt_, val);
+    mark_dirty(pos);
     return 1; // In-place update performed
   }
 
@@ -443,136 +637,104 @@ public:
     std::size_t T_implicit_trailing_begin = implicit_inner_node_cnt_ + tree_bit_cnt_;
     std::size_t L_implicit_trailing_begin = implicit_leading_label_cnt_ + label_bit_cnt_;
     std::size_t L_implicit_leading_end = implicit_leading_label_cnt_;
-    std::size_t cost_T = 0;
-    int cost_L = 0;
-
-    if (n >= T_implicit_trailing_begin) {
-      cost_T += n - T_implicit_trailing_begin + 1;
-    }
-
-    if (cost_T > free_bits_T_) {
-      //std::cout << "\nRun-breaking update: failed due to not enough bits in T";
-      return 2;
-    }
 
+    // Determine the nodes to insert and to turn into inner nodes, as well as
+    // the labels to insert.
     set_vec.push_back(n);
     rank_offset++;
 
-    size_type removed_label = get_label_idx(n);
-    if (removed_label < L_implicit_leading_end) {
-      L_implicit_leading_end--;
-    } else if (n < L_implicit_trailing_begin) {
-      cost_L -= 1;
-    }
-
     while (i >= 0) {
       u1 direction_bit = dtl::bits::bit_test(pos, i); // left if 0, right if 1
       u64 left_child = 2 * (rank_inclusive(n) + rank_offset) - 1;
-
       if (i > 0) {
-        // Calculate cost to T
-        if (direction_bit) {
-          // 01
-          if (left_child <= T_implicit_trailing_begin) {
-            cost_T += 2;
-            T_implicit_trailing_begin += 2;
-          } else {
-            cost_T += left_child - T_implicit_trailing_begin + 2;
-            T_implicit_trailing_begin += left_child - T_implicit_trailing_begin + 2;
-          }
-        } else {
-          // 10
-          if (left_child < T_implicit_trailing_begin) {
-            cost_T += 2;
-            T_implicit_trailing_begin += 2;
-          } else {
-            cost_T += left_child - T_implicit_trailing_begin + 1;
-            T_implicit_trailing_begin += left_child - T_implicit_trailing_begin + 1;
-          }
-        }
-
-        if (cost_T > free_bits_T_) {
-          //std::cout << "Run-breaking update: failed due to not enough bits in T, cost: " << cost_T << " " << T_implicit_trailing_begin << " " << left_child;
-          return 2;
-        }
-
         set_vec.push_back(left_child + direction_bit);
       }
       T_insert_vec.push_back(left_child);
 
       n = left_child - 1 - (2 * (rank_offset - 1));
-
-      // Calculate cost to L
       u64 label = left_child - rank_inclusive(n) - rank_offset;
-      u1 label_leading = label < L_implicit_leading_end;
-      u1 label_trailing = label >= L_implicit_trailing_begin;
-      u1 label_explicit = !label_leading && !label_trailing;
+      L_insert_vec.push_back(label);
+      if (i == 0) {
+        // The labels of both new leaf nodes at the lowest level.
+        L_insert_vec.push_back(label + 1);
+      }
+      rank_offset++;
+      --i;
+    }
 
-      // Not lowest level -> insert labels opposite to val
-      if (i > 0) {
-        // Updating to 1 -> insert 0 
-        if (val) {
-          if (label_leading) L_implicit_leading_end++;
-          // No changes in inserting trailing 0 label
-          else if (!label_trailing) {
-            cost_L += 1;
-            L_implicit_trailing_begin += 1;
-          }
-        } else {
-          if (label_leading) {
-            cost_L += L_implicit_leading_end - label + 1;
-            L_implicit_leading_end = label;
-          } else if (label_trailing) {
-            cost_L += label - L_implicit_trailing_begin + 1;
-            L_implicit_trailing_begin = label + 1;
-          } else {
-            cost_L++;
-            L_implicit_trailing_begin += 1;
-          }
+    // Determine the number of tree and label bits that need to be
+    // materialized, by replaying the modifications below. The update is
+    // cancelled if there are not enough free bits, before the TEB is modified.
+    {
+      // Cost to T.
+      std::size_t cost_T = 0;
+      std::size_t t_end = T_implicit_trailing_begin;
+      for (auto left : T_insert_vec) {
+        if (left < t_end) {
+          cost_T += 2;
+          t_end += 2;
         }
       }
-      //std::cout << "L insert cost: " << cost_L << "\n";
+      for (auto set_idx : set_vec) {
+        if (set_idx >= t_end) {
+          cost_T += set_idx - t_end + 1;
+          t_end = set_idx + 1;
+        }
+      }
+      if (cost_T > free_bits_T_) {
+        missing_bits_T_ = cost_T - free_bits_T_;
+      }
 
-      L_insert_vec.push_back(left_child - rank_inclusive(n) - rank_offset);
-      if (i == 0) {
-        u64 right_label = label + 1;
-        u1 right_label_leading = right_label < L_implicit_leading_end;
-        u1 right_label_trailing = right_label >= L_implicit_trailing_begin;
-        u1 right_explicit = !right_label_leading && !right_label_trailing;
-        // 01 : updating right child to 1 or updating left child to 0
-        if (val && direction_bit || !val && !direction_bit) {
-          if (label < L_implicit_leading_end) {
-            cost_L += L_implicit_leading_end - label + 1;
-          } else if (label == L_implicit_leading_end) {
-            cost_L += 1;
-          } else if (label >= L_implicit_trailing_begin) {
-            cost_L += L_implicit_trailing_begin - label + 2;
+      // Cost to L.
+      std::size_t lead = implicit_leading_label_cnt_;
+      std::size_t expl = label_bit_cnt_;
+      if (remove_label_idx < lead) {
+        lead--;
+      } else if (remove_label_idx < lead + expl) {
+        expl--;
+      }
+      const u1 insert_label = !val;
+      for (std::size_t k = 0; k < L_insert_vec.size() - 2; k++) {
+        const std::size_t insert_idx = L_insert_vec[k];
+        if (insert_idx < lead) {
+          if (insert_label) {
+            expl += lead - insert_idx + 1;
+            lead = insert_idx;
           } else {
-            // both explicit
-            cost_L += 2;
+            lead++;
           }
-        } else {
-          // 10
-          if (label <= L_implicit_leading_end) {
-            cost_L += L_implicit_leading_end - label + 2;
-          } else if (label < L_implicit_trailing_begin) {
-            cost_L += 2;
-          } else if (label == L_implicit_trailing_begin) {
-            cost_L += 1;
-          } else if (label > L_implicit_trailing_begin) {
-            cost_L += label - L_implicit_trailing_begin + 1;
+        } else if (insert_idx >= lead + expl) {
+          if (insert_label) {
+            expl = insert_idx - lead + 1;
           }
+        } else {
+          expl++;
         }
-
-        if (cost_L > free_bits_L_) {
-          // std::cout << "Run-breaking update: failed due to not enough bits in L.\n";
-          return 2;
-        }
-
-        L_insert_vec.push_back(right_label);
       }
-      rank_offset++;
-      --i;
+      const std::size_t left_label = L_insert_vec[L_insert_vec.size() - 2];
+      const std::size_t t_begin = lead + expl;
+      const u1 direction_bit = dtl::bits::bit_test(pos, 0);
+      if ((val && direction_bit) || (!val && !direction_bit)) {
+        // 01
+        if (left_label < lead) expl += lead - left_label + 1;
+        else if (left_label == lead) expl += 1;
+        else if (left_label > t_begin) expl += left_label - t_begin + 2;
+        else expl += 2;
+      } else {
+        // 10
+        if (left_label <= lead) expl += lead - left_label + 2;
+        else if (left_label < t_begin) expl += 2;
+        else if (left_label == t_begin) expl += 1;
+        else expl += left_label - t_begin + 1;
+      }
+      if (expl > label_bit_cnt_ && expl - label_bit_cnt_ > free_bits_L_) {
+        missing_bits_L_ = expl - label_bit_cnt_ - free_bits_L_;
+      }
+      // Both costs are determined, so that the caller can reserve enough
+      // space at once.
+      if (missing_bits_T_ > 0 || missing_bits_L_ > 0) {
+        return 2;
+      }
     }
 
     // timer for test
@@ -646,7 +808,6 @@ public:
       std::size_t trailing_begin = implicit_leading_label_cnt_ + label_bit_cnt_;
       if (insert_idx < implicit_leading_label_cnt_) {
         if (insert_label) {
-          std::cout << "Implicit label insert cost: " << implicit_leading_label_cnt_ - insert_idx + 1;
           insert_into_labels(0, implicit_leading_label_cnt_ - insert_idx + 1, 0);
           bitmap_fn::set(get_label_ptr(ptr_), 0);
           label_bit_cnt_ += implicit_leading_label_cnt_ - insert_idx + 1;
@@ -660,7 +821,8 @@ public:
           label_bit_cnt_ += insert_idx - trailing_begin + 1;
           free_bits_L_ -= insert_idx - trailing_begin + 1;
           implicit_trailing_label_cnt_ -= insert_idx - trailing_begin;
-          bitmap_fn::set(get_label_ptr(ptr_), insert_idx);
+          bitmap_fn::set(get_label_ptr(ptr_),
+              insert_idx - implicit_leading_label_cnt_);
         } else {
           implicit_trailing_label_cnt_++;
         }
@@ -689,7 +851,7 @@ public:
         bitmap_fn::set(get_label_ptr(ptr_), 0);
         free_bits_L_ -= L_implicit_leading_end - left_label + 1;
         label_bit_cnt_ += L_implicit_leading_end - left_label + 1;
-        implicit_inner_node_cnt_ -= L_implicit_leading_end - left_label;
+        implicit_leading_label_cnt_ -= L_implicit_leading_end - left_label - 1;
       } else if (left_label == L_implicit_leading_end) {
         // only left leading
         insert_into_labels(0, 1, 1);
@@ -712,7 +874,7 @@ public:
     } else {
       // 10
       if (left_label <= L_implicit_leading_end) {
-        insert_into_labels(0, L_implicit_trailing_begin - left_label + 2, 0);
+        insert_into_labels(0, L_implicit_leading_end - left_label + 2, 0);
         bitmap_fn::set(get_label_ptr(ptr_), 0);
         label_bit_cnt_ += L_implicit_leading_end - left_label + 2;
         free_bits_L_ -= L_implicit_leading_end - left_label + 2;
@@ -748,6 +910,7 @@ public:
     }
 
     encoded_tree_height_ = teb_util::determine_tree_height(n_) + 1;
+    mark_dirty(pos);
     return 1;
   }
 
@@ -804,7 +967,13 @@ public:
     std::size_t word_count = get_label_word_cnt(ptr_);
 
     // For now, assume there is always enough space
-    if (bit_idx + bits_to_insert >= word_bitlength) {
+    // Bits that are shifted beyond the last word are dropped. Thus, an insert
+    // at the end of the last word must not spill over into the next word,
+    // which belongs to the adjacent section of the serialized TEB.
+    bits_to_insert = std::min(bits_to_insert,
+        word_count * word_bitlength - begin_idx);
+    if (bit_idx + bits_to_insert >= word_bitlength
+        && word_idx + 1 < word_count) {
       std::size_t first_word_bits_to_insert = word_bitlength - bit_idx;
       std::size_t next_word_bits_to_shift = bits_to_insert - first_word_bits_to_insert;
 
@@ -962,7 +1131,11 @@ public:
     // For now, assume there is always enough space
     // For LuT updates, assume block granularity is equal to or a multiple of word size
 
-    if (bit_idx + bits_to_insert >= word_bitlength) {
+    // Do not spill over into the rank LuT (see insert_into_labels()).
+    bits_to_insert = std::min(bits_to_insert,
+        word_count * word_bitlength - begin_idx);
+    if (bit_idx + bits_to_insert >= word_bitlength
+        && word_idx + 1 < word_count) {
       // Bits are inserted between two words
       std::size_t first_word_bits_to_insert = word_bitlength - bit_idx;
       std::size_t next_word_bits_to_shift = bits_to_insert - first_word_bits_to_insert;
@@ -1242,17 +1415,10 @@ public:
     std::vector<prune_log_entry> prune_log;
 
     prune_traverse(0, 0, ofs_tree_update_vec, ofs_labels_update_vec, max_height_observed, &prune_log);
+    dirty_cnt_ = 0;
 
     // Update level offset tables
-    int T_update_sum = 0;
-    int L_update_sum = 0;
-    for (std::size_t i = 0; i < teb_max_height - 1; i++) {
-      T_update_sum += ofs_tree_update_vec[i];
-      L_update_sum += ofs_labels_update_vec[i];
-
-      level_offsets_tree_lut_ptr_[i + 1] += T_update_sum;
-      level_offsets_labels_lut_ptr_[i + 1] += L_update_sum;
-    }
+    apply_level_offset_updates(ofs_tree_update_vec, ofs_labels_update_vec);
     /*
     if (max_height_observed + 1 != encoded_tree_height_) {
       encoded_tree_height_ = max_height_observed + 1;
@@ -1332,6 +1498,232 @@ public:
     }
   }
   
+  /// Prunes only the subtrees that have been modified by in-place updates
+  /// since the last prune, i.e., the paths from the root to the updated
+  /// positions are pruned bottom-up, until a node cannot be pruned. In
+  /// contrast to prune(), trailing 0-bits in T and L are not trimmed. If too
+  /// many positions have been updated, the entire tree is traversed.
+  void
+  prune_dirty() {
+    if (dirty_cnt_ == 0) return;
+    std::size_t teb_max_height = encoded_tree_height_;
+    std::vector<int> ofs_tree_update_vec(teb_max_height, 0);
+    std::vector<int> ofs_labels_update_vec(teb_max_height, 0);
+    std::size_t max_height_observed = 0;
+
+    if (dirty_cnt_ > dirty_max_cnt) {
+      prune_traverse(0, 0, ofs_tree_update_vec, ofs_labels_update_vec, max_height_observed);
+    }
+    else {
+      std::array<$u64, 64> path;
+      for (std::size_t d = 0; d < dirty_cnt_; ++d) {
+        const auto pos = dirty_pos_[d];
+        // Determine the path from the root to the leaf that contains 'pos'.
+        std::size_t path_len = 0;
+        $u64 node_idx = 0;
+        int i = tree_height_ - 1;
+        while (is_inner_node(node_idx)) {
+          path[path_len++] = node_idx;
+          u1 direction_bit = dtl::bits::bit_test(pos, i);
+          node_idx = 2 * rank_inclusive(node_idx) - 1 + direction_bit;
+          --i;
+        }
+        // Prune bottom-up. Pruning a node only affects the nodes on the lower
+        // levels, thus the node indices of the ancestors remain valid.
+        while (path_len > 0) {
+          --path_len;
+          if (!prune_node(path[path_len], path_len, ofs_tree_update_vec,
+              ofs_labels_update_vec, max_height_observed)) {
+            break;
+          }
+        }
+      }
+    }
+    dirty_cnt_ = 0;
+
+    // Update level offset tables
+    apply_level_offset_updates(ofs_tree_update_vec, ofs_labels_update_vec);
+  }
+
+  /// Returns true if there are in-place updates that have not been pruned.
+  u1
+  is_dirty() const noexcept {
+    return dirty_cnt_ > 0;
+  }
+
+  /// Prunes the tree using multiple threads. The subtrees rooted at the
+  /// lowest perfect level are independent of each other. Thus, they are
+  /// pruned in parallel, each producing its nodes and labels in level order.
+  /// Afterwards, the pruned tree is assembled in parallel, based on the prefix
+  /// sums of the per-level node and label counts. In contrast to prune(), the
+  /// nodes above the subtree roots are not pruned, i.e., the number of
+  /// perfect levels remains unchanged. If the pruned tree does not fit into the
+  /// available space, which can happen when implicit nodes or labels need to
+  /// be materialized, the sequential prune_traverse() is used instead.
+  void
+  prune_parallel(std::size_t thread_cnt = std::thread::hardware_concurrency()) {
+    if (get_tree_ptr(ptr_) == nullptr || get_label_ptr(ptr_) == nullptr) {
+      return;
+    }
+    // All nodes above the lowest perfect level are inner nodes.
+    const std::size_t root_level = perfect_level_cnt_ - 1;
+    if (root_level >= tree_height_) {
+      // The subtree roots are on the lowest level, i.e., they are leaves.
+      return;
+    }
+    const std::size_t level_cnt = tree_height_ + 1 - root_level;
+    const std::size_t root_cnt = std::size_t(1) << root_level;
+    // The number of nodes on the perfect levels, which is also the index of
+    // the first subtree root.
+    const std::size_t perfect_node_cnt = root_cnt - 1;
+    thread_cnt = std::max(thread_cnt, std::size_t(1));
+    const std::size_t task_cnt = std::min(root_cnt, thread_cnt * 8);
+    const std::size_t roots_per_task = (root_cnt + task_cnt - 1) / task_cnt;
+
+    // Phase 1: Prune the subtrees in parallel. Each task prunes a range of
+    // subtrees, which are contiguous within each level.
+    struct prune_task {
+      std::vector<boost::dynamic_bitset<word_type>> T;
+      std::vector<boost::dynamic_bitset<word_type>> L;
+    };
+    std::vector<prune_task> tasks(task_cnt);
+    run_tasks_in_parallel(task_cnt, thread_cnt, [&](std::size_t t) {
+      auto& task = tasks[t];
+      task.T.resize(level_cnt);
+      task.L.resize(level_cnt);
+      const auto root_begin = std::min(t * roots_per_task, root_cnt);
+      const auto root_end = std::min(root_begin + roots_per_task, root_cnt);
+      for (std::size_t r = root_begin; r < root_end; ++r) {
+        prune_subtree(perfect_node_cnt + r, 0, task.T, task.L);
+      }
+    });
+
+    // Phase 2: Compute the prefix sums of the node and label counts, which
+    // determine where the tasks write their nodes and labels to.
+    std::vector<$u64> task_ofs_T(level_cnt * task_cnt);
+    std::vector<$u64> task_ofs_L(level_cnt * task_cnt);
+    std::vector<$u64> level_ofs_T(level_cnt);
+    std::vector<$u64> level_ofs_L(level_cnt);
+    $u64 node_cnt = perfect_node_cnt;
+    $u64 label_cnt = 0;
+    for (std::size_t l = 0; l < level_cnt; ++l) {
+      level_ofs_T[l] = node_cnt;
+      level_ofs_L[l] = label_cnt;
+      for (std::size_t t = 0; t < task_cnt; ++t) {
+        task_ofs_T[l * task_cnt + t] = node_cnt;
+        task_ofs_L[l * task_cnt + t] = label_cnt;
+        node_cnt += tasks[t].T[l].size();
+        label_cnt += tasks[t].L[l].size();
+      }
+    }
+
+    // Phase 3: Assemble the entire (pruned) tree and the labels, including
+    // the bits that are going to be implicit.
+    std::vector<word_type> T_tmp(node_cnt / word_bitlength + 2, 0);
+    std::vector<word_type> L_tmp(label_cnt / word_bitlength + 2, 0);
+    bitmap_fn::set(T_tmp.data(), 0, perfect_node_cnt);
+    run_tasks_in_parallel(task_cnt, thread_cnt, [&](std::size_t t) {
+      for (std::size_t l = 0; l < level_cnt; ++l) {
+        scatter_bits(tasks[t].T[l], T_tmp.data(), task_ofs_T[l * task_cnt + t]);
+        scatter_bits(tasks[t].L[l], L_tmp.data(), task_ofs_L[l * task_cnt + t]);
+      }
+    });
+
+    // Determine the implicit parts. At least one bit of T and L remains
+    // explicit.
+    const auto T_lead =
+        bitmap_fn::find_next_zero(T_tmp.data(), 0, node_cnt);
+    auto T_trail = node_cnt - 1
+        - bitmap_fn::find_last(T_tmp.data(), T_tmp.data() + T_tmp.size());
+    if (T_lead + T_trail == node_cnt) {
+      --T_trail;
+    }
+    const auto T_explicit = node_cnt - T_lead - T_trail;
+    auto L_lead =
+        bitmap_fn::find_first(L_tmp.data(), L_tmp.data() + L_tmp.size());
+    $u64 L_trail = 0;
+    if (L_lead >= label_cnt) {
+      // All labels are 0.
+      L_lead = label_cnt - 1;
+    }
+    else {
+      L_trail = label_cnt - 1
+          - bitmap_fn::find_last(L_tmp.data(), L_tmp.data() + L_tmp.size());
+    }
+    const auto L_explicit = label_cnt - L_lead - L_trail;
+
+    const auto tree_word_cnt = get_tree_word_cnt(ptr_);
+    const auto label_word_cnt = get_label_word_cnt(ptr_);
+    if (T_explicit > tree_word_cnt * word_bitlength
+        || L_explicit > label_word_cnt * word_bitlength) {
+      // Not enough space. Fall back to the sequential prune, which only
+      // prunes nodes when there are enough free bits.
+      std::vector<int> ofs_tree_update_vec(encoded_tree_height_, 0);
+      std::vector<int> ofs_labels_update_vec(encoded_tree_height_, 0);
+      std::size_t max_height_observed = 0;
+      prune_traverse(0, 0, ofs_tree_update_vec, ofs_labels_update_vec,
+          max_height_observed);
+      apply_level_offset_updates(ofs_tree_update_vec, ofs_labels_update_vec);
+      dirty_cnt_ = 0;
+      return;
+    }
+
+    // Phase 4: Write the explicit parts to T and L (in parallel).
+    auto* tree_ptr = get_tree_ptr(ptr_);
+    auto* label_ptr = get_label_ptr(ptr_);
+    const std::size_t words_per_task = 1ull << 12;
+    const std::size_t copy_task_cnt_T =
+        (tree_word_cnt + words_per_task - 1) / words_per_task;
+    const std::size_t copy_task_cnt_L =
+        (label_word_cnt + words_per_task - 1) / words_per_task;
+    run_tasks_in_parallel(copy_task_cnt_T + copy_task_cnt_L, thread_cnt,
+        [&](std::size_t t) {
+      if (t < copy_task_cnt_T) {
+        copy_bits(T_tmp.data(), T_lead, T_lead + T_explicit, tree_ptr,
+            t * words_per_task,
+            std::min((t + 1) * words_per_task, tree_word_cnt));
+      }
+      else {
+        t -= copy_task_cnt_T;
+        copy_bits(L_tmp.data(), L_lead, L_lead + L_explicit, label_ptr,
+            t * words_per_task,
+            std::min((t + 1) * words_per_task, label_word_cnt));
+      }
+    });
+
+    implicit_inner_node_cnt_ = T_lead;
+    tree_bit_cnt_ = T_explicit;
+    implicit_trailing_leaf_cnt_ = T_trail;
+    free_bits_T_ = tree_word_cnt * word_bitlength - T_explicit;
+    implicit_leading_label_cnt_ = L_lead;
+    label_bit_cnt_ = L_explicit;
+    implicit_trailing_label_cnt_ = L_trail;
+    free_bits_L_ = label_word_cnt * word_bitlength - L_explicit;
+
+    // Rebuild the rank LuT.
+    if (rank_lut_ptr_ == rank_.lut.data()) {
+      rank_.init(tree_ptr, tree_ptr + tree_word_cnt);
+      rank_lut_ptr_ = rank_.lut.data();
+    }
+    else {
+      rank_type::init_inplace(tree_ptr, tree_ptr + tree_word_cnt,
+          rank_lut_ptr_);
+    }
+
+    // Update the level offsets.
+    for (std::size_t l = 0; l < encoded_tree_height_; ++l) {
+      if (l < root_level) {
+        level_offsets_tree_lut_ptr_[l] = (size_type(1) << l) - 1;
+        level_offsets_labels_lut_ptr_[l] = 0;
+      }
+      else {
+        level_offsets_tree_lut_ptr_[l] = level_ofs_T[l - root_level];
+        level_offsets_labels_lut_ptr_[l] = level_ofs_L[l - root_level];
+      }
+    }
+    dirty_cnt_ = 0;
+  }
+
   void
   prune_traverse(
       u64 node_idx, 
@@ -1350,444 +1742,576 @@ public:
       // Traverse right subtree
       u64 right_child = 2 * rank_inclusive(node_idx);
       assert(right_child < implicit_inner_node_cnt_ + tree_bit_cnt_ + implicit_trailing_leaf_cnt_);
-      bool right_child_is_inner = is_inner_node(right_child);
-      if (right_child_is_inner) {
+      if (is_inner_node(right_child)) {
         prune_traverse(right_child, level + 1, ofs_T_update_vec, ofs_L_update_vec, max_height_observed, prune_log);
       }
-      right_child_is_inner = is_inner_node(right_child);
-      
+
       // Traverse left subtree
       u64 left_child = 2 * rank_inclusive(node_idx) - 1;
       assert(left_child < implicit_inner_node_cnt_ + tree_bit_cnt_ + implicit_trailing_leaf_cnt_);
-      bool left_child_is_inner = is_inner_node(left_child);
-      if (left_child_is_inner) {
+      if (is_inner_node(left_child)) {
         prune_traverse(left_child, level + 1, ofs_T_update_vec, ofs_L_update_vec, max_height_observed, prune_log);
       }
-      left_child_is_inner = is_inner_node(left_child);
-
-      if (!right_child_is_inner && !left_child_is_inner) {
-        u1 right_label = get_label(right_child);
-        u1 left_label = get_label(left_child);
-
-        if (right_label == left_label) {
-          u1 label = right_label;
-
-          uint64_t implicit_trailing_T_begin = implicit_inner_node_cnt_ + tree_bit_cnt_;
-          uint64_t implicit_trailing_L_begin = implicit_leading_label_cnt_ + label_bit_cnt_;
-
-          // Check if current node is implicit; only leafs can be trailing implicit
-          u1 current_is_implicit = node_idx < implicit_inner_node_cnt_;
-
-          // Check whether children are implicit; leafs can only be trailing implicit
-          u1 left_child_is_implicit = left_child >= implicit_trailing_T_begin;
-          u1 right_child_is_implicit = right_child >= implicit_trailing_T_begin;
-          u1 children_are_implicit = left_child_is_implicit && right_child_is_implicit;
-
-          // Check whether children label bits are implicit
-          u64 left_label_idx = get_label_idx(left_child);
-          u64 right_label_idx = left_label_idx + 1;
-          assert(left_label_idx < implicit_leading_label_cnt_ + label_bit_cnt_ + implicit_trailing_label_cnt_);
-          assert(right_label_idx < implicit_leading_label_cnt_ + label_bit_cnt_ + implicit_trailing_label_cnt_);
-
-          bool left_label_is_leading = left_label_idx < implicit_leading_label_cnt_;
-          bool right_label_is_leading = right_label_idx < implicit_leading_label_cnt_;
 
-          bool left_label_is_trailing = left_label_idx >= implicit_trailing_L_begin;
-          bool right_label_is_trailing = right_label_idx >= implicit_trailing_L_begin;
-
-          bool children_labels_are_leading = left_label_is_leading && right_label_is_leading;
-          bool children_labels_are_trailing = left_label_is_trailing && right_label_is_trailing;
-          bool children_labels_are_implicit = children_labels_are_leading || children_labels_are_trailing;
-
-          // Check whether the would be label of the parent would end up in the "implicit zone"
-          u64 current_label_idx = get_future_label_idx(node_idx);
-          bool current_label_is_leading = current_label_idx < implicit_leading_label_cnt_;
-          bool current_label_is_trailing = current_label_idx >= implicit_trailing_L_begin;
-          bool current_label_is_implicit = current_label_is_leading || current_label_is_trailing;
+      prune_node(node_idx, level, ofs_T_update_vec, ofs_L_update_vec, max_height_observed, prune_log);
+    }
+  }
 
-          // Cost to update, relevant if parent is implicit (in T or L or both)
-          std::size_t cost_T = 0;
-          std::size_t cost_L = 0;
+  /// Turns the given inner node into a leaf, if both of its children are
+  /// leaves with the same label and if there are enough free bits left in T
+  /// and L. Only the node itself is considered, i.e., its subtrees are expected
+  /// to be pruned already. Returns true if the node has been pruned.
+  u1
+  prune_node(
+      u64 node_idx,
+      std::size_t level,
+      std::vector<int> &ofs_T_update_vec,
+      std::vector<int> &ofs_L_update_vec,
+      std::size_t &max_height_observed,
+      std::vector<prune_log_entry> *prune_log = nullptr) {
+    u64 right_child = 2 * rank_inclusive(node_idx);
+    u64 left_child = right_child - 1;
+    assert(right_child < implicit_inner_node_cnt_ + tree_bit_cnt_ + implicit_trailing_leaf_cnt_);
+    bool right_child_is_inner = is_inner_node(right_child);
+    bool left_child_is_inner = is_inner_node(left_child);
+
+    if (!right_child_is_inner && !left_child_is_inner) {
+      u1 right_label = get_label(right_child);
+      u1 left_label = get_label(left_child);
+
+      if (right_label == left_label) {
+        u1 label = right_label;
+
+        uint64_t implicit_trailing_T_begin = implicit_inner_node_cnt_ + tree_bit_cnt_;
+        uint64_t implicit_trailing_L_begin = implicit_leading_label_cnt_ + label_bit_cnt_;
+
+        // Check if current node is implicit; only leafs can be trailing implicit
+        u1 current_is_implicit = node_idx < implicit_inner_node_cnt_;
+
+        // Check whether children are implicit; leafs can only be trailing implicit
+        u1 left_child_is_implicit = left_child >= implicit_trailing_T_begin;
+        u1 right_child_is_implicit = right_child >= implicit_trailing_T_begin;
+        u1 children_are_implicit = left_child_is_implicit && right_child_is_implicit;
+
+        // Check whether children label bits are implicit
+        u64 left_label_idx = get_label_idx(left_child);
+        u64 right_label_idx = left_label_idx + 1;
+        assert(left_label_idx < implicit_leading_label_cnt_ + label_bit_cnt_ + implicit_trailing_label_cnt_);
+        assert(right_label_idx < implicit_leading_label_cnt_ + label_bit_cnt_ + implicit_trailing_label_cnt_);
+
+        bool left_label_is_leading = left_label_idx < implicit_leading_label_cnt_;
+        bool right_label_is_leading = right_label_idx < implicit_leading_label_cnt_;
+
+        bool left_label_is_trailing = left_label_idx >= implicit_trailing_L_begin;
+        bool right_label_is_trailing = right_label_idx >= implicit_trailing_L_begin;
+
+        bool children_labels_are_leading = left_label_is_leading && right_label_is_leading;
+        bool children_labels_are_trailing = left_label_is_trailing && right_label_is_trailing;
+        bool children_labels_are_implicit = children_labels_are_leading || children_labels_are_trailing;
+
+        // Check whether the would be label of the parent would end up in the "implicit zone"
+        u64 current_label_idx = get_future_label_idx(node_idx);
+        bool current_label_is_leading = current_label_idx < implicit_leading_label_cnt_;
+        bool current_label_is_trailing = current_label_idx >= implicit_trailing_L_begin;
+        bool current_label_is_implicit = current_label_is_leading || current_label_is_trailing;
+
+        // Cost to update, relevant if parent is implicit (in T or L or both)
+        std::size_t cost_T = 0;
+        std::size_t cost_L = 0;
+
+        if (current_is_implicit) {
+          cost_T += implicit_inner_node_cnt_ - node_idx;
+        }
 
-          if (current_is_implicit) {
-            cost_T += implicit_inner_node_cnt_ - node_idx;
+        if (current_label_is_implicit && label) {
+          if (current_label_is_leading) {
+            cost_L += implicit_leading_label_cnt_ - current_label_idx + 1;
           }
-
-          if (current_label_is_implicit && label) {
-            if (current_label_is_leading) {
-              cost_L += implicit_leading_label_cnt_ - current_label_idx + 1;
-            }
-            if (current_label_is_trailing) {
-              cost_L += current_label_idx - implicit_trailing_L_begin + 1;
-            }
+          if (current_label_is_trailing) {
+            cost_L += current_label_idx - implicit_trailing_L_begin + 1;
           }
+        }
 
-          // Heuristic: check if prune reduces number of perfect levels
-          bool perfect_levels_reduced = level + 1 < perfect_level_cnt_;
-          perfect_levels_reduced = false;
+        // Heuristic: check if prune reduces number of perfect levels
+        bool perfect_levels_reduced = level + 1 < perfect_level_cnt_;
+        perfect_levels_reduced = false;
 
+        #ifdef DEBUG
+        std::cout << "Visiting node " << node_idx << std::endl;
+        std::cout << "Right Child id: " << right_child << " " << right_child_is_inner << " " << get_label(right_child) <<  std::endl;
+        std::cout << "Left Child id: " << left_child << " " << left_child_is_inner << " " << get_label(left_child) << std::endl;
+        std::cout << "Prunable leafs found at " << left_child << ", level " << level + 1 << std::endl;
+
+        if (current_is_implicit) {
+          std::cout << "Setting parent to leaf requires " << cost_T << " new bits\n";
+          std::cout << "There are " << free_bits_T_ << " free bits in T\n";
+          if (cost_T > free_bits_T_) {
+            std::cout << "There are not enough bits in T\n";
+          } else {
+            std::cout << "There are enough bits in T\n";
+          }
+        }
+
+        if (current_label_is_implicit && label) {
+          std::cout << "Inserting parent label requires " << cost_L << " new bits\n";
+          std::cout << "There are " << free_bits_L_ << " free bits in L\n";
+          if (cost_L > free_bits_L_) {
+            std::cout << "There are not enough bits in L\n";
+          } else {
+            std::cout << "There are enough bits in L\n";
+          } 
+        }
+        #endif
+        
+        //if (cost_T <= free_bits_T_ && cost_L <= free_bits_L_ && cost_L < 64 && cost_T < 64)
+        if (cost_T <= free_bits_T_ && cost_L <= free_bits_L_ && !perfect_levels_reduced) {
           #ifdef DEBUG
-          std::cout << "Visiting node " << node_idx << std::endl;
-          std::cout << "Right Child id: " << right_child << " " << right_child_is_inner << " " << get_label(right_child) <<  std::endl;
-          std::cout << "Left Child id: " << left_child << " " << left_child_is_inner << " " << get_label(left_child) << std::endl;
-          std::cout << "Prunable leafs found at " << left_child << ", level " << level + 1 << std::endl;
-
-          if (current_is_implicit) {
-            std::cout << "Setting parent to leaf requires " << cost_T << " new bits\n";
-            std::cout << "There are " << free_bits_T_ << " free bits in T\n";
-            if (cost_T > free_bits_T_) {
-              std::cout << "There are not enough bits in T\n";
+          /*
+          boost::dynamic_bitset<u_int32_t> test_bitset(n_);
+          for (std::size_t i = 0; i < n_; i++) {
+            test_bitset[i] = test(i);
+          }*/
+          #endif
+          std::size_t T_bits_before = implicit_inner_node_cnt_ + tree_bit_cnt_ + implicit_trailing_leaf_cnt_;
+          std::size_t L_bits_before = implicit_leading_label_cnt_ + label_bit_cnt_ + implicit_trailing_label_cnt_;
+
+          // Remove children label bits from L
+          if (!children_labels_are_implicit) {
+            if (left_label_is_leading && !right_label_is_leading) {
+              remove_from_labels(0, 1);
+              free_bits_L_ += 1;
+              label_bit_cnt_ -= 1;
+              implicit_leading_label_cnt_ -= 1;
+            } else if (!left_label_is_trailing && right_label_is_trailing) {
+              bitmap_fn::clear(get_label_ptr(ptr_), label_bit_cnt_ - 1);
+              free_bits_L_ += 1;
+              label_bit_cnt_ -= 1;
+              implicit_trailing_label_cnt_ -= 1;
             } else {
-              std::cout << "There are enough bits in T\n";
+              remove_from_labels(left_label_idx - implicit_leading_label_cnt_, 2);
+              label_bit_cnt_ -= 2;
+              free_bits_L_ += 2;
+            }
+          } else {
+            if (children_labels_are_leading) {
+              implicit_leading_label_cnt_ -= 2;
+            }
+            if (children_labels_are_trailing) {
+              implicit_trailing_label_cnt_ -= 2;
             }
           }
 
-          if (current_label_is_implicit && label) {
-            std::cout << "Inserting parent label requires " << cost_L << " new bits\n";
-            std::cout << "There are " << free_bits_L_ << " free bits in L\n";
-            if (cost_L > free_bits_L_) {
-              std::cout << "There are not enough bits in L\n";
-            } else {
-              std::cout << "There are enough bits in L\n";
-            } 
-          }
-          #endif
+          // Update label level offset LuT
+          ofs_L_update_vec[level + 1] -= 2;
           
-          //if (cost_T <= free_bits_T_ && cost_L <= free_bits_L_ && cost_L < 64 && cost_T < 64)
-          if (cost_T <= free_bits_T_ && cost_L <= free_bits_L_ && !perfect_levels_reduced) {
-            #ifdef DEBUG
-            /*
-            boost::dynamic_bitset<u_int32_t> test_bitset(n_);
-            for (std::size_t i = 0; i < n_; i++) {
-              test_bitset[i] = test(i);
-            }*/
-            #endif
-            std::size_t T_bits_before = implicit_inner_node_cnt_ + tree_bit_cnt_ + implicit_trailing_leaf_cnt_;
-            std::size_t L_bits_before = implicit_leading_label_cnt_ + label_bit_cnt_ + implicit_trailing_label_cnt_;
-
-            // Remove children label bits from L
-            if (!children_labels_are_implicit) {
-              if (left_label_is_leading && !right_label_is_leading) {
-                remove_from_labels(0, 1);
-                free_bits_L_ += 1;
-                label_bit_cnt_ -= 1;
-                implicit_leading_label_cnt_ -= 1;
-              } else if (!left_label_is_trailing && right_label_is_trailing) {
-                bitmap_fn::clear(get_label_ptr(ptr_), label_bit_cnt_ - 1);
-                free_bits_L_ += 1;
-                label_bit_cnt_ -= 1;
-                implicit_trailing_label_cnt_ -= 1;
-              } else {
-                remove_from_labels(left_label_idx - implicit_leading_label_cnt_, 2);
-                label_bit_cnt_ -= 2;
-                free_bits_L_ += 2;
-              }
+          // Remove children tree bits from T
+          if (children_are_implicit) {
+            // Both leaves are implicit
+            implicit_trailing_leaf_cnt_ -= 2;
+          } else {
+            // Left child is explicit while right child is trailing
+            if (!left_child_is_implicit && right_child_is_implicit) {
+              implicit_trailing_leaf_cnt_ -= 1;
+              tree_bit_cnt_ -= 1;
+              free_bits_T_ += 1;
             } else {
-              if (children_labels_are_leading) {
-                implicit_leading_label_cnt_ -= 2;
-              }
-              if (children_labels_are_trailing) {
-                implicit_trailing_label_cnt_ -= 2;
-              }
+              // Both are explicit
+              remove_from_tree(left_child - implicit_inner_node_cnt_, 2);
+              tree_bit_cnt_ -= 2;
+              free_bits_T_ += 2;
             }
+          }
 
-            // Update label level offset LuT
-            ofs_L_update_vec[level + 1] -= 2;
-            
-            // Remove children tree bits from T
-            if (children_are_implicit) {
-              // Both leaves are implicit
-              implicit_trailing_leaf_cnt_ -= 2;
-            } else {
-              // Left child is explicit while right child is trailing
-              if (!left_child_is_implicit && right_child_is_implicit) {
-                implicit_trailing_leaf_cnt_ -= 1;
-                tree_bit_cnt_ -= 1;
-                free_bits_T_ += 1;
-              } else {
-                // Both are explicit
-                remove_from_tree(left_child - implicit_inner_node_cnt_, 2);
-                tree_bit_cnt_ -= 2;
-                free_bits_T_ += 2;
-              }
-            }
+          // Update tree level offset LuT
+          ofs_T_update_vec[level + 1] -= 2;
 
-            // Update tree level offset LuT
-            ofs_T_update_vec[level + 1] -= 2;
+          // If pruning happens at a perfect level, decrease number of perfect levels
+          if (level + 1 < perfect_level_cnt_) {
+            perfect_level_cnt_ -= 1;
+          }
 
-            // If pruning happens at a perfect level, decrease number of perfect levels
-            if (level + 1 < perfect_level_cnt_) {
-              perfect_level_cnt_ -= 1;
+          std::size_t rank_block_granularity = rank_.get_block_bitlength();
+          std::size_t all_bits = get_tree_word_cnt(ptr_) * word_bitlength;
+          std::size_t rank_lut_block_cnt = (all_bits / rank_block_granularity) + 1;
+          if (all_bits % rank_block_granularity) rank_lut_block_cnt += 1;
+          std::size_t lut_begin = ((node_idx - implicit_inner_node_cnt_) / rank_block_granularity) + 1;
+          if (!current_is_implicit) {
+            // Set current (inner) node to a leaf node, update LuT
+            bitmap_fn::clear(get_tree_ptr(ptr_), node_idx - implicit_inner_node_cnt_);
+            for (std::size_t i = lut_begin; i < rank_lut_block_cnt; i++) {
+              rank_lut_ptr_[i] -= 1;
             }
-
-            std::size_t rank_block_granularity = rank_.get_block_bitlength();
-            std::size_t all_bits = get_tree_word_cnt(ptr_) * word_bitlength;
-            std::size_t rank_lut_block_cnt = (all_bits / rank_block_granularity) + 1;
-            if (all_bits % rank_block_granularity) rank_lut_block_cnt += 1;
-            std::size_t lut_begin = ((node_idx - implicit_inner_node_cnt_) / rank_block_granularity) + 1;
-            if (!current_is_implicit) {
-              // Set current (inner) node to a leaf node, update LuT
-              bitmap_fn::clear(get_tree_ptr(ptr_), node_idx - implicit_inner_node_cnt_);
-              for (std::size_t i = lut_begin; i < rank_lut_block_cnt; i++) {
-                rank_lut_ptr_[i] -= 1;
-              }
+          } else {
+            // Insert new bits into T
+            if (cost_T >= 64) {
+              std::size_t words_to_insert = cost_T / word_bitlength;
+              std::size_t bits_to_insert = cost_T % word_bitlength;
+              insert_into_tree(0, bits_to_insert, 1);
+              free_bits_T_ -= bits_to_insert;
+              implicit_inner_node_cnt_ -= bits_to_insert;
+              tree_bit_cnt_ += bits_to_insert;
+              prepend_words_T(words_to_insert);
+              free_bits_T_ -= words_to_insert * word_bitlength;
+              implicit_inner_node_cnt_ -= words_to_insert * word_bitlength;
+              tree_bit_cnt_ += words_to_insert * word_bitlength;
             } else {
-              // Insert new bits into T
-              if (cost_T >= 64) {
-                std::size_t words_to_insert = cost_T / word_bitlength;
-                std::size_t bits_to_insert = cost_T % word_bitlength;
-                insert_into_tree(0, bits_to_insert, 1);
-                free_bits_T_ -= bits_to_insert;
-                implicit_inner_node_cnt_ -= bits_to_insert;
-                tree_bit_cnt_ += bits_to_insert;
-                prepend_words_T(words_to_insert);
-                free_bits_T_ -= words_to_insert * word_bitlength;
-                implicit_inner_node_cnt_ -= words_to_insert * word_bitlength;
-                tree_bit_cnt_ += words_to_insert * word_bitlength;
-              } else {
-                insert_into_tree(0, cost_T, 1);
-                free_bits_T_ -= cost_T;
-                implicit_inner_node_cnt_ -= cost_T;
-                tree_bit_cnt_ += cost_T;
-              }
-              
-              // Set current (inner) node to a leaf node, update LuT
-              bitmap_fn::clear(get_tree_ptr(ptr_), 0);
-              for (std::size_t i = 1; i < rank_lut_block_cnt; i++) {
-                rank_lut_ptr_[i] -= 1;
-              }
+              insert_into_tree(0, cost_T, 1);
+              free_bits_T_ -= cost_T;
+              implicit_inner_node_cnt_ -= cost_T;
+              tree_bit_cnt_ += cost_T;
+            }
+            
+            // Set current (inner) node to a leaf node, update LuT
+            bitmap_fn::clear(get_tree_ptr(ptr_), 0);
+            for (std::size_t i = 1; i < rank_lut_block_cnt; i++) {
+              rank_lut_ptr_[i] -= 1;
             }
+          }
 
-            // Insert label bit of parent into
-            if (!current_label_is_implicit) {
-              insert_into_labels(current_label_idx - implicit_leading_label_cnt_, 1, label);
-              label_bit_cnt_ += 1;
-              free_bits_L_ -= 1;
-            } else {
-              if (label) {
-                if (current_label_is_leading) {
-                  if (cost_L >= 64) {
-                    std::size_t words_to_insert = cost_L / word_bitlength;
-                    std::size_t bits_to_insert = cost_L % word_bitlength;
-                    insert_into_labels(0, bits_to_insert, 0);
-                    free_bits_L_ -= bits_to_insert;
-                    implicit_leading_label_cnt_ -= bits_to_insert - 1;
-                    label_bit_cnt_ += bits_to_insert;
-                    prepend_words_L(words_to_insert);
-                    free_bits_L_ -= words_to_insert * word_bitlength;
-                    implicit_leading_label_cnt_ -= words_to_insert * word_bitlength;
-                    label_bit_cnt_ += words_to_insert * word_bitlength;
-                  } else {
-                    insert_into_labels(0, cost_L, 0);
-                    free_bits_L_ -= cost_L;
-                    implicit_leading_label_cnt_ -= cost_L - 1;
-                    label_bit_cnt_ += cost_L;
-                  }
-                  bitmap_fn::set(get_label_ptr(ptr_), 0);
+          // Insert label bit of parent into
+          if (!current_label_is_implicit) {
+            insert_into_labels(current_label_idx - implicit_leading_label_cnt_, 1, label);
+            label_bit_cnt_ += 1;
+            free_bits_L_ -= 1;
+          } else {
+            if (label) {
+              if (current_label_is_leading) {
+                if (cost_L >= 64) {
+                  std::size_t words_to_insert = cost_L / word_bitlength;
+                  std::size_t bits_to_insert = cost_L % word_bitlength;
+                  insert_into_labels(0, bits_to_insert, 0);
+                  free_bits_L_ -= bits_to_insert;
+                  implicit_leading_label_cnt_ -= bits_to_insert - 1;
+                  label_bit_cnt_ += bits_to_insert;
+                  prepend_words_L(words_to_insert);
+                  free_bits_L_ -= words_to_insert * word_bitlength;
+                  implicit_leading_label_cnt_ -= words_to_insert * word_bitlength;
+                  label_bit_cnt_ += words_to_insert * word_bitlength;
                 } else {
-                  //insert_into_labels(label_bit_cnt_, cost_L, 0);
+                  insert_into_labels(0, cost_L, 0);
                   free_bits_L_ -= cost_L;
-                  implicit_trailing_label_cnt_ -= cost_L - 1;
+                  implicit_leading_label_cnt_ -= cost_L - 1;
                   label_bit_cnt_ += cost_L;
-                  bitmap_fn::set(get_label_ptr(ptr_), label_bit_cnt_ + cost_L - 1);
                 }
+                bitmap_fn::set(get_label_ptr(ptr_), 0);
               } else {
-                if (current_label_is_leading) {
-                  implicit_leading_label_cnt_ += 1;
-                } else {
-                  implicit_trailing_label_cnt_ += 1;
-                }
+                //insert_into_labels(label_bit_cnt_, cost_L, 0);
+                free_bits_L_ -= cost_L;
+                implicit_trailing_label_cnt_ -= cost_L - 1;
+                label_bit_cnt_ += cost_L;
+                bitmap_fn::set(get_label_ptr(ptr_), label_bit_cnt_ + cost_L - 1);
               }
-            }
-            // Update label level offset table
-            ofs_L_update_vec[level] += 1;
-
-            // Update height
-            if (level > max_height_observed) max_height_observed = level;
-
-            #ifdef DEBUG
-            // Debugging & Logging
-            if (!children_labels_are_implicit) {
-              std::cout << "Label idx of left child: " << left_label_idx << "\n";
-              if (left_label_is_leading && !right_label_is_leading) {
-                std::cout << "Left child label is implicit, but right child is explicit\n";
-              } else if (!left_label_is_trailing && right_label_is_trailing) {
-                std::cout <<  "Right child label is implicit, but left child is explicit\n";
+            } else {
+              if (current_label_is_leading) {
+                implicit_leading_label_cnt_ += 1;
               } else {
-                std::cout << "Children labels are explicit\n";
+                implicit_trailing_label_cnt_ += 1;
               }
+            }
+          }
+          // Update label level offset table
+          ofs_L_update_vec[level] += 1;
+
+          // Update height
+          if (level > max_height_observed) max_height_observed = level;
+
+          #ifdef DEBUG
+          // Debugging & Logging
+          if (!children_labels_are_implicit) {
+            std::cout << "Label idx of left child: " << left_label_idx << "\n";
+            if (left_label_is_leading && !right_label_is_leading) {
+              std::cout << "Left child label is implicit, but right child is explicit\n";
+            } else if (!left_label_is_trailing && right_label_is_trailing) {
+              std::cout <<  "Right child label is implicit, but left child is explicit\n";
             } else {
-              if (children_labels_are_leading) {
-                std::cout << "Children labels are leading implicit\n";
-              }
-              if (children_labels_are_trailing) {
-                std::cout << "Children labels are trailing implicit\n";
-              }
+              std::cout << "Children labels are explicit\n";
             }
-            
-            // Remove children tree bits from T
-            if (children_are_implicit) {
-              // Both leaves are implicit
-              std::cout << "Both children are implicit\n";
+          } else {
+            if (children_labels_are_leading) {
+              std::cout << "Children labels are leading implicit\n";
+            }
+            if (children_labels_are_trailing) {
+              std::cout << "Children labels are trailing implicit\n";
+            }
+          }
+          
+          // Remove children tree bits from T
+          if (children_are_implicit) {
+            // Both leaves are implicit
+            std::cout << "Both children are implicit\n";
+          } else {
+            // Both are explicit
+            if (!left_child_is_implicit && right_child_is_implicit) {
+              std::cout << "Only left child is explicit\n";
             } else {
-              // Both are explicit
-              if (!left_child_is_implicit && right_child_is_implicit) {
-                std::cout << "Only left child is explicit\n";
-              } else {
-                std::cout << "Both children are explicit\n";
-              }
+              std::cout << "Both children are explicit\n";
             }
-            // Insert label bit of parent into
-            std::cout << "Calculated parent label idx: " << current_label_idx << std::endl;
-            if (!current_label_is_implicit) {
+          }
+          // Insert label bit of parent into
+          std::cout << "Calculated parent label idx: " << current_label_idx << std::endl;
+          if (!current_label_is_implicit) {
 
+          } else {
+            if (label) {
+              if (current_label_is_leading) {
+                std::cout << "Parent 1 label is leading implicit\n";
+              } else {
+                std::cout << "Parent 1 label is trailing implicit\n";
+              }
             } else {
-              if (label) {
-                if (current_label_is_leading) {
-                  std::cout << "Parent 1 label is leading implicit\n";
-                } else {
-                  std::cout << "Parent 1 label is trailing implicit\n";
-                }
+              if (current_label_is_leading) {
+                std::cout << "Parent 0 label is leading implicit\n";
               } else {
-                if (current_label_is_leading) {
-                  std::cout << "Parent 0 label is leading implicit\n";
-                } else {
-                  std::cout << "Parent 0 label is trailing implicit\n";
-                }
+                std::cout << "Parent 0 label is trailing implicit\n";
               }
             }
+          }
 
-            std::cout << "Tree bits: " << tree_bit_cnt_ << std::endl;
-            std::cout << "Total bits: " << get_tree_word_cnt(ptr_) * word_bitlength << std::endl;
-            std::cout << "Label bits: " << label_bit_cnt_ << std::endl;
-            std::cout << "Leading inner nodes: " << implicit_inner_node_cnt_ << std::endl;
-            std::cout << "Trailing leafs: " << implicit_trailing_leaf_cnt_ << std::endl;
-            std::cout << "Leading 0 labels: " << implicit_leading_label_cnt_ << std::endl;
-            std::cout << "Trailing 0 labels: " << implicit_trailing_label_cnt_ << std::endl;
-            std::cout << "Label ID after setting parent to leaf: " << get_label_idx(node_idx) << std::endl;
-            //display_T();
-            //display_L();
-            /*
-            std::cout << "Rank LuT: ";
-            for (std::size_t i = 0; i < get_rank_word_cnt(ptr_) * 2; i++) {
-              std::cout << get_rank_ptr(ptr_)[i] << " ";
-            }
-            std::cout << "\n"; */
-            std::cout << "Tree offset update vec: ";
-            for (std::size_t i = 0; i < encoded_tree_height_; i++) {
-              std::cout << ofs_T_update_vec[i] << " ";
-            }
-            std::cout << std::endl;
+          std::cout << "Tree bits: " << tree_bit_cnt_ << std::endl;
+          std::cout << "Total bits: " << get_tree_word_cnt(ptr_) * word_bitlength << std::endl;
+          std::cout << "Label bits: " << label_bit_cnt_ << std::endl;
+          std::cout << "Leading inner nodes: " << implicit_inner_node_cnt_ << std::endl;
+          std::cout << "Trailing leafs: " << implicit_trailing_leaf_cnt_ << std::endl;
+          std::cout << "Leading 0 labels: " << implicit_leading_label_cnt_ << std::endl;
+          std::cout << "Trailing 0 labels: " << implicit_trailing_label_cnt_ << std::endl;
+          std::cout << "Label ID after setting parent to leaf: " << get_label_idx(node_idx) << std::endl;
+          //display_T();
+          //display_L();
+          /*
+          std::cout << "Rank LuT: ";
+          for (std::size_t i = 0; i < get_rank_word_cnt(ptr_) * 2; i++) {
+            std::cout << get_rank_ptr(ptr_)[i] << " ";
+          }
+          std::cout << "\n"; */
+          std::cout << "Tree offset update vec: ";
+          for (std::size_t i = 0; i < encoded_tree_height_; i++) {
+            std::cout << ofs_T_update_vec[i] << " ";
+          }
+          std::cout << std::endl;
 
-            std::cout << "Label offset update vec: ";
-            for (std::size_t i = 0; i < encoded_tree_height_; i++) {
-              std::cout << ofs_L_update_vec[i] << " ";
-            }
-            std::cout << std::endl;
+          std::cout << "Label offset update vec: ";
+          for (std::size_t i = 0; i < encoded_tree_height_; i++) {
+            std::cout << ofs_L_update_vec[i] << " ";
+          }
+          std::cout << std::endl;
 
-            std::cout << "Tree offset table: ";
-            for (std::size_t i = 0; i < encoded_tree_height_; i++) {
-              std::cout << level_offsets_tree_lut_ptr_[i] << " ";
-            }
-            std::cout << std::endl;
+          std::cout << "Tree offset table: ";
+          for (std::size_t i = 0; i < encoded_tree_height_; i++) {
+            std::cout << level_offsets_tree_lut_ptr_[i] << " ";
+          }
+          std::cout << std::endl;
 
-            std::cout << "Label offset table: ";
-            for (std::size_t i = 0; i < encoded_tree_height_; i++) {
-              std::cout << level_offsets_labels_lut_ptr_[i] << " ";
-            }
-            std::cout << "\n\n";
-
-            prune_log_entry log_entry{
-              node_idx,
-              left_child,
-              right_child,
-              left_label,
-              current_label_idx,
-              children_are_implicit,
-              current_is_implicit,
-              cost_T,
-              !children_labels_are_implicit,
-              children_labels_are_leading,
-              right_label_is_trailing && !left_label_is_trailing,
-              children_labels_are_trailing,
-              left_label_is_leading && !right_label_is_leading,
-              current_label_is_leading,
-              current_label_is_trailing,
-              cost_L,
-              tree_bit_cnt_,
-              free_bits_T_,
-              implicit_inner_node_cnt_,
-              implicit_trailing_leaf_cnt_,
-              label_bit_cnt_,
-              free_bits_L_,
-              implicit_leading_label_cnt_,
-              implicit_trailing_label_cnt_,
-              0,
-              0
-            };
-
-            assert(prune_log != nullptr);
-            prune_log->push_back(log_entry);
-            /*
-            for (std::size_t i = 0; i < n_; i++) {
-              assert(test_bitset[i] == test(i));
-            }*/
-
-            #endif
-
-            assert(implicit_inner_node_cnt_ + tree_bit_cnt_ + implicit_trailing_leaf_cnt_ == T_bits_before - 2);
-            assert(implicit_leading_label_cnt_ + label_bit_cnt_ + implicit_trailing_label_cnt_ == L_bits_before - 1);
-            assert(free_bits_L_ == (get_label_word_cnt(ptr_) * word_bitlength) - label_bit_cnt_);
-            assert(free_bits_T_ == (get_tree_word_cnt(ptr_) * word_bitlength) - tree_bit_cnt_);
-            std::cout.flush();
-            check_LuT();
-          } else {
-            // Failed pruning
-            if (level + 1 > max_height_observed) max_height_observed = level + 1;
-            #ifdef DEBUG
-            std::cout << std::endl;
-            prune_log_entry log_entry{
-              node_idx,
-              left_child,
-              right_child,
-              left_label,
-              current_label_idx,
-              children_are_implicit,
-              current_is_implicit,
-              cost_T,
-              !children_are_implicit,
-              children_labels_are_leading,
-              right_label_is_trailing && !left_label_is_trailing,
-              children_labels_are_trailing,
-              left_label_is_leading && !right_label_is_leading,
-              current_label_is_leading,
-              current_label_is_trailing,
-              cost_L,
-              tree_bit_cnt_,
-              free_bits_T_,
-              implicit_inner_node_cnt_,
-              implicit_trailing_leaf_cnt_,
-              label_bit_cnt_,
-              free_bits_L_,
-              implicit_leading_label_cnt_,
-              implicit_trailing_label_cnt_,
-              cost_T > free_bits_T_,
-              cost_L > free_bits_L_
-            };
-            prune_log->push_back(log_entry);
-            #endif
+          std::cout << "Label offset table: ";
+          for (std::size_t i = 0; i < encoded_tree_height_; i++) {
+            std::cout << level_offsets_labels_lut_ptr_[i] << " ";
           }
+          std::cout << "\n\n";
+
+          prune_log_entry log_entry{
+            node_idx,
+            left_child,
+            right_child,
+            left_label,
+            current_label_idx,
+            children_are_implicit,
+            current_is_implicit,
+            cost_T,
+            !children_labels_are_implicit,
+            children_labels_are_leading,
+            right_label_is_trailing && !left_label_is_trailing,
+            children_labels_are_trailing,
+            left_label_is_leading && !right_label_is_leading,
+            current_label_is_leading,
+            current_label_is_trailing,
+            cost_L,
+            tree_bit_cnt_,
+            free_bits_T_,
+            implicit_inner_node_cnt_,
+            implicit_trailing_leaf_cnt_,
+            label_bit_cnt_,
+            free_bits_L_,
+            implicit_leading_label_cnt_,
+            implicit_trailing_label_cnt_,
+            0,
+            0
+          };
+
+          assert(prune_log != nullptr);
+          prune_log->push_back(log_entry);
+          /*
+          for (std::size_t i = 0; i < n_; i++) {
+            assert(test_bitset[i] == test(i));
+          }*/
+
+          #endif
+
+          assert(implicit_inner_node_cnt_ + tree_bit_cnt_ + implicit_trailing_leaf_cnt_ == T_bits_before - 2);
+          assert(implicit_leading_label_cnt_ + label_bit_cnt_ + implicit_trailing_label_cnt_ == L_bits_before - 1);
+          assert(free_bits_L_ == (get_label_word_cnt(ptr_) * word_bitlength) - label_bit_cnt_);
+          assert(free_bits_T_ == (get_tree_word_cnt(ptr_) * word_bitlength) - tree_bit_cnt_);
+#ifndef NDEBUG
+          check_LuT();
+#endif
+          return true;
         } else {
-          // Children nodes have different labels, update height
+          // Failed pruning
           if (level + 1 > max_height_observed) max_height_observed = level + 1;
+          #ifdef DEBUG
+          std::cout << std::endl;
+          prune_log_entry log_entry{
+            node_idx,
+            left_child,
+            right_child,
+            left_label,
+            current_label_idx,
+            children_are_implicit,
+            current_is_implicit,
+            cost_T,
+            !children_are_implicit,
+            children_labels_are_leading,
+            right_label_is_trailing && !left_label_is_trailing,
+            children_labels_are_trailing,
+            left_label_is_leading && !right_label_is_leading,
+            current_label_is_leading,
+            current_label_is_trailing,
+            cost_L,
+            tree_bit_cnt_,
+            free_bits_T_,
+            implicit_inner_node_cnt_,
+            implicit_trailing_leaf_cnt_,
+            label_bit_cnt_,
+            free_bits_L_,
+            implicit_leading_label_cnt_,
+            implicit_trailing_label_cnt_,
+            cost_T > free_bits_T_,
+            cost_L > free_bits_L_
+          };
+          prune_log->push_back(log_entry);
+          #endif
         }
       } else {
-        // Children are an inner node and leaf pair
+        // Children nodes have different labels, update height
         if (level + 1 > max_height_observed) max_height_observed = level + 1;
       }
+    } else {
+      // Children are an inner node and leaf pair
+      if (level + 1 > max_height_observed) max_height_observed = level + 1;
+    }
+    return false;
+  }
+
+  /// Applies the per-level changes of the node and label counts (as
+  /// collected during pruning) to the level offset tables.
+  void
+  apply_level_offset_updates(const std::vector<int>& ofs_T_update_vec,
+      const std::vector<int>& ofs_L_update_vec) {
+    int T_update_sum = 0;
+    int L_update_sum = 0;
+    for (std::size_t i = 0; i < ofs_T_update_vec.size() - 1; i++) {
+      T_update_sum += ofs_T_update_vec[i];
+      L_update_sum += ofs_L_update_vec[i];
+
+      level_offsets_tree_lut_ptr_[i + 1] += T_update_sum;
+      level_offsets_labels_lut_ptr_[i + 1] += L_update_sum;
+    }
+  }
+
+  /// Prunes the subtree rooted at the given node without modifying the TEB.
+  /// The nodes and labels of the pruned subtree are appended to T and L
+  /// (per level, relative to the level of the subtree root). Returns the
+  /// label if the pruned subtree is a single leaf, or 2 otherwise.
+  $u32
+  prune_subtree(u64 node_idx, std::size_t level,
+      std::vector<boost::dynamic_bitset<word_type>>& T,
+      std::vector<boost::dynamic_bitset<word_type>>& L) const {
+    if (is_leaf_node(node_idx)) {
+      const u1 label = get_label(node_idx);
+      T[level].push_back(false);
+      L[level].push_back(label);
+      return label;
+    }
+    const u64 left_child = 2 * rank_inclusive(node_idx) - 1;
+    const auto left = prune_subtree(left_child, level + 1, T, L);
+    const auto right = prune_subtree(left_child + 1, level + 1, T, L);
+    if (left != 2 && left == right) {
+      // Replace the two leaves by their parent.
+      T[level + 1].resize(T[level + 1].size() - 2);
+      L[level + 1].resize(L[level + 1].size() - 2);
+      T[level].push_back(false);
+      L[level].push_back(left == 1);
+      return left;
+    }
+    T[level].push_back(true);
+    return 2;
+  }
+
+  /// ORs the bits of 'src' into 'dst' starting at bit position 'dst_ofs'.
+  /// The function is thread-safe as long as the written ranges do not
+  /// overlap.
+  static void
+  scatter_bits(const boost::dynamic_bitset<word_type>& src, word_type* dst,
+      std::size_t dst_ofs) noexcept {
+    const std::size_t n = src.size();
+    const word_type* src_ptr = src.m_bits.data();
+    for (std::size_t i = 0; i < n; i += word_bitlength) {
+      const auto bits = bitmap_fn::fetch_bits(src_ptr, i,
+          std::min(i + word_bitlength, n));
+      if (bits == 0) continue;
+      const auto pos = dst_ofs + i;
+      const auto word_idx = pos / word_bitlength;
+      const auto bit_idx = pos % word_bitlength;
+      __atomic_fetch_or(&dst[word_idx], bits << bit_idx, __ATOMIC_RELAXED);
+      if (bit_idx != 0) {
+        __atomic_fetch_or(&dst[word_idx + 1],
+            bits >> (word_bitlength - bit_idx), __ATOMIC_RELAXED);
+      }
+    }
+  }
+
+  /// Writes the words [dst_word_begin, dst_word_end) of 'dst' with the bits
+  /// [b, e) of 'src'. Words beyond e are zeroed.
+  static void
+  copy_bits(const word_type* src, std::size_t b, std::size_t e,
+      word_type* dst, std::size_t dst_word_begin, std::size_t dst_word_end)
+      noexcept {
+    for (std::size_t k = dst_word_begin; k < dst_word_end; ++k) {
+      const auto i = b + k * word_bitlength;
+      dst[k] = (i < e)
+          ? bitmap_fn::fetch_bits(src, i, std::min(i + word_bitlength, e))
+          : word_type(0);
+    }
+  }
+
+  /// Executes the tasks [0, task_cnt) using up to 'thread_cnt' threads.
+  template<typename Fn>
+  static void
+  run_tasks_in_parallel(std::size_t task_cnt, std::size_t thread_cnt, Fn fn) {
+    std::atomic<std::size_t> next_task { 0 };
+    auto worker = [&]() {
+      for (std::size_t t = next_task++; t < task_cnt; t = next_task++) {
+        fn(t);
+      }
+    };
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < std::min(thread_cnt, task_cnt); ++i) {
+      threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+      thread.join();
     }
   }
 
+  /// Records that the given position has been updated in place.
+  void __teb_inline__
+  mark_dirty(std::size_t pos) noexcept {
+    if (dirty_cnt_ < dirty_max_cnt) {
+      dirty_pos_[dirty_cnt_] = static_cast<size_type>(pos);
+    }
+    // Saturate at 'dirty_max_cnt + 1', which marks the entire tree as dirty.
+    dirty_cnt_ = std::min(dirty_cnt_ + 1, static_cast<size_type>(dirty_max_cnt + 1));
+  }
+
   // Checks consistency between 1-bits in T and Rank LuT
   void check_LuT() {
     std::size_t set_bits_count = 0;
@@ -1824,6 +2348,355 @@ public:
     return word_cnt * word_size;
   }
 
+  /// Returns the header of a serialized copy of this TEB (including the
+  /// in-place updates), that reserves space for the given number of tree and
+  /// label bits. The capacities are increased if they are smaller than the
+  /// number of explicit bits.
+  teb_header
+  make_header(std::size_t tree_bit_capacity,
+      std::size_t label_bit_capacity) const noexcept {
+    teb_header hdr;
+    hdr.n = n_actual_;
+    // A non-existent tree structure or label bitmap is not materialized.
+    if (get_tree_ptr(ptr_) != nullptr && tree_bit_cnt_ > 0) {
+      hdr.tree_bit_cnt = tree_bit_cnt_;
+      hdr.free_bits_T = static_cast<size_type>(
+          std::max(tree_bit_capacity, std::size_t(tree_bit_cnt_))
+          - tree_bit_cnt_);
+    }
+    if (get_label_ptr(ptr_) != nullptr && label_bit_cnt_ > 0) {
+      hdr.label_bit_cnt = label_bit_cnt_;
+      hdr.free_bits_L = static_cast<size_type>(
+          std::max(label_bit_capacity, std::size_t(label_bit_cnt_))
+          - label_bit_cnt_);
+    }
+    hdr.implicit_inner_node_cnt = implicit_inner_node_cnt_;
+    hdr.trailing_inner_node_cnt = implicit_trailing_leaf_cnt_;
+    hdr.implicit_leading_label_cnt = implicit_leading_label_cnt_;
+    hdr.implicit_trailing_label_cnt = implicit_trailing_label_cnt_;
+    hdr.perfect_level_cnt = static_cast<u8>(perfect_level_cnt_);
+    // The number of level offset entries remains the same.
+    hdr.encoded_tree_height = hdr_->encoded_tree_height;
+    hdr.has_level_offsets = hdr_->has_level_offsets;
+    hdr.is_lossy = hdr_->is_lossy;
+    hdr.update_counter = update_counter_;
+    hdr.update_threshold = update_threshold_;
+    return hdr;
+  }
+
+  /// Returns the total number of labels, including the implicit ones.
+  std::size_t
+  get_label_cnt() const noexcept {
+    return std::size_t(implicit_leading_label_cnt_) + label_bit_cnt_
+        + implicit_trailing_label_cnt_;
+  }
+
+  /// Writes the labels of the complement of this TEB to the given
+  /// destination, which needs to provide space for get_label_cnt() bits. The
+  /// tree structure of the complement is the same, only the explicit labels
+  /// are flipped and the implicit 0-labels turn into 1-labels. The leaves
+  /// that cover the padding beyond n_actual_ (up to the next power of two)
+  /// remain 0-leaves. Returns false if the complement cannot be represented
+  /// using the same tree structure, i.e., if a 0-leaf covers the last bit as
+  /// well as (a part of) the padding. In that case, the leaf is a 1-leaf in
+  /// the destination and needs to be split (see teb_wrapper::complement()).
+  u1
+  complement_labels(word_type* dst) const noexcept {
+    const std::size_t label_cnt = get_label_cnt();
+    const std::size_t word_cnt =
+        (label_cnt + word_bitlength - 1) / word_bitlength;
+    std::fill(dst, dst + word_cnt, word_type(0));
+    if (label_cnt == 0) return true;
+    const std::size_t explicit_begin = implicit_leading_label_cnt_;
+    const std::size_t explicit_end = explicit_begin + label_bit_cnt_;
+    if (explicit_begin > 0) {
+      bitmap_fn::set(dst, 0, explicit_begin);
+    }
+    for (std::size_t i = 0; i < label_bit_cnt_; i += word_bitlength) {
+      const auto e = std::min(i + word_bitlength, std::size_t(label_bit_cnt_));
+      const auto bits = bitmap_fn::fetch_bits(label_ptr_, i, e);
+      bitmap_fn::store_bits(dst, explicit_begin + i, explicit_begin + e,
+          ~bits);
+    }
+    if (explicit_end < label_cnt) {
+      bitmap_fn::set(dst, explicit_end, label_cnt);
+    }
+    return clear_padding_labels(dst, 0, label_cnt);
+  }
+
+  /// Returns the header of a serialized copy of this TEB, where the labels
+  /// are replaced by the given ones, e.g., obtained from complement_labels().
+  /// The leading and trailing 0-labels become implicit, whereby the
+  /// remaining (explicit) labels are shifted in place to the beginning of
+  /// the given buffer. Note that the level offsets of the labels include the
+  /// implicit labels, and thus remain valid.
+  teb_header
+  make_header_with_labels(word_type* labels) const noexcept {
+    const std::size_t label_cnt = get_label_cnt();
+    const std::size_t word_cnt =
+        (label_cnt + word_bitlength - 1) / word_bitlength;
+    const std::size_t first = std::min(label_cnt,
+        bitmap_fn::find_first(labels, labels + word_cnt));
+    const std::size_t last = bitmap_fn::find_last(labels, labels + word_cnt);
+    const std::size_t end = (first < label_cnt) ? last + 1 : first;
+    // Shift the explicit labels. (The reads are always ahead of the writes.)
+    for (std::size_t i = 0; first + i < end; i += word_bitlength) {
+      const auto cnt = std::min(std::size_t(word_bitlength), end - first - i);
+      const auto bits = bitmap_fn::fetch_bits(labels, first + i, first + i + cnt);
+      bitmap_fn::store_bits(labels, i, i + cnt, bits);
+    }
+
+    auto hdr = make_header(0, 0);
+    hdr.label_bit_cnt = static_cast<size_type>(end - first);
+    hdr.free_bits_L = 0;
+    hdr.implicit_leading_label_cnt = static_cast<size_type>(first);
+    hdr.implicit_trailing_label_cnt = static_cast<size_type>(label_cnt - end);
+    return hdr;
+  }
+
+  /// Returns the size in number of words of a serialized TEB with the given
+  /// header.
+  static std::size_t
+  get_serialized_word_cnt(const teb_header& hdr) noexcept {
+    std::array<word_type, sizeof(teb_header) / word_size> hdr_words;
+    std::memcpy(hdr_words.data(), &hdr, sizeof(teb_header));
+    const auto* ptr = hdr_words.data();
+    return get_header_word_cnt(ptr) + get_tree_word_cnt(ptr)
+        + get_rank_word_cnt(ptr) + get_label_word_cnt(ptr)
+        + get_metadata_word_cnt(ptr);
+  }
+
+  /// Serializes this TEB (including the in-place updates) to the given
+  /// destination address, using the given header, which is expected to be
+  /// obtained from make_header(). The destination needs to provide space for
+  /// get_serialized_word_cnt(hdr) words.
+  void
+  serialize(const teb_header& hdr, word_type* dst) const noexcept {
+    serialize(hdr, label_ptr_, dst);
+  }
+
+  /// Serializes this TEB as above, but with the given (explicit) labels, e.g.,
+  /// obtained from make_header_with_labels().
+  void
+  serialize(const teb_header& hdr, const word_type* labels,
+      word_type* dst) const noexcept {
+    *reinterpret_cast<teb_header*>(dst) = hdr;
+
+    // Copy the explicit bits and clear the reserved bits.
+    const auto copy_bits = [](const word_type* src, std::size_t bit_cnt,
+        word_type* dst_begin, std::size_t dst_word_cnt) {
+      const std::size_t word_cnt =
+          (bit_cnt + word_bitlength - 1) / word_bitlength;
+      std::copy(src, src + word_cnt, dst_begin);
+      std::fill(dst_begin + word_cnt, dst_begin + dst_word_cnt, word_type(0));
+      bitmap_fn::clear(dst_begin, bit_cnt, word_cnt * word_bitlength);
+    };
+    auto* tree_ptr = get_tree_ptr(dst);
+    const auto tree_word_cnt = get_tree_word_cnt(dst);
+    if (tree_ptr != nullptr) {
+      copy_bits(tree_ptr_, hdr.tree_bit_cnt, tree_ptr, tree_word_cnt);
+    }
+    auto* label_ptr = get_label_ptr(dst);
+    if (label_ptr != nullptr) {
+      copy_bits(labels, hdr.label_bit_cnt, label_ptr,
+          get_label_word_cnt(dst));
+    }
+
+    // Rebuild the rank LuT, which also covers the reserved bits.
+    auto* rank_ptr = get_rank_ptr(dst);
+    if (rank_ptr != nullptr) {
+      rank_type::init_inplace(tree_ptr, tree_ptr + tree_word_cnt, rank_ptr);
+    }
+
+    // Copy the level offsets.
+    if (hdr.has_level_offsets) {
+      const auto entry_cnt = hdr.encoded_tree_height;
+      auto* ofs_tree = reinterpret_cast<size_type*>(get_metadata_ptr(dst));
+      auto* ofs_labels = ofs_tree + entry_cnt;
+      std::copy(level_offsets_tree_lut_ptr_,
+          level_offsets_tree_lut_ptr_ + entry_cnt, ofs_tree);
+      std::copy(level_offsets_labels_lut_ptr_,
+          level_offsets_labels_lut_ptr_ + entry_cnt, ofs_labels);
+    }
+  }
+
+  /// Increases the size of the bitmap to n bits, where n must not exceed the
+  /// capacity of the tree (n_). The appended bits are 0, as the tree covers
+  /// them already.
+  void
+  grow(std::size_t n) noexcept {
+    assert(n >= n_actual_);
+    assert(n <= n_);
+    n_actual_ = static_cast<size_type>(n);
+  }
+
+  /// Returns the header of a serialized copy of this TEB with an additional
+  /// root level. The tree becomes the left subtree of the new root node and
+  /// the right child is a 0-leaf, which doubles the capacity of the tree. The
+  /// size of the bitmap is set to n, with n_ < n <= 2 * n_.
+  teb_header
+  make_header_with_root_level(std::size_t n, std::size_t tree_bit_capacity,
+      std::size_t label_bit_capacity) const noexcept {
+    assert(n > n_ && n <= 2 * std::size_t(n_));
+    auto hdr = make_header(tree_bit_capacity, label_bit_capacity);
+    hdr.n = static_cast<size_type>(n);
+    hdr.encoded_tree_height = hdr_->encoded_tree_height + 1;
+    if (implicit_inner_node_cnt_ == 0) {
+      // The tree consists of a single leaf.
+      if (!has_root_1label()) {
+        // A 0-leaf remains a 0-leaf.
+        return hdr;
+      }
+      // The tree becomes '1 0 0' and the labels '1 0', whereof the first
+      // node and the last node and label are implicit.
+      hdr.implicit_inner_node_cnt = 1;
+      hdr.tree_bit_cnt = 1;
+      hdr.trailing_inner_node_cnt = 1;
+      hdr.implicit_leading_label_cnt = 0;
+      hdr.label_bit_cnt = 1;
+      hdr.implicit_trailing_label_cnt = 1;
+    }
+    else {
+      // The leading inner nodes, except for the old root node, are
+      // materialized, as they now follow the new 0-leaf in level order. The
+      // new 0-label becomes the first label. Trailing explicit leaves become
+      // implicit.
+      const auto explicit_cnt = explicit_tree_bit_cnt();
+      const auto trimmed_cnt = trimmed_tree_bit_cnt();
+      hdr.implicit_inner_node_cnt = 2;
+      hdr.tree_bit_cnt = (trimmed_cnt > 0)
+          ? implicit_inner_node_cnt_ + trimmed_cnt
+          : std::max(implicit_inner_node_cnt_, size_type(1));
+      hdr.trailing_inner_node_cnt = implicit_trailing_leaf_cnt_
+          + (implicit_inner_node_cnt_ + explicit_cnt) - hdr.tree_bit_cnt;
+      hdr.implicit_leading_label_cnt = implicit_leading_label_cnt_ + 1;
+    }
+    hdr.free_bits_T = static_cast<size_type>(
+        std::max(tree_bit_capacity, std::size_t(hdr.tree_bit_cnt))
+        - hdr.tree_bit_cnt);
+    hdr.free_bits_L = static_cast<size_type>(
+        std::max(label_bit_capacity, std::size_t(hdr.label_bit_cnt))
+        - hdr.label_bit_cnt);
+    hdr.perfect_level_cnt = static_cast<u8>(
+        teb_util::determine_perfect_tree_levels(hdr.implicit_inner_node_cnt));
+    return hdr;
+  }
+
+  /// Serializes this TEB with an additional root level to the given
+  /// destination address, using the header obtained from
+  /// make_header_with_root_level().
+  void
+  serialize_with_root_level(const teb_header& hdr, word_type* dst)
+      const noexcept {
+    *reinterpret_cast<teb_header*>(dst) = hdr;
+    const u1 single_leaf = implicit_inner_node_cnt_ == 0;
+
+    auto* tree_ptr = get_tree_ptr(dst);
+    const auto tree_word_cnt = get_tree_word_cnt(dst);
+    std::fill(tree_ptr, tree_ptr + tree_word_cnt, word_type(0));
+    if (!single_leaf) {
+      // The new 0-leaf, followed by the formerly implicit inner nodes and the
+      // explicit nodes.
+      const std::size_t ofs = implicit_inner_node_cnt_;
+      bitmap_fn::set(tree_ptr, 1, ofs);
+      const std::size_t src_bit_cnt = hdr.tree_bit_cnt - ofs;
+      const std::size_t src_word_cnt =
+          (src_bit_cnt + word_bitlength - 1) / word_bitlength;
+      for (std::size_t k = 0; k < src_word_cnt; ++k) {
+        auto w = tree_ptr_[k];
+        const auto bit_cnt = std::min(std::size_t(word_bitlength),
+            src_bit_cnt - k * word_bitlength);
+        if (bit_cnt < word_bitlength) w &= (word_type(1) << bit_cnt) - 1;
+        const auto i = ofs + k * word_bitlength;
+        tree_ptr[i / word_bitlength] |= w << (i % word_bitlength);
+        if (i % word_bitlength != 0
+            && (i / word_bitlength) + 1 < tree_word_cnt) {
+          tree_ptr[i / word_bitlength + 1] |=
+              w >> (word_bitlength - (i % word_bitlength));
+        }
+      }
+    }
+
+    auto* label_ptr = get_label_ptr(dst);
+    if (label_ptr != nullptr) {
+      const auto label_word_cnt = get_label_word_cnt(dst);
+      if (single_leaf) {
+        std::fill(label_ptr, label_ptr + label_word_cnt, word_type(0));
+        bitmap_fn::set(label_ptr, 0);
+      }
+      else {
+        // The explicit labels remain unchanged.
+        const std::size_t word_cnt =
+            (label_bit_cnt_ + word_bitlength - 1) / word_bitlength;
+        std::copy(label_ptr_, label_ptr_ + word_cnt, label_ptr);
+        std::fill(label_ptr + word_cnt, label_ptr + label_word_cnt,
+            word_type(0));
+        bitmap_fn::clear(label_ptr, label_bit_cnt_, word_cnt * word_bitlength);
+      }
+    }
+
+    auto* rank_ptr = get_rank_ptr(dst);
+    if (rank_ptr != nullptr) {
+      rank_type::init_inplace(tree_ptr, tree_ptr + tree_word_cnt, rank_ptr);
+    }
+
+    // The levels move down by one. The new root and the new 0-leaf precede
+    // all the nodes below level 1, and the new 0-label precedes all the
+    // labels below level 1. (unless the new 0-leaf has been pruned)
+    if (hdr.has_level_offsets) {
+      const std::size_t entry_cnt = hdr.encoded_tree_height;
+      const u1 pruned = single_leaf && !has_root_1label();
+      auto* ofs_tree = reinterpret_cast<size_type*>(get_metadata_ptr(dst));
+      auto* ofs_labels = ofs_tree + entry_cnt;
+      ofs_tree[0] = 0;
+      ofs_labels[0] = 0;
+      for (std::size_t l = 1; l < entry_cnt; ++l) {
+        if (l == 1) {
+          ofs_tree[l] = 1;
+          ofs_labels[l] = pruned ? 1 : 0;
+        }
+        else {
+          ofs_tree[l] = level_offsets_tree_lut_ptr_[l - 1] + (pruned ? 0 : 2);
+          ofs_labels[l] =
+              level_offsets_labels_lut_ptr_[l - 1] + (pruned ? 0 : 1);
+        }
+      }
+    }
+  }
+
+  /// Returns true if the tree consists of a single leaf, labelled with 1.
+  u1
+  has_root_1label() const noexcept {
+    return implicit_inner_node_cnt_ == 0 && label_bit_cnt_ > 0
+        && bitmap_fn::test(label_ptr_, 0);
+  }
+
+  /// Returns the number of explicit tree bits without the trailing leaves
+  /// (0-bits).
+  std::size_t
+  trimmed_tree_bit_cnt() const noexcept {
+    for (std::size_t k = explicit_tree_bit_cnt(); k > 0; --k) {
+      if (bitmap_fn::test(tree_ptr_, k - 1)) return k;
+    }
+    return 0;
+  }
+
+  /// Returns the number of explicit tree bits. In contrast to tree_bit_cnt_,
+  /// this is 0 if the tree structure is not materialized.
+  std::size_t
+  explicit_tree_bit_cnt() const noexcept {
+    return get_tree_ptr(ptr_) != nullptr ? tree_bit_cnt_ : 0;
+  }
+
+  /// Takes over the state that is not reflected in the serialized header
+  /// from 'other', which refers to the TEB this instance has been serialized
+  /// from.
+  void
+  take_over_transient_state(const teb_flat& other) noexcept {
+    dirty_pos_ = other.dirty_pos_;
+    dirty_cnt_ = other.dirty_cnt_;
+  }
+
   /// For debugging purposes.
   void __forceinline__
   print(std::ostream& os) const noexcept {
@@ -1889,6 +2762,47 @@ public: // TODO revert
     return ret_val;
   }
 
+  /// Prefetches the tree word and the rank LuT entry of the given tree node,
+  /// i.e., the data that is required to determine the node type and the rank.
+  void __teb_inline__
+  prefetch_node(size_type node_idx) const noexcept {
+    const auto implicit_1bit_cnt = implicit_inner_node_cnt_;
+    if (node_idx < implicit_1bit_cnt || tree_bit_cnt_ == 0) {
+      return;
+    }
+    const auto i = std::min(node_idx - implicit_1bit_cnt, tree_bit_cnt_ - 1);
+    __builtin_prefetch(&tree_ptr_[i / word_bitlength], 0, 3);
+    __builtin_prefetch(&rank_lut_ptr_[i / rank_type::block_bitlength], 0, 3);
+  }
+
+  /// Prefetches the word in L that contains the given label.
+  void __teb_inline__
+  prefetch_label(size_type label_idx) const noexcept {
+    const auto implicit_leading_label_cnt = implicit_leading_label_cnt_;
+    if (label_idx < implicit_leading_label_cnt
+        || label_idx >= label_bit_cnt_ + implicit_leading_label_cnt) {
+      return;
+    }
+    __builtin_prefetch(
+        &label_ptr_[(label_idx - implicit_leading_label_cnt) / word_bitlength],
+        0, 3);
+  }
+
+  /// Translates a pointer into the serialized TEB of this instance to the
+  /// corresponding location within the copy at 'dst'. Pointers that do not
+  /// point into the serialized TEB are returned unchanged.
+  template<typename T>
+  T*
+  relocate(T* p, word_type* const dst) const noexcept {
+    const auto* begin = reinterpret_cast<const char*>(ptr_);
+    const auto* end = begin + size_in_bytes();
+    const auto* c = reinterpret_cast<const char*>(p);
+    if (c < begin || c > end) {
+      return p;
+    }
+    return reinterpret_cast<T*>(reinterpret_cast<char*>(dst) + (c - begin));
+  }
+
   /// Returns true if the given node is an inner node, false otherwise.
   u1 __teb_inline__
   is_inner_node(size_type node_idx) const noexcept {
@@ -1956,6 +2870,13 @@ public: // TODO revert
     return hdr_->has_level_offsets;
   }
 
+  /// Returns true if the TEB has been pruned lossy, i.e., 0-bits may be
+  /// reported as 1-bits.
+  u1 __teb_inline__
+  is_lossy() const noexcept {
+    return hdr_->is_lossy;
+  }
+
   /// Returns the position in T where the first tree node of level is stored.
   size_type __teb_inline__
   get_level_offset_tree(size_type level) const noexcept {
@@ -0,0 +1,473 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "teb_wrapper.hpp"
+
+#include <dtl/bitmap/iterator.hpp>
+#include <dtl/dtl.hpp>
+#include <dtl/math.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// A versioned handle to a TEB that allows for concurrent readers and a single
+/// writer.
+///
+/// The bitmap is split into fixed size blocks of P bits, each of which is
+/// encoded as a separate TEB. A version is an immutable list of (shared)
+/// pointers to these blocks. Readers pin the current version and never block,
+/// i.e., they do not acquire any locks and they do not modify reference
+/// counters. Updates are copy-on-write: The writer copies only the touched
+/// blocks, applies the updates in-place (or re-encodes the block if the TEB
+/// runs out of free bits), and publishes a new version that shares all
+/// untouched blocks with its predecessor. Outdated versions are reclaimed
+/// using an epoch-based scheme, once no reader refers to them anymore.
+///
+/// Note: Write accesses must be serialized by the caller.
+template<
+    /// The block size in bits.
+    std::size_t P = 1ull << 16>
+class teb_handle {
+  static_assert(dtl::is_power_of_two(P),
+      "The block size must be a power of two.");
+
+public:
+  using block_type = teb_wrapper;
+  static constexpr std::size_t block_bitlength = P;
+  /// The max. number of concurrently pinned versions.
+  static constexpr std::size_t max_reader_cnt = 256;
+
+  /// An immutable version of the bitmap.
+  struct version {
+    /// The version number.
+    $u64 version_no;
+    /// The length of the bitmap.
+    std::size_t n;
+    /// The blocks, which may be shared among multiple versions.
+    std::vector<std::shared_ptr<const block_type>> blocks;
+  };
+
+private:
+  /// The epoch of a reader. Zero, if the slot is unused.
+  struct alignas(64) reader_slot {
+    std::atomic<$u64> epoch { 0 };
+  };
+
+  /// The current version.
+  std::atomic<version*> current_;
+  /// The global epoch, which is incremented whenever a new version has been
+  /// published.
+  std::atomic<$u64> global_epoch_;
+  /// The reader slots, used to determine whether versions can be reclaimed.
+  mutable std::unique_ptr<reader_slot[]> reader_slots_;
+  /// The outdated versions that have not been reclaimed yet, along with the
+  /// epoch when they have been retired. (Accessed only by the writer.)
+  std::vector<std::pair<$u64, version*>> retired_;
+
+public:
+  /// C'tor (similar to all other implementations)
+  explicit teb_handle(const boost::dynamic_bitset<$u32>& bitmap)
+      : current_(nullptr),
+        global_epoch_(1),
+        reader_slots_(std::make_unique<reader_slot[]>(max_reader_cnt)) {
+    auto* v = new version();
+    v->version_no = 0;
+    v->n = bitmap.size();
+    const std::size_t block_cnt =
+        (bitmap.size() + (block_bitlength - 1)) / block_bitlength;
+    for (std::size_t b = 0; b < block_cnt; ++b) {
+      boost::dynamic_bitset<$u32> block(block_bitlength);
+      const std::size_t b_begin = b * block_bitlength;
+      const std::size_t b_end = std::min((b + 1) * block_bitlength, v->n);
+      auto i = (b_begin == 0)
+          ? bitmap.find_first()
+          : bitmap.find_next(b_begin - 1);
+      while (i < b_end && i != boost::dynamic_bitset<$u32>::npos) {
+        block[i % block_bitlength] = true;
+        i = bitmap.find_next(i);
+      }
+      v->blocks.push_back(std::make_shared<const block_type>(block));
+    }
+    current_.store(v);
+  }
+
+  teb_handle(const teb_handle& other) = delete;
+  teb_handle(teb_handle&& other) noexcept = delete;
+  teb_handle& operator=(const teb_handle& other) = delete;
+  teb_handle& operator=(teb_handle&& other) noexcept = delete;
+
+  /// D'tor. All snapshots need to be released before.
+  ~teb_handle() {
+    for (auto& r : retired_) {
+      delete r.second;
+    }
+    delete current_.load();
+  }
+
+  /// Return the name of the implementation.
+  static std::string
+  name() noexcept {
+    return std::string("teb_handle<")
+        + std::to_string(dtl::log_2(block_bitlength))
+        + std::string(">");
+  }
+
+  /// Returns the length of the original bitmap.
+  std::size_t
+  size() const noexcept {
+    return current_.load()->n;
+  }
+
+  /// Return the size in bytes of the current version.
+  std::size_t
+  size_in_bytes() const noexcept {
+    const auto* v = current_.load();
+    std::size_t s = 0;
+    for (const auto& block_ptr : v->blocks) {
+      s += block_ptr->size_in_bytes();
+    }
+    s += v->blocks.size() * sizeof(void*);
+    return s;
+  }
+
+  /// Returns the name of the instance including the most important parameters
+  /// in JSON.
+  std::string
+  info() const noexcept {
+    const auto* v = current_.load();
+    return "{\"name\":\"" + name() + "\""
+        + ",\"n\":" + std::to_string(v->n)
+        + ",\"block_cnt\":" + std::to_string(v->blocks.size())
+        + ",\"version\":" + std::to_string(v->version_no)
+        + ",\"size\":" + std::to_string(size_in_bytes())
+        + "}";
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Read related functions.
+  //===--------------------------------------------------------------------===//
+  /// A pinned (immutable) version of the bitmap. The version is guaranteed to
+  /// stay alive until the snapshot is destroyed.
+  class snapshot {
+    friend class teb_handle;
+    /// The reader slot, used to pin the version.
+    reader_slot* slot_;
+    /// The pinned version.
+    const version* version_;
+
+    snapshot(reader_slot* slot, const version* v)
+        : slot_(slot), version_(v) {}
+
+  public:
+    snapshot(const snapshot& other) = delete;
+    snapshot(snapshot&& other) noexcept
+        : slot_(other.slot_), version_(other.version_) {
+      other.slot_ = nullptr;
+    }
+    snapshot& operator=(const snapshot& other) = delete;
+    snapshot& operator=(snapshot&& other) = delete;
+
+    ~snapshot() {
+      if (slot_ != nullptr) {
+        slot_->epoch.store(0);
+      }
+    }
+
+    /// Returns the version number.
+    u64
+    version_no() const noexcept {
+      return version_->version_no;
+    }
+
+    /// Returns the length of the original bitmap.
+    std::size_t
+    size() const noexcept {
+      return version_->n;
+    }
+
+    /// Returns the value of the bit at the given position.
+    u1 __forceinline__
+    test(const std::size_t pos) const noexcept {
+      assert(pos < version_->n);
+      return version_->blocks[pos / block_bitlength]
+          ->test(pos % block_bitlength);
+    }
+
+    //===------------------------------------------------------------------===//
+    /// 1-run iterator over the blocks of the pinned version.
+    template<run_iterator_type iter_type>
+    class iter {
+      /// The pinned version.
+      const version* version_;
+
+      /// The iterator type of the nested bitmap.
+      using nested_iter_type =
+          typename obtain_run_iterator<const block_type, iter_type>::type;
+
+      // Hack to place nested iterators on heap memory.
+      struct heap_iter {
+        nested_iter_type iter;
+
+        heap_iter(const block_type* bitmap)
+            : iter(obtain_run_iterator<const block_type, iter_type>::from(
+                *bitmap)) {}
+        heap_iter(const heap_iter& other) = delete;
+        heap_iter(heap_iter&& other) noexcept = delete;
+        heap_iter& operator=(const heap_iter& other) = delete;
+        heap_iter& operator=(heap_iter&& other) noexcept = delete;
+        ~heap_iter() = default;
+      };
+
+      //===----------------------------------------------------------------===//
+      // Iterator state
+      //===----------------------------------------------------------------===//
+      /// The current block.
+      std::size_t current_block_idx_;
+      /// The nested iterator (of the current block).
+      std::unique_ptr<heap_iter> block_iter_;
+      /// Points to the beginning of a 1-fill.
+      $u64 pos_;
+      /// The length of the current 1-fill
+      $u64 length_;
+      //===----------------------------------------------------------------===//
+
+      /// Updates the iterator state. Advances to the next non-empty block if
+      /// the current block is exhausted.
+      void __forceinline__
+      sync() {
+        while (block_iter_->iter.end()) {
+          ++current_block_idx_;
+          if (current_block_idx_ >= version_->blocks.size()) {
+            // Reached the end.
+            block_iter_ = nullptr;
+            pos_ = version_->n;
+            length_ = 0;
+            return;
+          }
+          block_iter_ = std::make_unique<heap_iter>(
+              version_->blocks[current_block_idx_].get());
+        }
+        pos_ = (current_block_idx_ * block_bitlength)
+            + block_iter_->iter.pos();
+        length_ = block_iter_->iter.length();
+      }
+
+    public:
+      explicit iter(const version* v)
+          : version_(v),
+            current_block_idx_(0),
+            block_iter_(nullptr),
+            pos_(v->n),
+            length_(0) {
+        if (version_->blocks.empty()) return;
+        block_iter_ = std::make_unique<heap_iter>(
+            version_->blocks[current_block_idx_].get());
+        sync();
+      }
+
+      iter(iter&&) = default;
+
+      void __forceinline__
+      next() {
+        assert(!end());
+        block_iter_->iter.next();
+        sync();
+      }
+
+      void __forceinline__
+      skip_to(const std::size_t to_pos) {
+        if (to_pos < (pos_ + length_)) {
+          length_ -= to_pos - pos_;
+          pos_ = to_pos;
+          return;
+        }
+        if (end()) return;
+        const auto dst_block_idx = to_pos / block_bitlength;
+        if (dst_block_idx >= version_->blocks.size()) {
+          block_iter_ = nullptr;
+          pos_ = version_->n;
+          length_ = 0;
+          return;
+        }
+        if (dst_block_idx != current_block_idx_) {
+          current_block_idx_ = dst_block_idx;
+          block_iter_ = std::make_unique<heap_iter>(
+              version_->blocks[current_block_idx_].get());
+        }
+        const auto block_pos = to_pos % block_bitlength;
+        if (!block_iter_->iter.end() && block_iter_->iter.pos() < block_pos) {
+          block_iter_->iter.skip_to(block_pos);
+        }
+        sync();
+      }
+
+      u1 __forceinline__
+      end() const noexcept {
+        return length_ == 0;
+      }
+
+      u64 __forceinline__
+      pos() const noexcept {
+        return pos_;
+      }
+
+      u64 __forceinline__
+      length() const noexcept {
+        return length_;
+      }
+    };
+
+    using skip_iter_type = iter<run_iterator_type::SKIP>;
+    using scan_iter_type = iter<run_iterator_type::SCAN>;
+
+    skip_iter_type __forceinline__
+    it() const {
+      return skip_iter_type(version_);
+    }
+
+    scan_iter_type __forceinline__
+    scan_it() const {
+      return scan_iter_type(version_);
+    }
+    //===------------------------------------------------------------------===//
+  };
+
+  /// Pins the current version. The function is lock-free. It only blocks
+  /// (spins) in case all reader slots are in use.
+  snapshot
+  pin() const {
+    const std::size_t start =
+        std::hash<std::thread::id>()(std::this_thread::get_id());
+    while (true) {
+      for (std::size_t i = 0; i < max_reader_cnt; ++i) {
+        auto& slot = reader_slots_[(start + i) % max_reader_cnt];
+        if (slot.epoch.load(std::memory_order_relaxed) != 0) continue;
+        $u64 expected = 0;
+        // Announce the epoch BEFORE reading the current version. The writer
+        // reclaims a version only if all announced epochs are greater or
+        // equal to the epoch when the version has been retired.
+        if (slot.epoch.compare_exchange_strong(expected, global_epoch_.load())) {
+          return snapshot(&slot, current_.load());
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  /// Returns the value of the bit at the given position.
+  u1
+  test(const std::size_t pos) const noexcept {
+    return pin().test(pos);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Update related functions. (single writer)
+  //===--------------------------------------------------------------------===//
+  /// Set the i-th bit to the given value and publish a new version.
+  void
+  set(std::size_t i, u1 val) {
+    const std::pair<std::size_t, $u1> upd { i, val };
+    set(&upd, &upd + 1);
+  }
+
+  /// Applies a batch of updates and publishes a single new version. The
+  /// iterators need to refer to (position, value) pairs. Each touched block
+  /// is copied once, no matter how many updates it receives.
+  template<typename It>
+  void
+  set(It begin, It end) {
+    const auto* cur = current_.load();
+    // The blocks that have been copied for the new version.
+    std::vector<std::shared_ptr<block_type>> copies(cur->blocks.size());
+    $u1 modified = false;
+    for (auto it = begin; it != end; ++it) {
+      const std::size_t pos = it->first;
+      u1 val = it->second;
+      assert(pos < cur->n);
+      const auto block_idx = pos / block_bitlength;
+      const auto block_pos = pos % block_bitlength;
+      auto& copy = copies[block_idx];
+      if (copy == nullptr) {
+        if (cur->blocks[block_idx]->test(block_pos) == val) continue;
+        copy = std::make_shared<block_type>(*cur->blocks[block_idx]);
+      }
+      modified = true;
+      // Try to perform the update in-place, otherwise re-encode the block.
+      // Run-breaking updates are not performed in-place, as they do not
+      // maintain the level offsets required by the scan iterator.
+      $u1 diff_val = false;
+      const auto res = copy->update(block_pos, val, &diff_val);
+      if (res == 2) {
+        auto dec = copy->to_bitmap_using_iterator();
+        dec[block_pos] = val;
+        *copy = block_type(dec);
+      }
+    }
+    if (!modified) return;
+
+    auto* v = new version();
+    v->version_no = cur->version_no + 1;
+    v->n = cur->n;
+    v->blocks.reserve(cur->blocks.size());
+    for (std::size_t b = 0; b < cur->blocks.size(); ++b) {
+      if (copies[b] != nullptr) {
+        v->blocks.push_back(std::move(copies[b]));
+      }
+      else {
+        v->blocks.push_back(cur->blocks[b]);
+      }
+    }
+    publish(v);
+  }
+
+  /// Returns the number of outdated versions that have not been reclaimed
+  /// yet.
+  std::size_t
+  retired_version_cnt() const noexcept {
+    return retired_.size();
+  }
+
+  /// Tries to reclaim outdated versions. This function is called
+  /// automatically whenever a new version is published.
+  void
+  reclaim() {
+    $u64 min_epoch = ~0ull;
+    for (std::size_t i = 0; i < max_reader_cnt; ++i) {
+      const auto e = reader_slots_[i].epoch.load();
+      if (e != 0) {
+        min_epoch = std::min(min_epoch, e);
+      }
+    }
+    auto it = std::remove_if(retired_.begin(), retired_.end(),
+        [&](const std::pair<$u64, version*>& r) {
+          if (r.first <= min_epoch) {
+            delete r.second;
+            return true;
+          }
+          return false;
+        });
+    retired_.erase(it, retired_.end());
+  }
+
+private:
+  /// Installs the given version and retires the previous one.
+  void
+  publish(version* v) {
+    auto* prev = current_.exchange(v);
+    // Readers that announce the new epoch (or a later one) are guaranteed to
+    // see the new version.
+    const auto retire_epoch = global_epoch_.fetch_add(1) + 1;
+    retired_.emplace_back(retire_epoch, prev);
+    reclaim();
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
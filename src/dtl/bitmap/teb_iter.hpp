@@ -10,6 +10,12 @@
 #include <ostream>
 #include <string>
 //===----------------------------------------------------------------------===//
+// Set TEB_ITER_PREFETCH to 0 to disable software prefetching during the
+// downward navigation.
+#if !defined(TEB_ITER_PREFETCH)
+#define TEB_ITER_PREFETCH 1
+#endif
+//===----------------------------------------------------------------------===//
 namespace dtl {
 //===----------------------------------------------------------------------===//
 /// A 1-run iterator for TEBs with efficient skip support.
@@ -413,9 +419,10 @@ public:
     length_ = 0;
   }
 
-  /// Navigate to the desired position, starting from the trees' root node.
+  /// Positions the iterator at the top node that contains the desired
+  /// position. The downward navigation is left to the caller.
   void __teb_inline__
-  nav_from_root_to(const std::size_t to_pos) noexcept {
+  nav_to_top_node(const std::size_t to_pos) noexcept {
     //===------------------------------------------------------------------===//
     // (Re-)initialize the iterator state.
     stack_.clear();
@@ -430,6 +437,12 @@ public:
     //===------------------------------------------------------------------===//
 
     node_idx_ = top_node_idx_current_;
+  }
+
+  /// Navigate to the desired position, starting from the trees' root node.
+  void __teb_inline__
+  nav_from_root_to(const std::size_t to_pos) noexcept {
+    nav_to_top_node(to_pos);
     nav_downwards(to_pos);
     return;
   }
@@ -440,9 +453,18 @@ public:
   void __teb_inline__
   nav_downwards(const std::size_t to_pos) noexcept {
     $u64 level = dtl::teb_util::determine_level_of(path_);
-    auto rank = teb_.rank_inclusive(node_idx_);
-    std::size_t i = tree_height_ - level - 1;
-    while (true) {
+    $u64 rank = teb_.rank_inclusive(node_idx_);
+    while (!nav_downwards_step(to_pos, level, rank)) {}
+  }
+
+  /// Performs a single step of the downward navigation, i.e., it either
+  /// descends to the child node in the direction of the desired position, or,
+  /// if the current node is a leaf, it produces the output.  'level' and
+  /// 'rank' refer to the current node and are updated accordingly.  Returns
+  /// true, if the navigation is complete.
+  u1 __teb_inline__
+  nav_downwards_step(const std::size_t to_pos, $u64& level, $u64& rank) noexcept {
+    {
       // First check, if this is already a leaf node.
       if (teb_.is_leaf_node(node_idx_)) {
         // Reached the desired position.
@@ -457,24 +479,31 @@ public:
           // Adjust the current position and fill-length.
           length_ -= to_pos - pos_;
           pos_ = to_pos;
-          return;
+          return true;
         }
         else {
           // Search forward to the next 1-fill.
           next();
-          return;
+          return true;
         }
       }
 
       // Navigate downwards the tree.
       // 0 -> go to left child, 1 -> go to right child
-      u1 direction_bit = dtl::bits::bit_test(to_pos, i);
-      i--;
+      u1 direction_bit = dtl::bits::bit_test(to_pos, tree_height_ - level - 1);
       const auto right_child_idx = 2 * rank;
       const auto left_child_idx = right_child_idx - 1;
       const auto right_child_rank = teb_.rank_inclusive(right_child_idx);
       const auto right_child_is_inner = teb_.is_inner_node(right_child_idx);
       const auto left_child_rank = right_child_rank - right_child_is_inner;
+#if TEB_ITER_PREFETCH
+      // Prefetch the tree words and the rank LuT entries of the children of
+      // both candidates one level ahead. The child we descend to is accessed
+      // in the next step, its sibling (if pushed on the stack) when the
+      // iterator is forwarded.
+      teb_.prefetch_node(2 * left_child_rank);
+      teb_.prefetch_node(2 * right_child_rank);
+#endif
       level++;
       if (!direction_bit) {
         // Push the right child only if necessary.
@@ -499,6 +528,7 @@ public:
         rank = right_child_rank;
       }
     }
+    return false;
   }
 
   /// Forwards the iterator to the given position. The function first
@@ -507,6 +537,16 @@ public:
   /// node.
   void __teb_inline__
   nav_to(const std::size_t to_pos) noexcept {
+    if (nav_upwards(to_pos)) {
+      nav_downwards(to_pos);
+    }
+  }
+
+  /// First part of nav_to(). Positions the iterator at the node from where
+  /// the downward navigation starts. Returns false, if the iterator has
+  /// already been forwarded and no downward navigation is necessary.
+  u1 __teb_inline__
+  nav_upwards(const std::size_t to_pos) noexcept {
     assert(to_pos >= pos_ + length_);
     assert(perfect_levels_ > 0);
     // Fast path.  If the skip distance is larger than the range spanned by
@@ -514,8 +554,8 @@ public:
     // root node.  Thus, we do not need to compute the common ancestor node.
     if (pos_ >> partition_shift_ != to_pos >> partition_shift_
         || stack_.empty()) {
-      nav_from_root_to(to_pos);
-      return;
+      nav_to_top_node(to_pos);
+      return true;
     }
 
     // Determine the common ancestor node.  Note that the common ancestor is
@@ -541,8 +581,8 @@ public:
 
     if ((upstep_cnt > tree_height_) // underflow happens if the common ancestor is not on the stack
         || (upstep_cnt << 3) > downstep_cnt) { // cost(downstep) is approx. 9 x cost(upstep), however, we use << 3 instead of * 9
-      nav_from_root_to(to_pos);
-      return;
+      nav_to_top_node(to_pos);
+      return true;
     }
 
     assert(!stack_.empty());
@@ -556,8 +596,8 @@ public:
     $u64 level = tree_height_;
     while (path != right_child_of_common_ancestor_path) {
       if (stack_.empty()) {
-        nav_from_root_to(to_pos);
-        return;
+        nav_to_top_node(to_pos);
+        return true;
       };
       const stack_entry& node = stack_.top();
       node_idx = node.node_idx;
@@ -575,13 +615,13 @@ public:
       //   the next 1-fill.
       if (level < right_child_of_common_ancestor_level) {
         next();
-        return;
+        return false;
       }
       stack_.pop();
     }
     node_idx_ = node_idx;
     path_ = path;
-    nav_downwards(to_pos);
+    return true;
   }
 
   /// ------------------ FOR BENCHMARKING PURPOSES ONLY. -----------------------
@@ -670,6 +710,59 @@ public:
     nav_to(to_pos);
   }
 
+  /// The maximum number of iterators that can be forwarded at once using
+  /// skip_to_many().
+  static constexpr std::size_t skip_to_many_max_cnt = 8;
+
+  /// Fast-forwards multiple (independent) iterators to the given positions.
+  /// The downward navigations are interleaved, i.e., the iterators descend
+  /// one level at a time in a round-robin fashion. Thus, the memory accesses
+  /// of one iterator (which are prefetched one level ahead) overlap with the
+  /// work performed for the other iterators.
+  static void __teb_inline__
+  skip_to_many(teb_iter* const* iters, const std::size_t* to_pos,
+      const std::size_t cnt) noexcept {
+    assert(cnt <= skip_to_many_max_cnt);
+    $u64 level[skip_to_many_max_cnt];
+    $u64 rank[skip_to_many_max_cnt];
+    $u1 active[skip_to_many_max_cnt];
+    std::size_t active_cnt = 0;
+    for (std::size_t k = 0; k < cnt; ++k) {
+      teb_iter& it = *iters[k];
+      active[k] = false;
+      if (to_pos[k] >= it.teb_.n_actual_) {
+        it.pos_ = it.teb_.n_actual_;
+        it.length_ = 0;
+        continue;
+      }
+      if (to_pos[k] < (it.pos_ + it.length_)) {
+        it.length_ -= to_pos[k] - it.pos_;
+        it.pos_ = to_pos[k];
+        continue;
+      }
+      if (it.nav_upwards(to_pos[k])) {
+        it.teb_.prefetch_node(it.node_idx_);
+        active[k] = true;
+        ++active_cnt;
+      }
+    }
+    for (std::size_t k = 0; k < cnt; ++k) {
+      if (!active[k]) continue;
+      teb_iter& it = *iters[k];
+      level[k] = dtl::teb_util::determine_level_of(it.path_);
+      rank[k] = it.teb_.rank_inclusive(it.node_idx_);
+    }
+    while (active_cnt > 0) {
+      for (std::size_t k = 0; k < cnt; ++k) {
+        if (!active[k]) continue;
+        if (iters[k]->nav_downwards_step(to_pos[k], level[k], rank[k])) {
+          active[k] = false;
+          --active_cnt;
+        }
+      }
+    }
+  }
+
   /// Returns true if the iterator reached the end, false otherwise.
   u1 __forceinline__
   end() const noexcept {
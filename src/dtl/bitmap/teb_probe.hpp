@@ -0,0 +1,137 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "teb_flat.hpp"
+
+#include <dtl/dtl.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// A point lookup, i.e., the bit at position 'pos' of the given TEB.
+struct teb_probe {
+  const teb_flat* teb;
+  $u64 pos;
+};
+//===----------------------------------------------------------------------===//
+/// Evaluates a batch of independent point lookups, which may refer to
+/// different TEBs (e.g., one TEB per group). A single lookup navigates
+/// downwards the tree and typically stalls on a cache miss in T, the rank LuT
+/// and finally in L. The lookups are therefore executed in an interleaved
+/// fashion (known as asynchronous memory access chaining, AMAC): Each of the
+/// 'stream_cnt' streams keeps the state of one lookup. A stream performs a
+/// single navigational step, prefetches the data required for the next step
+/// and then yields to the next stream in a round-robin fashion. Once a lookup
+/// is completed, the stream picks up the next pending lookup.
+class teb_probe_executor {
+
+  /// The state of a single lookup.
+  struct stream_state {
+    /// The index of the lookup within the batch.
+    std::size_t probe_idx;
+    /// The TEB to probe.
+    const teb_flat* teb;
+    /// The position to probe.
+    $u64 pos;
+    /// The current tree node (during the downward navigation) or the label
+    /// index (once a leaf node has been reached).
+    $u64 idx;
+    /// The bit of 'pos' that determines the direction of the next step.
+    $u64 bit_idx;
+    /// True, if the downward navigation has reached a leaf node.
+    $u1 at_leaf;
+  };
+
+public:
+  /// The maximum number of interleaved lookups.
+  static constexpr std::size_t max_stream_cnt = 64;
+
+private:
+  /// Starts the given lookup, i.e., computes the top node and prefetches it.
+  static void __teb_inline__
+  start(stream_state& s, const teb_probe& probe, std::size_t probe_idx)
+      noexcept {
+    const auto& teb = *probe.teb;
+    assert(probe.pos < teb.size());
+    const auto level = teb.perfect_level_cnt_ - 1;
+    const auto top_node_idx_begin = (1ull << level) - 1;
+    s.probe_idx = probe_idx;
+    s.teb = probe.teb;
+    s.pos = probe.pos;
+    s.idx = top_node_idx_begin + (probe.pos >> (teb.tree_height_ - level));
+    s.bit_idx = teb.tree_height_ - 1 - level;
+    s.at_leaf = false;
+    teb.prefetch_node(s.idx);
+  }
+
+  /// Performs a single step of the given lookup. Returns true, if the lookup
+  /// is completed and the result has been written.
+  static u1 __teb_inline__
+  step(stream_state& s, $u1* results) noexcept {
+    const auto& teb = *s.teb;
+    if (s.at_leaf) {
+      results[s.probe_idx] = teb.get_label_by_idx(s.idx);
+      return true;
+    }
+    if (teb.is_inner_node(s.idx)) {
+      // Go to the left or the right child.
+      u1 direction_bit = dtl::bits::bit_test(s.pos, s.bit_idx);
+      s.idx = 2 * teb.rank_inclusive(s.idx) - 1 + direction_bit;
+      --s.bit_idx;
+      teb.prefetch_node(s.idx);
+    }
+    else {
+      // Reached a leaf node.
+      s.idx = teb.get_label_idx(s.idx);
+      s.at_leaf = true;
+      teb.prefetch_label(s.idx);
+    }
+    return false;
+  }
+
+public:
+  /// Evaluates the given lookups and writes the results to 'results'. At most
+  /// 'stream_cnt' lookups are in flight at any time.
+  static void
+  test(const teb_probe* probes, $u1* results, const std::size_t cnt,
+      const std::size_t stream_cnt = 16) noexcept {
+    assert(stream_cnt > 0);
+    stream_state streams[max_stream_cnt];
+    const std::size_t s_cnt = std::min(
+        std::min(stream_cnt, std::size_t(max_stream_cnt)), cnt);
+    std::size_t next_probe_idx = 0;
+    for (; next_probe_idx < s_cnt; ++next_probe_idx) {
+      start(streams[next_probe_idx], probes[next_probe_idx], next_probe_idx);
+    }
+    std::size_t active_cnt = s_cnt;
+    while (active_cnt > 0) {
+      for (std::size_t k = 0; k < active_cnt; ++k) {
+        if (!step(streams[k], results)) continue;
+        if (next_probe_idx < cnt) {
+          // Reuse the stream for the next lookup.
+          start(streams[k], probes[next_probe_idx], next_probe_idx);
+          ++next_probe_idx;
+        }
+        else {
+          // Retire the stream, i.e., replace it with the last active one.
+          --active_cnt;
+          streams[k] = streams[active_cnt];
+          --k;
+        }
+      }
+    }
+  }
+
+  /// Evaluates the given lookups one after another (the baseline).
+  static void
+  test_sequential(const teb_probe* probes, $u1* results,
+      const std::size_t cnt) noexcept {
+    for (std::size_t i = 0; i < cnt; ++i) {
+      results[i] = probes[i].teb->test(probes[i].pos);
+    }
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
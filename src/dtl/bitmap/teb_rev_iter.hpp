@@ -0,0 +1,299 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include "teb_flat.hpp"
+#include "teb_util.hpp"
+
+#include <dtl/dtl.hpp>
+#include <dtl/static_stack.hpp>
+
+#include <algorithm>
+#include <cassert>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// A reverse 1-run iterator for TEBs, i.e., the 1-fills are produced in
+/// descending order of their positions. The tree is traversed right-to-left
+/// (depth first), which is the mirror image of teb_iter. The iterator starts
+/// at the last 1-fill and is moved towards the beginning of the bitmap using
+/// prev() and skip_to_before().
+class teb_rev_iter {
+  /// The fundamental type to encode paths within the tree.
+  using path_t = $u64;
+
+  struct stack_entry {
+    $u64 node_idx;
+    path_t path;
+    $u64 rank;
+    $u64 level;
+    $u64 is_inner;
+  };
+
+  /// Reference to the TEB instance.
+  const teb_flat& teb_;
+  /// The height of the tree structure.
+  u64 tree_height_;
+  /// The number of perfect levels in the tree structure.
+  u64 perfect_levels_;
+  /// First node index in the last perfect level.
+  u64 top_node_idx_begin_;
+  /// Last node index + 1 in the last perfect level.
+  u64 top_node_idx_end_;
+  /// The current top node.
+  $u64 top_node_idx_current_;
+  /// The stack contains the tree nodes that need to be visited, whereas the
+  /// left-most node is at the bottom.
+  static_stack<stack_entry, 32> stack_;
+  /// Points to the beginning of the current 1-fill.
+  $u64 pos_;
+  /// The length of the current 1-fill.
+  $u64 length_;
+
+public:
+  /// Constructs an iterator for the given TEB instance. After construction,
+  /// the iterator points to the last 1-fill.
+  explicit __teb_inline__
+  teb_rev_iter(const teb_flat& teb) noexcept
+      : teb_(teb),
+        tree_height_(dtl::teb_util::determine_tree_height(teb.n_)),
+        perfect_levels_(teb.perfect_level_cnt_),
+        top_node_idx_begin_((1ull << (teb.perfect_level_cnt_ - 1)) - 1),
+        top_node_idx_end_((1ull << teb.perfect_level_cnt_) - 1),
+        top_node_idx_current_((1ull << teb.perfect_level_cnt_) - 1),
+        pos_(0),
+        length_(0) {
+    prev_top_node();
+    advance();
+  }
+
+  teb_rev_iter(teb_rev_iter&&) noexcept = default;
+
+private:
+  /// Pushes the given top node on the stack.
+  void __teb_inline__
+  push_top_node(u64 node_idx, u64 rank, u64 is_inner) {
+    stack_entry& node = stack_.push();
+    node.node_idx = node_idx;
+    node.path = path_t(node_idx - top_node_idx_begin_);
+    // Set the sentinel bit.
+    node.path |= path_t(1) << (perfect_levels_ - 1);
+    node.level = perfect_levels_ - 1;
+    node.rank = rank;
+    node.is_inner = is_inner;
+  }
+
+  /// Moves the iterator to the previous top node that is either an inner
+  /// node or a leaf node with a 1-label, and pushes it on the stack. The
+  /// stack remains empty if no such node exists.
+  void __teb_inline__
+  prev_top_node() {
+    while (top_node_idx_current_ > top_node_idx_begin_) {
+      --top_node_idx_current_;
+      const auto is_inner = 0ull + teb_.is_inner_node(top_node_idx_current_);
+      const auto rank = teb_.rank_inclusive(top_node_idx_current_);
+      if (is_inner
+          || teb_.get_label_by_idx(top_node_idx_current_ - rank)) {
+        push_top_node(top_node_idx_current_, rank, is_inner);
+        return;
+      }
+    }
+  }
+
+  /// Sets the current 1-fill to the range covered by the given leaf node,
+  /// whereas the fill is cut at 'end_pos'. Returns false, if the remaining
+  /// 1-fill is empty, which can only happen for the padding bits.
+  u1 __teb_inline__
+  produce_output(u64 path, u64 level, u64 end_pos) noexcept {
+    // Toggle sentinel bit (= highest bit set) and add offset.
+    const u64 begin = (path ^ (1ull << level)) << (tree_height_ - level);
+    const u64 end = std::min(u64(begin + (teb_.n_ >> level)), end_pos);
+    if (begin >= end) return false;
+    pos_ = begin;
+    length_ = end - begin;
+    return true;
+  }
+
+  /// Moves the iterator to the next 1-fill in descending order, or to the
+  /// end, if there is none.
+  void __teb_inline__
+  advance() noexcept {
+    while (true) {
+      while (!stack_.empty()) {
+        // The current node.
+        stack_entry node_info = stack_.top();
+        stack_.pop();
+        $u1 node_label = node_info.is_inner == 0;
+
+        while (node_info.is_inner) {
+          // Determine left and right child. - Both exist, because the tree
+          // is full binary.
+          u64 right_child_idx = 2 * node_info.rank;
+          u64 left_child_idx = right_child_idx - 1;
+
+          // Determine whether the children are inner or leaf nodes.
+          const auto right_child_is_inner = 0ull
+              + teb_.is_inner_node(right_child_idx);
+          const auto left_child_is_inner = 0ull
+              + teb_.is_inner_node(left_child_idx);
+
+          // Compute the rank for one child, and derive the rank of the
+          // other one.
+          u64 left_child_rank = teb_.rank_inclusive(left_child_idx);
+          u64 right_child_rank = left_child_rank + right_child_is_inner;
+
+          // Determine the label indices in L.
+          u64 left_child_label_idx = left_child_idx - left_child_rank
+              + left_child_is_inner; // prevent underflow
+          u64 right_child_label_idx = left_child_label_idx + 1
+              - left_child_is_inner; // adjust index if necessary
+
+          // Eagerly fetch the labels.
+          u1 left_child_label = teb_.get_label_by_idx(left_child_label_idx);
+          u1 right_child_label = teb_.get_label_by_idx(right_child_label_idx);
+          node_label = right_child_label;
+
+          // Push left child on the stack and go to right child.
+          stack_entry& left_child_info = stack_.push();
+          left_child_info.node_idx = left_child_idx;
+          left_child_info.path = node_info.path << 1;
+          left_child_info.level = node_info.level + 1;
+          left_child_info.rank = left_child_rank;
+          left_child_info.is_inner = left_child_is_inner;
+          // Keep the left child only if necessary.
+          u1 push_left_child = (left_child_is_inner | left_child_label);
+          stack_.cnt_ = push_left_child ? stack_.cnt_ : stack_.cnt_ - 1;
+
+          node_info.node_idx = right_child_idx;
+          node_info.path = (node_info.path << 1) | 1;
+          node_info.level++;
+          node_info.rank = right_child_rank;
+          node_info.is_inner = right_child_is_inner;
+        }
+        // Reached a leaf node.
+        if (node_label
+            && produce_output(node_info.path, node_info.level,
+                teb_.n_actual_)) {
+          return;
+        }
+      }
+
+      if (top_node_idx_current_ == top_node_idx_begin_) break;
+      // Push the previous top node on the stack (if any).
+      prev_top_node();
+    }
+    pos_ = 0;
+    length_ = 0;
+  }
+
+public:
+  /// Moves the iterator to the previous 1-fill (if any).
+  void __teb_inline__
+  prev() noexcept {
+    assert(!end());
+    advance();
+  }
+
+  /// Moves the iterator backwards, so that it points to the last 1-fill that
+  /// begins before the given position. If that 1-fill extends beyond the
+  /// given position, it is cut. The iterator never moves forward, i.e., if
+  /// the current 1-fill ends before the given position, it remains unchanged.
+  void __teb_inline__
+  skip_to_before(const std::size_t to_pos) noexcept {
+    if (end()) return;
+    if (to_pos > pos_) {
+      length_ = std::min(length_, to_pos - pos_);
+      return;
+    }
+    if (to_pos == 0) {
+      pos_ = 0;
+      length_ = 0;
+      return;
+    }
+    if (to_pos == pos_) {
+      // The preceding 1-fill ends before the given position.
+      advance();
+      return;
+    }
+    nav_from_top_node_to(to_pos - 1, to_pos);
+  }
+
+private:
+  /// Navigates to the leaf that contains the position 'target', starting from
+  /// the corresponding top node. The left siblings along the path are pushed
+  /// on the stack, the right siblings are ignored, as they are located after
+  /// 'target'. If the leaf has a 0-label, the iterator is moved to the
+  /// previous 1-fill.
+  void __teb_inline__
+  nav_from_top_node_to(const std::size_t target, const std::size_t end_pos)
+      noexcept {
+    stack_.clear();
+    $u64 level = perfect_levels_ - 1;
+    const auto top_node_offset = target >> (tree_height_ - level);
+    top_node_idx_current_ = top_node_idx_begin_ + top_node_offset;
+    path_t path = (path_t(1) << level) | top_node_offset;
+    $u64 node_idx = top_node_idx_current_;
+    $u64 rank = teb_.rank_inclusive(node_idx);
+
+    while (teb_.is_inner_node(node_idx)) {
+      // 0 -> go to left child, 1 -> go to right child
+      u1 direction_bit = dtl::bits::bit_test(target, tree_height_ - level - 1);
+      const auto right_child_idx = 2 * rank;
+      const auto left_child_idx = right_child_idx - 1;
+      const auto right_child_rank = teb_.rank_inclusive(right_child_idx);
+      const auto right_child_is_inner = teb_.is_inner_node(right_child_idx);
+      const auto left_child_rank = right_child_rank - right_child_is_inner;
+      level++;
+      if (direction_bit) {
+        // Push the left child only if necessary.
+        const auto left_child_is_inner = teb_.is_inner_node(left_child_idx);
+        if (left_child_is_inner
+            || teb_.get_label_by_idx(left_child_idx - left_child_rank)) {
+          stack_entry& left_child_info = stack_.push();
+          left_child_info.node_idx = left_child_idx;
+          left_child_info.path = path << 1;
+          left_child_info.level = level;
+          left_child_info.rank = left_child_rank;
+          left_child_info.is_inner = 0ull + left_child_is_inner;
+        }
+        // Go to right child.
+        path = (path << 1) | 1;
+        node_idx = right_child_idx;
+        rank = right_child_rank;
+      }
+      else {
+        // Go to left child.
+        path <<= 1;
+        node_idx = left_child_idx;
+        rank = left_child_rank;
+      }
+    }
+    // Reached a leaf node.
+    if (teb_.get_label_by_idx(node_idx - rank)
+        && produce_output(path, level,
+            std::min(u64(end_pos), u64(teb_.n_actual_)))) {
+      return;
+    }
+    advance();
+  }
+
+public:
+  /// Returns true if the iterator reached the end (i.e., there is no 1-fill
+  /// left), false otherwise.
+  u1 __forceinline__
+  end() const noexcept {
+    return length_ == 0;
+  }
+
+  /// Returns the starting position of the current 1-fill.
+  u64 __forceinline__
+  pos() const noexcept {
+    return pos_;
+  }
+
+  /// Returns the length of the current 1-fill.
+  u64 __forceinline__
+  length() const noexcept {
+    return length_;
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
@@ -16,9 +16,17 @@
 #include <memory>
 #include <ostream>
 #include <string>
+#include <vector>
 //===----------------------------------------------------------------------===//
 namespace dtl {
 //===----------------------------------------------------------------------===//
+/// A range of positions [begin, end) of a TEB, which can be scanned
+/// independently of other ranges, see teb_scan_iter::split().
+struct teb_scan_range {
+  $u64 begin;
+  $u64 end;
+};
+//===----------------------------------------------------------------------===//
 /// 1-fill iterator, WITHOUT efficient skip support. The scan iterator falls
 /// back to a regular iterator if the level offsets are not present.
 class teb_scan_iter {
@@ -83,6 +91,12 @@ class teb_scan_iter {
 
   std::size_t first_1label_idx_ = 0;
 
+  /// The (exclusive) end position of the scan. Differs from n only if the
+  /// iterator is restricted to a range.
+  $u64 end_pos_;
+  /// True, if the iterator is restricted to a range.
+  $u1 is_range_scan_ = false;
+
   u1 fallback_to_default_iter;
   std::unique_ptr<teb_iter> default_iter;
   //===--------------------------------------------------------------------===//
@@ -118,6 +132,7 @@ public:
         result_read_pos_(0),
         batch_size_(batch_size),
         alpha_(0),
+        end_pos_(teb.n_),
         fallback_to_default_iter(!teb.has_level_offsets()),
         default_iter(nullptr) {
     if (fallback_to_default_iter) {
@@ -166,12 +181,205 @@ public:
     get_next_batch();
   }
 
+  /// Constructs an iterator that produces the 1-fills within the range
+  /// [begin_pos, end_pos) only. The range boundaries need to coincide with
+  /// the boundaries of the tree nodes, which holds for the ranges returned
+  /// by split(). The scan starts at the (highest) node that begins at
+  /// 'begin_pos' rather than at the first top node. After construction, the
+  /// iterator points to the first 1-fill within the range.
+  __teb_inline__
+  teb_scan_iter(const teb_flat& teb, u64 begin_pos, u64 end_pos,
+      u64 batch_size = DEFAULT_BATCH_SIZE) noexcept
+      : teb_(teb),
+        tree_height_(dtl::teb_util::determine_tree_height(teb.n_)),
+        perfect_levels_(teb.perfect_level_cnt_),
+        top_node_idx_begin_((1ull << (teb.perfect_level_cnt_ - 1)) - 1),
+        top_node_idx_end_((1ull << teb.perfect_level_cnt_) - 1),
+        top_node_idx_current_((1ull << (teb.perfect_level_cnt_ - 1)) - 1),
+        results_(batch_size),
+        result_cnt_(0),
+        batch_size_(batch_size),
+        result_read_pos_(0),
+        alpha_(0),
+        end_pos_(end_pos),
+        is_range_scan_(true),
+        fallback_to_default_iter(false),
+        default_iter(nullptr) {
+    // The level offsets are required to position the scanners.
+    assert(teb.has_level_offsets());
+    first_time_stack_ = false;
+    if (begin_pos >= std::min(end_pos, u64(teb_.n_actual_))) {
+      results_[0].pos = teb_.n_actual_;
+      results_[0].length = 0;
+      result_cnt_ = 1;
+      return;
+    }
+
+    // Navigate downwards to the node that begins at 'begin_pos'. The
+    // ancestor nodes are considered as visited, i.e., their scanners point
+    // to the subsequent node on the same level.
+    $u64 level = perfect_levels_ - 1;
+    $u64 node_idx = top_node_idx_begin_
+        + (begin_pos >> (tree_height_ - level));
+    top_node_idx_current_ = node_idx;
+    while ((begin_pos & ((teb_.n_ >> level) - 1)) != 0) {
+      assert(teb_.is_inner_node(node_idx));
+      const auto rank = teb_.rank_inclusive(node_idx);
+      scanner_states_[level].init(node_idx + 1, node_idx + 1 - rank);
+      const auto direction_bit =
+          dtl::bits::bit_test(begin_pos, tree_height_ - level - 1);
+      node_idx = 2 * rank - 1 + direction_bit;
+      ++level;
+    }
+    scan_path_ = begin_pos >> (tree_height_ - level);
+    scan_path_level_ = level;
+
+    // Position the scanners of the subsequent levels at the first node
+    // that is located at or after 'begin_pos'. - The children of the inner
+    // nodes are stored in the same order as their parents.
+    for (; level < teb_.encoded_tree_height_; ++level) {
+      const auto rank = rank_exclusive(node_idx);
+      scanner_states_[level].init(node_idx, node_idx - rank);
+      node_idx = 2 * rank + 1;
+    }
+    get_next_batch();
+  }
+
   teb_scan_iter(teb_scan_iter&&) noexcept = default;
   teb_scan_iter(const teb_scan_iter& other) = default;
   teb_scan_iter& operator=(const teb_scan_iter& other) = default;
   teb_scan_iter& operator=(teb_scan_iter&& other) = default;
   ~teb_scan_iter() = default;
 
+  /// Splits the given TEB into (at most) k ranges, which can be scanned
+  /// independently, e.g., by multiple threads. The ranges are aligned to the
+  /// boundaries of the top nodes or, if there are too few top nodes, to the
+  /// boundaries of the nodes on a deeper level. The ranges are balanced by
+  /// the number of tree nodes rather than by the number of bits, as the
+  /// former determines the scan costs.
+  static std::vector<teb_scan_range>
+  split(const teb_flat& teb, std::size_t k) {
+    std::vector<teb_scan_range> ret;
+    const u64 n = teb.n_actual_;
+    const auto tree_height = dtl::teb_util::determine_tree_height(teb.n_);
+    const u64 top_level = teb.perfect_level_cnt_ - 1;
+    if (k < 2 || !teb.has_level_offsets() || tree_height == 0) {
+      ret.push_back({0, n});
+      return ret;
+    }
+    // The position of the first node of the given level in level order. The
+    // children of the first inner node are the first nodes of the subsequent
+    // level, which also holds for the (non-existent) level below the leaves.
+    auto level_offset = [&](u64 level) {
+      if (level < teb.encoded_tree_height_) {
+        return u64(teb.get_level_offset_tree(level));
+      }
+      return 2 * rank_exclusive(teb, teb.get_level_offset_tree(level - 1)) + 1;
+    };
+    auto node_cnt_at = [&](u64 level) {
+      return level_offset(level + 1) - level_offset(level);
+    };
+    // Determine the level that provides the split candidates. We aim for
+    // multiple candidates per range to balance the ranges.
+    $u64 split_level = top_level;
+    while (split_level + 1 < tree_height
+        && node_cnt_at(split_level) < 8 * k
+        && node_cnt_at(split_level + 1) > 0) {
+      ++split_level;
+    }
+
+    // Collect the nodes on the split level along with their positions.
+    struct candidate {
+      $u64 node_idx;
+      $u64 pos;
+    };
+    std::vector<candidate> candidates;
+    {
+      std::vector<candidate> stack;
+      const u64 top_node_idx_begin = (1ull << top_level) - 1;
+      const u64 top_node_idx_end = (1ull << (top_level + 1)) - 1;
+      for (auto i = top_node_idx_end; i > top_node_idx_begin; --i) {
+        const auto node_idx = i - 1;
+        stack.push_back({node_idx, (node_idx - top_node_idx_begin)
+            << (tree_height - top_level)});
+      }
+      // Depth-first traversal, the levels are tracked using the positions.
+      std::vector<$u64> levels(stack.size(), top_level);
+      while (!stack.empty()) {
+        const auto c = stack.back();
+        const auto level = levels.back();
+        stack.pop_back();
+        levels.pop_back();
+        if (c.pos >= n) continue;
+        if (level == split_level) {
+          candidates.push_back(c);
+          continue;
+        }
+        if (!teb.is_inner_node(c.node_idx)) continue;
+        const auto right_child_idx = 2 * teb.rank_inclusive(c.node_idx);
+        stack.push_back({right_child_idx,
+            c.pos + (teb.n_ >> (level + 1))});
+        levels.push_back(level + 1);
+        stack.push_back({right_child_idx - 1, c.pos});
+        levels.push_back(level + 1);
+      }
+    }
+    if (candidates.empty()) {
+      ret.push_back({0, n});
+      return ret;
+    }
+
+    // The number of nodes on and below the split level that precede the
+    // given node (on the split level) in level order. The differences
+    // between two candidates refer to the nodes in between.
+    auto weight_of = [&](u64 node_idx) {
+      $u64 w = 0;
+      $u64 idx = node_idx;
+      for (auto level = split_level; level < teb.encoded_tree_height_;
+           ++level) {
+        w += idx;
+        if (level + 1 == teb.encoded_tree_height_) break;
+        idx = 2 * rank_exclusive(teb, idx) + 1;
+      }
+      return w;
+    };
+    const auto w_begin = weight_of(candidates.front().node_idx);
+    const auto w_end = weight_of(level_offset(split_level + 1));
+    const auto w_total = w_end - w_begin;
+
+    $u64 begin = 0;
+    std::size_t range_idx = 1;
+    for (const auto& c : candidates) {
+      if (range_idx == k) break;
+      if (c.pos <= begin) continue;
+      const auto w = weight_of(c.node_idx) - w_begin;
+      if (w * k >= range_idx * w_total) {
+        ret.push_back({begin, c.pos});
+        begin = c.pos;
+        // Skip the targets that have already been exceeded.
+        while (range_idx < k && w * k >= range_idx * w_total) ++range_idx;
+      }
+    }
+    ret.push_back({begin, n});
+    return ret;
+  }
+
+private:
+  /// Returns the number of inner nodes that precede the given node in level
+  /// order.
+  static u64 __teb_inline__
+  rank_exclusive(const teb_flat& teb, u64 node_idx) noexcept {
+    if (node_idx < teb.implicit_inner_node_cnt_) return node_idx;
+    if (teb.tree_bit_cnt_ == 0) return teb.implicit_inner_node_cnt_;
+    return teb.rank_inclusive(node_idx) - teb.is_inner_node(node_idx);
+  }
+
+  u64 __teb_inline__
+  rank_exclusive(u64 node_idx) const noexcept {
+    return rank_exclusive(teb_, node_idx);
+  }
+
+public:
   /// Forwards the iterator to the next 1-fill (if any).
   /// Use the functions pos() and length() to get the 1-fill the iterator
   /// is currently pointing to.
@@ -224,6 +432,11 @@ public:
       next_batch_from_default_iter();
       return;
     }
+    if (is_range_scan_) {
+      // Only the common tree-scan algorithm supports ranges.
+      next_batch_scalar_stack_perfect();
+      return;
+    }
     const auto tree_levels = tree_height_ + 1;
     // Check, if a special implementation can be used to produce the next batch.
     if (perfect_levels_ == tree_levels) {
@@ -511,7 +724,7 @@ public:
               results_[result_cnt].pos = pos + (!label0);
               const auto len = 0 + label0 + label1;
               results_[result_cnt].length = len;
-              result_cnt += len;
+              result_cnt += (len > 0);
             }
             else {
               // Observed a leaf node at level ....
@@ -1374,6 +1587,11 @@ public:
           break;
         }
       }
+      // Stop at the end of the range.
+      if ((path << (h - path_level)) >= end_pos_) {
+        path_level = 0;
+        break;
+      }
       // Reserve one entry in the current batch, in case we reach the end.
       if (result_cnt == batch_size_ - 1 || path_level == 0) break;
     }
@@ -1412,6 +1630,37 @@ public:
     }
   }
 
+  /// Writes the positions of the 1-bits, starting at the current position of
+  /// the iterator, to the given destination pointer. The function stops
+  /// when 'max_cnt' positions have been written or at position 'end_pos',
+  /// whatever comes first, and returns the number of positions written. The
+  /// iterator is forwarded accordingly; a subsequent call resumes where the
+  /// previous one stopped.
+  std::size_t __teb_inline__
+  to_positions($u32* dst_ptr, const std::size_t max_cnt,
+      const std::size_t end_pos) noexcept __attribute__((hot)) {
+    std::size_t write_cnt = 0;
+    while (!end() && write_cnt < max_cnt) {
+      // Consume the runs of the current batch.
+      auto& r = results_[result_read_pos_];
+      if (r.pos >= end_pos) break;
+      const auto run_end = std::min(r.pos + r.length, u64(end_pos));
+      const auto cnt = std::min(run_end - r.pos, u64(max_cnt - write_cnt));
+      bitmap_fun<word_type>::run_to_positions(static_cast<$u32>(r.pos), cnt,
+          dst_ptr + write_cnt);
+      write_cnt += cnt;
+      if (cnt == r.length) {
+        next();
+      }
+      else {
+        // Remember the remainder of the run.
+        r.pos += cnt;
+        r.length -= cnt;
+      }
+    }
+    return write_cnt;
+  }
+
   /// Returns true if the iterator reached the end, false otherwise.
   u1 __forceinline__
   end() const noexcept {
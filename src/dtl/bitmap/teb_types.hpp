@@ -4,6 +4,8 @@
 #include "util/rank1_logic_surf.hpp"
 
 #include <dtl/dtl.hpp>
+
+#include <algorithm>
 //===----------------------------------------------------------------------===//
 #if defined(TEB_NO_INLINE) && !defined(__teb_inline__)
 #define __teb_inline __attribute__((noinline))
@@ -57,11 +59,14 @@ struct teb_header {
   teb_size_type update_counter = 0;
   /// The number of updates to trigger pruning
   teb_size_type update_threshold = 0;
-  /// The number of free bits available for updates
+  /// The number of bits reserved for in-place updates, in addition to the
+  /// tree and the label bits. The reserved bits are located at the end of the
+  /// tree and the label bitmap, respectively.
   teb_size_type free_bits_T = 0;
   teb_size_type free_bits_L = 0;
-  /// Padding.
-  $u8 padding = 0;
+  /// True if the TEB has been pruned lossy, i.e., it may report false
+  /// positives, but no false negatives.
+  $u1 is_lossy = false;
 };
 #pragma pack(pop)
 //===----------------------------------------------------------------------===//
@@ -70,6 +75,26 @@ static_assert(sizeof(teb_header) == 48,
 static_assert(sizeof(teb_header) % sizeof(teb_word_type) == 0,
     "A TEB header is supposed to be a multiple of the word size.");
 //===----------------------------------------------------------------------===//
+/// Determines the number of bits that are reserved in a serialized TEB to
+/// perform (run-breaking) updates in place. The slack is sized relative to the
+/// size of the encoded tree and labels, but is at least 'min_bits'.
+struct teb_slack {
+  /// The reserved bits relative to the number of tree/label bits.
+  $f64 factor = 0.0;
+  /// The minimum number of bits to reserve for the tree and the labels each.
+  $u64 min_bits = 0;
+
+  /// Returns the number of bits to reserve, given the number of encoded bits.
+  /// No bits are reserved for an empty tree or empty labels, as those are not
+  /// materialized.
+  u64 __forceinline__
+  bits(u64 encoded_bit_cnt) const noexcept {
+    if (encoded_bit_cnt == 0) return 0;
+    const auto b = static_cast<$u64>(encoded_bit_cnt * factor);
+    return std::max(b, min_bits);
+  }
+};
+//===----------------------------------------------------------------------===//
 /// Used to represent empty trees and labels.
 static const teb_word_type teb_null_word = 0;
 //===----------------------------------------------------------------------===//
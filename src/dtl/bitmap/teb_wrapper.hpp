@@ -3,6 +3,8 @@
 #include "teb_builder.hpp"
 #include "teb_flat.hpp"
 #include "teb_iter.hpp"
+#include "teb_probe.hpp"
+#include "teb_rev_iter.hpp"
 #include "teb_scan_iter.hpp"
 #include "teb_types.hpp"
 
@@ -10,8 +12,10 @@
 
 #include <boost/dynamic_bitset.hpp>
 
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 //===----------------------------------------------------------------------===//
 namespace dtl {
@@ -24,6 +28,10 @@ public: // TODO remove
   std::unique_ptr<teb_flat> teb_;
   /// For testing: whether this TEB uses in-place pruning or reconstruction
   bool reconstruct = true;
+  /// The factor by which the reserved space of the tree or the labels grows,
+  /// when an in-place update fails due to insufficient space. A value <= 1
+  /// disables the growth, i.e., such updates fail.
+  $f64 growth_factor_ = 0.0;
 
 public:
   /// C'tor
@@ -36,10 +44,32 @@ public:
     teb_ = std::make_unique<teb_flat>(data_.data());
   }
 
-  /// C'tor
+  /// C'tor. Reserves additional space for in-place updates.
+  teb_wrapper(const boost::dynamic_bitset<$u32>& bitmap, const teb_slack& slack)
+      : data_(0), teb_(nullptr) {
+    dtl::teb_builder builder(bitmap);
+    builder.set_slack(slack);
+    const auto word_cnt = builder.serialized_size_in_words();
+    data_.resize(word_cnt);
+    builder.serialize(data_.data());
+    teb_ = std::make_unique<teb_flat>(data_.data());
+  }
+
+  /// C'tor. Creates a lossy TEB, with at most fpr * (number of 0-bits)
+  /// false positives.
+  teb_wrapper(const boost::dynamic_bitset<$u32>& bitmap, f64 fpr)
+      : data_(0), teb_(nullptr) {
+    dtl::teb_builder builder(bitmap, fpr);
+    const auto word_cnt = builder.serialized_size_in_words();
+    data_.resize(word_cnt);
+    builder.serialize(data_.data());
+    teb_ = std::make_unique<teb_flat>(data_.data());
+  }
+
+  /// C'tor. A false-positive rate (fpr) > 0 results in a lossy TEB.
   explicit teb_wrapper(const bitmap_tree<>&& bitmap_tree, f64 fpr = 0.0)
       : data_(0), teb_(nullptr) {
-    dtl::teb_builder builder(std::move(bitmap_tree));
+    dtl::teb_builder builder(std::move(bitmap_tree), fpr);
     const auto word_cnt = builder.serialized_size_in_words();
     data_.resize(word_cnt);
     builder.serialize(data_.data());
@@ -71,7 +101,17 @@ void display_T() {
     std::cout << std::endl;
 }
 
-  teb_wrapper(const teb_wrapper& other) = delete;
+  /// C'tor. Takes ownership of the given serialized TEB.
+  explicit teb_wrapper(std::vector<teb_word_type>&& data)
+      : data_(std::move(data)),
+        teb_(std::make_unique<teb_flat>(data_.data())) {}
+
+  /// Copy c'tor. Creates a deep copy, including the in-place updates.
+  teb_wrapper(const teb_wrapper& other)
+      : data_(other.data_),
+        teb_(std::make_unique<teb_flat>(*other.teb_, data_.data())),
+        reconstruct(other.reconstruct),
+        growth_factor_(other.growth_factor_) {}
   teb_wrapper(teb_wrapper&& other) noexcept = default;
   teb_wrapper& operator=(const teb_wrapper& other) = delete;
   teb_wrapper& operator=(teb_wrapper&& other) noexcept = default;
@@ -94,9 +134,59 @@ void display_T() {
     return std::move(teb_scan_iter(*teb_));
   }
 
+  /// Returns a point lookup for the given position, which can be evaluated
+  /// together with other lookups using teb_probe_executor.
+  teb_probe __teb_inline__
+  probe(std::size_t pos) const noexcept {
+    return teb_probe { teb_.get(), pos };
+  }
+
+  /// Returns a 1-fill iterator that is restricted to the given range, which
+  /// has been obtained from split().
+  teb_scan_iter __teb_inline__
+  scan_it(const teb_scan_range& range) const noexcept {
+    return teb_scan_iter(*teb_, range.begin, range.end);
+  }
+
+  /// Splits the TEB into (at most) k ranges of similar scan costs, which can
+  /// be scanned in parallel, see teb_scan_iter::split().
+  std::vector<teb_scan_range>
+  split(std::size_t k) const {
+    return teb_scan_iter::split(*teb_, k);
+  }
+
+  /// Returns a 1-fill iterator that produces the 1-fills in descending order,
+  /// starting with the last one.
+  teb_rev_iter __teb_inline__
+  rev_it() const noexcept {
+    return teb_rev_iter(*teb_);
+  }
+
   using skip_iter_type = teb_iter;
   using scan_iter_type = teb_scan_iter;
 
+  /// Decodes the TEB into a list of positions (row IDs). At most 'max_cnt'
+  /// positions are written to 'dst'. The cursor, which is obtained from
+  /// scan_it(), keeps track of the progress, so that the positions can be
+  /// materialized in batches. The function returns the number of positions
+  /// written; a value less than 'max_cnt' indicates that the decoding is
+  /// complete.
+  std::size_t __teb_inline__
+  to_positions($u32* dst, std::size_t max_cnt, teb_scan_iter& cursor)
+      const noexcept {
+    return cursor.to_positions(dst, max_cnt, size());
+  }
+
+  /// Same as above, but only the positions within [begin, end) are decoded.
+  std::size_t __teb_inline__
+  to_positions($u32* dst, std::size_t max_cnt, teb_scan_iter& cursor,
+      std::size_t begin, std::size_t end) const noexcept {
+    if (!cursor.end() && cursor.pos() < begin) {
+      cursor.skip_to(begin);
+    }
+    return cursor.to_positions(dst, max_cnt, end);
+  }
+
   /// Returns the length of the original bitmap.
   std::size_t __teb_inline__
   size() const noexcept {
@@ -109,9 +199,66 @@ void display_T() {
     return teb_->test(pos);
   }
 
-  /// Updates the TEB with a new value for the specified bit in the uncompressed bitmap
+  /// Decodes the bits in [b, e) into the given (plain) bitmap, see
+  /// teb_flat::fetch_words().
+  void __teb_inline__
+  fetch_words(std::size_t b, std::size_t e, teb_word_type* dst)
+      const noexcept {
+    teb_->fetch_words(b, e, dst);
+  }
+
+  /// Returns the complement of this TEB. The complement has the same tree
+  /// structure, thus only the labels are flipped, which costs O(|L|) instead
+  /// of decoding and re-encoding the bitmap. If the length of the bitmap is
+  /// not a power of two, the leaf that covers the last bit may also cover
+  /// (a part of) the padding, which needs to remain 0. Such a leaf is split
+  /// using a single run-breaking update. Only if the update cannot be
+  /// performed in place, the complement is re-encoded. The complement of a
+  /// lossy TEB is the exact complement of the bitmap represented by the
+  /// lossy TEB.
+  teb_wrapper
+  complement() const {
+    constexpr std::size_t word_bitlength = sizeof(teb_word_type) * 8;
+    std::vector<teb_word_type> labels(
+        (teb_->get_label_cnt() + word_bitlength - 1) / word_bitlength);
+    u1 is_split_required = !teb_->complement_labels(labels.data());
+    auto hdr = teb_->make_header_with_labels(labels.data());
+    hdr.is_lossy = false;
+    std::vector<teb_word_type> data(teb_flat::get_serialized_word_cnt(hdr));
+    teb_->serialize(hdr, labels.data(), data.data());
+    teb_wrapper ret(std::move(data));
+    if (is_split_required) {
+      // Clearing the first bit of the padding splits the leaf. Afterwards,
+      // the siblings along the path that lie in the padding are cleared.
+      if (ret.update_growing(size(), false, 2.0) != 1
+          || !ret.teb_->clear_padding_labels()) {
+        auto bitmap = to_bitmap_using_iterator();
+        bitmap.flip();
+        return teb_wrapper(bitmap);
+      }
+      ret.shrink_to_fit();
+    }
+    return ret;
+  }
+
+  /// Returns true if the TEB is lossy, i.e., it may contain false positives.
+  u1 __teb_inline__
+  is_lossy() const noexcept {
+    return teb_->is_lossy();
+  }
+
+  /// Updates the TEB with a new value for the specified bit in the uncompressed bitmap.
+  /// If growth is enabled and the update fails due to insufficient space, the
+  /// serialized TEB is re-allocated and the update is retried. Note that this
+  /// invalidates all iterators.
   int
   update(std::size_t pos, u1 val, u1 *diff_val, u1 two_run_opt = false) {
+    const auto res = teb_->update(pos, val, nullptr, diff_val, two_run_opt);
+    if (res != 2 || growth_factor_ <= 1.0
+        || (teb_->missing_bits_T_ == 0 && teb_->missing_bits_L_ == 0)) {
+      return res;
+    }
+    grow_reserved_space(growth_factor_);
     return teb_->update(pos, val, nullptr, diff_val, two_run_opt);
       /*
     if (teb_->update(pos, val)) {
@@ -130,6 +277,173 @@ void display_T() {
       } */
   }
 
+  /// Updates the TEB in place. If the reserved space is insufficient, it grows
+  /// by (at least) the given factor, regardless of the growth factor of this
+  /// instance, and the update is retried. Returns 2 if the update cannot be
+  /// performed in place, e.g., if the tree consists of a single leaf. Note
+  /// that this invalidates all iterators.
+  int
+  update_growing(std::size_t pos, u1 val, f64 growth_factor) {
+    auto res = teb_->update(pos, val);
+    if (res == 2
+        && (teb_->missing_bits_T_ > 0 || teb_->missing_bits_L_ > 0)) {
+      grow_reserved_space(std::max(growth_factor_, growth_factor));
+      res = teb_->update(pos, val);
+    }
+    return res;
+  }
+
+  /// Sets the growth factor of the reserved space. See growth_factor_.
+  void
+  set_growth_factor(f64 growth_factor) {
+    growth_factor_ = growth_factor;
+  }
+
+  /// Returns the number of tree bits (explicit and reserved).
+  std::size_t
+  tree_bit_capacity() const noexcept {
+    return teb_flat::get_tree_word_cnt(teb_->ptr_) * teb_flat::word_bitlength;
+  }
+
+  /// Returns the number of label bits (explicit and reserved).
+  std::size_t
+  label_bit_capacity() const noexcept {
+    return teb_flat::get_label_word_cnt(teb_->ptr_) * teb_flat::word_bitlength;
+  }
+
+  /// Re-allocates the serialized TEB if it provides less than the given
+  /// number of tree or label bits. Invalidates all iterators.
+  void
+  reserve(std::size_t tree_bit_cnt, std::size_t label_bit_cnt) {
+    const auto tree_capacity = tree_bit_capacity();
+    const auto label_capacity = label_bit_capacity();
+    if (tree_bit_cnt <= tree_capacity && label_bit_cnt <= label_capacity) {
+      return;
+    }
+    reallocate(std::max(tree_bit_cnt, tree_capacity),
+        std::max(label_bit_cnt, label_capacity));
+  }
+
+  /// Releases the reserved space. Invalidates all iterators.
+  void
+  shrink_to_fit() {
+    const auto hdr = teb_->make_header(0, 0);
+    if (teb_flat::get_serialized_word_cnt(hdr) < data_.size()) {
+      reallocate(hdr);
+    }
+  }
+
+  /// Increases the size of the bitmap to n bits. The new bits are 0. Within
+  /// the capacity of the tree (the next power of two), only the size is
+  /// adjusted. Otherwise, root levels are added until the tree covers n bits,
+  /// whereof each doubles the capacity and costs a copy of the serialized TEB.
+  /// Invalidates all iterators.
+  void
+  grow(std::size_t n) {
+    assert(n >= size());
+    while (n > teb_->n_) {
+      const std::size_t n_level = std::min(n, 2 * std::size_t(teb_->n_));
+      const auto hdr = teb_->make_header_with_root_level(n_level,
+          tree_bit_capacity(), label_bit_capacity());
+      std::vector<teb_word_type> data(teb_flat::get_serialized_word_cnt(hdr));
+      teb_->serialize_with_root_level(hdr, data.data());
+      auto teb = std::make_unique<teb_flat>(data.data());
+      // The dirty positions remain valid, as the old tree is the left subtree.
+      teb->take_over_transient_state(*teb_);
+      data_.swap(data);
+      teb_ = std::move(teb);
+    }
+    teb_->grow(n);
+  }
+
+  /// Appends the given bits to the bitmap. The 1-bits are set using in-place
+  /// updates, whereby the reserved space grows as needed (at least by a
+  /// factor of 2), and the modified subtrees are pruned afterwards. Thus, the
+  /// costs depend on the number of appended bits and the size of the encoded
+  /// tree, but not on the size of the bitmap. Invalidates all iterators.
+  void
+  append(const boost::dynamic_bitset<$u32>& bitmap) {
+    const std::size_t offset = size();
+    grow(offset + bitmap.size());
+    for (auto i = bitmap.find_first(); i != bitmap.npos;
+        i = bitmap.find_next(i)) {
+      if (update_growing(offset + i, true, 2.0) == 2) {
+        // The update cannot be performed in place, which happens if the tree
+        // consists of a single leaf. Fall back to re-encoding.
+        auto bm = to_bitmap_using_iterator();
+        for (; i != bitmap.npos; i = bitmap.find_next(i)) {
+          bm[offset + i] = true;
+        }
+        reencode(bm);
+        return;
+      }
+    }
+    teb_->prune_dirty();
+  }
+
+  /// Prunes the parts of the tree that have been modified by in-place
+  /// updates since the last prune.
+  void
+  prune_dirty() {
+    teb_->prune_dirty();
+  }
+
+  /// Prunes the tree using multiple threads.
+  void
+  prune_parallel(std::size_t thread_cnt = std::thread::hardware_concurrency()) {
+    teb_->prune_parallel(thread_cnt);
+  }
+
+  /// Replaces the TEB with a new encoding of the given bitmap. The
+  /// (relative) amount of reserved space is retained.
+  void
+  reencode(const boost::dynamic_bitset<$u32>& bitmap) {
+    const auto* tree_ptr = teb_flat::get_tree_ptr(teb_->ptr_);
+    const f64 slack_factor = (tree_ptr != nullptr)
+        ? static_cast<f64>(tree_bit_capacity()) / teb_->tree_bit_cnt_ - 1.0
+        : 0.0;
+    dtl::teb_builder builder(bitmap);
+    builder.set_slack(teb_slack { slack_factor, 0 });
+    std::vector<teb_word_type> data(builder.serialized_size_in_words());
+    builder.serialize(data.data());
+    data_.swap(data);
+    teb_ = std::make_unique<teb_flat>(data_.data());
+  }
+
+private:
+  /// Increases the reserved space of the tree and/or the labels
+  /// geometrically, such that the bits that were missing to perform the most
+  /// recent in-place update become available.
+  void
+  grow_reserved_space(f64 growth_factor) {
+    const auto grow_capacity = [&](std::size_t capacity, std::size_t missing) {
+      if (missing == 0) return capacity;
+      const auto grown = static_cast<std::size_t>(capacity * growth_factor);
+      return std::max(grown, capacity + missing);
+    };
+    reallocate(grow_capacity(tree_bit_capacity(), teb_->missing_bits_T_),
+        grow_capacity(label_bit_capacity(), teb_->missing_bits_L_));
+  }
+
+  /// Copies the TEB to a new buffer with the given capacities.
+  void
+  reallocate(std::size_t tree_bit_capacity, std::size_t label_bit_capacity) {
+    reallocate(teb_->make_header(tree_bit_capacity, label_bit_capacity));
+  }
+
+  /// Copies the TEB to a new buffer using the given header.
+  void
+  reallocate(const teb_header& hdr) {
+    std::vector<teb_word_type> data(teb_flat::get_serialized_word_cnt(hdr));
+    teb_->serialize(hdr, data.data());
+    auto teb = std::make_unique<teb_flat>(data.data());
+    teb->take_over_transient_state(*teb_);
+    // The heap buffer is retained when the vectors are swapped.
+    data_.swap(data);
+    teb_ = std::move(teb);
+  }
+
+public:
   void
   reconstruct_teb() {
     // Decompress
@@ -152,7 +466,7 @@ void display_T() {
 
   /// Reconstruct a plain bitmap using the run iterator, copied from util/convert.hpp
   boost::dynamic_bitset<$u32>
-  to_bitmap_using_iterator() {
+  to_bitmap_using_iterator() const {
     boost::dynamic_bitset<$u32> bm(teb_->size());
     auto it = scan_it();
     while (!it.end()) {
@@ -210,6 +524,7 @@ void display_T() {
         + ",\"rank\":" + teb_->rank_.info(teb_->tree_bit_cnt_)
         + ",\"leading_zero_labels\":" + std::to_string(
             teb_->implicit_leading_label_cnt_)
+        + ",\"lossy\":" + (is_lossy() ? "true" : "false")
         + "}";
   }
 
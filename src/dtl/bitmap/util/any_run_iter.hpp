@@ -0,0 +1,170 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include <dtl/dtl.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+namespace internal {
+//===----------------------------------------------------------------------===//
+/// A 1-run, i.e., a 1-fill.
+struct run_t {
+  $u64 pos;
+  $u64 length;
+};
+//===----------------------------------------------------------------------===//
+/// The (virtual) interface of a type-erased run iterator. The runs are
+/// obtained in batches, to amortize the costs of the virtual function calls.
+class run_source {
+public:
+  virtual ~run_source() = default;
+
+  /// Writes up to 'max_cnt' runs to the given destination and returns the
+  /// number of runs written. A value less than 'max_cnt' indicates that the
+  /// iterator reached its end.
+  virtual std::size_t
+  next_batch(run_t* dst, std::size_t max_cnt) noexcept = 0;
+
+  /// Forwards the iterator to the given position. Subsequent batches start
+  /// at or after the given position.
+  virtual void
+  skip_to(std::size_t to_pos) noexcept = 0;
+};
+//===----------------------------------------------------------------------===//
+/// Adapts an arbitrary run iterator to the run_source interface.
+template<typename iter_t>
+class run_source_impl : public run_source {
+  iter_t it_;
+
+public:
+  explicit run_source_impl(iter_t&& it) : it_(std::move(it)) {}
+  explicit run_source_impl(const iter_t& it) : it_(it) {}
+
+  std::size_t
+  next_batch(run_t* dst, std::size_t max_cnt) noexcept override {
+    std::size_t cnt = 0;
+    while (cnt < max_cnt && !it_.end()) {
+      dst[cnt].pos = it_.pos();
+      dst[cnt].length = it_.length();
+      ++cnt;
+      it_.next();
+    }
+    return cnt;
+  }
+
+  void
+  skip_to(std::size_t to_pos) noexcept override {
+    if (!it_.end() && to_pos > it_.pos()) it_.skip_to(to_pos);
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace internal
+//===----------------------------------------------------------------------===//
+/// A type-erased run iterator, e.g., to compose iterators at runtime. The
+/// iterator buffers a batch of runs of the underlying iterator, thus the
+/// virtual function calls are amortized over multiple runs and the hot
+/// functions (pos(), length(), next()) operate on the local buffer only.
+class any_run_iter {
+  /// The number of runs fetched at once.
+  static constexpr std::size_t batch_size = 32;
+
+  /// The underlying iterator.
+  std::unique_ptr<internal::run_source> src_;
+  /// The length of the bitmap, which is the position of the iterator once it
+  /// reached its end.
+  $u64 n_;
+  /// The buffered runs, followed by an empty run at position n.
+  internal::run_t runs_[batch_size + 1];
+  /// The number of buffered runs.
+  std::size_t run_cnt_ = 0;
+  /// The index of the current run.
+  std::size_t read_pos_ = 0;
+  /// True, if the underlying iterator reached its end.
+  $u1 src_end_ = false;
+
+  /// Fetches the next batch of runs.
+  void
+  fill() noexcept {
+    read_pos_ = 0;
+    run_cnt_ = src_end_ ? 0 : src_->next_batch(runs_, batch_size);
+    src_end_ = run_cnt_ < batch_size;
+    runs_[run_cnt_].pos = n_;
+    runs_[run_cnt_].length = 0;
+  }
+
+public:
+  /// C'tor. Takes ownership of the given iterator, which iterates over a
+  /// bitmap of length n.
+  template<typename iter_t>
+  any_run_iter(iter_t&& it, std::size_t n)
+      : src_(std::make_unique<
+            internal::run_source_impl<typename std::decay<iter_t>::type>>(
+                std::forward<iter_t>(it))),
+        n_(n) {
+    fill();
+  }
+
+  any_run_iter(any_run_iter&&) noexcept = default;
+  any_run_iter& operator=(any_run_iter&&) noexcept = default;
+
+  /// Forwards the iterator to the next run.
+  void __forceinline__
+  next() noexcept {
+    ++read_pos_;
+    if (read_pos_ == run_cnt_) {
+      fill();
+    }
+  }
+
+  /// Forwards the iterator to the given position. Only the buffered runs are
+  /// consumed, if the position lies within the current batch.
+  void
+  skip_to(const std::size_t to_pos) noexcept {
+    while (!end()) {
+      auto& r = runs_[read_pos_];
+      if (r.pos + r.length > to_pos) {
+        if (r.pos < to_pos) {
+          r.length -= to_pos - r.pos;
+          r.pos = to_pos;
+        }
+        return;
+      }
+      if (read_pos_ + 1 < run_cnt_) {
+        // The target may be contained in the current batch.
+        ++read_pos_;
+        continue;
+      }
+      // All buffered runs end before the given position.
+      if (src_end_) {
+        read_pos_ = run_cnt_;
+        return;
+      }
+      src_->skip_to(to_pos);
+      fill();
+    }
+  }
+
+  /// Returns true if the iterator reached the end, false otherwise.
+  u1 __forceinline__
+  end() const noexcept {
+    return read_pos_ == run_cnt_;
+  }
+
+  /// Returns the starting position of the current 1-fill.
+  u64 __forceinline__
+  pos() const noexcept {
+    return runs_[read_pos_].pos;
+  }
+
+  /// Returns the length of the current 1-fill.
+  u64 __forceinline__
+  length() const noexcept {
+    return runs_[read_pos_].length;
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
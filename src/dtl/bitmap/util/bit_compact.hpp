@@ -0,0 +1,254 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include <dtl/dtl.hpp>
+
+#include <cassert>
+#include <cstddef>
+#include <immintrin.h>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// Static functions to compact the bits at even positions of 64-bit words into
+/// 32-bit words, i.e., the equivalent of _pext_u64(w, 0x5555555555555555), and
+/// the inverse operation (the equivalent of _pdep_u64(w, 0x5555555555555555)).
+///
+/// The bitmap tree uses these functions to compute the labels and the tree
+/// structure of the parent level from two sibling nodes. We intentionally do
+/// not rely on PEXT/PDEP, as these instructions are not available on pre-BMI2
+/// hardware and they are microcoded on AMD Zen 1/2 (several hundred cycles
+/// for dense masks). The BMI2 instructions can be enforced by defining
+/// TEB_USE_PEXT.
+///
+/// The batch variants are selected at compile time, like in 'bitmap_fun':
+///  - AVX-512 with GFNI: one affine transformation per byte, followed by a
+///    single shift/mask step and a (truncating) down-conversion.
+///  - AVX-512 (BW): three shift/mask steps and a down-conversion.
+///  - AVX2: three shift/mask steps and a byte shuffle.
+///  - Otherwise: five shift/mask steps per word.
+struct bit_compact {
+
+  //===--------------------------------------------------------------------===//
+  // Operations that are applied to the two adjacent bits 2i and 2i+1 (i.e.,
+  // two sibling nodes) prior to compaction. Only the results at the even bit
+  // positions are relevant.
+  //===--------------------------------------------------------------------===//
+  /// Selects the bit at the even position.
+  struct pair_first {
+    static u64 __forceinline__ apply(u64 w) { return w; }
+#ifdef __AVX2__
+    static __m256i __forceinline__ apply(const __m256i w) { return w; }
+#endif
+#ifdef __AVX512F__
+    static __m512i __forceinline__ apply(const __m512i w) { return w; }
+#endif
+  };
+  /// Bitwise OR of two adjacent bits.
+  struct pair_or {
+    static u64 __forceinline__ apply(u64 w) { return w | (w >> 1); }
+#ifdef __AVX2__
+    static __m256i __forceinline__ apply(const __m256i w) {
+      return _mm256_or_si256(w, _mm256_srli_epi64(w, 1));
+    }
+#endif
+#ifdef __AVX512F__
+    static __m512i __forceinline__ apply(const __m512i w) {
+      return _mm512_or_si512(w, _mm512_srli_epi64(w, 1));
+    }
+#endif
+  };
+  /// Bitwise XOR of two adjacent bits.
+  struct pair_xor {
+    static u64 __forceinline__ apply(u64 w) { return w ^ (w >> 1); }
+#ifdef __AVX2__
+    static __m256i __forceinline__ apply(const __m256i w) {
+      return _mm256_xor_si256(w, _mm256_srli_epi64(w, 1));
+    }
+#endif
+#ifdef __AVX512F__
+    static __m512i __forceinline__ apply(const __m512i w) {
+      return _mm512_xor_si512(w, _mm512_srli_epi64(w, 1));
+    }
+#endif
+  };
+  /// Bitwise NOR of two adjacent bits, i.e., both bits are zero.
+  struct pair_nor {
+    static u64 __forceinline__ apply(u64 w) { return ~(w | (w >> 1)); }
+#ifdef __AVX2__
+    static __m256i __forceinline__ apply(const __m256i w) {
+      return _mm256_xor_si256(pair_or::apply(w), _mm256_set1_epi64x(-1));
+    }
+#endif
+#ifdef __AVX512F__
+    static __m512i __forceinline__ apply(const __m512i w) {
+      return _mm512_xor_si512(pair_or::apply(w), _mm512_set1_epi64(-1));
+    }
+#endif
+  };
+  //===--------------------------------------------------------------------===//
+
+  /// Compacts the bits at the even positions of the given word.
+  static u32 __forceinline__
+  compact_even_bits(u64 w) noexcept {
+#ifdef TEB_USE_PEXT
+    return static_cast<$u32>(_pext_u64(w, 0x5555555555555555ull));
+#else
+    $u64 x = w & 0x5555555555555555ull;
+    x = (x | (x >> 1)) & 0x3333333333333333ull;
+    x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x >> 4)) & 0x00FF00FF00FF00FFull;
+    x = (x | (x >> 8)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x >> 16)) & 0x00000000FFFFFFFFull;
+    return static_cast<$u32>(x);
+#endif
+  }
+
+  /// Spreads the bits of the given word to the even positions of a 64-bit
+  /// word.  The inverse of 'compact_even_bits()'.
+  static u64 __forceinline__
+  spread_even_bits(u32 w) noexcept {
+#ifdef TEB_USE_PEXT
+    return _pdep_u64(w, 0x5555555555555555ull);
+#else
+    $u64 x = w;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8)) & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2)) & 0x3333333333333333ull;
+    x = (x | (x << 1)) & 0x5555555555555555ull;
+    return x;
+#endif
+  }
+
+  /// Applies the pairwise operation to each source word, compacts the even
+  /// bits and writes one 32-bit word per source word to 'dst'. The source and
+  /// the destination must not overlap.
+  template<typename op = pair_first>
+  static inline void
+  compact_even_bits(
+      const $u64* __restrict src_begin,
+      const $u64* __restrict src_end,
+      $u32* __restrict dst) noexcept {
+#if defined(TEB_USE_PEXT)
+    compact_even_bits_x86<op>(src_begin, src_end, dst);
+#elif defined(__AVX512BW__) && defined(__GFNI__)
+    compact_even_bits_avx512_gfni<op>(src_begin, src_end, dst);
+#elif defined(__AVX512BW__)
+    compact_even_bits_avx512<op>(src_begin, src_end, dst);
+#elif defined(__AVX2__)
+    compact_even_bits_avx2<op>(src_begin, src_end, dst);
+#else
+    compact_even_bits_x86<op>(src_begin, src_end, dst);
+#endif
+  }
+
+  /// Fall back implementation of the batched 'compact_even_bits()'.
+  template<typename op = pair_first>
+  static inline void
+  compact_even_bits_x86(
+      const $u64* __restrict src_begin,
+      const $u64* __restrict src_end,
+      $u32* __restrict dst) noexcept {
+    const std::size_t word_cnt = src_end - src_begin;
+    for (std::size_t i = 0; i < word_cnt; ++i) {
+      dst[i] = compact_even_bits(op::apply(src_begin[i]));
+    }
+  }
+
+#ifdef __AVX2__
+  /// AVX2 implementation of the batched 'compact_even_bits()'. Processes four
+  /// words at a time.
+  template<typename op = pair_first>
+  static inline void
+  compact_even_bits_avx2(
+      const $u64* __restrict src_begin,
+      const $u64* __restrict src_end,
+      $u32* __restrict dst) noexcept {
+    const std::size_t word_cnt = src_end - src_begin;
+    const __m256i m1 = _mm256_set1_epi64x(0x5555555555555555ull);
+    const __m256i m2 = _mm256_set1_epi64x(0x3333333333333333ull);
+    const __m256i m4 = _mm256_set1_epi64x(0x0F0F0F0F0F0F0F0Full);
+    const __m256i m8 = _mm256_set1_epi64x(0x00FF00FF00FF00FFull);
+    // Gathers the even bytes of each 128-bit lane in the lower half.
+    const __m256i even_bytes = _mm256_setr_epi8(
+        0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1,
+        0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+    std::size_t i = 0;
+    for (; i + 4 <= word_cnt; i += 4) {
+      __m256i x = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(&src_begin[i]));
+      x = _mm256_and_si256(op::apply(x), m1);
+      x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 1)), m2);
+      x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 2)), m4);
+      x = _mm256_and_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 4)), m8);
+      // Each 16-bit lane now holds 8 compacted bits in its lower byte.
+      x = _mm256_shuffle_epi8(x, even_bytes);
+      x = _mm256_permute4x64_epi64(x, 0b1000);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[i]),
+          _mm256_castsi256_si128(x));
+    }
+    compact_even_bits_x86<op>(&src_begin[i], src_end, &dst[i]);
+  }
+#endif
+
+#ifdef __AVX512BW__
+  /// AVX-512 implementation of the batched 'compact_even_bits()'. Processes
+  /// eight words at a time.
+  template<typename op = pair_first>
+  static inline void
+  compact_even_bits_avx512(
+      const $u64* __restrict src_begin,
+      const $u64* __restrict src_end,
+      $u32* __restrict dst) noexcept {
+    const std::size_t word_cnt = src_end - src_begin;
+    const __m512i m1 = _mm512_set1_epi64(0x5555555555555555ull);
+    const __m512i m2 = _mm512_set1_epi64(0x3333333333333333ull);
+    const __m512i m4 = _mm512_set1_epi64(0x0F0F0F0F0F0F0F0Full);
+    const __m512i m8 = _mm512_set1_epi64(0x00FF00FF00FF00FFull);
+    std::size_t i = 0;
+    for (; i + 8 <= word_cnt; i += 8) {
+      __m512i x = _mm512_loadu_si512(&src_begin[i]);
+      x = _mm512_and_si512(op::apply(x), m1);
+      x = _mm512_and_si512(_mm512_or_si512(x, _mm512_srli_epi64(x, 1)), m2);
+      x = _mm512_and_si512(_mm512_or_si512(x, _mm512_srli_epi64(x, 2)), m4);
+      x = _mm512_and_si512(_mm512_or_si512(x, _mm512_srli_epi64(x, 4)), m8);
+      // Truncate the 16-bit lanes to 8-bit.
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dst[i]),
+          _mm512_cvtepi16_epi8(x));
+    }
+    compact_even_bits_x86<op>(&src_begin[i], src_end, &dst[i]);
+  }
+#endif
+
+#if defined(__AVX512BW__) && defined(__GFNI__)
+  /// AVX-512 + GFNI implementation of the batched 'compact_even_bits()'. The
+  /// affine transformation moves the four even bits of each byte to the lower
+  /// nibble, which replaces the first three shift/mask steps.
+  template<typename op = pair_first>
+  static inline void
+  compact_even_bits_avx512_gfni(
+      const $u64* __restrict src_begin,
+      const $u64* __restrict src_end,
+      $u32* __restrict dst) noexcept {
+    const std::size_t word_cnt = src_end - src_begin;
+    // Row i of the bit matrix (stored in byte 7-i) selects the source bit of
+    // the i-th destination bit: dst[i] = src[2i] for i < 4, 0 otherwise.
+    const __m512i matrix = _mm512_set1_epi64(0x0104104000000000ull);
+    const __m512i m8 = _mm512_set1_epi64(0x00FF00FF00FF00FFull);
+    std::size_t i = 0;
+    for (; i + 8 <= word_cnt; i += 8) {
+      __m512i x = _mm512_loadu_si512(&src_begin[i]);
+      x = _mm512_gf2p8affine_epi64_epi8(op::apply(x), matrix, 0);
+      x = _mm512_and_si512(_mm512_or_si512(x, _mm512_srli_epi64(x, 4)), m8);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&dst[i]),
+          _mm512_cvtepi16_epi8(x));
+    }
+    compact_even_bits_x86<op>(&src_begin[i], src_end, &dst[i]);
+  }
+#endif
+
+private:
+  // Construction not allowed.
+  bit_compact() = delete;
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
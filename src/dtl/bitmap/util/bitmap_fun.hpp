@@ -100,6 +100,28 @@ struct bitmap_fun {
     }
   }
 
+  /// Flip the bits in [b,e).
+  static void __forceinline__
+  flip(word_type* bitmap, std::size_t b, std::size_t e) noexcept {
+    if (e <= b) return;
+    const auto x = b / word_bitlength;
+    const auto y = (e - 1) / word_bitlength;
+    const word_type Z = ~word_type(0);
+
+    const word_type X = Z << (b % word_bitlength);
+    const word_type Y = Z >> ((word_bitlength - (e % word_bitlength)) % word_bitlength);
+    if (x == y) {
+      bitmap[x] ^= (X & Y);
+    }
+    else {
+      bitmap[x] ^= X;
+      for (std::size_t k = x + 1; k < y; ++k) {
+        bitmap[k] ^= Z;
+      }
+      bitmap[y] ^= Y;
+    }
+  }
+
   /// Fetch up to size(word_type)*8 consecutive bits.
   static word_type __forceinline__
   fetch_bits(const word_type* bitmap,
@@ -531,6 +553,38 @@ struct bitmap_fun {
   }
 #endif
 
+  /// Writes the positions of a 1-run, i.e., the consecutive values
+  /// [pos, pos + cnt), to the given destination pointer.
+  static inline void
+  run_to_positions(u32 pos, const std::size_t cnt, $u32* dst_ptr) {
+    std::size_t i = 0;
+#ifdef __AVX512F__
+    const __m512i sequence = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    const __m512i sixteen_v = _mm512_set1_epi32(16);
+    __m512i pos_v = _mm512_add_epi32(sequence, _mm512_set1_epi32(pos));
+    for (; i + 16 <= cnt; i += 16) {
+      _mm512_storeu_si512(reinterpret_cast<__m512i*>(dst_ptr + i), pos_v);
+      pos_v = _mm512_add_epi32(pos_v, sixteen_v);
+    }
+    if (i < cnt) {
+      const __mmask16 m = static_cast<__mmask16>((1u << (cnt - i)) - 1);
+      _mm512_mask_storeu_epi32(dst_ptr + i, m, pos_v);
+    }
+    return;
+#elif __AVX2__
+    const __m256i sequence = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    const __m256i eight_v = _mm256_set1_epi32(8);
+    __m256i pos_v = _mm256_add_epi32(sequence, _mm256_set1_epi32(pos));
+    for (; i + 8 <= cnt; i += 8) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst_ptr + i), pos_v);
+      pos_v = _mm256_add_epi32(pos_v, eight_v);
+    }
+#endif
+    for (; i < cnt; ++i) {
+      dst_ptr[i] = pos + static_cast<$u32>(i);
+    }
+  }
+
   /// Scans the given range [b,e) of the bitmap and produce a position list.
   /// The positions are written to the given destination pointer.
   /// The function returns the number for values written to 'dst_ptr'.
@@ -1,6 +1,7 @@
 #pragma once
 //===----------------------------------------------------------------------===//
 #include "binary_tree_structure.hpp"
+#include "bit_compact.hpp"
 #include "plain_bitmap.hpp"
 #include "rank1.hpp"
 #include "rank1_logic_surf.hpp"
@@ -9,6 +10,7 @@
 
 #include <boost/dynamic_bitset.hpp>
 
+#include <algorithm>
 #include <cstring>
 #include <iomanip>
 #include <immintrin.h>
@@ -100,9 +102,14 @@ protected:
   /// next power of two.
   std::size_t n_actual_;
 
+  /// The number of 0-bits in the original bitmap that are (falsely) reported
+  /// as 1-bits, due to lossy pruning.
+  std::size_t false_positive_cnt_ = 0;
+
 public:
-  /// C'tor
-  explicit bitmap_tree(const bitmap_t& bitmap)
+  /// C'tor. If a false-positive rate (fpr) > 0 is given, the tree is pruned
+  /// lossy, see prune_lossy().
+  explicit bitmap_tree(const bitmap_t& bitmap, f64 fpr = 0.0)
       : binary_tree_structure(dtl::next_power_of_two(bitmap.size())),
         labels_(max_node_cnt_ + offset),
         inner_node_cnt_(0),
@@ -122,11 +129,13 @@ public:
     if (!fast_path) {
       // Fused code path.
       compress();
+      if (fpr > 0.0) prune_lossy(fpr);
     }
     else {
       // Classic code path.
       init_labels();
       prune_tree();
+      if (fpr > 0.0) prune_lossy(fpr);
 
       // Run space optimizations.
       if (optimization_level_ > 1) {
@@ -202,25 +211,24 @@ public:
         const auto remaining = src_node_idx_end - src_node_idx;
         assert(remaining >= 2);
         if (remaining >= 64) {
-          // Process 64 nodes at a time.  For each loaded 64-bit word we write
-          // a 32-bit word. For this to be efficient, we want proper alignment
-          // which is why we have the +1 offset in the label and tree bitmaps.
+          // Process 64 nodes per word and all (full) words of the current
+          // level at once.  For each loaded 64-bit word we write a 32-bit
+          // word. For this to be efficient, we want proper alignment which is
+          // why we have the +1 offset in the label and tree bitmaps.
           const auto src_label_idx = label_idx_of_node(src_node_idx);
           const auto dst_label_idx = label_idx_of_node(dst_node_idx);
           assert(src_label_idx % 64 == 0);
           assert(src_label_idx % 32 == 0);
+          const auto word_cnt = remaining / 64;
 
           auto* raw_ptr = labels_.data();
-          $u64* src_ptr = &raw_ptr[src_label_idx / 64];
+          const $u64* src_ptr = &raw_ptr[src_label_idx / 64];
           $u32* dst_ptr = &reinterpret_cast<$u32*>(raw_ptr)[dst_label_idx / 32];
+          bit_compact::compact_even_bits<bit_compact::pair_or>(
+              src_ptr, src_ptr + word_cnt, dst_ptr);
 
-          auto src = *src_ptr;
-          src |= src >> 1;
-          auto dst = _pext_u64(src, 0x5555555555555555); // FIXME non-portable code
-          *dst_ptr = static_cast<$u32>(dst);
-
-          src_node_idx += 64;
-          dst_node_idx += 32;
+          src_node_idx += 64 * word_cnt;
+          dst_node_idx += 32 * word_cnt;
         }
         else {
           // Process two nodes (siblings) at a time.
@@ -270,39 +278,46 @@ public:
           dst_node_idx += 1;
         }
         else {
-          // Process 64 nodes at a time.
+          // Process 64 nodes per word, in batches of up to 'batch_size' words.
           const auto src_idx = label_idx_of_node(src_node_idx);
           const auto dst_idx = label_idx_of_node(dst_node_idx);
           assert(src_idx % 64 == 0);
           assert(src_idx % 32 == 0);
 
+          constexpr std::size_t batch_size = 16;
+          const auto word_cnt = std::min(remaining / 64, batch_size);
           const auto src_word_idx = src_idx / 64;
 
           $u64* raw_label_ptr = labels_.data();
-          u64 src_labels = raw_label_ptr[src_word_idx];
-          u32 collapse_causes_false_positives = static_cast<$u32>(
-              _pext_u64(src_labels ^ (src_labels >> 1), 0x5555555555555555)); // FIXME non-portable code
+          $u32 collapse_causes_false_positives[batch_size];
+          bit_compact::compact_even_bits<bit_compact::pair_xor>(
+              &raw_label_ptr[src_word_idx],
+              &raw_label_ptr[src_word_idx + word_cnt],
+              collapse_causes_false_positives);
 
           $u64* raw_node_ptr = is_inner_node_.data();
-          u64 src_nodes = raw_node_ptr[src_word_idx];
-          u32 both_nodes_are_leaves = static_cast<$u32>(
-              _pext_u64(~src_nodes & (~src_nodes >> 1), 0x5555555555555555)); // FIXME non-portable code
-
-          u32 collapse = both_nodes_are_leaves & ~collapse_causes_false_positives;
-          collapse_cnt += dtl::bits::pop_count(collapse);
+          $u32 both_nodes_are_leaves[batch_size];
+          bit_compact::compact_even_bits<bit_compact::pair_nor>(
+              &raw_node_ptr[src_word_idx],
+              &raw_node_ptr[src_word_idx + word_cnt],
+              both_nodes_are_leaves);
 
           $u32* dst_nodes_ptr = &reinterpret_cast<$u32*>(raw_node_ptr)[dst_idx / 32];
-          *dst_nodes_ptr = (*dst_nodes_ptr) ^ collapse;
-
-          // Set the pruned nodes inactive.
           $u64* raw_active_node_ptr = is_active_node_.data();
-          auto src_active_nodes = raw_active_node_ptr[src_word_idx];
-          $u64 a = _pdep_u64(~collapse, 0x5555555555555555);
-          a = a | (a << 1);
-          raw_active_node_ptr[src_word_idx] = a;
+          for (std::size_t k = 0; k < word_cnt; ++k) {
+            u32 collapse =
+                both_nodes_are_leaves[k] & ~collapse_causes_false_positives[k];
+            collapse_cnt += dtl::bits::pop_count(collapse);
+            dst_nodes_ptr[k] = dst_nodes_ptr[k] ^ collapse;
+
+            // Set the pruned nodes inactive.
+            $u64 a = bit_compact::spread_even_bits(~collapse);
+            a = a | (a << 1);
+            raw_active_node_ptr[src_word_idx + k] = a;
+          }
 
-          src_node_idx += 64;
-          dst_node_idx += 32;
+          src_node_idx += 64 * word_cnt;
+          dst_node_idx += 32 * word_cnt;
         }
       }
       D(init_counters();)
@@ -333,6 +348,79 @@ public:
     counters_are_valid = false;
   }
 
+  /// Bottom-up pruning (lossy). Collapses inner nodes, whose children are
+  /// leaves with different labels, into 1-leaves. Thereby, the 0-bits covered
+  /// by the 0-leaf turn into false positives. Nodes are collapsed as long as
+  /// the total number of false positives does not exceed the given fraction
+  /// of 0-bits in the original bitmap. As the cost of a collapse doubles with
+  /// every level, the cheapest nodes (in the lowest levels) are collapsed
+  /// first. Siblings that end up with the same label are collapsed as well.
+  /// Note: The counters are thereby invalidated.
+  void __attribute__((noinline))
+  prune_lossy(f64 fpr) {
+    if (last_level() == 0) return;
+    const auto one_cnt = labels_.count(
+        first_node_idx_at_level(last_level()) + offset,
+        max_node_cnt_ + offset);
+    const auto zero_cnt = n_actual_ - std::min(n_actual_, one_cnt);
+    const auto budget =
+        static_cast<std::size_t>(std::min(fpr, 1.0) * zero_cnt);
+    if (budget <= false_positive_cnt_) return;
+    $u64 remaining = budget - false_positive_cnt_;
+    // Collapsing a node in front of the first leaf (in level order) would
+    // turn implicit inner nodes into explicit nodes, which may increase the
+    // encoded size.
+    ensure_counters_are_valid();
+    const auto first_leaf_idx = explicit_node_idxs_.begin;
+
+    for (auto level = last_level(); level > 0; --level) {
+      // The number of bits covered by a node at the given level.
+      u64 width = n_ >> level;
+      const auto node_idx_begin = first_node_idx_at_level(level);
+      const auto node_idx_end = first_node_idx_at_level(level + 1);
+      $u64 collapse_cnt = 0;
+      for (auto node_idx = node_idx_begin; node_idx < node_idx_end;
+           node_idx += 2) {
+        if (!is_active_node(node_idx)
+            || is_inner_node(node_idx) || is_inner_node(node_idx + 1)) {
+          continue;
+        }
+        const auto parent_idx = parent_of(node_idx);
+        if (parent_idx < first_leaf_idx) continue;
+        if (label_of_node(node_idx) != label_of_node(node_idx + 1)) {
+          // Do not extend 1-runs beyond the end of the bitmap.
+          const auto end = (node_idx + 2 - node_idx_begin) * width;
+          if (width > remaining || end > n_actual_) continue;
+          remaining -= width;
+          false_positive_cnt_ += width;
+        }
+        // Note: The labels of inner nodes are the bitwise OR of the labels
+        // of their children, thus the new leaf carries a 1-label.
+        binary_tree_structure::set_leaf(parent_idx);
+        ++collapse_cnt;
+      }
+      if (collapse_cnt == 0 && 2 * width > remaining) {
+        // No new pairs of sibling leaves emerged, and the collapses in the
+        // next higher level would exceed the budget.
+        break;
+      }
+    }
+    // Invalidate the counters.
+    counters_are_valid = false;
+  }
+
+  /// Returns true if the tree has been pruned lossy.
+  u1
+  is_lossy() const noexcept {
+    return false_positive_cnt_ > 0;
+  }
+
+  /// Returns the number of false positives introduced by lossy pruning.
+  std::size_t
+  get_false_positive_cnt() const noexcept {
+    return false_positive_cnt_;
+  }
+
   /// Determine the total number of tree nodes and which of these nodes need
   /// to be stored explicitly.
   void __attribute__((noinline))
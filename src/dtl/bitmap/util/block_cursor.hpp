@@ -0,0 +1,70 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include <dtl/dtl.hpp>
+
+#include <algorithm>
+#include <cassert>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// Streams a bitmap in consecutive windows (blocks) of a fixed number of bits.
+/// Each block is decoded into plain 64-bit words, using the fetch_words()
+/// function of the given bitmap. This is intended for vectorized query
+/// executors, which process the rows block by block.
+template<typename B>
+class block_cursor {
+  /// The bitmap to decode.
+  const B& bitmap_;
+  /// The number of bits per block.
+  const std::size_t block_bitlength_;
+  /// The beginning of the next block.
+  $u64 pos_ = 0;
+
+public:
+  /// C'tor. The block length should be a multiple of the word size, as each
+  /// block starts at word index 0 of the destination.
+  block_cursor(const B& bitmap, std::size_t block_bitlength)
+      : bitmap_(bitmap), block_bitlength_(block_bitlength) {
+    assert(block_bitlength > 0);
+  }
+
+  /// Returns the number of words required to hold a single block.
+  std::size_t __forceinline__
+  block_word_cnt() const noexcept {
+    return (block_bitlength_ + 63) / 64;
+  }
+
+  /// Returns true if all blocks have been decoded.
+  u1 __forceinline__
+  end() const noexcept {
+    return pos_ >= bitmap_.size();
+  }
+
+  /// Returns the position of the first bit of the next block.
+  u64 __forceinline__
+  pos() const noexcept {
+    return pos_;
+  }
+
+  /// Decodes the next block into the given destination, which needs to
+  /// provide space for block_word_cnt() words. Returns the number of bits in
+  /// that block, which is less than the block length for the last block.
+  std::size_t
+  next($u64* dst) noexcept {
+    assert(!end());
+    const std::size_t b = pos_;
+    const std::size_t e = std::min(b + block_bitlength_, bitmap_.size());
+    bitmap_.fetch_words(b, e, dst);
+    pos_ = e;
+    return e - b;
+  }
+
+  /// Forwards the cursor to the given position, which becomes the beginning
+  /// of the next block.
+  void __forceinline__
+  skip_to(std::size_t to_pos) noexcept {
+    pos_ = std::max(u64(to_pos), pos_);
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
@@ -161,7 +161,7 @@ public:
   }
 
   explicit mutable_bitmap_tree(const boost::dynamic_bitset<$u32>& bitmap, f64 fpr = 0.0)
-      : bitmap_tree<optimization_level_>(bitmap),
+      : bitmap_tree<optimization_level_>(bitmap, fpr),
         perfect_level_cnt_(1),
         tree_height_(dtl::log_2(bitmap.size())) {}
 
@@ -0,0 +1,813 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include <dtl/bitmap/teb_types.hpp>
+#include <dtl/bits.hpp>
+#include <dtl/dtl.hpp>
+#include <dtl/math.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <limits>
+#include <vector>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+namespace internal {
+//===----------------------------------------------------------------------===//
+/// Calls fn(val, len) for each (maximal) 0- and 1-run in the range [b, e) of
+/// the given bitmap words, in ascending order.
+template<typename fn_t>
+static void
+for_each_run(const $u32* words, std::size_t b, std::size_t e, fn_t&& fn) {
+  if (b >= e) return;
+  std::size_t pos = b;
+  $u1 val = (words[pos / 32] >> (pos % 32)) & 1u;
+  while (pos < e) {
+    // Find the next bit that differs from the current value.
+    std::size_t word_idx = pos / 32;
+    $u32 w = (words[word_idx] ^ (val ? ~$u32(0) : $u32(0)))
+        & (~$u32(0) << (pos % 32));
+    std::size_t next = e;
+    while (true) {
+      if (w != 0) {
+        next = std::min(e, word_idx * 32 + dtl::bits::tz_count(w));
+        break;
+      }
+      ++word_idx;
+      if (word_idx * 32 >= e) break;
+      w = words[word_idx] ^ (val ? ~$u32(0) : $u32(0));
+    }
+    fn(val, next - pos);
+    pos = next;
+    val = !val;
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Counts the code words of an UAH encoded bitmap. Mirrors uah::append_run()
+/// without materializing the code words.
+template<std::size_t word_bitlength>
+struct uah_model {
+  static constexpr std::size_t payload_bit_cnt = word_bitlength - 1;
+  static constexpr std::size_t max_fill_length =
+      (1ull << (word_bitlength - 2)) - 1;
+
+  $u64 word_cnt = 0;
+  $u1 last_is_fill = true;
+  $u1 fill_val = false;
+  $u64 fill_len = 0;
+  $u64 remaining_bit_cnt = 0;
+
+  void
+  append(u1 val, $u64 len) {
+    if (word_cnt == 0) {
+      // The initial fill word of length 0.
+      word_cnt = 1;
+      last_is_fill = true;
+      fill_val = val;
+      fill_len = 0;
+    }
+    if (last_is_fill) {
+      if (fill_val == val) {
+        const auto extend_by = std::min(max_fill_length - fill_len, len);
+        fill_len += extend_by;
+        if (extend_by == len) return;
+        len -= extend_by;
+      }
+      else if (fill_len < payload_bit_cnt) {
+        // The last fill word is turned into a literal word.
+        const auto remaining_bits = payload_bit_cnt - fill_len;
+        const auto extend_by = std::min(remaining_bits, len);
+        last_is_fill = false;
+        remaining_bit_cnt = remaining_bits - extend_by;
+        if (extend_by == len) return;
+        len -= extend_by;
+      }
+    }
+    else if (remaining_bit_cnt > 0) {
+      const auto extend_by = std::min(remaining_bit_cnt, len);
+      remaining_bit_cnt -= extend_by;
+      if (extend_by == len) return;
+      len -= extend_by;
+    }
+    // The remaining bits are appended as fill words.
+    while (len > 0) {
+      const auto l = std::min($u64(max_fill_length), len);
+      ++word_cnt;
+      last_is_fill = true;
+      fill_val = val;
+      fill_len = l;
+      len -= l;
+    }
+    remaining_bit_cnt = 0;
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Counts the code words of an XAH encoded bitmap. Mirrors xah::append_run()
+/// without materializing the code words.
+template<std::size_t word_bitlength>
+struct xah_model {
+  static constexpr std::size_t payload_bit_cnt = word_bitlength - 1;
+  static constexpr std::size_t max_fill_repetitions =
+      (1ull << (word_bitlength - 2)) - 1;
+
+  $u64 word_cnt = 0;
+  $u1 last_is_fill = false;
+  $u1 fill_val = false;
+  $u64 fill_rep = 0;
+  $u64 remaining_bit_cnt = 0;
+  /// Whether all bits of the last literal word are 0 or 1, respectively.
+  $u1 literal_all_zero = false;
+  $u1 literal_all_one = false;
+
+  void
+  append_literal(u1 val, $u64 len) {
+    ++word_cnt;
+    last_is_fill = false;
+    literal_all_one = val;
+    literal_all_zero = !val;
+    remaining_bit_cnt = payload_bit_cnt - len;
+  }
+
+  void
+  append_fill(u1 val, $u64& len) {
+    const auto rep = std::min($u64(max_fill_repetitions), len / payload_bit_cnt);
+    ++word_cnt;
+    last_is_fill = true;
+    fill_val = val;
+    fill_rep = rep;
+    len -= rep * payload_bit_cnt;
+  }
+
+  void
+  append(u1 val, $u64 len) {
+    if (word_cnt == 0) {
+      if (len >= payload_bit_cnt) {
+        append_fill(val, len);
+        remaining_bit_cnt = 0;
+      }
+      else {
+        append_literal(val, len);
+        len = 0;
+      }
+      if (len == 0) return;
+    }
+    if (len >= payload_bit_cnt && last_is_fill && fill_val == val) {
+      const auto extend_by =
+          std::min(max_fill_repetitions - fill_rep, len / payload_bit_cnt);
+      fill_rep += extend_by;
+      if (extend_by * payload_bit_cnt == len) return;
+      len -= extend_by * payload_bit_cnt;
+    }
+    if (!last_is_fill && remaining_bit_cnt > 0) {
+      const auto extend_by = std::min(remaining_bit_cnt, len);
+      literal_all_zero &= !val;
+      literal_all_one &= val;
+      remaining_bit_cnt -= extend_by;
+      if (remaining_bit_cnt == 0 && (literal_all_zero || literal_all_one)) {
+        // The literal word is turned into a fill word.
+        last_is_fill = true;
+        fill_val = literal_all_one;
+        fill_rep = payload_bit_cnt;
+      }
+      if (extend_by == len) return;
+      len -= extend_by;
+    }
+    while (len > 0) {
+      if (len >= payload_bit_cnt) {
+        append_fill(val, len);
+      }
+      else {
+        append_literal(val, len);
+        len = 0;
+      }
+    }
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Counts the code words of a word-aligned hybrid encoding (WAH, CONCISE),
+/// where the bitmap is divided into groups of 'group_bitlength' bits. A
+/// literal word is required for each group that contains 0's and 1's,
+/// whereas consecutive groups of all 0's (or all 1's) share a fill word. If
+/// 'dirty_bits' is set, a literal word that differs in a single bit from the
+/// subsequent fill is piggybacked by that fill (CONCISE).
+template<std::size_t group_bitlength, u1 dirty_bits>
+struct aligned_model {
+  enum kind_t { NONE, FILL_0, FILL_1, LITERAL };
+
+  $u64 word_cnt = 0;
+  /// The number of 1-bits in the current group.
+  $u64 one_cnt = 0;
+  /// The number of bits in the current group.
+  $u64 bit_cnt = 0;
+  /// The kind of the last code word.
+  kind_t last_kind = NONE;
+  /// The number of 1-bits in the last literal word.
+  $u64 last_literal_one_cnt = 0;
+
+  void
+  append_group(u64 ones) {
+    if (ones == 0 || ones == group_bitlength) {
+      const auto kind = ones == 0 ? FILL_0 : FILL_1;
+      if (last_kind == kind) return; // extend the fill
+      const u1 piggyback = dirty_bits && last_kind == LITERAL
+          && ((kind == FILL_0 && last_literal_one_cnt == 1)
+              || (kind == FILL_1
+                  && last_literal_one_cnt == group_bitlength - 1));
+      if (!piggyback) ++word_cnt;
+      last_kind = kind;
+    }
+    else {
+      ++word_cnt;
+      last_kind = LITERAL;
+      last_literal_one_cnt = ones;
+    }
+  }
+
+  void
+  append(u1 val, $u64 len) {
+    if (bit_cnt > 0) {
+      const auto l = std::min(group_bitlength - bit_cnt, len);
+      bit_cnt += l;
+      one_cnt += val ? l : 0;
+      len -= l;
+      if (bit_cnt < group_bitlength) return;
+      append_group(one_cnt);
+      bit_cnt = 0;
+      one_cnt = 0;
+    }
+    if (len >= group_bitlength) {
+      // Homogeneous groups.
+      append_group(val ? group_bitlength : 0);
+      len %= group_bitlength;
+    }
+    bit_cnt = len;
+    one_cnt = val ? len : 0;
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Counts the bytes of a BBC encoded bitmap. Mirrors bbc::compress(), based
+/// on the kinds of the input bytes.
+struct bbc_model {
+  static constexpr std::size_t max_fill_byte_cnt = 1u << (7 * 4);
+  static constexpr std::size_t max_tail_byte_cnt = 15;
+
+  $u64 byte_cnt = 0;
+  // The current segment.
+  $u64 fill_byte_cnt = 0;
+  $u1 fill_val = false;
+  $u64 literal_byte_cnt = 0;
+  // The current (incomplete) input byte.
+  $u32 current_byte = 0;
+  $u32 current_bit_cnt = 0;
+  // The previous input byte.
+  $i32 prev_byte = -1;
+
+  static u64
+  counter_byte_cnt(u64 fill_byte_cnt) {
+    return fill_byte_cnt < 4
+        ? 0
+        : (64 - dtl::bits::lz_count(fill_byte_cnt) + 6) / 7;
+  }
+
+  void
+  close_segment(u1 dirty_tail) {
+    if (fill_byte_cnt == 0 && literal_byte_cnt == 0 && !dirty_tail) return;
+    byte_cnt += 1 + counter_byte_cnt(fill_byte_cnt) + literal_byte_cnt;
+    fill_byte_cnt = 0;
+    literal_byte_cnt = 0;
+  }
+
+  void
+  append_byte(u32 b) {
+    const auto pop_cnt = dtl::bits::pop_count(b);
+    if (b == 0x00 || b == 0xFF) {
+      const u1 val = b == 0xFF;
+      if (literal_byte_cnt > 0
+          || (fill_byte_cnt > 0
+              && (fill_val != val || fill_byte_cnt == max_fill_byte_cnt))) {
+        close_segment(false);
+      }
+      fill_val = val;
+      ++fill_byte_cnt;
+    }
+    else if ((pop_cnt == 1 && prev_byte == 0x00)
+        || (pop_cnt == 7 && prev_byte == 0xFF)) {
+      // A dirty bit, which terminates the current segment.
+      close_segment(true);
+    }
+    else {
+      if (fill_byte_cnt + literal_byte_cnt >= max_tail_byte_cnt) {
+        close_segment(false);
+      }
+      ++literal_byte_cnt;
+    }
+    prev_byte = static_cast<$i32>(b);
+  }
+
+  void
+  append(u1 val, $u64 len) {
+    while (len > 0) {
+      if (current_bit_cnt == 0 && len >= 8) {
+        // A whole fill byte.
+        append_byte(val ? 0xFF : 0x00);
+        len -= 8;
+        // Subsequent fill bytes extend the current fill (if possible).
+        auto cnt = len / 8;
+        while (cnt > 0) {
+          const auto extend_by = std::min(cnt,
+              $u64(max_fill_byte_cnt - fill_byte_cnt));
+          fill_byte_cnt += extend_by;
+          cnt -= extend_by;
+          len -= extend_by * 8;
+          if (cnt > 0) {
+            append_byte(val ? 0xFF : 0x00);
+            --cnt;
+            len -= 8;
+          }
+        }
+        continue;
+      }
+      const auto l = std::min($u64(8 - current_bit_cnt), len);
+      if (val) {
+        current_byte |= ((1u << l) - 1) << current_bit_cnt;
+      }
+      current_bit_cnt += l;
+      len -= l;
+      if (current_bit_cnt == 8) {
+        append_byte(current_byte);
+        current_byte = 0;
+        current_bit_cnt = 0;
+      }
+    }
+  }
+
+  void
+  finalize() {
+    if (current_bit_cnt > 0) {
+      append_byte(current_byte);
+      current_byte = 0;
+      current_bit_cnt = 0;
+    }
+    close_segment(false);
+  }
+};
+//===----------------------------------------------------------------------===//
+/// Counts the (pruned) inner nodes of the bitmap tree, per level. A node is
+/// an inner node, iff the bits it covers are not all the same, i.e., iff a
+/// run boundary lies within its range.
+struct teb_model {
+  /// The number of inner nodes per level.
+  std::array<$u64, 64> inner_node_cnt {};
+  /// The index of the last inner node per level.
+  std::array<$u64, 64> last_inner_node_idx {};
+  /// The number of consecutive inner nodes at the beginning of each level.
+  std::array<$u64, 64> leading_inner_node_cnt {};
+  /// The height of the (perfect) tree.
+  $u64 height = 0;
+
+  void
+  add_boundary(u64 pos) {
+    // Walk up the tree, until we hit a node that has already been counted.
+    for ($i64 level = height - 1; level >= 0; --level) {
+      const auto shift = height - level;
+      if ((pos & ((1ull << shift) - 1)) == 0) continue; // aligned
+      const auto node_idx = pos >> shift;
+      if (inner_node_cnt[level] > 0 && last_inner_node_idx[level] == node_idx) {
+        break;
+      }
+      if (leading_inner_node_cnt[level] == node_idx) {
+        ++leading_inner_node_cnt[level];
+      }
+      ++inner_node_cnt[level];
+      last_inner_node_idx[level] = node_idx;
+    }
+  }
+};
+//===----------------------------------------------------------------------===//
+} // namespace internal
+//===----------------------------------------------------------------------===//
+/// Estimates the compressed size of a bitmap for the different encodings,
+/// without actually constructing them. The estimates are derived from the
+/// 0- and 1-runs of the bitmap, which are gathered in a single (word-level)
+/// pass over the bitmap. For large bitmaps, only a sample of blocks is
+/// inspected and the results are extrapolated.
+///
+/// Most of the estimates are exact, as they mirror the construction of the
+/// corresponding encoding (UAH, XAH, BBC, CONCISE, Roaring, position and range
+/// lists), whereas the estimates for TEB and WAH are approximations. Note that
+/// the WAH estimate is unvalidated, as it is not compared against FastBit in
+/// the tests. Other
+/// encodings can be estimated by constructing them on the sample only, see
+/// sampled<T>().
+///
+/// Along with the size, a scan cost is reported, which is the number of code
+/// words (or elements) that a run iterator needs to decode plus the number of
+/// produced 1-runs. The scan cost is only meant to rank the encodings.
+class size_estimator {
+public:
+  /// The estimated size and scan cost of an encoding.
+  struct estimate {
+    $u64 size_in_bytes;
+    $f64 scan_cost;
+  };
+
+  /// The size of the blocks that are sampled from large bitmaps. Equals the
+  /// chunk size of Roaring.
+  static constexpr std::size_t block_bitlength = 1ull << 16;
+
+private:
+  /// The bitmap.
+  const boost::dynamic_bitset<$u32>& bitmap_;
+  /// The length of the bitmap.
+  $u64 n_;
+  /// The number of inspected bits. Equal to n, unless the bitmap is sampled.
+  $u64 sampled_n_ = 0;
+  /// The offsets of the inspected blocks.
+  std::vector<$u64> block_offsets_;
+
+  /// The number of 1-bits and 1-runs (in the sample).
+  $u64 pop_cnt_ = 0;
+  $u64 run_cnt_ = 0;
+
+  /// Roaring: The number of non-empty containers, whether a run container
+  /// exists, and the accumulated size of the containers.
+  $u64 roaring_container_cnt_ = 0;
+  $u1 roaring_has_run_container_ = false;
+  $u64 roaring_container_bytes_ = 0;
+
+  internal::uah_model<8> uah8_;
+  internal::uah_model<16> uah16_;
+  internal::uah_model<32> uah32_;
+  internal::uah_model<64> uah64_;
+  internal::xah_model<8> xah8_;
+  internal::xah_model<16> xah16_;
+  internal::xah_model<32> xah32_;
+  internal::xah_model<64> xah64_;
+  internal::aligned_model<31, false> wah32_;
+  internal::aligned_model<63, false> wah64_;
+  internal::aligned_model<31, true> concise_;
+  /// The number of CONCISE words up to the last 1-bit, as trailing 0's are
+  /// not encoded.
+  $u64 concise_word_cnt_ = 0;
+  internal::bbc_model bbc_;
+  internal::teb_model teb_;
+
+  /// Extrapolates a count gathered on the sample to the entire bitmap.
+  f64
+  scale(f64 cnt) const noexcept {
+    return sampled_n_ == 0 ? cnt : cnt * n_ / sampled_n_;
+  }
+
+  u64
+  scale_u(f64 cnt) const noexcept {
+    return static_cast<$u64>(scale(cnt) + 0.5);
+  }
+
+  /// Accumulates the statistics of the given Roaring container.
+  void
+  add_roaring_container(u64 card, u64 runs) {
+    if (card == 0) return;
+    ++roaring_container_cnt_;
+    const u64 current_bytes = card <= 4096 ? card * 2 : 8192;
+    const u64 run_bytes = 2 + runs * 4;
+    if (run_bytes < current_bytes) {
+      roaring_has_run_container_ = true;
+      roaring_container_bytes_ += run_bytes;
+    }
+    else {
+      roaring_container_bytes_ += current_bytes;
+    }
+  }
+
+  /// Gathers the statistics. (single pass)
+  void
+  init() {
+    const $u32* words = bitmap_.m_bits.data();
+    teb_.height = dtl::log_2(dtl::next_power_of_two(std::max(sampled_n_,
+        $u64(2))));
+
+    // The current (logical) position within the sample.
+    $u64 pos = 0;
+    // The value of the previous run.
+    $u1 prev_val = false;
+    // The statistics of the current Roaring container.
+    $u64 chunk_idx = 0;
+    $u64 chunk_card = 0;
+    $u64 chunk_runs = 0;
+
+    // Processes a maximal run.
+    auto add_run = [&](u1 val, u64 len) {
+      if (val) {
+        pop_cnt_ += len;
+        ++run_cnt_;
+      }
+      if (pos > 0) {
+        teb_.add_boundary(pos);
+      }
+      // Roaring containers.
+      $u64 p = pos;
+      $u64 l = len;
+      while (l > 0) {
+        const auto c = p / block_bitlength;
+        if (c != chunk_idx) {
+          add_roaring_container(chunk_card, chunk_runs);
+          chunk_idx = c;
+          chunk_card = 0;
+          chunk_runs = 0;
+        }
+        const auto k = std::min(l, (c + 1) * block_bitlength - p);
+        if (val) {
+          chunk_card += k;
+          // A run that spans multiple chunks is split.
+          ++chunk_runs;
+        }
+        p += k;
+        l -= k;
+      }
+      uah8_.append(val, len);
+      uah16_.append(val, len);
+      uah32_.append(val, len);
+      uah64_.append(val, len);
+      xah8_.append(val, len);
+      xah16_.append(val, len);
+      xah32_.append(val, len);
+      xah64_.append(val, len);
+      wah32_.append(val, len);
+      wah64_.append(val, len);
+      concise_.append(val, len);
+      if (val) {
+        // Count the CONCISE words including the group that contains the last
+        // 1-bit.
+        concise_word_cnt_ = concise_.word_cnt + (concise_.bit_cnt > 0 ? 1 : 0);
+      }
+      bbc_.append(val, len);
+      pos += len;
+      prev_val = val;
+    };
+
+    // The runs are reported per block. Adjacent runs with the same value are
+    // merged, as the encodings would do.
+    $u1 pending_val = false;
+    $u64 pending_len = 0;
+    auto on_run = [&](u1 val, u64 len) {
+      if (pending_len > 0 && val != pending_val) {
+        add_run(pending_val, pending_len);
+        pending_len = 0;
+      }
+      pending_val = val;
+      pending_len += len;
+    };
+
+    for (auto block_begin : block_offsets_) {
+      const auto block_end = std::min(block_begin + $u64(block_bitlength), n_);
+      internal::for_each_run(words, block_begin, block_end, on_run);
+    }
+    if (pending_len > 0) add_run(pending_val, pending_len);
+    add_roaring_container(chunk_card, chunk_runs);
+    // The TEB is padded to the next power of two.
+    if (prev_val && pos < (1ull << teb_.height)) {
+      teb_.add_boundary(pos);
+    }
+    bbc_.finalize();
+  }
+
+public:
+  /// C'tor. Bitmaps that are longer than 'max_exact_bitlength' are sampled,
+  /// whereas 'sample_block_cnt' blocks of 'block_bitlength' bits are
+  /// inspected.
+  explicit size_estimator(const boost::dynamic_bitset<$u32>& bitmap,
+      std::size_t max_exact_bitlength = 1ull << 24,
+      std::size_t sample_block_cnt = 256)
+      : bitmap_(bitmap), n_(bitmap.size()) {
+    const auto block_cnt = (n_ + block_bitlength - 1) / block_bitlength;
+    if (n_ <= max_exact_bitlength || sample_block_cnt >= block_cnt) {
+      for (std::size_t i = 0; i < block_cnt; ++i) {
+        block_offsets_.push_back(i * block_bitlength);
+      }
+      sampled_n_ = n_;
+    }
+    else {
+      // Systematic sampling, i.e., blocks are picked at equal distances.
+      sampled_n_ = 0;
+      for (std::size_t i = 0; i < sample_block_cnt; ++i) {
+        const auto block_idx = (i * block_cnt) / sample_block_cnt;
+        block_offsets_.push_back(block_idx * block_bitlength);
+        sampled_n_ += std::min($u64(block_bitlength),
+            n_ - block_idx * block_bitlength);
+      }
+    }
+    init();
+  }
+
+  /// Returns the length of the bitmap.
+  u64
+  size() const noexcept {
+    return n_;
+  }
+
+  /// Returns true if the estimates are based on a sample.
+  u1
+  is_sampled() const noexcept {
+    return sampled_n_ < n_;
+  }
+
+  /// Returns the (estimated) number of 1-bits.
+  u64
+  pop_count() const noexcept {
+    return scale_u(pop_cnt_);
+  }
+
+  /// Returns the (estimated) number of 1-runs.
+  u64
+  run_count() const noexcept {
+    return scale_u(run_cnt_);
+  }
+
+  //===--------------------------------------------------------------------===//
+  // Estimates.
+  //===--------------------------------------------------------------------===//
+  /// Uncompressed bitmap (dynamic_bitmap<$u32>).
+  estimate
+  plain() const noexcept {
+    const auto word_cnt = (n_ + 31) / 32;
+    return {word_cnt * 4 + 4, f64(word_cnt + run_count())};
+  }
+
+  /// Position list.
+  estimate
+  position_list(std::size_t position_bytes = 4) const noexcept {
+    return {pop_count() * position_bytes + position_bytes + 8,
+            f64(pop_count())};
+  }
+
+  /// Range list.
+  estimate
+  range_list(std::size_t position_bytes = 4) const noexcept {
+    return {run_count() * 2 * position_bytes + sizeof(std::size_t) + 8,
+            f64(run_count())};
+  }
+
+  /// Roaring (dynamic_roaring_bitmap), including the run optimization.
+  estimate
+  roaring() const noexcept {
+    const auto container_cnt = scale_u(roaring_container_cnt_);
+    // The header of the portable format.
+    u64 header_bytes = roaring_has_run_container_
+        ? (container_cnt < 4
+            ? 4 + (container_cnt + 7) / 8 + 4 * container_cnt
+            : 4 + (container_cnt + 7) / 8 + 8 * container_cnt)
+        : 4 + 4 + 8 * container_cnt;
+    const u64 portable_bytes = header_bytes
+        + scale_u(roaring_container_bytes_);
+    const u64 array_bytes = pop_count() * 4 + 4;
+    return {std::min(portable_bytes, array_bytes) + 1 + sizeof(std::size_t),
+            f64(pop_count() + run_count())};
+  }
+
+  /// UAH with the given word size in bits (8, 16, 32 or 64).
+  estimate
+  uah(std::size_t word_bitlength) const noexcept {
+    $u64 word_cnt = 0;
+    switch (word_bitlength) {
+      case 8:  word_cnt = uah8_.word_cnt; break;
+      case 16: word_cnt = uah16_.word_cnt; break;
+      case 32: word_cnt = uah32_.word_cnt; break;
+      case 64: word_cnt = uah64_.word_cnt; break;
+      default: assert(false);
+    }
+    word_cnt = scale_u(word_cnt);
+    return {word_cnt * (word_bitlength / 8) + sizeof(std::size_t),
+            f64(word_cnt + run_count())};
+  }
+
+  /// XAH with the given word size in bits (8, 16, 32 or 64).
+  estimate
+  xah(std::size_t word_bitlength) const noexcept {
+    $u64 word_cnt = 0;
+    switch (word_bitlength) {
+      case 8:  word_cnt = xah8_.word_cnt; break;
+      case 16: word_cnt = xah16_.word_cnt; break;
+      case 32: word_cnt = xah32_.word_cnt; break;
+      case 64: word_cnt = xah64_.word_cnt; break;
+      default: assert(false);
+    }
+    word_cnt = scale_u(word_cnt);
+    return {word_cnt * (word_bitlength / 8) + sizeof(std::size_t),
+            f64(word_cnt + run_count())};
+  }
+
+  /// WAH with 32-bit words (FastBit). The trailing bits that do not fill an
+  /// entire group are kept in the 'active word', which is accounted for in
+  /// the constant overhead of the bit vector.
+  estimate
+  wah32() const noexcept {
+    const auto word_cnt = scale_u(wah32_.word_cnt);
+    return {word_cnt * 4 + wah_overhead_bytes, f64(word_cnt + run_count())};
+  }
+
+  /// WAH with 64-bit words (FastBit).
+  estimate
+  wah64() const noexcept {
+    const auto word_cnt = scale_u(wah64_.word_cnt);
+    return {word_cnt * 8 + 2 * wah_overhead_bytes,
+            f64(word_cnt + run_count())};
+  }
+
+  /// CONCISE.
+  estimate
+  concise() const noexcept {
+    const auto word_cnt = scale_u(concise_word_cnt_);
+    return {word_cnt * 4 + sizeof(std::size_t), f64(word_cnt + run_count())};
+  }
+
+  /// BBC.
+  estimate
+  bbc() const noexcept {
+    const auto byte_cnt = scale_u(bbc_.byte_cnt);
+    return {byte_cnt + sizeof(std::size_t), f64(byte_cnt + run_count())};
+  }
+
+  /// TEB (teb_wrapper). The estimate is based on the number of inner nodes of
+  /// the pruned bitmap tree. The labels of the leading and trailing 0-leaves,
+  /// which are implicit in a TEB, are not taken into account.
+  estimate
+  teb() const noexcept {
+    constexpr u64 word_bitlength = sizeof(teb_word_type) * 8;
+    constexpr u64 word_size = sizeof(teb_word_type);
+    const auto height = teb_.height;
+    // The number of inner nodes and the number of leading inner nodes, which
+    // are implicit.
+    $f64 inner_node_cnt = 0;
+    $f64 leading_inner_node_cnt = 0;
+    $u1 is_perfect = true;
+    $f64 deepest_level_inner_node_cnt = 0;
+    for (std::size_t level = 0; level < height; ++level) {
+      const f64 max_cnt = f64(1ull << level) * n_ / std::max(sampled_n_,
+          $u64(1));
+      const f64 cnt = std::min(scale(teb_.inner_node_cnt[level]), max_cnt);
+      if (cnt == 0) break;
+      inner_node_cnt += cnt;
+      deepest_level_inner_node_cnt = cnt;
+      if (is_perfect) {
+        leading_inner_node_cnt += scale(teb_.leading_inner_node_cnt[level]);
+        is_perfect = teb_.leading_inner_node_cnt[level] == (1ull << level);
+      }
+    }
+    const f64 node_cnt = 2 * inner_node_cnt + 1;
+    // The leaves in the last level are implicit.
+    const f64 trailing_leaf_cnt = 2 * deepest_level_inner_node_cnt
+        + (inner_node_cnt == 0 ? 1 : 0);
+    const auto explicit_tree_node_cnt = static_cast<$u64>(std::max(0.0,
+        node_cnt - leading_inner_node_cnt - trailing_leaf_cnt));
+    const auto explicit_label_cnt = static_cast<$u64>(inner_node_cnt + 1);
+
+    // The layout of the serialized TEB, see teb_builder.
+    const auto words = [](u64 bit_cnt) {
+      return (bit_cnt + word_bitlength - 1) / word_bitlength;
+    };
+    $u64 word_cnt = sizeof(teb_header) / word_size;
+    word_cnt += words(explicit_tree_node_cnt);
+    if (explicit_tree_node_cnt > 0) {
+      word_cnt += (teb_rank_type::estimate_size_in_bytes(
+          explicit_tree_node_cnt) + word_size - 1) / word_size;
+    }
+    word_cnt += words(explicit_label_cnt);
+    // The level offsets.
+    const auto encoded_tree_height =
+        dtl::log_2(dtl::next_power_of_two(std::max(n_, $u64(2)))) + 1;
+    word_cnt += (2 * sizeof(teb_size_type) * encoded_tree_height
+        + word_size - 1) / word_size;
+    const auto bytes = word_cnt * word_size;
+    return {bytes, f64(explicit_label_cnt + run_count())};
+  }
+
+  /// Estimates the size of an arbitrary encoding T, by constructing T for
+  /// each of the inspected blocks. The result is exact only if the encoding
+  /// of a bitmap is the concatenation of the encodings of its blocks, which
+  /// is typically not the case.
+  template<typename T>
+  estimate
+  sampled() const {
+    $u64 bytes = 0;
+    boost::dynamic_bitset<$u32> block;
+    for (auto block_begin : block_offsets_) {
+      const auto block_end = std::min(block_begin + $u64(block_bitlength), n_);
+      // The blocks are word aligned.
+      block.resize(block_end - block_begin);
+      const auto* words = bitmap_.m_bits.data() + block_begin / 32;
+      std::copy(words, words + block.num_blocks(), block.m_bits.begin());
+      T enc(block);
+      bytes += enc.size_in_bytes();
+    }
+    return {scale_u(bytes), f64(scale_u(bytes) + run_count())};
+  }
+
+private:
+  /// The constant overhead of a FastBit bit vector.
+  static constexpr std::size_t wah_overhead_bytes = 32;
+};
+//===----------------------------------------------------------------------===//
+} // namespace dtl
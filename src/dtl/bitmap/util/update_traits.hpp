@@ -0,0 +1,72 @@
+#pragma once
+//===----------------------------------------------------------------------===//
+#include <dtl/bitmap/teb_types.hpp>
+#include <dtl/dtl.hpp>
+
+#include <boost/dynamic_bitset.hpp>
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+//===----------------------------------------------------------------------===//
+namespace dtl {
+//===----------------------------------------------------------------------===//
+/// Type trait to determine whether a bitmap type supports in-place updates,
+/// i.e., it provides the function 'int update(pos, val, u1* diff_val)' like
+/// the TEB. The function returns 0 if the bit already has the desired value,
+/// 1 if the update has been performed in place, and 2 if the update could not
+/// be performed in place, in which case the bitmap remains unchanged.
+/// The signature is matched exactly, as the pointer would otherwise convert
+/// to the 'two_run_opt' flag of the differential bitmap's update function.
+template<typename B, typename = void>
+struct has_inplace_update : std::false_type {};
+
+template<typename B>
+struct has_inplace_update<B,
+    decltype(static_cast<int (B::*)(std::size_t, u1, u1*, u1)>(&B::update),
+        void())>
+    : std::true_type {};
+//===----------------------------------------------------------------------===//
+/// Type trait to determine whether a bitmap type supports hybrid updates,
+/// i.e., it provides the function 'int update(pos, val)' like the
+/// differential bitmap, which performs the update in place if possible and
+/// falls back to the differential data structure otherwise. Hybrid updates
+/// require the underlying bitmap type to support in-place updates.
+template<typename B, typename = void>
+struct has_hybrid_update : std::false_type {};
+
+template<typename B>
+struct has_hybrid_update<B,
+    decltype(std::declval<B&>().update(std::declval<std::size_t>(),
+        std::declval<$u1>(), std::declval<$u1>()), void())>
+    : std::integral_constant<bool,
+        has_inplace_update<typename B::bitmap_type>::value> {};
+//===----------------------------------------------------------------------===//
+/// Constructs a (compressed) bitmap of type B. If the bitmap type supports
+/// reserving space for in-place updates, the given slack is taken into
+/// account, otherwise it is ignored.
+template<typename B>
+static std::unique_ptr<B>
+make_updatable_bitmap(const boost::dynamic_bitset<$u32>& bitmap,
+    const teb_slack& slack, std::true_type /* supports slack */) {
+  return std::make_unique<B>(bitmap, slack);
+}
+
+template<typename B>
+static std::unique_ptr<B>
+make_updatable_bitmap(const boost::dynamic_bitset<$u32>& bitmap,
+    const teb_slack& /* slack */, std::false_type /* supports slack */) {
+  return std::make_unique<B>(bitmap);
+}
+
+template<typename B>
+static std::unique_ptr<B>
+make_updatable_bitmap(const boost::dynamic_bitset<$u32>& bitmap,
+    const teb_slack& slack) {
+  using supports_slack = std::integral_constant<bool,
+      std::is_constructible<B, const boost::dynamic_bitset<$u32>&,
+          const teb_slack&>::value>;
+  return make_updatable_bitmap<B>(bitmap, slack, supports_slack());
+}
+//===----------------------------------------------------------------------===//
+} // namespace dtl
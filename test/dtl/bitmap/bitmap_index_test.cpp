@@ -0,0 +1,115 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/index/bit_sliced_index.hpp>
+#include <dtl/bitmap/index/equality_encoded_index.hpp>
+#include <dtl/bitmap/index/range_encoded_index.hpp>
+#include <dtl/bitmap/part/part.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the equality-encoded, range-encoded and bit-sliced indexes.
+//===----------------------------------------------------------------------===//
+template<typename T>
+class bitmap_index_test : public ::testing::Test {};
+
+using types_under_test = ::testing::Types<
+    dtl::equality_encoded_index<dtl::teb_wrapper>,
+    dtl::range_encoded_index<dtl::teb_wrapper>,
+    dtl::bit_sliced_index<dtl::teb_wrapper>,
+    dtl::bit_sliced_index<dtl::part<dtl::teb_wrapper, 1ull << 10>>>;
+TYPED_TEST_CASE(bitmap_index_test, types_under_test);
+//===----------------------------------------------------------------------===//
+/// Generates a sequence of n values in [0, c), where the values are repeated
+/// in runs of random length, i.e., the sequence is clustered.
+std::vector<$u32>
+gen_clustered_sequence(std::size_t n, u32 c, std::mt19937& gen) {
+  std::vector<$u32> values;
+  values.reserve(n);
+  while (values.size() < n) {
+    const auto v = gen() % c;
+    const auto run_length = 1 + gen() % 16;
+    for (std::size_t i = 0; i < run_length && values.size() < n; ++i) {
+      values.push_back(v);
+    }
+  }
+  return values;
+}
+//===----------------------------------------------------------------------===//
+/// Returns the rows with a value in [lo, hi] that are also in the filter.
+dtl::bitmap
+expected_between(const std::vector<$u32>& values, u64 lo, u64 hi,
+    const dtl::bitmap& filter) {
+  dtl::bitmap ret(values.size());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    ret[i] = filter[i] && values[i] >= lo && values[i] <= hi;
+  }
+  return ret;
+}
+//===----------------------------------------------------------------------===//
+TYPED_TEST(bitmap_index_test, queries) {
+  std::mt19937 gen(42);
+  const std::size_t n = 5000;
+  for (u32 c : {1u, 2u, 3u, 7u, 8u, 100u}) {
+    const auto values = gen_clustered_sequence(n, c, gen);
+    const TypeParam idx(values, c);
+    ASSERT_EQ(n, idx.size());
+    ASSERT_EQ(c, idx.cardinality());
+
+    const dtl::bitmap all = ~dtl::bitmap(n);
+    const auto filter_bm = dtl::gen_random_bitmap_markov(n, 8.0, 0.3);
+    const dtl::teb_wrapper filter(filter_bm);
+
+    // Point and range queries, with and without a filter.
+    for ($u64 v = 0; v <= c; ++v) {
+      auto eq_it = idx.eq(v);
+      ASSERT_EQ(expected_between(values, v, v, all),
+          dtl::to_bitmap_from_iterator(eq_it, n)) << "c=" << c << ", v=" << v;
+      auto lt_it = idx.lt(v);
+      ASSERT_EQ(v == 0 ? dtl::bitmap(n) : expected_between(values, 0, v - 1, all),
+          dtl::to_bitmap_from_iterator(lt_it, n)) << "c=" << c << ", v=" << v;
+      auto eq_filter_it = idx.eq(v, filter);
+      ASSERT_EQ(expected_between(values, v, v, filter_bm),
+          dtl::to_bitmap_from_iterator(eq_filter_it, n))
+          << "c=" << c << ", v=" << v;
+      auto lt_filter_it = idx.lt(v, filter);
+      ASSERT_EQ(v == 0
+              ? dtl::bitmap(n) : expected_between(values, 0, v - 1, filter_bm),
+          dtl::to_bitmap_from_iterator(lt_filter_it, n))
+          << "c=" << c << ", v=" << v;
+    }
+    for (std::size_t rep = 0; rep < 50; ++rep) {
+      const u64 lo = gen() % (c + 1);
+      const u64 hi = gen() % (c + 1);
+      auto between_it = idx.between(lo, hi);
+      ASSERT_EQ(expected_between(values, lo, hi, all),
+          dtl::to_bitmap_from_iterator(between_it, n))
+          << "c=" << c << ", lo=" << lo << ", hi=" << hi;
+      auto between_filter_it = idx.between(lo, hi, filter);
+      ASSERT_EQ(expected_between(values, lo, hi, filter_bm),
+          dtl::to_bitmap_from_iterator(between_filter_it, n))
+          << "c=" << c << ", lo=" << lo << ", hi=" << hi;
+    }
+
+    // Aggregation.
+    $u64 expected_sum = 0;
+    $u64 expected_filtered_sum = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+      expected_sum += values[i];
+      if (filter_bm[i]) expected_filtered_sum += values[i];
+    }
+    ASSERT_EQ(expected_sum, idx.sum()) << "c=" << c;
+    ASSERT_EQ(expected_filtered_sum, idx.sum(filter)) << "c=" << c;
+  }
+}
+//===----------------------------------------------------------------------===//
+TYPED_TEST(bitmap_index_test, invalid_values) {
+  std::vector<$u32> values { 0, 1, 2, 3 };
+  ASSERT_THROW(TypeParam(values, 3), std::invalid_argument);
+  ASSERT_THROW(TypeParam(values, 0), std::invalid_argument);
+}
+//===----------------------------------------------------------------------===//
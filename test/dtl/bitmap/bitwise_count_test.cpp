@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/bitwise_count.hpp>
+#include <dtl/bitmap/part/part.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+//===----------------------------------------------------------------------===//
+// Tests for the population count of bitwise operations.
+//===----------------------------------------------------------------------===//
+template<typename T>
+void validate(const dtl::bitmap& bm_a, const dtl::bitmap& bm_b) {
+  T a(bm_a);
+  T b(bm_b);
+  ASSERT_EQ((bm_a & bm_b).count(), dtl::and_count(a, b));
+  ASSERT_EQ((bm_a | bm_b).count(), dtl::or_count(a, b));
+  ASSERT_EQ((bm_a ^ bm_b).count(), dtl::xor_count(a, b));
+  ASSERT_EQ((bm_a & bm_b).count(), dtl::and_count(b, a));
+  ASSERT_EQ((bm_a | bm_b).count(), dtl::or_count(b, a));
+  ASSERT_EQ((bm_a ^ bm_b).count(), dtl::xor_count(b, a));
+}
+//===----------------------------------------------------------------------===//
+TEST(bitwise_count, teb) {
+  for (auto len : {2, 1000, 1024, 1025, 4096, 10000}) {
+    for (auto d_a : {0.0, 0.01, 0.1, 0.5, 1.0}) {
+      for (auto d_b : {0.0, 0.001, 0.1, 0.9, 1.0}) {
+        const auto bm_a = dtl::gen_random_bitmap_markov(len, 8.0, d_a);
+        const auto bm_b = dtl::gen_random_bitmap_markov(len, 4.0, d_b);
+        validate<dtl::teb_wrapper>(bm_a, bm_b);
+        if (::testing::Test::HasFatalFailure()) {
+          FAIL() << "len=" << len << ", d_a=" << d_a << ", d_b=" << d_b;
+        }
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(bitwise_count, part_teb) {
+  using part_t = dtl::part<dtl::teb_wrapper, 1ull << 10>;
+  for (auto len : {1024, 5000, 16384}) {
+    for (auto d : {0.0, 0.01, 0.1, 0.5, 1.0}) {
+      const auto bm_a = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+      const auto bm_b = dtl::gen_random_bitmap_markov(len, 8.0, d);
+      validate<part_t>(bm_a, bm_b);
+      if (::testing::Test::HasFatalFailure()) {
+        FAIL() << "len=" << len << ", d=" << d;
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(bitwise_count, lossy_teb) {
+  const std::size_t len = 1ull << 14;
+  const auto bm_a = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  const auto bm_b = dtl::gen_random_bitmap_markov(len, 8.0, 0.2);
+  dtl::teb_wrapper a(bm_a, 0.1);
+  dtl::teb_wrapper b(bm_b);
+  // The result refers to the decoded (lossy) bitmap.
+  const auto decoded_a = dtl::to_bitmap_using_iterator(a);
+  ASSERT_EQ((decoded_a & bm_b).count(), dtl::and_count(a, b));
+  ASSERT_EQ((decoded_a | bm_b).count(), dtl::or_count(a, b));
+  ASSERT_EQ((decoded_a ^ bm_b).count(), dtl::xor_count(a, b));
+}
+//===----------------------------------------------------------------------===//
+TEST(bitwise_count, generic) {
+  // Falls back to the run iterators.
+  using part_t = dtl::part<dtl::teb_wrapper, 1ull << 10>;
+  const std::size_t len = 5000;
+  const auto bm_a = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  const auto bm_b = dtl::gen_random_bitmap_markov(len, 8.0, 0.3);
+  dtl::teb_wrapper a(bm_a);
+  part_t b(bm_b);
+  ASSERT_EQ((bm_a & bm_b).count(), dtl::and_count(a, b));
+  ASSERT_EQ((bm_a | bm_b).count(), dtl::or_count(a, b));
+  ASSERT_EQ((bm_a ^ bm_b).count(), dtl::xor_count(a, b));
+}
+//===----------------------------------------------------------------------===//
@@ -0,0 +1,124 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/bitwise_operations.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+//===----------------------------------------------------------------------===//
+// Tests for the AND-NOT and the NOT operation.
+//===----------------------------------------------------------------------===//
+/// Compares the given iterator against the expected bitmap, after skipping to
+/// the given position.
+template<typename It>
+void validate_skip(It&& it, const dtl::bitmap& expected, std::size_t to_pos) {
+  if (to_pos > it.pos()) {
+    it.skip_to(to_pos);
+  }
+  else {
+    to_pos = 0;
+  }
+  auto expected_pos = (to_pos == 0)
+      ? expected.find_first() : expected.find_next(to_pos - 1);
+  while (expected_pos != dtl::bitmap::npos) {
+    ASSERT_FALSE(it.end()) << "to_pos=" << to_pos;
+    ASSERT_EQ(expected_pos, it.pos()) << "to_pos=" << to_pos;
+    for (std::size_t i = it.pos(); i < it.pos() + it.length(); ++i) {
+      ASSERT_TRUE(expected[i]) << "to_pos=" << to_pos << ", i=" << i;
+    }
+    expected_pos = expected.find_next(it.pos() + it.length() - 1);
+    it.next();
+  }
+  ASSERT_TRUE(it.end()) << "to_pos=" << to_pos;
+}
+//===----------------------------------------------------------------------===//
+TEST(complement, bitwise_and_not) {
+  std::mt19937 gen(42);
+  for (auto len : {1000, 1024, 4096, 10000}) {
+    for (auto density : {0.0, 0.01, 0.1, 0.5, 0.9, 1.0}) {
+      const auto bm_a = dtl::gen_random_bitmap_markov(len, 8.0, 0.5);
+      const auto bm_b = dtl::gen_random_bitmap_markov(len, 8.0, density);
+      const auto expected = bm_a & ~bm_b;
+      dtl::teb_wrapper teb_a(bm_a);
+      dtl::teb_wrapper teb_b(bm_b);
+
+      auto it = dtl::bitwise_and_not_it(teb_a.it(), teb_b.it());
+      ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(it, len));
+      auto scan_it = dtl::bitwise_and_not_it(teb_a.scan_it(), teb_b.scan_it());
+      ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(scan_it, len));
+
+      for (std::size_t rep = 0; rep < 10; ++rep) {
+        const std::size_t to_pos = gen() % len;
+        validate_skip(dtl::bitwise_and_not_it(teb_a.it(), teb_b.it()),
+            expected, to_pos);
+        validate_skip(dtl::bitwise_and_not_it(teb_a.scan_it(), teb_b.it()),
+            expected, to_pos);
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(complement, complement_iterator) {
+  std::mt19937 gen(42);
+  for (auto len : {2, 1000, 1024, 4096, 10000}) {
+    for (auto density : {0.0, 0.01, 0.1, 0.5, 0.9, 1.0}) {
+      const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, density);
+      const auto expected = ~bm;
+      dtl::teb_wrapper teb(bm);
+
+      auto it = dtl::complement_it(teb.it(), len);
+      ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(it, len));
+      auto scan_it = dtl::complement_it(teb.scan_it(), len);
+      ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(scan_it, len));
+      // Double negation.
+      auto it_2 = dtl::complement_it(dtl::complement_it(teb.it(), len), len);
+      ASSERT_EQ(bm, dtl::to_bitmap_from_iterator(it_2, len));
+      // The complement as an input of a binary operation.
+      auto and_it = dtl::bitwise_and_it(teb.it(),
+          dtl::complement_it(teb.it(), len));
+      ASSERT_TRUE(and_it.end());
+
+      for (std::size_t rep = 0; rep < 10; ++rep) {
+        const std::size_t to_pos = gen() % len;
+        validate_skip(dtl::complement_it(teb.it(), len), expected, to_pos);
+        validate_skip(dtl::complement_it(teb.scan_it(), len), expected,
+            to_pos);
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(complement, teb_complement) {
+  for (auto len : {2, 1000, 1024, 1025, 4096, 10000}) {
+    for (auto density : {0.0, 0.001, 0.01, 0.1, 0.5, 0.9, 1.0}) {
+      const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, density);
+      const auto expected = ~bm;
+      dtl::teb_wrapper teb(bm);
+      const auto teb_not = teb.complement();
+      ASSERT_EQ(len, teb_not.size());
+      ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(teb_not))
+          << "len=" << len << ", density=" << density;
+      auto scan_it = teb_not.scan_it();
+      ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(scan_it, len));
+      for (std::size_t i = 0; i < len; ++i) {
+        ASSERT_EQ(expected[i], teb_not.test(i)) << "i=" << i;
+      }
+      // Double negation.
+      const auto teb_not_not = teb_not.complement();
+      ASSERT_EQ(bm, dtl::to_bitmap_using_iterator(teb_not_not));
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(complement, teb_complement_of_lossy_teb) {
+  const std::size_t len = 4096;
+  const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  dtl::teb_wrapper teb(bm, 0.1);
+  const auto decoded = dtl::to_bitmap_using_iterator(teb);
+  const auto teb_not = teb.complement();
+  ASSERT_FALSE(teb_not.is_lossy());
+  ASSERT_EQ(~decoded, dtl::to_bitmap_using_iterator(teb_not));
+}
+//===----------------------------------------------------------------------===//
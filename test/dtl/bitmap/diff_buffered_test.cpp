@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/diff/diff_buffered.hpp>
+#include <dtl/bitmap/diff/merge.hpp>
+#include <dtl/bitmap/dynamic_roaring_bitmap.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the differential bitmap with an update log.
+//===----------------------------------------------------------------------===//
+using diff_t = dtl::diff_buffered<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap,
+    4, 64>;
+using merge_t =
+    dtl::merge_naive_iter<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap>;
+//===----------------------------------------------------------------------===//
+TEST(diff_buffered, random_updates) {
+  for (auto len = 1024; len <= 8192 * 2; len *= 2) {
+    const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+    diff_t enc(bm_initial);
+    auto plain = bm_initial;
+
+    std::mt19937 gen(42);
+    for (std::size_t i = 0; i < 5; ++i) {
+      for (std::size_t u = 0; u < 500; ++u) {
+        const std::size_t pos = gen() % len;
+        const $u1 val = gen() % 2;
+        enc.set(pos, val);
+        plain[pos] = val;
+        // Point lookups need to consider the log.
+        ASSERT_EQ(plain[pos], enc.test(pos));
+      }
+      ASSERT_EQ(plain, dtl::to_bitmap_using_iterator(enc));
+      ASSERT_EQ(enc.logged_update_cnt(), 0);
+      enc.template merge<merge_t>();
+      ASSERT_EQ(plain, dtl::to_bitmap_using_iterator(enc));
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Multiple writers update disjoint sets of positions.
+TEST(diff_buffered, concurrent_writers) {
+  const std::size_t len = 1ull << 16;
+  const std::size_t thread_cnt = 8;
+  const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  diff_t enc(bm_initial);
+
+  std::vector<std::thread> writers;
+  for (std::size_t t = 0; t < thread_cnt; ++t) {
+    writers.emplace_back([&, t]() {
+      for (std::size_t i = t; i < len; i += thread_cnt * 3) {
+        enc.set(i, !bm_initial[i]);
+      }
+    });
+  }
+  for (auto& w : writers) w.join();
+
+  auto expected = bm_initial;
+  for (std::size_t i = 0; i < len; ++i) {
+    if ((i % (thread_cnt * 3)) < thread_cnt) {
+      expected[i] = !bm_initial[i];
+    }
+  }
+  ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(enc));
+}
+//===----------------------------------------------------------------------===//
+/// Updates of the same position by different threads, which are ordered by a
+/// happens-before relationship, must be applied in that order.
+TEST(diff_buffered, ordered_updates_of_different_threads) {
+  const std::size_t len = 1ull << 12;
+  const dtl::bitmap bm_initial(len);
+  diff_t enc(bm_initial);
+
+  std::atomic<$u64> turn(0);
+  const std::size_t round_cnt = 1000;
+  auto writer = [&](u64 thread_id) {
+    for (std::size_t r = 0; r < round_cnt; ++r) {
+      while (turn.load() % 2 != thread_id) std::this_thread::yield();
+      // Thread 0 sets the bits, thread 1 clears them.
+      enc.set(r % 16, thread_id == 0);
+      turn.fetch_add(1);
+    }
+  };
+  std::thread t0(writer, 0);
+  std::thread t1(writer, 1);
+  t0.join();
+  t1.join();
+  ASSERT_EQ(bm_initial, dtl::to_bitmap_using_iterator(enc));
+}
+//===----------------------------------------------------------------------===//
+/// More writers than shards, which concurrently read their own updates,
+/// while the log is drained by other writers.
+TEST(diff_buffered, concurrent_readers) {
+  const std::size_t len = 1ull << 14;
+  const std::size_t thread_cnt = 12;
+  const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  diff_t enc(bm_initial);
+
+  std::atomic<$u64> error_cnt(0);
+  std::vector<std::thread> threads;
+  for (std::size_t t = 0; t < thread_cnt; ++t) {
+    threads.emplace_back([&, t]() {
+      for (std::size_t r = 0; r < 4; ++r) {
+        for (std::size_t i = t; i < len; i += thread_cnt) {
+          const $u1 val = (r % 2 == 0) ? !bm_initial[i] : bm_initial[i];
+          enc.set(i, val);
+          // A thread needs to observe its own updates.
+          if (enc.test(i) != val) error_cnt.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  ASSERT_EQ(0, error_cnt.load());
+  ASSERT_EQ(bm_initial, dtl::to_bitmap_using_iterator(enc));
+}
+//===----------------------------------------------------------------------===//
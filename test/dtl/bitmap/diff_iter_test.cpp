@@ -0,0 +1,97 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/bitwise_operations.hpp>
+#include <dtl/bitmap/diff/diff.hpp>
+#include <dtl/bitmap/diff/merge.hpp>
+#include <dtl/bitmap/diff/small_diff.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+//===----------------------------------------------------------------------===//
+// Tests for the XOR iterator for sparse diffs.
+//===----------------------------------------------------------------------===//
+/// Compares the given iterator against the expected bitmap, after skipping to
+/// the given position. Note that the iterators only skip forward.
+template<typename It>
+void validate_skip(It&& it, const dtl::bitmap& expected, std::size_t to_pos) {
+  if (it.end()) {
+    ASSERT_TRUE(expected.none());
+    return;
+  }
+  if (to_pos > it.pos()) {
+    it.skip_to(to_pos);
+  }
+  else {
+    to_pos = 0;
+  }
+  auto expected_pos = (to_pos == 0)
+      ? expected.find_first() : expected.find_next(to_pos - 1);
+  while (expected_pos != dtl::bitmap::npos) {
+    ASSERT_FALSE(it.end()) << "to_pos=" << to_pos;
+    // The output 1-fills are not necessarily maximal.
+    ASSERT_EQ(expected_pos, it.pos()) << "to_pos=" << to_pos;
+    for (std::size_t i = it.pos(); i < it.pos() + it.length(); ++i) {
+      ASSERT_TRUE(expected[i]) << "to_pos=" << to_pos << ", i=" << i;
+    }
+    expected_pos = expected.find_next(it.pos() + it.length() - 1);
+    it.next();
+  }
+  ASSERT_TRUE(it.end()) << "to_pos=" << to_pos;
+}
+//===----------------------------------------------------------------------===//
+TEST(diff_iter, bitwise_xor_sparse) {
+  std::mt19937 gen(42);
+  for (auto len = 1024; len <= 8192 * 2; len *= 2) {
+    for (auto diff_density : {0.0, 0.0001, 0.001, 0.01, 0.1, 0.5}) {
+      const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+      const auto diff_bm = dtl::gen_random_bitmap_uniform(len, diff_density);
+      const auto expected = bm ^ diff_bm;
+      dtl::teb_wrapper teb(bm);
+      dtl::small_diff diff(diff_bm);
+
+      auto it = dtl::bitwise_xor_sparse_it(teb.it(), diff.it());
+      ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(it, len));
+      auto scan_it = dtl::bitwise_xor_sparse_it(teb.scan_it(), diff.it());
+      ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(scan_it, len));
+
+      for (std::size_t rep = 0; rep < 10; ++rep) {
+        const std::size_t to_pos = gen() % len;
+        validate_skip(dtl::bitwise_xor_sparse_it(teb.it(), diff.it()),
+            expected, to_pos);
+        validate_skip(dtl::bitwise_xor_sparse_it(teb.scan_it(), diff.it()),
+            expected, to_pos);
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(diff_iter, no_pending_updates) {
+  using diff_t = dtl::diff<dtl::teb_wrapper, dtl::small_diff>;
+  using merge_t = dtl::merge_naive_iter<dtl::teb_wrapper, dtl::small_diff>;
+  const std::size_t len = 4096;
+  const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  diff_t enc(bm);
+  auto plain = bm;
+  ASSERT_EQ(plain, dtl::to_bitmap_using_iterator(enc));
+
+  std::mt19937 gen(42);
+  for (std::size_t i = 0; i < 3; ++i) {
+    for (std::size_t j = 0; j < 100; ++j) {
+      const std::size_t pos = gen() % len;
+      enc.set(pos, !plain[pos]);
+      plain[pos] = !plain[pos];
+    }
+    ASSERT_EQ(plain, dtl::to_bitmap_using_iterator(enc));
+    enc.template merge<merge_t>();
+    // The diff is empty now.
+    ASSERT_TRUE(enc.get_diff()->it().end());
+    ASSERT_EQ(plain, dtl::to_bitmap_using_iterator(enc));
+    for (std::size_t pos = 0; pos < len; ++pos) {
+      ASSERT_EQ(plain[pos], enc.test(pos));
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
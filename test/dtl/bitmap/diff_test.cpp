@@ -5,6 +5,7 @@
 #include <dtl/bitmap/diff/diff.hpp>
 #include <dtl/bitmap/diff/merge.hpp>
 #include <dtl/bitmap/diff/merge_teb.hpp>
+#include <dtl/bitmap/diff/small_diff.hpp>
 #include <dtl/bitmap/util/random.hpp>
 //===----------------------------------------------------------------------===//
 // Tests for the differential update feature.
@@ -26,6 +27,7 @@ using diff_types_under_test = ::testing::Types<
     TestSetting<roaring_bitmap, wah, dtl::merge_naive>,
     TestSetting<wah, roaring_bitmap, dtl::merge_naive>,
     TestSetting<wah, wah, dtl::merge_naive>,
+    TestSetting<teb_v2, dtl::small_diff, dtl::merge_naive>,
     // Naive merge (using the run iterator).
     TestSetting<teb_v2, roaring_bitmap, dtl::merge_naive_iter>,
     TestSetting<teb_v2, wah, dtl::merge_naive_iter>,
@@ -33,12 +35,18 @@ using diff_types_under_test = ::testing::Types<
     TestSetting<roaring_bitmap, wah, dtl::merge_naive_iter>,
     TestSetting<wah, roaring_bitmap, dtl::merge_naive_iter>,
     TestSetting<wah, wah, dtl::merge_naive_iter>,
+    TestSetting<teb_v2, dtl::small_diff, dtl::merge_naive_iter>,
+    TestSetting<roaring_bitmap, dtl::small_diff, dtl::merge_naive_iter>,
     // In-place merge.
     TestSetting<roaring_bitmap, roaring_bitmap, dtl::merge_inplace>,
     TestSetting<wah, wah, dtl::merge_inplace>,
     // Tree-based merge (TEB only).
     TestSetting<teb_v2, roaring_bitmap, dtl::merge_tree>,
-    TestSetting<teb_v2, wah, dtl::merge_tree>>;
+    TestSetting<teb_v2, wah, dtl::merge_tree>,
+    TestSetting<teb_v2, dtl::small_diff, dtl::merge_tree>,
+    // In-place merge using the in-place updates (TEB only).
+    TestSetting<teb_v2, roaring_bitmap, dtl::merge_inplace_teb>,
+    TestSetting<teb_v2, dtl::small_diff, dtl::merge_inplace_teb>>;
 //===----------------------------------------------------------------------===//
 // Fixture for the parameterized test case.
 template<typename T>
@@ -0,0 +1,196 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/diff/diff.hpp>
+#include <dtl/bitmap/diff/small_diff.hpp>
+#include <dtl/bitmap/dynamic_roaring_bitmap.hpp>
+#include <dtl/bitmap/expression.hpp>
+#include <dtl/bitmap/part/part.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/any_run_iter.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the boolean expressions over bitmaps.
+//===----------------------------------------------------------------------===//
+using expr_t = dtl::bitmap_expr;
+//===----------------------------------------------------------------------===//
+TEST(expression, any_run_iter) {
+  std::mt19937 gen(42);
+  const std::size_t len = 1ull << 14;
+  for (auto d : {0.0, 0.01, 0.1, 0.5}) {
+    const auto bm = dtl::gen_random_bitmap_markov(len, 4.0, d);
+    dtl::teb_wrapper teb(bm);
+    dtl::any_run_iter it(teb.it(), len);
+    ASSERT_EQ(bm, dtl::to_bitmap_from_iterator(it, len));
+
+    // Skip within and beyond the buffered runs.
+    for (std::size_t rep = 0; rep < 100; ++rep) {
+      dtl::any_run_iter skip_it(teb.scan_it(), len);
+      std::size_t to_pos = 0;
+      while (true) {
+        to_pos += 1 + gen() % ((rep + 1) * 16);
+        if (to_pos >= len) break;
+        if (to_pos <= skip_it.pos()) continue;
+        skip_it.skip_to(to_pos);
+        std::size_t expected_pos = to_pos;
+        while (expected_pos < len && !bm[expected_pos]) ++expected_pos;
+        if (expected_pos == len) {
+          ASSERT_TRUE(skip_it.end());
+          ASSERT_EQ(len, skip_it.pos());
+          break;
+        }
+        ASSERT_FALSE(skip_it.end());
+        ASSERT_EQ(expected_pos, skip_it.pos());
+        ASSERT_TRUE(bm[skip_it.pos()]);
+        ASSERT_TRUE(bm[skip_it.pos() + skip_it.length() - 1]);
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(expression, optimize) {
+  const std::size_t len = 1ull << 12;
+  dtl::bitmap bm(len);
+  dtl::teb_wrapper teb(bm);
+  auto a = expr_t::leaf(teb, "a", 10);
+  auto b = expr_t::leaf(teb, "b", 100);
+  auto c = expr_t::leaf(teb, "c", 1000);
+  auto d = expr_t::leaf(teb, "d", 2000);
+
+  // The sparsest input comes first.
+  ASSERT_EQ("AND(a,b,c)", ((c & b) & a).optimize().to_string());
+  ASSERT_EQ("OR(a,b,c)", (c | (b | a)).optimize().to_string());
+  // The negated inputs are evaluated last.
+  ASSERT_EQ("AND(c,NOT(d),NOT(a))", (!a & c & !d).optimize().to_string());
+  ASSERT_EQ("a", (!(!a)).optimize().to_string());
+  // De Morgan.
+  ASSERT_EQ("NOT(OR(a,b))", (!b & !a).optimize().to_string());
+  // Selectivity estimates.
+  ASSERT_DOUBLE_EQ(10.0 / len, a.selectivity());
+  ASSERT_DOUBLE_EQ(1.0 - 10.0 / len, (!a).selectivity());
+  ASSERT_DOUBLE_EQ((10.0 / len) * (100.0 / len), (a & b).selectivity());
+}
+//===----------------------------------------------------------------------===//
+TEST(expression, cardinality_estimate) {
+  const std::size_t len = 1ull << 16;
+  const auto bm_sparse = dtl::gen_random_bitmap_uniform(len, 0.001);
+  const auto bm_dense = dtl::gen_random_bitmap_uniform(len, 0.2);
+  dtl::teb_wrapper teb_dense(bm_dense);
+  dtl::dynamic_roaring_bitmap roaring_sparse(bm_sparse);
+  auto a = expr_t::leaf(teb_dense, "a");
+  auto b = expr_t::leaf(roaring_sparse, "b");
+  // Roaring provides the exact cardinality.
+  ASSERT_DOUBLE_EQ(f64(bm_sparse.count()) / len, b.selectivity());
+  ASSERT_EQ("AND(b,a)", (a & b).optimize().to_string());
+  // The cardinality of TEBs is determined using a run scan.
+  ASSERT_DOUBLE_EQ(f64(bm_dense.count()) / len, a.selectivity());
+}
+//===----------------------------------------------------------------------===//
+/// A dense TEB that consists of long 1-runs is small, but not selective.
+TEST(expression, cardinality_of_dense_teb) {
+  const std::size_t len = 1ull << 16;
+  const auto bm_sparse = dtl::gen_random_bitmap_uniform(len, 0.01);
+  dtl::bitmap bm_dense(len);
+  bm_dense.set();
+  bm_dense[len / 2] = false;
+  dtl::teb_wrapper teb_dense(bm_dense);
+  dtl::dynamic_roaring_bitmap roaring_sparse(bm_sparse);
+  auto a = expr_t::leaf(teb_dense, "a");
+  auto b = expr_t::leaf(roaring_sparse, "b");
+  ASSERT_DOUBLE_EQ(f64(len - 1) / len, a.selectivity());
+  ASSERT_EQ("AND(b,a)", (a & b).optimize().to_string());
+}
+//===----------------------------------------------------------------------===//
+/// Generates a random expression over the given leaves and computes the
+/// expected result.
+expr_t
+gen_random_expr(std::mt19937& gen, const std::vector<expr_t>& leaves,
+    const std::vector<dtl::bitmap>& bitmaps, std::size_t depth,
+    dtl::bitmap& expected) {
+  const auto r = gen() % 4;
+  if (depth == 0 || r == 0) {
+    const auto i = gen() % leaves.size();
+    expected = bitmaps[i];
+    return leaves[i];
+  }
+  if (r == 1) {
+    auto ret = !gen_random_expr(gen, leaves, bitmaps, depth - 1, expected);
+    expected.flip();
+    return ret;
+  }
+  std::vector<expr_t> operands;
+  const std::size_t cnt = 2 + gen() % 3;
+  for (std::size_t i = 0; i < cnt; ++i) {
+    dtl::bitmap e;
+    operands.push_back(gen_random_expr(gen, leaves, bitmaps, depth - 1, e));
+    if (i == 0) {
+      expected = e;
+    }
+    else if (r == 2) {
+      expected &= e;
+    }
+    else {
+      expected |= e;
+    }
+  }
+  return (r == 2)
+      ? expr_t::conjunction(std::move(operands))
+      : expr_t::disjunction(std::move(operands));
+}
+//===----------------------------------------------------------------------===//
+TEST(expression, random_expressions) {
+  using diff_t = dtl::diff<dtl::teb_wrapper, dtl::small_diff>;
+  using part_t = dtl::part<dtl::teb_wrapper, 1ull << 10>;
+  const std::size_t len = 1ull << 14;
+  std::mt19937 gen(42);
+
+  std::vector<dtl::bitmap> bitmaps;
+  for (auto d : {0.001, 0.01, 0.1, 0.5, 0.9}) {
+    bitmaps.push_back(dtl::gen_random_bitmap_markov(len, 8.0, d));
+  }
+  bitmaps.push_back(dtl::bitmap(len));
+  bitmaps.push_back(~dtl::bitmap(len));
+
+  // Different kinds of encodings.
+  std::vector<dtl::teb_wrapper> tebs;
+  std::vector<part_t> parts;
+  std::vector<diff_t> diffs;
+  for (const auto& bm : bitmaps) {
+    tebs.emplace_back(bm);
+    parts.emplace_back(bm);
+    diffs.emplace_back(bm);
+  }
+  std::vector<expr_t> leaves;
+  std::vector<dtl::bitmap> leaf_bitmaps;
+  for (std::size_t i = 0; i < bitmaps.size(); ++i) {
+    leaves.push_back(expr_t::leaf(tebs[i], "t" + std::to_string(i)));
+    leaf_bitmaps.push_back(bitmaps[i]);
+    leaves.push_back(expr_t::leaf(parts[i], "p" + std::to_string(i)));
+    leaf_bitmaps.push_back(bitmaps[i]);
+    // Pending updates.
+    auto bm = bitmaps[i];
+    for (std::size_t j = 0; j < 20; ++j) {
+      const std::size_t pos = gen() % len;
+      diffs[i].set(pos, !bm[pos]);
+      bm[pos] = !bm[pos];
+    }
+    leaves.push_back(expr_t::leaf(diffs[i], "d" + std::to_string(i)));
+    leaf_bitmaps.push_back(bm);
+  }
+
+  for (std::size_t rep = 0; rep < 200; ++rep) {
+    dtl::bitmap expected;
+    const auto expr = gen_random_expr(gen, leaves, leaf_bitmaps, 4, expected);
+    auto it = expr.it();
+    ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(it, len))
+        << expr.to_string();
+    auto it_unoptimized = expr.it_unoptimized();
+    ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(it_unoptimized, len))
+        << expr.to_string();
+  }
+}
+//===----------------------------------------------------------------------===//
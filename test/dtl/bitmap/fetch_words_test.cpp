@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/diff/diff.hpp>
+#include <dtl/bitmap/diff/small_diff.hpp>
+#include <dtl/bitmap/part/part.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/block_cursor.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the range-window decoding into plain words.
+//===----------------------------------------------------------------------===//
+/// Decodes the range [b, e) and compares the words against the given bitmap.
+template<typename T>
+void validate_range(const T& enc, const dtl::bitmap& expected,
+    std::size_t b, std::size_t e) {
+  const auto word_cnt = (e - b + 63) / 64;
+  // Fill the buffer with garbage, which needs to be overwritten.
+  std::vector<$u64> words(word_cnt + 1, ~$u64(0));
+  enc.fetch_words(b, e, words.data());
+  for (std::size_t i = b; i < word_cnt * 64 + b; ++i) {
+    const u1 bit = dtl::bitmap_fun<$u64>::test(words.data(), i - b);
+    const u1 expected_bit = (i < e) && expected[i];
+    ASSERT_EQ(expected_bit, bit) << "b=" << b << ", e=" << e << ", i=" << i;
+  }
+  // No writes beyond the range.
+  ASSERT_EQ(~$u64(0), words[word_cnt]);
+}
+//===----------------------------------------------------------------------===//
+/// Decodes random (aligned and unaligned) ranges.
+template<typename T>
+void validate(const T& enc, const dtl::bitmap& expected) {
+  const auto len = expected.size();
+  validate_range(enc, expected, 0, len);
+  std::mt19937 gen(42);
+  for (std::size_t rep = 0; rep < 100; ++rep) {
+    std::size_t b = gen() % len;
+    if (rep % 2 == 0) b -= b % 64;
+    const std::size_t e = b + 1 + gen() % (len - b);
+    validate_range(enc, expected, b, e);
+  }
+
+  // Stream the bitmap block by block.
+  for (std::size_t block_bitlength : {64, 1024, 1000}) {
+    dtl::block_cursor<T> cursor(enc, block_bitlength);
+    std::vector<$u64> words(cursor.block_word_cnt());
+    while (!cursor.end()) {
+      const auto b = cursor.pos();
+      const auto cnt = cursor.next(words.data());
+      for (std::size_t i = 0; i < cnt; ++i) {
+        ASSERT_EQ(expected[b + i],
+            dtl::bitmap_fun<$u64>::test(words.data(), i));
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(fetch_words, teb) {
+  for (auto len : {2u, 100u, 1000u, 1u << 16}) {
+    for (auto d : {0.0, 0.01, 0.1, 0.5, 1.0}) {
+      const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, d);
+      dtl::teb_wrapper enc(bm);
+      validate(enc, bm);
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(fetch_words, part) {
+  for (auto len : {1000u, 1u << 16}) {
+    for (auto d : {0.01, 0.1, 0.5}) {
+      const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, d);
+      dtl::part<dtl::teb_wrapper, 1024> enc_1024(bm);
+      validate(enc_1024, bm);
+      dtl::part<dtl::teb_wrapper, 32> enc_32(bm);
+      validate(enc_32, bm);
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(fetch_words, diff) {
+  using diff_t = dtl::diff<dtl::teb_wrapper, dtl::small_diff>;
+  std::mt19937 gen(42);
+  for (auto len : {1000u, 1u << 16}) {
+    for (auto d : {0.01, 0.1, 0.5}) {
+      auto bm = dtl::gen_random_bitmap_markov(len, 8.0, d);
+      diff_t enc(bm);
+      validate(enc, bm);
+      for (std::size_t i = 0; i < 100; ++i) {
+        const auto pos = gen() % len;
+        enc.set(pos, !bm[pos]);
+        bm[pos] = !bm[pos];
+      }
+      validate(enc, bm);
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
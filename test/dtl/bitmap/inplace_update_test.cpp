@@ -0,0 +1,378 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/diff/diff.hpp>
+#include <dtl/bitmap/diff/merge.hpp>
+#include <dtl/bitmap/diff/merge_teb.hpp>
+#include <dtl/bitmap/dynamic_roaring_bitmap.hpp>
+#include <dtl/bitmap/part/part_updirect.hpp>
+#include <dtl/bitmap/part/part_upforward.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+#include <dtl/bitmap/util/update_traits.hpp>
+
+#include <random>
+//===----------------------------------------------------------------------===//
+// Tests for the in-place updates of TEBs, and the routing of updates through
+// partitioned bitmaps.
+//===----------------------------------------------------------------------===//
+using diff_teb = dtl::diff<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap>;
+
+static_assert(dtl::has_inplace_update<dtl::teb_wrapper>::value, "");
+static_assert(!dtl::has_inplace_update<dtl::dynamic_roaring_bitmap>::value, "");
+static_assert(!dtl::has_inplace_update<diff_teb>::value, "");
+static_assert(dtl::has_hybrid_update<diff_teb>::value, "");
+static_assert(!dtl::has_hybrid_update<dtl::teb_wrapper>::value, "");
+static_assert(!dtl::has_hybrid_update<
+    dtl::diff<dtl::dynamic_roaring_bitmap, dtl::dynamic_roaring_bitmap>>::value,
+    "");
+//===----------------------------------------------------------------------===//
+/// Validates the TEB using point lookups and both iterator types.
+static void
+validate(const dtl::bitmap& expected, const dtl::teb_wrapper& enc) {
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(expected[i], enc.test(i)) << "i=" << i;
+  }
+  ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(enc));
+  auto it = enc.it();
+  ASSERT_EQ(expected, dtl::to_bitmap_from_iterator(it, expected.size()));
+}
+/// Returns the number of (implicit and explicit) tree nodes.
+static std::size_t
+node_cnt(const dtl::teb_wrapper& enc) {
+  const auto& teb = *enc.teb_;
+  return teb.implicit_inner_node_cnt_ + teb.tree_bit_cnt_
+      + teb.implicit_trailing_leaf_cnt_;
+}
+//===----------------------------------------------------------------------===//
+/// Apply all possible single-bit updates to small bitmaps.
+TEST(inplace_update, runbreaking_updates) {
+  std::mt19937 gen(42);
+  for (std::size_t len : {16, 32, 64}) {
+    for (std::size_t rep = 0; rep < 100; ++rep) {
+      const auto bm_initial = dtl::gen_random_bitmap_markov(len, 4.0, 0.5);
+      for (std::size_t pos = 0; pos < len; ++pos) {
+        dtl::teb_wrapper enc(bm_initial);
+        auto expected = bm_initial;
+        const auto res = enc.update(pos, !bm_initial[pos], nullptr);
+        ASSERT_NE(0, res);
+        if (res == 1) expected[pos] = !bm_initial[pos];
+        validate(expected, enc);
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Apply a sequence of random updates to TEBs with reserved space.
+TEST(inplace_update, random_updates_with_slack) {
+  std::mt19937 gen(42);
+  std::size_t inplace_cnt = 0;
+  for (auto len = 1024; len <= 8192 * 2; len *= 2) {
+    for (auto d : {0.01, 0.1, 0.5}) {
+      const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, d);
+      dtl::teb_wrapper enc(bm_initial, dtl::teb_slack { 0.25, 256 });
+      ASSERT_EQ(bm_initial, dtl::to_bitmap_using_iterator(enc));
+      auto expected = bm_initial;
+      for (std::size_t u = 0; u < 1000; ++u) {
+        const std::size_t pos = gen() % len;
+        const $u1 val = gen() % 2;
+        const auto res = enc.update(pos, val, nullptr);
+        if (res == 2) continue;
+        inplace_cnt += res;
+        expected[pos] = val;
+      }
+      validate(expected, enc);
+    }
+  }
+  ASSERT_GT(inplace_cnt, 0);
+}
+//===----------------------------------------------------------------------===//
+/// The reserved space increases the number of updates performed in place.
+TEST(inplace_update, slack) {
+  const std::size_t len = 1ull << 16;
+  const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  dtl::teb_wrapper enc(bm_initial);
+  dtl::teb_wrapper enc_slack(bm_initial, dtl::teb_slack { 0.25, 256 });
+  ASSERT_GT(enc_slack.size_in_bytes(), enc.size_in_bytes());
+  ASSERT_EQ(bm_initial, dtl::to_bitmap_using_iterator(enc_slack));
+
+  std::mt19937 gen(42);
+  std::size_t inplace_cnt = 0;
+  std::size_t inplace_cnt_slack = 0;
+  for (std::size_t u = 0; u < 1000; ++u) {
+    const std::size_t pos = gen() % len;
+    const $u1 val = gen() % 2;
+    inplace_cnt += enc.update(pos, val, nullptr) == 1;
+    inplace_cnt_slack += enc_slack.update(pos, val, nullptr) == 1;
+  }
+  ASSERT_GT(inplace_cnt_slack, inplace_cnt);
+}
+//===----------------------------------------------------------------------===//
+/// Run-forming updates followed by incremental pruning of the dirty subtrees.
+TEST(inplace_update, prune_dirty) {
+  std::mt19937 gen(42);
+  for (auto len = 256; len <= 8192; len *= 4) {
+    for (std::size_t prune_interval : {1, 10, 100}) {
+      const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.3);
+      dtl::teb_wrapper enc(bm_initial, dtl::teb_slack { 0.25, 256 });
+      dtl::teb_wrapper enc_unpruned(bm_initial, dtl::teb_slack { 0.25, 256 });
+      auto expected = bm_initial;
+      for (std::size_t u = 0; u < 1000; ++u) {
+        // Copy the value of the sibling bit, which allows for pruning.
+        const std::size_t pos = gen() % len;
+        const $u1 val = expected[pos ^ 1];
+        const auto res = enc.update(pos, val, nullptr);
+        ASSERT_EQ(res, enc_unpruned.update(pos, val, nullptr));
+        if (res == 2) continue;
+        expected[pos] = val;
+        if (u % prune_interval == 0) {
+          enc.prune_dirty();
+          ASSERT_FALSE(enc.teb_->is_dirty());
+        }
+      }
+      enc.prune_dirty();
+      validate(expected, enc);
+      ASSERT_LT(node_cnt(enc), node_cnt(enc_unpruned));
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Multi-threaded pruning after run-forming updates.
+TEST(inplace_update, prune_parallel) {
+  std::mt19937 gen(42);
+  for (auto len = 1024; len <= 1024 * 64; len *= 4) {
+    for (auto d : {0.01, 0.1, 0.5}) {
+      const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, d);
+      dtl::teb_wrapper enc(bm_initial, dtl::teb_slack { 0.25, 256 });
+      auto expected = bm_initial;
+      for (std::size_t u = 0; u < 1000; ++u) {
+        const std::size_t pos = gen() % len;
+        const $u1 val = expected[pos ^ 1];
+        if (enc.update(pos, val, nullptr) != 2) expected[pos] = val;
+      }
+      for (std::size_t thread_cnt : {1, 4}) {
+        dtl::teb_wrapper pruned(enc);
+        pruned.prune_parallel(thread_cnt);
+        validate(expected, pruned);
+        ASSERT_LE(node_cnt(pruned), node_cnt(enc));
+        ASSERT_EQ(enc.teb_->perfect_level_cnt_, pruned.teb_->perfect_level_cnt_);
+        // The pruned TEB remains updatable.
+        auto expected_after_update = expected;
+        for (std::size_t u = 0; u < 100; ++u) {
+          const std::size_t pos = gen() % len;
+          const $u1 val = gen() % 2;
+          if (pruned.update(pos, val, nullptr) != 2) {
+            expected_after_update[pos] = val;
+          }
+        }
+        validate(expected_after_update, pruned);
+      }
+      // The original TEB is not affected.
+      validate(expected, enc);
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// The serialized TEB is re-allocated when it runs out of free bits.
+TEST(inplace_update, growth) {
+  std::mt19937 gen(42);
+  for (auto len = 1024; len <= 8192 * 2; len *= 4) {
+    for (auto d : {0.01, 0.1, 0.5}) {
+      const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, d);
+      dtl::teb_wrapper enc(bm_initial);
+      dtl::teb_wrapper enc_growing(bm_initial);
+      enc_growing.set_growth_factor(1.5);
+      auto expected = bm_initial;
+      std::size_t out_of_space_cnt = 0;
+      for (std::size_t u = 0; u < 1000; ++u) {
+        const std::size_t pos = gen() % len;
+        const $u1 val = gen() % 2;
+        if (enc.update(pos, val, nullptr) == 2) {
+          out_of_space_cnt += enc.teb_->missing_bits_T_ + enc.teb_->missing_bits_L_ > 0;
+        }
+        const auto res = enc_growing.update(pos, val, nullptr);
+        if (res == 2) {
+          // Only updates that are not caused by a lack of space may fail.
+          ASSERT_EQ(0, enc_growing.teb_->missing_bits_T_);
+          ASSERT_EQ(0, enc_growing.teb_->missing_bits_L_);
+          continue;
+        }
+        expected[pos] = val;
+      }
+      validate(expected, enc_growing);
+      if (out_of_space_cnt > 0) {
+        ASSERT_GT(enc_growing.size_in_bytes(), enc.size_in_bytes());
+      }
+
+      // Release the reserved space.
+      const auto size_before = enc_growing.size_in_bytes();
+      enc_growing.shrink_to_fit();
+      ASSERT_LE(enc_growing.size_in_bytes(), size_before);
+      ASSERT_LT(enc_growing.tree_bit_capacity(),
+          enc_growing.teb_->tree_bit_cnt_ + 64);
+      validate(expected, enc_growing);
+      for (std::size_t u = 0; u < 100; ++u) {
+        const std::size_t pos = gen() % len;
+        const $u1 val = gen() % 2;
+        if (enc_growing.update(pos, val, nullptr) != 2) expected[pos] = val;
+      }
+      validate(expected, enc_growing);
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Increase the size of the bitmap, within and beyond the capacity of the tree.
+TEST(inplace_update, grow) {
+  std::mt19937 gen(42);
+  for (std::size_t len : {1000, 1024, 5000}) {
+    for (auto d : {0.0, 0.01, 0.1, 0.5, 1.0}) {
+      for (std::size_t new_len : {len + 16, 2 * len + 6, 5 * len}) {
+        auto bm = dtl::gen_random_bitmap_markov(len, 8.0, d);
+        if (d == 1.0) bm.set();
+        dtl::teb_wrapper enc(bm);
+        enc.grow(new_len);
+        auto expected = bm;
+        expected.resize(new_len);
+        ASSERT_EQ(new_len, enc.size());
+        validate(expected, enc);
+        // The grown TEB remains updatable.
+        enc.set_growth_factor(2.0);
+        for (std::size_t u = 0; u < 100; ++u) {
+          const std::size_t pos = gen() % new_len;
+          const $u1 val = gen() % 2;
+          if (enc.update(pos, val, nullptr) != 2) expected[pos] = val;
+        }
+        validate(expected, enc);
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Append batches of bits to a TEB.
+TEST(inplace_update, append) {
+  std::mt19937 gen(42);
+  for (auto d : {0.01, 0.1, 0.5}) {
+    dtl::bitmap expected(64);
+    dtl::teb_wrapper enc(expected);
+    for (std::size_t batch = 0; batch < 20; ++batch) {
+      const std::size_t batch_len = 2 * (1 + gen() % 512);
+      const auto rows = dtl::gen_random_bitmap_markov(batch_len, 8.0, d);
+      enc.append(rows);
+      const auto offset = expected.size();
+      expected.resize(offset + batch_len);
+      for (std::size_t i = 0; i < batch_len; ++i) {
+        expected[offset + i] = rows[i];
+      }
+      ASSERT_EQ(expected.size(), enc.size());
+      validate(expected, enc);
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Merge the pending updates using in-place updates. Large diffs fall back to
+/// a rebuild.
+TEST(inplace_update, merge_inplace_teb) {
+  using M = dtl::merge_inplace_teb<dtl::teb_wrapper,
+      dtl::dynamic_roaring_bitmap>;
+  std::mt19937 gen(42);
+  for (auto len = 1024; len <= 8192 * 2; len *= 2) {
+    for (std::size_t update_cnt : {1, 10, 100, 1000}) {
+      const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+      diff_teb enc(bm_initial);
+      auto expected = bm_initial;
+      for (std::size_t i = 0; i < 3; ++i) {
+        for (std::size_t u = 0; u < update_cnt; ++u) {
+          const std::size_t pos = gen() % len;
+          const $u1 val = gen() % 2;
+          enc.set(pos, val);
+          expected[pos] = val;
+        }
+        if (update_cnt <= 10) {
+          ASSERT_TRUE(M::prefer_inplace(*enc.get_bitmap(), *enc.get_diff()));
+        }
+        enc.template merge<M>();
+        ASSERT_TRUE(enc.get_diff()->it().end());
+        validate(expected, *enc.get_bitmap());
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// The re-encoding of a TEB, which is the fallback of the in-place merge,
+/// retains the reserved space and the growth factor.
+TEST(inplace_update, reencode_retains_slack) {
+  const std::size_t len = 1ull << 14;
+  const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  dtl::teb_wrapper enc(bm_initial, dtl::teb_slack { 0.5, 0 });
+  enc.growth_factor_ = 2.0;
+  const auto bm_updated = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  enc.reencode(bm_updated);
+  validate(bm_updated, enc);
+  ASSERT_EQ(2.0, enc.growth_factor_);
+  const auto tree_bit_cnt = enc.teb_->tree_bit_cnt_;
+  ASSERT_GE(enc.tree_bit_capacity(), tree_bit_cnt + tree_bit_cnt / 2);
+}
+//===----------------------------------------------------------------------===//
+/// Updates of partitioned TEBs, which are performed in place if possible.
+TEST(inplace_update, part_updirect) {
+  using T = dtl::part_updirect<dtl::teb_wrapper, 1ull << 10>;
+  std::mt19937 gen(42);
+  for (auto len = 1024; len <= 8192 * 2; len *= 2) {
+    const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+    T enc(bm_initial);
+    auto expected = bm_initial;
+    for (std::size_t u = 0; u < 2000; ++u) {
+      const std::size_t pos = gen() % len;
+      const $u1 val = gen() % 2;
+      enc.set(pos, val);
+      expected[pos] = val;
+      ASSERT_EQ(val, enc.test(pos));
+    }
+    ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(enc));
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Updates of partitioned differential TEBs, which do not support in-place
+/// updates.
+TEST(inplace_update, part_updirect_diff) {
+  using T = dtl::part_updirect<diff_teb, 1ull << 10>;
+  std::mt19937 gen(42);
+  for (auto len = 1024; len <= 8192 * 2; len *= 2) {
+    const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+    T enc(bm_initial);
+    auto expected = bm_initial;
+    for (std::size_t u = 0; u < 2000; ++u) {
+      const std::size_t pos = gen() % len;
+      const $u1 val = gen() % 2;
+      enc.set(pos, val);
+      expected[pos] = val;
+      ASSERT_EQ(val, enc.test(pos));
+    }
+    ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(enc));
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Hybrid updates of partitioned differential TEBs.
+TEST(inplace_update, part_upforward) {
+  using T = dtl::part_upforward<diff_teb, 1ull << 10>;
+  using M = dtl::merge_naive_iter<dtl::teb_wrapper, dtl::dynamic_roaring_bitmap>;
+  std::mt19937 gen(42);
+  for (auto len = 1024; len <= 8192 * 2; len *= 2) {
+    const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+    T enc(bm_initial);
+    auto expected = bm_initial;
+    for (std::size_t i = 0; i < 4; ++i) {
+      for (std::size_t u = 0; u < 500; ++u) {
+        const std::size_t pos = gen() % len;
+        const $u1 val = gen() % 2;
+        enc.set(pos, val);
+        expected[pos] = val;
+      }
+      ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(enc));
+      enc.template merge<M>();
+      ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(enc));
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
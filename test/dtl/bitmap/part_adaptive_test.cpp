@@ -0,0 +1,173 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/part/part_adaptive.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+//===----------------------------------------------------------------------===//
+// Tests for the adaptive (per-partition) encoding.
+//===----------------------------------------------------------------------===//
+static constexpr std::size_t P = 1ull << 12;
+using part_t = dtl::part_adaptive<P>;
+//===----------------------------------------------------------------------===//
+/// Returns a bitmap where each partition has a different characteristic.
+static dtl::bitmap
+gen_mixed_bitmap() {
+  std::mt19937 gen(42);
+  dtl::bitmap bm(7 * P - 100);
+  // Partition 0 is empty.
+  // Partition 1 is full.
+  for (std::size_t i = P; i < 2 * P; ++i) bm[i] = true;
+  // Partition 2 is very sparse.
+  for (std::size_t i = 2 * P + 17; i < 3 * P; i += 997) bm[i] = true;
+  // Partition 3 is random with a density of 0.5.
+  for (std::size_t i = 3 * P; i < 4 * P; ++i) bm[i] = gen() & 1;
+  // Partition 4 consists of a few long runs.
+  for (std::size_t i = 4 * P + 100; i < 4 * P + 1500; ++i) bm[i] = true;
+  for (std::size_t i = 4 * P + 2001; i < 4 * P + 3333; ++i) bm[i] = true;
+  // Partition 5 is clustered.
+  const auto clustered = dtl::gen_random_bitmap_markov(P, 16.0, 0.2);
+  for (std::size_t i = 0; i < P; ++i) bm[5 * P + i] = clustered[i];
+  // Partition 6 is incomplete and dense.
+  for (std::size_t i = 6 * P; i < bm.size(); ++i) bm[i] = (i % 7) != 0;
+  return bm;
+}
+//===----------------------------------------------------------------------===//
+template<typename it_t>
+static dtl::bitmap
+decode(it_t&& it, std::size_t n) {
+  dtl::bitmap bm(n);
+  while (!it.end()) {
+    for (std::size_t i = it.pos(); i < it.pos() + it.length(); ++i) {
+      bm[i] = true;
+    }
+    it.next();
+  }
+  return bm;
+}
+//===----------------------------------------------------------------------===//
+TEST(part_adaptive, encoding_choice) {
+  const auto bm = gen_mixed_bitmap();
+  part_t enc(bm);
+  ASSERT_EQ(enc.partition_cnt(), 7);
+  ASSERT_EQ(enc.encoding_of(0), dtl::part_encoding::ZEROS);
+  ASSERT_EQ(enc.encoding_of(1), dtl::part_encoding::ONES);
+  ASSERT_EQ(enc.encoding_of(2), dtl::part_encoding::POSITION_LIST);
+  ASSERT_EQ(enc.encoding_of(3), dtl::part_encoding::PLAIN);
+  ASSERT_EQ(enc.encoding_of(4), dtl::part_encoding::RANGE_LIST);
+
+  // Never larger than any of the homogeneous alternatives (apart from the
+  // partition meta data).
+  std::size_t part_size = 0;
+  for (std::size_t p = 0; p < enc.partition_cnt(); ++p) {
+    dtl::bitmap b(P);
+    for (std::size_t i = p * P; i < std::min((p + 1) * P, bm.size()); ++i) {
+      b[i % P] = bm[i];
+    }
+    if (b.none() || b.all()) continue;
+    part_size += std::min({
+        part_t::teb_type(b).size_in_bytes(),
+        part_t::roaring_type(b).size_in_bytes(),
+        part_t::range_list_type(b).size_in_bytes(),
+        part_t::position_list_type(b).size_in_bytes(),
+        part_t::plain_type(b).size_in_bytes()});
+  }
+  // The estimates are not exact.
+  ASSERT_LE(enc.size_in_bytes(),
+      part_size * 1.1 + enc.partition_cnt() * (1 + sizeof(void*)));
+}
+//===----------------------------------------------------------------------===//
+TEST(part_adaptive, size_tolerance) {
+  const auto bm = gen_mixed_bitmap();
+  part_t smallest(bm);
+  part_t fastest(bm, 1e6);
+  // With an (almost) unlimited tolerance, all partitions that require a
+  // bitmap instance are encoded as range lists.
+  for (std::size_t p = 0; p < fastest.partition_cnt(); ++p) {
+    const auto e = smallest.encoding_of(p);
+    if (e == dtl::part_encoding::ZEROS || e == dtl::part_encoding::ONES) {
+      ASSERT_EQ(fastest.encoding_of(p), e);
+    }
+    else {
+      ASSERT_EQ(fastest.encoding_of(p), dtl::part_encoding::RANGE_LIST);
+    }
+  }
+  ASSERT_LE(smallest.size_in_bytes(), fastest.size_in_bytes());
+  ASSERT_EQ(bm, decode(fastest.it(), bm.size()));
+}
+//===----------------------------------------------------------------------===//
+TEST(part_adaptive, decode) {
+  const auto bm = gen_mixed_bitmap();
+  part_t enc(bm);
+  ASSERT_EQ(bm, decode(enc.it(), bm.size()));
+  ASSERT_EQ(bm, decode(enc.scan_it(), bm.size()));
+  ASSERT_EQ(bm, dtl::to_bitmap_using_iterator(enc));
+  for (std::size_t i = 0; i < bm.size(); ++i) {
+    ASSERT_EQ(bm[i], enc.test(i)) << "i=" << i;
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(part_adaptive, skip) {
+  const auto bm = gen_mixed_bitmap();
+  part_t enc(bm);
+  for (std::size_t step : {1, 13, 64, 1000, 4096, 5000}) {
+    auto it = enc.it();
+    for (std::size_t to = 0; to < bm.size() && !it.end(); to += step) {
+      it.skip_to(to);
+      if (it.end()) {
+        ASSERT_EQ(bm.find_next(to - 1), dtl::bitmap::npos);
+        break;
+      }
+      const auto expected = bm[to] ? to : bm.find_next(to);
+      ASSERT_EQ(expected, it.pos()) << "step=" << step << ", to=" << to;
+      // Note: Runs that span multiple partitions are split.
+      for (std::size_t i = it.pos(); i < it.pos() + it.length(); ++i) {
+        ASSERT_TRUE(bm[i]) << "step=" << step << ", to=" << to;
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(part_adaptive, update) {
+  auto bm = gen_mixed_bitmap();
+  part_t enc(bm);
+  auto set = [&](std::size_t i, u1 val) {
+    bm[i] = val;
+    enc.set(i, val);
+  };
+  // Add a run to the sparse partition.
+  for (std::size_t i = 2 * P + 100; i < 2 * P + 400; ++i) set(i, true);
+  ASSERT_EQ(enc.encoding_of(2), dtl::part_encoding::RANGE_LIST);
+  ASSERT_EQ(bm, decode(enc.scan_it(), bm.size()));
+  // Clear the sparse partition.
+  for (std::size_t i = 2 * P; i < 3 * P; ++i) {
+    if (bm[i]) set(i, false);
+  }
+  ASSERT_EQ(enc.encoding_of(2), dtl::part_encoding::ZEROS);
+  // Break the run in the full partition.
+  set(P + 1234, false);
+  ASSERT_NE(enc.encoding_of(1), dtl::part_encoding::ONES);
+  ASSERT_FALSE(enc.test(P + 1234));
+  set(P + 1234, true);
+  ASSERT_EQ(enc.encoding_of(1), dtl::part_encoding::ONES);
+  // Set a single bit in the empty partition.
+  set(42, true);
+  ASSERT_EQ(enc.encoding_of(0), dtl::part_encoding::POSITION_LIST);
+  ASSERT_EQ(bm, decode(enc.scan_it(), bm.size()));
+}
+//===----------------------------------------------------------------------===//
+TEST(part_adaptive, random) {
+  for (auto len : {64, 1000, 4096, 10000, 50000}) {
+    for (auto d : {0.0, 0.001, 0.1, 0.5, 0.9, 1.0}) {
+      const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, d);
+      part_t enc(bm);
+      ASSERT_EQ(bm, decode(enc.it(), bm.size()))
+          << "len=" << len << ", d=" << d;
+      ASSERT_EQ(bm, decode(enc.scan_it(), bm.size()))
+          << "len=" << len << ", d=" << d;
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
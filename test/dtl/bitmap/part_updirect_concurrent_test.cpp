@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/part/part_updirect_concurrent.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the concurrent update path of partitioned bitmaps.
+//===----------------------------------------------------------------------===//
+using part_t = dtl::part_updirect_concurrent<dtl::teb_wrapper, 1ull << 10>;
+//===----------------------------------------------------------------------===//
+TEST(part_updirect_concurrent, batched_updates) {
+  const std::size_t len = 1ull << 14;
+  for (auto d : {0.001, 0.01, 0.1, 0.5}) {
+    dtl::bitmap bm = dtl::gen_random_bitmap_markov(len, 8.0, d);
+    part_t enc(bm);
+    ASSERT_EQ(bm, dtl::to_bitmap_using_iterator(enc));
+
+    dtl::bitmap expected = bm;
+    std::vector<std::pair<std::size_t, $u1>> updates;
+    std::mt19937 gen(42);
+    for (std::size_t i = 0; i < 1000; ++i) {
+      const std::size_t pos = gen() % len;
+      const $u1 val = gen() % 2;
+      updates.emplace_back(pos, val);
+      expected[pos] = val;
+    }
+    enc.set(updates.begin(), updates.end());
+    ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(enc));
+    for (std::size_t i = 0; i < len; ++i) {
+      ASSERT_EQ(expected[i], enc.test(i));
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Multiple writers update disjoint sets of positions, using point updates and
+/// batched updates.
+TEST(part_updirect_concurrent, concurrent_writers) {
+  const std::size_t len = 1ull << 16;
+  const std::size_t thread_cnt = 4;
+  dtl::bitmap bm = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  part_t enc(bm);
+
+  // Each thread flips every thread_cnt-th bit, i.e., all threads work on all
+  // partitions.
+  std::vector<std::thread> writers;
+  for (std::size_t t = 0; t < thread_cnt; ++t) {
+    writers.emplace_back([&, t]() {
+      std::vector<std::pair<std::size_t, $u1>> batch;
+      for (std::size_t i = t; i < len; i += thread_cnt * 7) {
+        if ((i / thread_cnt) % 2 == 0) {
+          enc.set(i, !bm[i]);
+        }
+        else {
+          batch.emplace_back(i, !bm[i]);
+          if (batch.size() == 64) {
+            enc.set(batch.begin(), batch.end());
+            batch.clear();
+          }
+        }
+      }
+      enc.set(batch.begin(), batch.end());
+    });
+  }
+  for (auto& w : writers) w.join();
+
+  dtl::bitmap expected = bm;
+  for (std::size_t i = 0; i < len; ++i) {
+    if ((i % (thread_cnt * 7)) < thread_cnt) {
+      expected[i] = !bm[i];
+    }
+  }
+  ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(enc));
+}
+//===----------------------------------------------------------------------===//
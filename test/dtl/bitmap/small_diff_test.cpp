@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/diff/diff.hpp>
+#include <dtl/bitmap/diff/merge.hpp>
+#include <dtl/bitmap/diff/small_diff.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+//===----------------------------------------------------------------------===//
+// Tests for the differential data structure for small diffs.
+//===----------------------------------------------------------------------===//
+/// Validates the point lookups and the run iterator against the given bitmap.
+void validate(const dtl::small_diff& diff, const dtl::bitmap& expected) {
+  ASSERT_EQ(expected.count(), diff.count());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(expected[i], diff.test(i)) << "i=" << i;
+  }
+  ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(diff));
+  ASSERT_EQ(expected, diff.to_bitset());
+
+  // Skip to random positions.
+  std::mt19937 gen(42);
+  for (std::size_t rep = 0; rep < 100; ++rep) {
+    const std::size_t to_pos = gen() % expected.size();
+    auto it = diff.it();
+    it.skip_to(to_pos);
+    auto expected_pos = expected.find_next(to_pos - 1);
+    if (to_pos == 0) expected_pos = expected.find_first();
+    if (expected_pos == dtl::bitmap::npos) {
+      ASSERT_TRUE(it.end()) << "to_pos=" << to_pos;
+      continue;
+    }
+    ASSERT_EQ(expected_pos, it.pos()) << "to_pos=" << to_pos;
+    ASSERT_TRUE(expected[it.pos() + it.length() - 1]);
+    ASSERT_TRUE(it.pos() + it.length() == expected.size()
+        || !expected[it.pos() + it.length()]);
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(small_diff, random_set_and_clear) {
+  std::mt19937 gen(42);
+  for (std::size_t len : {1, 63, 64, 65, 1000, 4096}) {
+    dtl::small_diff diff(len);
+    dtl::bitmap expected(len);
+    for (std::size_t i = 0; i < 4 * len; ++i) {
+      const std::size_t pos = gen() % len;
+      // Insert more than delete, to eventually switch to the dense
+      // representation.
+      const u1 val = (gen() % 4) != 0;
+      diff.set(pos, val);
+      diff.shrink();
+      expected[pos] = val;
+      if (i % 97 == 0) validate(diff, expected);
+    }
+    validate(diff, expected);
+    if (len >= 64) {
+      // Most of the bits are set.
+      ASSERT_NE(std::string::npos, diff.info().find("\"dense\":true"));
+    }
+
+    // Clear everything, which switches back to the sparse representation.
+    for (std::size_t i = 0; i < len; ++i) {
+      diff.set(i, false);
+      diff.shrink();
+    }
+    expected.reset();
+    validate(diff, expected);
+    ASSERT_TRUE(diff.it().end());
+    ASSERT_NE(std::string::npos, diff.info().find("\"dense\":false"));
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(small_diff, hybrid_updates) {
+  using diff_t = dtl::diff<dtl::teb_wrapper, dtl::small_diff>;
+  using merge_t = dtl::merge_naive_iter<dtl::teb_wrapper, dtl::small_diff>;
+  std::mt19937 gen(42);
+  for (auto len = 1024; len <= 8192 * 2; len *= 2) {
+    const auto bm_initial = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+    diff_t enc(bm_initial, dtl::teb_slack{0.1, 64});
+    auto plain = bm_initial;
+
+    for (std::size_t i = 0; i < 5; ++i) {
+      for (std::size_t j = 0; j < 200; ++j) {
+        const std::size_t pos = gen() % len;
+        const u1 val = !plain[pos];
+        enc.update(pos, val);
+        plain[pos] = val;
+        ASSERT_EQ(val, enc.test(pos));
+      }
+      ASSERT_EQ(plain, dtl::to_bitmap_using_iterator(enc));
+      enc.template merge<merge_t>();
+      ASSERT_TRUE(enc.get_diff()->it().end());
+      ASSERT_EQ(plain, dtl::to_bitmap_using_iterator(enc));
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
@@ -0,0 +1,141 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/teb_handle.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the versioned (copy-on-write) TEB handle.
+//===----------------------------------------------------------------------===//
+using handle_t = dtl::teb_handle<1ull << 10>;
+//===----------------------------------------------------------------------===//
+TEST(teb_handle, snapshot_isolation) {
+  const std::size_t len = 1ull << 14;
+  for (auto d : {0.001, 0.01, 0.1, 0.5}) {
+    dtl::bitmap bm = dtl::gen_random_bitmap_markov(len, 8.0, d);
+    handle_t handle(bm);
+
+    auto s0 = handle.pin();
+    ASSERT_EQ(bm, dtl::to_bitmap_using_iterator(s0));
+
+    // Apply a batch of random updates.
+    dtl::bitmap expected = bm;
+    std::vector<std::pair<std::size_t, $u1>> updates;
+    std::mt19937 gen(42);
+    for (std::size_t i = 0; i < 100; ++i) {
+      const std::size_t pos = gen() % len;
+      const $u1 val = gen() % 2;
+      updates.emplace_back(pos, val);
+      expected[pos] = val;
+    }
+    handle.set(updates.begin(), updates.end());
+
+    // The pinned version must not change.
+    ASSERT_EQ(bm, dtl::to_bitmap_using_iterator(s0));
+    for (std::size_t i = 0; i < len; ++i) {
+      ASSERT_EQ(bm[i], s0.test(i));
+    }
+
+    // A new snapshot reflects the updates.
+    auto s1 = handle.pin();
+    ASSERT_GT(s1.version_no(), s0.version_no());
+    ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(s1));
+    for (std::size_t i = 0; i < len; ++i) {
+      ASSERT_EQ(expected[i], s1.test(i));
+    }
+
+    // Point updates.
+    for (std::size_t i = 0; i < 100; ++i) {
+      const std::size_t pos = gen() % len;
+      const $u1 val = gen() % 2;
+      handle.set(pos, val);
+      expected[pos] = val;
+    }
+    auto s2 = handle.pin();
+    ASSERT_EQ(expected, dtl::to_bitmap_using_iterator(s2));
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_handle, skip) {
+  const std::size_t len = 1ull << 14;
+  dtl::bitmap bm = dtl::gen_random_bitmap_markov(len, 4.0, 0.05);
+  handle_t handle(bm);
+  auto s = handle.pin();
+  for (std::size_t to_pos = 0; to_pos < len; to_pos += 97) {
+    auto it = s.it();
+    if (it.end()) break;
+    // Skipping is only allowed in forward direction.
+    if (it.pos() < to_pos) {
+      it.skip_to(to_pos);
+    }
+    // Determine the expected position.
+    std::size_t expected_pos = to_pos;
+    while (expected_pos < len && !bm[expected_pos]) ++expected_pos;
+    if (expected_pos == len) {
+      ASSERT_TRUE(it.end());
+    }
+    else {
+      ASSERT_FALSE(it.end());
+      ASSERT_EQ(expected_pos, it.pos());
+      ASSERT_TRUE(bm[it.pos() + it.length() - 1]);
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_handle, reclamation) {
+  const std::size_t len = 1ull << 12;
+  dtl::bitmap bm(len);
+  handle_t handle(bm);
+  {
+    auto s = handle.pin();
+    handle.set(1, true);
+    handle.set(2, true);
+    // The initial version is still pinned.
+    ASSERT_GT(handle.retired_version_cnt(), 0);
+    ASSERT_FALSE(s.test(1));
+  }
+  handle.reclaim();
+  ASSERT_EQ(handle.retired_version_cnt(), 0);
+}
+//===----------------------------------------------------------------------===//
+/// A single writer sets one bit after the other, while multiple readers
+/// validate that each snapshot is consistent, i.e., the version number equals
+/// the number of set bits.
+TEST(teb_handle, concurrent_readers) {
+  const std::size_t len = 1ull << 14;
+  const std::size_t update_cnt = 512;
+  dtl::bitmap bm(len);
+  handle_t handle(bm);
+
+  std::atomic<$u1> done(false);
+  std::atomic<$u64> error_cnt(0);
+  std::vector<std::thread> readers;
+  for (std::size_t t = 0; t < 4; ++t) {
+    readers.emplace_back([&]() {
+      while (!done) {
+        auto s = handle.pin();
+        std::size_t bit_cnt = 0;
+        auto it = s.scan_it();
+        while (!it.end()) {
+          bit_cnt += it.length();
+          it.next();
+        }
+        if (bit_cnt != s.version_no()) ++error_cnt;
+      }
+    });
+  }
+  for (std::size_t i = 0; i < update_cnt; ++i) {
+    handle.set((i * 31) % len, true);
+  }
+  done = true;
+  for (auto& r : readers) r.join();
+  ASSERT_EQ(error_cnt, 0);
+  ASSERT_EQ(handle.pin().version_no(), update_cnt);
+}
+//===----------------------------------------------------------------------===//
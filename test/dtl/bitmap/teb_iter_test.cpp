@@ -0,0 +1,138 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/bitwise_operations.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the batched skip support of the TEB skip iterator.
+//===----------------------------------------------------------------------===//
+/// Returns the expected iterator position after skipping to 'to_pos'.
+static std::size_t
+expected_pos(const dtl::bitmap& bm, std::size_t to_pos) {
+  while (to_pos < bm.size() && !bm[to_pos]) ++to_pos;
+  return to_pos;
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_iter, skip_to_many) {
+  const std::size_t len = 1ull << 16;
+  const std::size_t cnt = dtl::teb_iter::skip_to_many_max_cnt;
+  std::mt19937 gen(42);
+  for (auto d : {0.001, 0.01, 0.1, 0.5}) {
+    std::vector<dtl::bitmap> bms;
+    std::vector<dtl::teb_wrapper> tebs;
+    for (std::size_t k = 0; k < cnt; ++k) {
+      bms.push_back(dtl::gen_random_bitmap_markov(len, 8.0, d));
+    }
+    for (std::size_t k = 0; k < cnt; ++k) {
+      tebs.emplace_back(bms[k]);
+    }
+    std::vector<dtl::teb_iter> iters;
+    for (std::size_t k = 0; k < cnt; ++k) {
+      iters.push_back(tebs[k].it());
+    }
+    std::vector<dtl::teb_iter*> iter_ptrs;
+    for (auto& it : iters) iter_ptrs.push_back(&it);
+
+    std::vector<std::size_t> to_pos(cnt, 0);
+    for (std::size_t round = 0; round < 1000; ++round) {
+      // Determine the destination positions (forward only).
+      std::size_t active_cnt = 0;
+      for (std::size_t k = 0; k < cnt; ++k) {
+        if (iters[k].end()) continue;
+        to_pos[active_cnt] = iters[k].pos() + 1 + gen() % (len >> 6);
+        iter_ptrs[active_cnt] = &iters[k];
+        ++active_cnt;
+      }
+      if (active_cnt == 0) break;
+      dtl::teb_iter::skip_to_many(iter_ptrs.data(), to_pos.data(), active_cnt);
+
+      for (std::size_t i = 0; i < active_cnt; ++i) {
+        const auto k = static_cast<std::size_t>(iter_ptrs[i] - iters.data());
+        const auto exp = expected_pos(bms[k], to_pos[i]);
+        if (exp >= len) {
+          ASSERT_TRUE(iters[k].end());
+        }
+        else {
+          ASSERT_FALSE(iters[k].end());
+          ASSERT_EQ(exp, iters[k].pos());
+          ASSERT_TRUE(bms[k][iters[k].pos() + iters[k].length() - 1]);
+        }
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Nested intersections forward both input iterators at once.
+TEST(teb_iter, nested_intersection) {
+  const std::size_t len = 1ull << 16;
+  for (auto d : {0.01, 0.1, 0.5}) {
+    const auto a = dtl::gen_random_bitmap_markov(len, 8.0, d);
+    const auto b = dtl::gen_random_bitmap_markov(len, 8.0, d);
+    const auto c = dtl::gen_random_bitmap_markov(len, 4.0, 0.01);
+    dtl::teb_wrapper enc_a(a);
+    dtl::teb_wrapper enc_b(b);
+    dtl::teb_wrapper enc_c(c);
+    auto it = dtl::bitwise_and_it(enc_c.it(),
+        dtl::bitwise_and_it(enc_a.it(), enc_b.it()));
+    ASSERT_EQ(a & b & c, dtl::to_bitmap_from_iterator(it, len));
+
+    auto or_it = dtl::bitwise_or_it(enc_a.it(), enc_b.it());
+    ASSERT_EQ(a | b, dtl::to_bitmap_from_iterator(or_it, len));
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Decodes TEBs into position lists in batches of varying size.
+TEST(teb_iter, to_positions) {
+  std::mt19937 gen(42);
+  for (auto len : {2u, 100u, 1000u, 1u << 16}) {
+    for (auto d : {0.001, 0.01, 0.1, 0.5, 1.0}) {
+      const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, d);
+      dtl::teb_wrapper enc(bm);
+      std::vector<$u32> expected;
+      for (auto i = bm.find_first(); i != dtl::bitmap::npos;
+           i = bm.find_next(i)) {
+        expected.push_back(static_cast<$u32>(i));
+      }
+
+      for (std::size_t batch_size : {1u, 7u, 16u, 1024u, 1u << 16}) {
+        std::vector<$u32> positions;
+        std::vector<$u32> batch(batch_size);
+        auto cursor = enc.scan_it();
+        while (true) {
+          const auto cnt = enc.to_positions(batch.data(), batch_size, cursor);
+          positions.insert(positions.end(), batch.begin(),
+              batch.begin() + cnt);
+          if (cnt < batch_size) break;
+        }
+        ASSERT_EQ(expected, positions) << "batch_size=" << batch_size;
+      }
+
+      // Range variant.
+      for (std::size_t rep = 0; rep < 10; ++rep) {
+        std::size_t b = gen() % len;
+        std::size_t e = b + gen() % (len - b + 1);
+        std::vector<$u32> expected_range;
+        for (auto p : expected) {
+          if (p >= b && p < e) expected_range.push_back(p);
+        }
+        std::vector<$u32> positions;
+        std::vector<$u32> batch(64);
+        auto cursor = enc.scan_it();
+        while (true) {
+          const auto cnt =
+              enc.to_positions(batch.data(), batch.size(), cursor, b, e);
+          positions.insert(positions.end(), batch.begin(),
+              batch.begin() + cnt);
+          if (cnt < batch.size()) break;
+        }
+        ASSERT_EQ(expected_range, positions) << "b=" << b << ", e=" << e;
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/bitmap_tree.hpp>
+#include <dtl/bitmap/util/convert.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+//===----------------------------------------------------------------------===//
+// Tests for lossy TEBs with a bounded false-positive rate.
+//===----------------------------------------------------------------------===//
+/// Validates that the lossy TEB does not contain false negatives and that the
+/// number of false positives is within the given bound.
+void validate(const dtl::teb_wrapper& teb, const dtl::bitmap& bm, f64 fpr) {
+  const auto decoded = dtl::to_bitmap_using_iterator(teb);
+  ASSERT_EQ(bm.size(), decoded.size());
+  // No false negatives.
+  ASSERT_TRUE((bm & ~decoded).none());
+  const auto false_positive_cnt = (decoded & ~bm).count();
+  const auto zero_cnt = bm.size() - bm.count();
+  ASSERT_LE(false_positive_cnt, fpr * zero_cnt);
+  ASSERT_EQ(false_positive_cnt > 0, teb.is_lossy());
+  // Point lookups are consistent with the iterators.
+  for (std::size_t i = 0; i < bm.size(); ++i) {
+    ASSERT_EQ(decoded[i], teb.test(i)) << "i=" << i;
+  }
+  auto scan_it = teb.scan_it();
+  ASSERT_EQ(decoded, dtl::to_bitmap_from_iterator(scan_it, bm.size()));
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_lossy, bounded_false_positive_rate) {
+  for (auto len : {2, 100, 1024, 1000, 8192, 10000}) {
+    for (auto d : {0.01, 0.1, 0.5}) {
+      const auto bm = dtl::gen_random_bitmap_markov(len, 4.0, d);
+      const dtl::teb_wrapper exact(bm);
+      ASSERT_FALSE(exact.is_lossy());
+      auto prev_size = exact.size_in_bytes();
+      for (auto fpr : {0.0, 0.001, 0.01, 0.1, 0.5, 1.0}) {
+        const dtl::teb_wrapper teb(bm, fpr);
+        validate(teb, bm, fpr);
+        // Larger false-positive rates do not increase the size, except for
+        // a (rare) additional word, when lossy pruning materializes formerly
+        // implicit labels.
+        ASSERT_LE(teb.size_in_bytes(), prev_size + sizeof(dtl::teb_word_type))
+            << "fpr=" << fpr;
+        prev_size = teb.size_in_bytes();
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_lossy, from_bitmap_tree) {
+  const std::size_t len = 1u << 14;
+  const auto bm = dtl::gen_random_bitmap_markov(len, 8.0, 0.1);
+  const f64 fpr = 0.05;
+  const dtl::teb_wrapper teb(dtl::bitmap_tree<>(bm), fpr);
+  validate(teb, bm, fpr);
+  ASSERT_LT(teb.size_in_bytes(), dtl::teb_wrapper(bm).size_in_bytes());
+}
+//===----------------------------------------------------------------------===//
@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/teb_probe.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <memory>
+#include <random>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the interleaved evaluation of many point lookups.
+//===----------------------------------------------------------------------===//
+TEST(teb_probe_executor, single_teb) {
+  std::mt19937 gen(42);
+  for (auto n : {2ull, 100ull, 1000ull, 1ull << 16, 100000ull}) {
+    for (auto d : {0.0, 0.01, 0.1, 0.5, 1.0}) {
+      const auto bm = dtl::gen_random_bitmap_markov(n, 8.0, d);
+      dtl::teb_wrapper enc(bm);
+      std::vector<dtl::teb_probe> probes;
+      for (std::size_t i = 0; i < 1000; ++i) {
+        probes.push_back(enc.probe(gen() % n));
+      }
+      for (std::size_t stream_cnt : {1, 2, 7, 64, 100}) {
+        std::unique_ptr<$u1[]> results(new $u1[probes.size()]);
+        dtl::teb_probe_executor::test(probes.data(), results.get(),
+            probes.size(), stream_cnt);
+        for (std::size_t i = 0; i < probes.size(); ++i) {
+          ASSERT_EQ(bm[probes[i].pos], results[i])
+              << "n=" << n << ", d=" << d << ", stream_cnt=" << stream_cnt;
+        }
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_probe_executor, many_tebs) {
+  std::mt19937 gen(42);
+  const std::size_t teb_cnt = 256;
+  const std::size_t n = 4096;
+  std::vector<dtl::bitmap> bitmaps;
+  std::vector<std::unique_ptr<dtl::teb_wrapper>> tebs;
+  for (std::size_t i = 0; i < teb_cnt; ++i) {
+    const auto d = (gen() % 100) / 100.0;
+    bitmaps.push_back(dtl::gen_random_bitmap_markov(n, 4.0, d));
+    tebs.emplace_back(std::make_unique<dtl::teb_wrapper>(bitmaps.back()));
+  }
+  std::vector<dtl::teb_probe> probes;
+  std::vector<std::size_t> teb_ids;
+  for (std::size_t i = 0; i < 10000; ++i) {
+    teb_ids.push_back(gen() % teb_cnt);
+    probes.push_back(tebs[teb_ids.back()]->probe(gen() % n));
+  }
+  std::unique_ptr<$u1[]> expected(new $u1[probes.size()]);
+  dtl::teb_probe_executor::test_sequential(probes.data(), expected.get(),
+      probes.size());
+  for (std::size_t stream_cnt = 1; stream_cnt <= 64; stream_cnt *= 2) {
+    std::unique_ptr<$u1[]> results(new $u1[probes.size()]);
+    dtl::teb_probe_executor::test(probes.data(), results.get(),
+        probes.size(), stream_cnt);
+    for (std::size_t i = 0; i < probes.size(); ++i) {
+      ASSERT_EQ(bitmaps[teb_ids[i]][probes[i].pos], expected[i]);
+      ASSERT_EQ(expected[i], results[i]) << "stream_cnt=" << stream_cnt;
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
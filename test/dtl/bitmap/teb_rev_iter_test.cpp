@@ -0,0 +1,138 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/bitwise_operations.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <random>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the reverse run iterator of TEBs.
+//===----------------------------------------------------------------------===//
+/// Decodes the given reverse iterator and validates the order of the 1-fills.
+template<typename iter_t>
+static dtl::bitmap
+decode_reverse(iter_t&& it, std::size_t n) {
+  dtl::bitmap ret(n);
+  std::size_t prev_pos = n;
+  while (!it.end()) {
+    EXPECT_LE(it.pos() + it.length(), prev_pos);
+    for (std::size_t i = it.pos(); i < it.pos() + it.length(); ++i) {
+      ret[i] = true;
+    }
+    prev_pos = it.pos();
+    it.prev();
+  }
+  return ret;
+}
+
+/// Returns the position of the last 1-bit before 'to_pos', or npos.
+static std::size_t
+last_one_before(const dtl::bitmap& bm, std::size_t to_pos) {
+  while (to_pos > 0) {
+    --to_pos;
+    if (bm[to_pos]) return to_pos;
+  }
+  return dtl::bitmap::npos;
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_rev_iter, iterate) {
+  for (auto n : {2ull, 100ull, 1000ull, 1ull << 16, 100000ull}) {
+    for (auto d : {0.0, 0.001, 0.01, 0.1, 0.5, 0.9, 1.0}) {
+      const auto bm = dtl::gen_random_bitmap_markov(n, 8.0, d);
+      dtl::teb_wrapper enc(bm);
+      ASSERT_EQ(bm, decode_reverse(enc.rev_it(), n))
+          << "n=" << n << ", d=" << d;
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_rev_iter, skip_to_before) {
+  std::mt19937 gen(42);
+  for (auto n : {1000ull, 1ull << 16, 100000ull}) {
+    for (auto d : {0.001, 0.01, 0.1, 0.5}) {
+      const auto bm = dtl::gen_random_bitmap_markov(n, 8.0, d);
+      dtl::teb_wrapper enc(bm);
+      auto it = enc.rev_it();
+      std::size_t to_pos = n;
+      while (!it.end()) {
+        to_pos -= std::min(to_pos, std::size_t(1 + gen() % (n >> 6)));
+        it.skip_to_before(to_pos);
+        const auto expected = last_one_before(bm, to_pos);
+        if (expected == dtl::bitmap::npos) {
+          ASSERT_TRUE(it.end());
+        }
+        else {
+          ASSERT_FALSE(it.end());
+          ASSERT_EQ(expected + 1, it.pos() + it.length());
+          ASSERT_TRUE(bm[it.pos()]);
+        }
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_rev_iter, bitwise_operations) {
+  const std::size_t n = 1ull << 16;
+  for (auto d : {0.01, 0.1, 0.5}) {
+    const auto a = dtl::gen_random_bitmap_markov(n, 8.0, d);
+    const auto b = dtl::gen_random_bitmap_markov(n, 8.0, d);
+    const auto c = dtl::gen_random_bitmap_markov(n, 4.0, 0.1);
+    dtl::teb_wrapper enc_a(a);
+    dtl::teb_wrapper enc_b(b);
+    dtl::teb_wrapper enc_c(c);
+    ASSERT_EQ(a & b, decode_reverse(
+        dtl::bitwise_and_rev_it(enc_a.rev_it(), enc_b.rev_it()), n));
+    ASSERT_EQ(a | b, decode_reverse(
+        dtl::bitwise_or_rev_it(enc_a.rev_it(), enc_b.rev_it()), n));
+    ASSERT_EQ((a | b) & c, decode_reverse(
+        dtl::bitwise_and_rev_it(enc_c.rev_it(),
+            dtl::bitwise_or_rev_it(enc_a.rev_it(), enc_b.rev_it())), n));
+  }
+}
+//===----------------------------------------------------------------------===//
+/// Fetches the k largest positions of an intersection.
+TEST(teb_rev_iter, top_k) {
+  const std::size_t n = 1ull << 16;
+  const std::size_t k = 10;
+  const auto a = dtl::gen_random_bitmap_markov(n, 4.0, 0.1);
+  const auto b = dtl::gen_random_bitmap_markov(n, 4.0, 0.1);
+  const auto expected_bm = a & b;
+  std::vector<std::size_t> expected;
+  for (auto i = last_one_before(expected_bm, n);
+       i != dtl::bitmap::npos && expected.size() < k;
+       i = last_one_before(expected_bm, i)) {
+    expected.push_back(i);
+  }
+
+  dtl::teb_wrapper enc_a(a);
+  dtl::teb_wrapper enc_b(b);
+  auto it = dtl::bitwise_and_rev_it(enc_a.rev_it(), enc_b.rev_it());
+  std::vector<std::size_t> actual;
+  while (!it.end() && actual.size() < k) {
+    for (std::size_t i = it.pos() + it.length();
+         i > it.pos() && actual.size() < k; --i) {
+      actual.push_back(i - 1);
+    }
+    it.prev();
+  }
+  ASSERT_EQ(expected, actual);
+
+  // Skipping on the composed iterator.
+  auto skip_it = dtl::bitwise_and_rev_it(enc_a.rev_it(), enc_b.rev_it());
+  std::mt19937 gen(42);
+  std::size_t to_pos = n;
+  while (!skip_it.end()) {
+    to_pos -= std::min(to_pos, std::size_t(1 + gen() % 1024));
+    skip_it.skip_to_before(to_pos);
+    const auto exp = last_one_before(expected_bm, to_pos);
+    if (exp == dtl::bitmap::npos) {
+      ASSERT_TRUE(skip_it.end());
+    }
+    else {
+      ASSERT_EQ(exp + 1, skip_it.pos() + skip_it.length());
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
@@ -0,0 +1,89 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/util/random.hpp>
+
+#include <thread>
+#include <vector>
+//===----------------------------------------------------------------------===//
+// Tests for the parallel scan of a single TEB, i.e., splitting a TEB into
+// ranges which are scanned independently.
+//===----------------------------------------------------------------------===//
+/// Decodes the 1-fills within the given range and validates that they do not
+/// exceed the range boundaries.
+static void
+decode_range(const dtl::teb_wrapper& enc, const dtl::teb_scan_range& range,
+    dtl::bitmap& dst) {
+  auto it = enc.scan_it(range);
+  while (!it.end()) {
+    EXPECT_GE(it.pos(), range.begin);
+    EXPECT_LE(it.pos() + it.length(), range.end);
+    for (std::size_t i = it.pos(); i < it.pos() + it.length(); ++i) {
+      dst[i] = true;
+    }
+    it.next();
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_scan_split, ranges_cover_the_bitmap) {
+  for (auto n : {2ull, 100ull, 1000ull, 1ull << 16, 100000ull}) {
+    for (auto d : {0.0, 0.001, 0.01, 0.1, 0.5, 0.9, 1.0}) {
+      const auto bm = dtl::gen_random_bitmap_markov(n, 8.0, d);
+      dtl::teb_wrapper enc(bm);
+      for (std::size_t k : {1, 2, 3, 4, 7, 16, 64}) {
+        const auto ranges = enc.split(k);
+        ASSERT_GE(ranges.size(), 1);
+        ASSERT_LE(ranges.size(), k);
+        ASSERT_EQ(ranges.front().begin, 0);
+        ASSERT_EQ(ranges.back().end, n);
+        for (std::size_t i = 1; i < ranges.size(); ++i) {
+          ASSERT_EQ(ranges[i - 1].end, ranges[i].begin);
+          ASSERT_LT(ranges[i].begin, ranges[i].end);
+        }
+        dtl::bitmap dec(n);
+        for (const auto& r : ranges) {
+          decode_range(enc, r, dec);
+        }
+        ASSERT_EQ(bm, dec) << "n=" << n << ", d=" << d << ", k=" << k;
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_scan_split, balanced_ranges) {
+  // A bitmap where the (non-compressible) bits are located in the first
+  // quarter. The ranges should not be split evenly by position.
+  const std::size_t n = 1ull << 20;
+  const auto head = dtl::gen_random_bitmap_markov(n / 4, 4.0, 0.5);
+  dtl::bitmap bm(n);
+  for (std::size_t i = 0; i < n / 4; ++i) bm[i] = head[i];
+  dtl::teb_wrapper enc(bm);
+  const std::size_t k = 4;
+  const auto ranges = enc.split(k);
+  ASSERT_EQ(ranges.size(), k);
+  // All but the last range are located within the first quarter.
+  ASSERT_LE(ranges[k - 2].end, n / 4);
+  dtl::bitmap dec(n);
+  for (const auto& r : ranges) {
+    decode_range(enc, r, dec);
+  }
+  ASSERT_EQ(bm, dec);
+}
+//===----------------------------------------------------------------------===//
+TEST(teb_scan_split, parallel_scan) {
+  const std::size_t n = 1ull << 20;
+  const auto bm = dtl::gen_random_bitmap_markov(n, 8.0, 0.1);
+  dtl::teb_wrapper enc(bm);
+  const auto ranges = enc.split(4);
+  std::vector<dtl::bitmap> results(ranges.size(), dtl::bitmap(n));
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < ranges.size(); ++i) {
+    threads.emplace_back([&, i]() { decode_range(enc, ranges[i], results[i]); });
+  }
+  for (auto& t : threads) t.join();
+  dtl::bitmap dec(n);
+  for (const auto& r : results) dec |= r;
+  ASSERT_EQ(bm, dec);
+}
+//===----------------------------------------------------------------------===//
@@ -0,0 +1,86 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap/util/bit_compact.hpp>
+#include <dtl/dtl.hpp>
+
+#include <random>
+#include <vector>
+//===----------------------------------------------------------------------===//
+/// Reference implementation of _pext_u64(w, 0x5555555555555555).
+static $u32
+compact_even_bits_naive(u64 w) {
+  $u32 ret = 0;
+  for (std::size_t i = 0; i < 32; ++i) {
+    ret |= static_cast<$u32>((w >> (2 * i)) & 1) << i;
+  }
+  return ret;
+}
+//===----------------------------------------------------------------------===//
+static std::vector<$u64>
+gen_words(std::size_t cnt) {
+  std::mt19937_64 gen(42);
+  std::vector<$u64> words(cnt);
+  for (auto& w : words) w = gen();
+  words[0] = 0;
+  words[1] = ~0ull;
+  words[2] = 0x5555555555555555ull;
+  words[3] = 0xAAAAAAAAAAAAAAAAull;
+  return words;
+}
+//===----------------------------------------------------------------------===//
+TEST(bit_compact,
+    compact_and_spread) {
+  using bc = dtl::bit_compact;
+  const auto words = gen_words(10000);
+  for (auto w : words) {
+    ASSERT_EQ(bc::compact_even_bits(w), compact_even_bits_naive(w));
+    // Round trip.
+    u32 c = compact_even_bits_naive(w);
+    ASSERT_EQ(bc::spread_even_bits(c), w & 0x5555555555555555ull);
+    ASSERT_EQ(bc::compact_even_bits(bc::spread_even_bits(c)), c);
+  }
+}
+//===----------------------------------------------------------------------===//
+template<typename op>
+void
+validate_batch(void (*fn)(const $u64*, const $u64*, $u32*)) {
+  // Odd word count to cover the scalar tail of the SIMD implementations.
+  const auto words = gen_words(1003);
+  for (std::size_t cnt : {0ul, 1ul, 3ul, 4ul, 7ul, 8ul, 17ul, words.size()}) {
+    std::vector<$u32> dst(cnt + 1, 0xDEADBEEF);
+    fn(words.data(), words.data() + cnt, dst.data());
+    for (std::size_t i = 0; i < cnt; ++i) {
+      ASSERT_EQ(dst[i], compact_even_bits_naive(op::apply(words[i])))
+          << "cnt=" << cnt << ", i=" << i;
+    }
+    // Make sure, we do not write past the end.
+    ASSERT_EQ(dst[cnt], 0xDEADBEEF);
+  }
+}
+//===----------------------------------------------------------------------===//
+template<typename op>
+void
+validate_all_batch_variants() {
+  using bc = dtl::bit_compact;
+  validate_batch<op>(bc::compact_even_bits<op>);
+  validate_batch<op>(bc::compact_even_bits_x86<op>);
+#ifdef __AVX2__
+  validate_batch<op>(bc::compact_even_bits_avx2<op>);
+#endif
+#ifdef __AVX512BW__
+  validate_batch<op>(bc::compact_even_bits_avx512<op>);
+#endif
+#if defined(__AVX512BW__) && defined(__GFNI__)
+  validate_batch<op>(bc::compact_even_bits_avx512_gfni<op>);
+#endif
+}
+//===----------------------------------------------------------------------===//
+TEST(bit_compact,
+    batch_compaction) {
+  using bc = dtl::bit_compact;
+  validate_all_batch_variants<bc::pair_first>();
+  validate_all_batch_variants<bc::pair_or>();
+  validate_all_batch_variants<bc::pair_xor>();
+  validate_all_batch_variants<bc::pair_nor>();
+}
+//===----------------------------------------------------------------------===//
@@ -397,3 +397,18 @@ TEST(bitmap_fun,
   ASSERT_EQ(2, bm.find_next_zero(0, bm.size()));
 }
 //===----------------------------------------------------------------------===//
+TEST(bitmap_fun, run_to_positions) {
+  std::vector<$u32> positions(100, 0);
+  for (std::size_t cnt = 0; cnt < 64; ++cnt) {
+    std::fill(positions.begin(), positions.end(), 0);
+    dtl::bitmap_fun<$u64>::run_to_positions(42, cnt, positions.data());
+    for (std::size_t i = 0; i < cnt; ++i) {
+      ASSERT_EQ(42 + i, positions[i]) << "cnt=" << cnt;
+    }
+    // No writes beyond the run.
+    for (std::size_t i = cnt; i < positions.size(); ++i) {
+      ASSERT_EQ(0, positions[i]) << "cnt=" << cnt;
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+
+#include <dtl/bitmap.hpp>
+#include <dtl/bitmap/bah.hpp>
+#include <dtl/bitmap/bbc.hpp>
+#include <dtl/bitmap/concise.hpp>
+#include <dtl/bitmap/dynamic_bitmap.hpp>
+#include <dtl/bitmap/dynamic_roaring_bitmap.hpp>
+#include <dtl/bitmap/position_list.hpp>
+#include <dtl/bitmap/range_list.hpp>
+#include <dtl/bitmap/teb_wrapper.hpp>
+#include <dtl/bitmap/uah.hpp>
+#include <dtl/bitmap/util/random.hpp>
+#include <dtl/bitmap/util/size_estimator.hpp>
+#include <dtl/bitmap/xah.hpp>
+#include <dtl/dtl.hpp>
+
+#include <cmath>
+//===----------------------------------------------------------------------===//
+// Tests for the size estimator.
+//===----------------------------------------------------------------------===//
+template<typename T>
+static std::size_t
+actual_size(const dtl::bitmap& bm) {
+  T enc(bm);
+  return enc.size_in_bytes();
+}
+//===----------------------------------------------------------------------===//
+TEST(size_estimator, statistics) {
+  dtl::bitmap bm(1000);
+  for (std::size_t i = 10; i < 20; ++i) bm[i] = true;
+  bm[31] = true;
+  bm[32] = true;
+  bm[999] = true;
+  dtl::size_estimator est(bm);
+  ASSERT_FALSE(est.is_sampled());
+  ASSERT_EQ(est.size(), 1000);
+  ASSERT_EQ(est.pop_count(), 13);
+  ASSERT_EQ(est.run_count(), 3);
+}
+//===----------------------------------------------------------------------===//
+TEST(size_estimator, exact_estimates) {
+  for (std::size_t n : {100ull, 1000ull, 1ull << 16, 100000ull, 1ull << 18}) {
+    for (auto d : {0.0, 0.001, 0.01, 0.1, 0.5, 0.9, 1.0}) {
+      for (auto f : {1.0, 8.0, 64.0}) {
+        if (d > 0.0 && d < 1.0 && d / (1.0 - d) > f) {
+          continue; // infeasible combination
+        }
+        const auto bm = dtl::gen_random_bitmap_markov(n, f, d);
+        const dtl::size_estimator est(bm);
+        const auto info = "n=" + std::to_string(n)
+            + ", d=" + std::to_string(d) + ", f=" + std::to_string(f);
+        ASSERT_EQ(est.position_list().size_in_bytes,
+            actual_size<dtl::position_list<$u32>>(bm)) << info;
+        ASSERT_EQ(est.range_list().size_in_bytes,
+            actual_size<dtl::range_list<$u32>>(bm)) << info;
+        ASSERT_EQ(est.plain().size_in_bytes,
+            actual_size<dtl::dynamic_bitmap<$u32>>(bm)) << info;
+        ASSERT_EQ(est.roaring().size_in_bytes,
+            actual_size<dtl::dynamic_roaring_bitmap>(bm)) << info;
+        ASSERT_EQ(est.uah(8).size_in_bytes, actual_size<dtl::uah8>(bm)) << info;
+        ASSERT_EQ(est.uah(16).size_in_bytes, actual_size<dtl::uah16>(bm)) << info;
+        ASSERT_EQ(est.uah(32).size_in_bytes, actual_size<dtl::uah32>(bm)) << info;
+        ASSERT_EQ(est.uah(64).size_in_bytes, actual_size<dtl::uah64>(bm)) << info;
+        ASSERT_EQ(est.xah(8).size_in_bytes, actual_size<dtl::xah8>(bm)) << info;
+        ASSERT_EQ(est.xah(16).size_in_bytes, actual_size<dtl::xah16>(bm)) << info;
+        ASSERT_EQ(est.xah(32).size_in_bytes, actual_size<dtl::xah32>(bm)) << info;
+        ASSERT_EQ(est.xah(64).size_in_bytes, actual_size<dtl::xah64>(bm)) << info;
+        ASSERT_EQ(est.bbc().size_in_bytes, actual_size<dtl::bbc>(bm)) << info;
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(size_estimator, concise_estimate) {
+  // Note: The bitmaps must not contain long 1-runs, which trigger a (known)
+  // assertion in the CONCISE encoder.
+  for (std::size_t n : {100ull, 1000ull, 1ull << 16, 100000ull}) {
+    for (auto d : {0.0, 0.001, 0.01, 0.1, 0.5}) {
+      const auto bm = dtl::gen_random_bitmap_markov(n, 1.5, d);
+      const dtl::size_estimator est(bm);
+      ASSERT_EQ(est.concise().size_in_bytes, actual_size<dtl::concise>(bm))
+          << "n=" << n << ", d=" << d;
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(size_estimator, approximate_estimates) {
+  auto rel_err = [](f64 estimated, f64 actual) {
+    return std::abs(estimated - actual) / actual;
+  };
+  for (std::size_t n : {1ull << 12, 100000ull, 1ull << 20}) {
+    for (auto d : {0.001, 0.01, 0.1, 0.5}) {
+      for (auto f : {1.5, 8.0, 64.0}) {
+        const auto bm = dtl::gen_random_bitmap_markov(n, f, d);
+        const dtl::size_estimator est(bm);
+        const auto info = "n=" + std::to_string(n)
+            + ", d=" + std::to_string(d) + ", f=" + std::to_string(f);
+        // The TEB estimate ignores the space optimizations and therefore
+        // tends to overestimate the size.
+        ASSERT_LT(rel_err(est.teb().size_in_bytes,
+            actual_size<dtl::teb_wrapper>(bm)), 0.35) << info;
+        // BAH is estimated by encoding each block separately, which adds
+        // a constant overhead per block.
+        const auto block_cnt = (n + est.block_bitlength - 1)
+            / est.block_bitlength;
+        const f64 bah_actual = actual_size<dtl::bah>(bm);
+        ASSERT_LE(std::abs(est.sampled<dtl::bah>().size_in_bytes - bah_actual),
+            0.05 * bah_actual + 64 * block_cnt) << info;
+      }
+    }
+  }
+}
+//===----------------------------------------------------------------------===//
+TEST(size_estimator, sampling) {
+  const std::size_t n = 1ull << 22;
+  for (auto d : {0.01, 0.1, 0.5}) {
+    const auto bm = dtl::gen_random_bitmap_markov(n, 8.0, d);
+    const dtl::size_estimator exact(bm);
+    const dtl::size_estimator sampled(bm, 1ull << 20, 16);
+    ASSERT_FALSE(exact.is_sampled());
+    ASSERT_TRUE(sampled.is_sampled());
+    auto rel_err = [](f64 estimated, f64 actual) {
+      return std::abs(estimated - actual) / actual;
+    };
+    ASSERT_LT(rel_err(sampled.pop_count(), exact.pop_count()), 0.1) << d;
+    ASSERT_LT(rel_err(sampled.run_count(), exact.run_count()), 0.1) << d;
+    ASSERT_LT(rel_err(sampled.roaring().size_in_bytes,
+        exact.roaring().size_in_bytes), 0.1) << d;
+    ASSERT_LT(rel_err(sampled.uah(8).size_in_bytes,
+        exact.uah(8).size_in_bytes), 0.1) << d;
+    ASSERT_LT(rel_err(sampled.teb().size_in_bytes,
+        exact.teb().size_in_bytes), 0.1) << d;
+  }
+}
+//===----------------------------------------------------------------------===//